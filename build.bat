@@ -16,9 +16,20 @@ cl %compiler_options% ../src/game/game.cpp -DPP_EDITOR -LD /link %linker_options
 
 cl %compiler_options% -Fe:engine22.exe -MP ../src/main.cpp ../src/core/platform/win32_platform.cpp  -Fm:wild.map /link %linker_options% user32.lib sdl2.lib sdl2main.lib soloud.lib vulkan-1.lib -SUBSYSTEM:CONSOLE 
 
+cl %compiler_options% -Fe:texture_cooker.exe ../src/tools/texture_cooker.cpp /link %linker_options% -SUBSYSTEM:CONSOLE
+
 popd
 
+if not exist data\textures\chalet.ptex build\texture_cooker.exe data\textures\chalet.jpg data\textures\chalet.ptex bc7
+
 pushd data\shaders
 %VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/main.vert
 %VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/main.frag
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/main_bindless.frag -o bindless.frag.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/main_instanced.vert -o instanced.vert.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/main_instanced_bindless.frag -o instanced_bindless.frag.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/cull.comp -o cull.comp.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/meshlet_cull.comp -o meshlet_cull.comp.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/imgui.vert -o imgui.vert.spv
+%VULKAN_SDK%\Bin32\glslangValidator.exe -V ../../src/shaders/imgui.frag -o imgui.frag.spv
 popd
\ No newline at end of file
@@ -0,0 +1,36 @@
+#!/bin/bash
+# NOTE: linux build, expects SDL2, the vulkan loader and glslangValidator installed and libsoloud in deps/lib/x64/linux
+# deps/include is searched after the system headers so the system SDL2 wins over the windows one in deps, and like
+# the system headers the third party code in it doesn't warn
+compiler_options="-std=c++14 -g -O0 -msse2 -fno-rtti -Wall -Wextra -Wno-unused-parameter -D_CRT_SECURE_NO_WARNINGS -I../src -idirafter ../deps/include"
+linker_options="-L../deps/lib/x64/linux -Wl,-rpath,\$ORIGIN"
+
+mkdir -p build
+
+pushd build > /dev/null
+
+cp ../deps/lib/x64/linux/*.so . 2> /dev/null
+
+g++ $compiler_options -DPP_EDITOR -shared -fPIC ../src/game/game.cpp -o libgame.so $linker_options
+
+g++ $compiler_options -o engine22 ../src/main.cpp ../src/core/platform/linux_platform.cpp $linker_options -lSDL2 -lsoloud -lvulkan -ldl -lpthread
+
+g++ $compiler_options -o texture_cooker ../src/tools/texture_cooker.cpp $linker_options -lm
+
+g++ $compiler_options -o gpu_memory_test ../src/tests/gpu_memory_test.cpp ../src/core/platform/linux_platform.cpp $linker_options -lSDL2 -lvulkan -ldl -lpthread
+
+popd > /dev/null
+
+if [ ! -f data/textures/chalet.ptex ]; then build/texture_cooker data/textures/chalet.jpg data/textures/chalet.ptex bc7; fi
+
+pushd data/shaders > /dev/null
+glslangValidator -V ../../src/shaders/main.vert
+glslangValidator -V ../../src/shaders/main.frag
+glslangValidator -V ../../src/shaders/main_bindless.frag -o bindless.frag.spv
+glslangValidator -V ../../src/shaders/main_instanced.vert -o instanced.vert.spv
+glslangValidator -V ../../src/shaders/main_instanced_bindless.frag -o instanced_bindless.frag.spv
+glslangValidator -V ../../src/shaders/cull.comp -o cull.comp.spv
+glslangValidator -V ../../src/shaders/meshlet_cull.comp -o meshlet_cull.comp.spv
+glslangValidator -V ../../src/shaders/imgui.vert -o imgui.vert.spv
+glslangValidator -V ../../src/shaders/imgui.frag -o imgui.frag.spv
+popd > /dev/null
@@ -36,18 +36,29 @@ enum class Key {
 };
 
 typedef void (TextInputFunc)(const char *);
+typedef int (ThreadFunc)(void *);
+
+struct PlatformThread {
+	void *handle;
+};
+
+struct PlatformSemaphore {
+	void *handle;
+};
 
 struct Platform {
 	TextInputFunc *on_text_input;
 	
-	virtual bool init();
+	virtual bool init(bool headless = false);
 	virtual void uninit();
 
 	virtual void copyFile(char *a, char *b);
 	virtual FileTime getLastWriteTime(char *file);
 	virtual u32 compareFileTime(FileTime *a, FileTime *b);
+	virtual s32 runCommand(const char *command); // NOTE: blocks until it exits, returns its exit code or -1 if it couldn't start
 	
 	virtual void getDirectoryContents();
+	virtual bool fileExists(const char *filename);
 	virtual FileData readEntireFile(const char *filename);
 	virtual void writeStructureToFile(const char *filename, void *structure, s32 size);
 	virtual void *openFileForWriting(const char *filename);
@@ -58,7 +69,7 @@ struct Platform {
 	virtual void free(void *data);
 	
 	// NOTE(nathan): an error message box
-	virtual void error(char *err);
+	virtual void error(const char *err);
 		
 	virtual PlatformWindow createWindow(const char *title, u32 width, u32 height, bool centerd, bool resizable);
 	virtual void destroyWindow(PlatformWindow *window);
@@ -69,6 +80,15 @@ struct Platform {
 	virtual void setWindowTitle(PlatformWindow *window, const char *title);
 	
 	virtual void sleepMS(u32 ms);
+	virtual void sleepMicroseconds(u64 microseconds); // NOTE: high resolution timer wait, per os since SDL_Delay is millisecond granular
+	
+	virtual PlatformThread createThread(ThreadFunc *func, const char *name, void *data);
+	virtual void waitThread(PlatformThread *thread);
+	virtual PlatformSemaphore createSemaphore(u32 initial_value);
+	virtual void destroySemaphore(PlatformSemaphore *semaphore);
+	virtual void signalSemaphore(PlatformSemaphore *semaphore);
+	virtual void waitSemaphore(PlatformSemaphore *semaphore);
+	virtual u32 getProcessorCount();
 	
 	virtual void *loadLibrary(const char *name);
 	virtual void unloadLibrary(void *library);
@@ -0,0 +1,64 @@
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <core/platform/sdl_platform.cpp>
+
+void Platform::copyFile(char *a, char *b) {
+	FILE *source = fopen(a, "rb");
+	if(source == 0) return;
+	
+	FILE *dest = fopen(b, "wb");
+	if(dest == 0) {
+		fclose(source);
+		return;
+	}
+	
+	char buffer[64 * 1024];
+	size_t read_size;
+	while((read_size = fread(buffer, 1, sizeof(buffer), source)) > 0) {
+		fwrite(buffer, 1, read_size, dest);
+	}
+	
+	fclose(dest);
+	fclose(source);
+}
+
+FileTime Platform::getLastWriteTime(char *filename) {
+	FileTime last_write_time = {};
+	struct stat file_stat;
+	if(stat(filename, &file_stat) == 0) {
+		u64 nanoseconds = (u64)file_stat.st_mtim.tv_sec * 1000000000ull + (u64)file_stat.st_mtim.tv_nsec;
+		last_write_time.low_date_time = (u32)(nanoseconds & 0xffffffff);
+		last_write_time.high_date_time = (u32)(nanoseconds >> 32);
+	}
+	
+	return last_write_time;
+}
+
+// NOTE: same contract as CompareFileTime, -1 if a is older, 0 if equal, 1 if newer
+u32 Platform::compareFileTime(FileTime *a, FileTime *b) {
+	u64 f = ((u64)a->high_date_time << 32) | a->low_date_time;
+	u64 g = ((u64)b->high_date_time << 32) | b->low_date_time;
+	if(f < g) return (u32)-1;
+	if(f > g) return 1;
+	return 0;
+}
+
+// NOTE: runs through /bin/sh
+s32 Platform::runCommand(const char *command) {
+	int status = system(command);
+	if(status == -1 || !WIFEXITED(status)) return -1;
+	return WEXITSTATUS(status);
+}
+
+// NOTE: absolute deadline on the monotonic clock so a signal interrupting the sleep doesn't stretch it
+void Platform::sleepMicroseconds(u64 microseconds) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	u64 nanoseconds = (u64)deadline.tv_nsec + microseconds * 1000ull;
+	deadline.tv_sec += (time_t)(nanoseconds / 1000000000ull);
+	deadline.tv_nsec = (long)(nanoseconds % 1000000000ull);
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, 0) == EINTR) {}
+}
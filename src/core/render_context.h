@@ -74,8 +74,8 @@ struct RenderContext {
 		MAX
 	};
 	
-	static u32 format_values[Format::MAX];
-	static u32 format_sizes[Format::MAX];
+	static u32 format_values[(u32)Format::MAX];
+	static u32 format_sizes[(u32)Format::MAX];
 	
 	struct LayoutElement {
 		char *name;
@@ -89,7 +89,7 @@ struct RenderContext {
 		MAX
 	};
 	
-	static u32 topologies[Topology::MAX];
+	static u32 topologies[(u32)Topology::MAX];
 	
 	enum class BufferType {
 		Vertex,
@@ -97,67 +97,67 @@ struct RenderContext {
 		MAX
 	};
 	
-	static u32 buffer_types[BufferType::MAX];
+	static u32 buffer_types[(u32)BufferType::MAX];
 	
-	virtual void setClipRect(s32 x, s32 y, s32 w, s32 h);
-	virtual void setViewport(s32 width, s32 height, f32 min_depth, f32 max_depth);
-	virtual void resizeBuffer(s32 width, s32 height);
-	virtual void init(s32 width, s32 height, s32 refresh_rate, PlatformWindow *window);
-	virtual void uninit();
-	virtual void clear(float color[4]);
-	virtual void present();
-	virtual void bindDefaultTextures();
+	virtual void setClipRect(s32 x, s32 y, s32 w, s32 h) = 0;
+	virtual void setViewport(s32 width, s32 height, f32 min_depth, f32 max_depth) = 0;
+	virtual void resizeBuffer(s32 width, s32 height) = 0;
+	virtual void init(s32 width, s32 height, s32 refresh_rate, PlatformWindow *window) = 0;
+	virtual void uninit() = 0;
+	virtual void clear(float color[4]) = 0;
+	virtual void present() = 0;
+	virtual void bindDefaultTextures() = 0;
 	
 	
-	virtual Texture2D createTexture2D(void *data, u32 width, u32 height, Format format, bool render_texture = false, bool depth = false);
-	virtual void bindTexture2D(Texture2D *texture, u32 slot);
-	virtual void destroyTexture2D(Texture2D *texture);
+	virtual Texture2D createTexture2D(void *data, u32 width, u32 height, Format format, bool render_texture = false, bool depth = false) = 0;
+	virtual void bindTexture2D(Texture2D *texture, u32 slot) = 0;
+	virtual void destroyTexture2D(Texture2D *texture) = 0;
 	
-	virtual RenderTexture createRenderTexture(u32 width, u32 height, Format format);
-	virtual DepthStencilTexture createDepthStencilTexture(u32 width, u32 height);
-	virtual void bindRenderTextures(Platform *platform, RenderTexture **rts, u32 count, DepthStencilTexture *dst);
-	virtual void clearRenderTexture(RenderTexture *rt, float color[4]);
-	virtual void clearDepthStencilTexture(DepthStencilTexture *dst, float value);
+	virtual RenderTexture createRenderTexture(u32 width, u32 height, Format format) = 0;
+	virtual DepthStencilTexture createDepthStencilTexture(u32 width, u32 height) = 0;
+	virtual void bindRenderTextures(Platform *platform, RenderTexture **rts, u32 count, DepthStencilTexture *dst) = 0;
+	virtual void clearRenderTexture(RenderTexture *rt, float color[4]) = 0;
+	virtual void clearDepthStencilTexture(DepthStencilTexture *dst, float value) = 0;
 	
-	virtual Sampler createSampler();
-	virtual void bindSampler(Sampler *sampler, u32 slot);
-	virtual void destroySampler(Sampler *sampler);
+	virtual Sampler createSampler() = 0;
+	virtual void bindSampler(Sampler *sampler, u32 slot) = 0;
+	virtual void destroySampler(Sampler *sampler) = 0;
 	
-	virtual Shader createShader(Platform *platform, const std::string &name);
-	virtual void destroyShader(Shader *shader);
-	virtual void bindShader(Shader *shader);
-	virtual void unbindShader();
+	virtual Shader createShader(Platform *platform, const std::string &name) = 0;
+	virtual void destroyShader(Shader *shader) = 0;
+	virtual void bindShader(Shader *shader) = 0;
+	virtual void unbindShader() = 0;
 	
-	virtual ShaderLayout createShaderLayout(RenderContext::LayoutElement *elements, u32 count, Shader *shader, bool inc_input_slot = false, bool inc_byte_stride = true);
-	virtual void bindShaderLayout(ShaderLayout *constant);
+	virtual ShaderLayout createShaderLayout(RenderContext::LayoutElement *elements, u32 count, Shader *shader, bool inc_input_slot = false, bool inc_byte_stride = true) = 0;
+	virtual void bindShaderLayout(ShaderLayout *constant) = 0;
 	
-	virtual ShaderConstant createShaderConstant(u32 buffer_size);
-	virtual void updateShaderConstant(ShaderConstant *constant, void *data);
-	virtual void bindShaderConstant(ShaderConstant *constant, s32 vs_loc, s32 ps_loc);
+	virtual ShaderConstant createShaderConstant(u32 buffer_size) = 0;
+	virtual void updateShaderConstant(ShaderConstant *constant, void *data) = 0;
+	virtual void bindShaderConstant(ShaderConstant *constant, s32 vs_loc, s32 ps_loc) = 0;
 	
-	virtual VertexBuffer createVertexBuffer(void *vertices, u32 vertex_size, u32 num_vertices, BufferType type = BufferType::Vertex);
-	virtual void destroyVertexBuffer(VertexBuffer *vb);
-	virtual void bindVertexBuffer(VertexBuffer *vb, u32 slot);
-	virtual void bindIndexBuffer(VertexBuffer *vb, Format format);
+	virtual VertexBuffer createVertexBuffer(void *vertices, u32 vertex_size, u32 num_vertices, BufferType type = BufferType::Vertex) = 0;
+	virtual void destroyVertexBuffer(VertexBuffer *vb) = 0;
+	virtual void bindVertexBuffer(VertexBuffer *vb, u32 slot) = 0;
+	virtual void bindIndexBuffer(VertexBuffer *vb, Format format) = 0;
 	
-	virtual RasterState createRasterState(bool scissor_enabled, bool depth_enabled);
-	virtual void bindRasterState(RasterState *state);
-	virtual void destroyRasterState(RasterState *state);
+	virtual RasterState createRasterState(bool scissor_enabled, bool depth_enabled) = 0;
+	virtual void bindRasterState(RasterState *state) = 0;
+	virtual void destroyRasterState(RasterState *state) = 0;
 	
-	virtual BlendState createBlendState();
-	virtual void bindBlendState(BlendState *state, const float factor[4], u32 mask);
-	virtual void destroyBlendState(BlendState *state);
+	virtual BlendState createBlendState() = 0;
+	virtual void bindBlendState(BlendState *state, const float factor[4], u32 mask) = 0;
+	virtual void destroyBlendState(BlendState *state) = 0;
 	
-	virtual DepthStencilState createDepthStencilState();
-	virtual void bindDepthStencilState(DepthStencilState *state);
-	virtual void destroyDepthStencilState(DepthStencilState *state);
+	virtual DepthStencilState createDepthStencilState() = 0;
+	virtual void bindDepthStencilState(DepthStencilState *state) = 0;
+	virtual void destroyDepthStencilState(DepthStencilState *state) = 0;
 
-	virtual PlatformRenderState *saveRenderState();
-	virtual void reloadRenderState(PlatformRenderState *state);
-	virtual void destroyRenderState(PlatformRenderState *state);
+	virtual PlatformRenderState *saveRenderState() = 0;
+	virtual void reloadRenderState(PlatformRenderState *state) = 0;
+	virtual void destroyRenderState(PlatformRenderState *state) = 0;
 	
-	virtual void sendDraw(Topology topology, u32 num_vertices);
-	virtual void sendDrawIndexed(Topology topology, u32 num_indices, int vertex_offset = 0, int index_offset = 0);
+	virtual void sendDraw(Topology topology, u32 num_vertices) = 0;
+	virtual void sendDrawIndexed(Topology topology, u32 num_indices, int vertex_offset = 0, int index_offset = 0) = 0;
 };
 
 #endif // RENDER_CONTEXT_H
\ No newline at end of file
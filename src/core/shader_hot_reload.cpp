@@ -0,0 +1,121 @@
+#include <core/platform.h>
+
+#define SHADER_RELOAD_MAX_SHADERS 16
+#define SHADER_RELOAD_POLL_INTERVAL 0.25f // NOTE: seconds between checking the sources' write times
+
+#ifdef _WIN32
+#define SHADER_COMPILER "%VULKAN_SDK%\\Bin32\\glslangValidator.exe"
+#else
+#define SHADER_COMPILER "glslangValidator"
+#endif
+
+struct WatchedShader {
+	char source_path[256]; // NOTE: the GLSL, the compiler picks the stage from its extension
+	char output_path[256]; // NOTE: the SPIR-V the renderer loads
+	FileTime last_write_time;
+	u64 source_hash; // NOTE: of the source output_path was last built from
+	bool changed; // NOTE: output_path was replaced by the last poll
+};
+
+internal_func u64 hashShaderSource(const char *source, u64 size) {
+	u64 hash = 14695981039346656037ull;
+	for(u64 i = 0; i < size; i++) {
+		hash ^= (u8)source[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// NOTE: Polls the GLSL sources for writes. A written source whose contents actually changed is compiled with
+// glslangValidator, the same as the build scripts, into a cache named after the hash of its contents, so flipping
+// between edits or reverting one copies the SPIR-V from the cache instead of compiling again. The result replaces the
+// .spv the renderer loads, and the caller rebuilds whatever uses it. Shaders with #includes would need those hashed too,
+// none of ours have any.
+struct ShaderHotReloader {
+	WatchedShader shaders[SHADER_RELOAD_MAX_SHADERS];
+	u32 shader_count;
+	char cache_prefix[512];
+	u64 last_poll;
+
+	void init(Platform *platform) {
+		shader_count = 0;
+		last_poll = platform->getPerformanceCounter();
+		snprintf(cache_prefix, sizeof(cache_prefix), "%sshader_cache_", platform->getExePath());
+	}
+
+	// NOTE: a missing source, e.g. running without the src directory, never reports a write and is never compiled
+	void watch(Platform *platform, const char *source_path, const char *output_path) {
+		if(shader_count == SHADER_RELOAD_MAX_SHADERS) {
+			platform->error("Too many shaders to watch");
+			return;
+		}
+		WatchedShader *shader = &shaders[shader_count++];
+		*shader = {};
+		snprintf(shader->source_path, sizeof(shader->source_path), "%s", source_path);
+		snprintf(shader->output_path, sizeof(shader->output_path), "%s", output_path);
+		shader->last_write_time = platform->getLastWriteTime(shader->source_path);
+		if(platform->fileExists(shader->source_path)) {
+			FileData source = platform->readEntireFile(shader->source_path);
+			shader->source_hash = hashShaderSource(source.contents, source.size);
+			platform->free(source.contents);
+		}
+	}
+
+	bool changed(const char *output_path) {
+		for(u32 i = 0; i < shader_count; i++) {
+			if(shaders[i].changed && strcmp(shaders[i].output_path, output_path) == 0) return true;
+		}
+		return false;
+	}
+
+	// NOTE: true if any output was replaced, check which with changed
+	bool poll(Platform *platform) {
+		for(u32 i = 0; i < shader_count; i++) shaders[i].changed = false;
+
+		u64 now = platform->getPerformanceCounter();
+		if((f32)(now - last_poll) / (f32)platform->getPerformanceFrequency() < SHADER_RELOAD_POLL_INTERVAL) return false;
+		last_poll = now;
+
+		bool result = false;
+		for(u32 i = 0; i < shader_count; i++) {
+			WatchedShader *shader = &shaders[i];
+			FileTime write_time = platform->getLastWriteTime(shader->source_path);
+			if(platform->compareFileTime(&write_time, &shader->last_write_time) == 0) continue;
+			shader->last_write_time = write_time;
+			if(rebuild(platform, shader)) result = true;
+		}
+		return result;
+	}
+
+	bool rebuild(Platform *platform, WatchedShader *shader) {
+		if(!platform->fileExists(shader->source_path)) return false;
+		FileData source = platform->readEntireFile(shader->source_path);
+		u64 hash = hashShaderSource(source.contents, source.size);
+		platform->free(source.contents);
+		// NOTE: saved without edits
+		if(hash == shader->source_hash) return false;
+
+		const char *extension = strrchr(shader->source_path, '.');
+		char cache_path[600];
+		snprintf(cache_path, sizeof(cache_path), "%s%016llx%s.spv", cache_prefix, (unsigned long long)hash, extension ? extension : "");
+
+		u64 start = platform->getPerformanceCounter();
+		bool from_cache = platform->fileExists(cache_path);
+		if(!from_cache) {
+			char command[1600];
+			snprintf(command, sizeof(command), SHADER_COMPILER " -V \"%s\" -o \"%s\"", shader->source_path, cache_path);
+			if(platform->runCommand(command) != 0) {
+				// NOTE: keeps source_hash, so reverting to what's loaded is a no-op and the next edit compiles again
+				printf("Shader %s failed to compile, keeping the old one\n", shader->source_path);
+				return false;
+			}
+		}
+
+		platform->copyFile(cache_path, shader->output_path);
+		shader->source_hash = hash;
+		shader->changed = true;
+		f32 ms = (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f;
+		printf("Shader %s %s in %.3fms\n", shader->source_path, from_cache ? "taken from the cache" : "compiled", ms);
+		return true;
+	}
+};
@@ -0,0 +1,133 @@
+#define BINDLESS_MAX_TEXTURES 4096
+#define BINDLESS_INVALID_SLOT 0xffffffff
+
+// NOTE: one large update-after-bind array of combined image samplers. It's bound once per command buffer and
+// draws pick their texture with a push constant index, so switching material never rebinds a descriptor set.
+struct BindlessTextureTable {
+	VkDevice device;
+	VkDescriptorSetLayout layout;
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+	u32 capacity;
+	u32 next_slot;
+	u32 *free_slots;
+	u32 free_count;
+
+	void init(Platform *platform, VkPhysicalDevice physical_device, VkDevice device, u32 max_textures) {
+		this->device = device;
+
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_props = {};
+		indexing_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2 device_props = {};
+		device_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		device_props.pNext = &indexing_props;
+		vkGetPhysicalDeviceProperties2(physical_device, &device_props);
+
+		capacity = max_textures;
+		if(capacity > indexing_props.maxDescriptorSetUpdateAfterBindSampledImages) capacity = indexing_props.maxDescriptorSetUpdateAfterBindSampledImages;
+		if(capacity > indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages) capacity = indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages;
+		if(capacity > indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers) capacity = indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers;
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = capacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		// NOTE: partially bound so empty slots are fine, update after bind so new textures can be added while older frames are in flight
+		VkDescriptorBindingFlagsEXT binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info = {};
+		binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		binding_flags_info.bindingCount = 1;
+		binding_flags_info.pBindingFlags = &binding_flags;
+
+		VkDescriptorSetLayoutCreateInfo layout_info = {};
+		layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_info.pNext = &binding_flags_info;
+		layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		layout_info.bindingCount = 1;
+		layout_info.pBindings = &binding;
+
+		if(vkCreateDescriptorSetLayout(device, &layout_info, 0, &layout) != VK_SUCCESS) {
+			platform->error("Couldn't create bindless descriptor set layout");
+		}
+
+		VkDescriptorPoolSize pool_size = {};
+		pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		pool_size.descriptorCount = capacity;
+
+		VkDescriptorPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &pool_size;
+		pool_info.maxSets = 1;
+
+		if(vkCreateDescriptorPool(device, &pool_info, 0, &pool) != VK_SUCCESS) {
+			platform->error("Couldn't create bindless descriptor pool");
+		}
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+
+		if(vkAllocateDescriptorSets(device, &alloc_info, &set) != VK_SUCCESS) {
+			platform->error("Couldn't allocate bindless descriptor set");
+		}
+
+		next_slot = 0;
+		free_count = 0;
+		free_slots = (u32 *)platform->alloc(sizeof(u32) * capacity);
+
+		printf("Bindless texture table: %u slots\n", capacity);
+	}
+
+	// NOTE: returns the index the shader samples with, BINDLESS_INVALID_SLOT once the table is full
+	u32 add(VkImageView view, VkSampler sampler) {
+		u32 slot;
+		if(free_count > 0) {
+			slot = free_slots[--free_count];
+		} else if(next_slot < capacity) {
+			slot = next_slot++;
+		} else {
+			return BINDLESS_INVALID_SLOT;
+		}
+
+		VkDescriptorImageInfo image_info = {};
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_info.imageView = view;
+		image_info.sampler = sampler;
+
+		VkWriteDescriptorSet write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = 0;
+		write.dstArrayElement = slot;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &image_info;
+		vkUpdateDescriptorSets(device, 1, &write, 0, 0);
+
+		return slot;
+	}
+
+	static void releaseSlot(void *data, u32 slot) {
+		BindlessTextureTable *table = (BindlessTextureTable *)data;
+		table->free_slots[table->free_count++] = slot;
+	}
+
+	// NOTE: the slot goes back on the free list when the given frame queue flushes, so no frame in flight can still be
+	// sampling it when add() hands it out again. The descriptor is left as is until then.
+	void remove(u32 slot, DeletionQueue *deletion_queue) {
+		if(slot == BINDLESS_INVALID_SLOT) return;
+		deletion_queue->callback(releaseSlot, this, slot);
+	}
+
+	void destroy(Platform *platform) {
+		vkDestroyDescriptorPool(device, pool, 0);
+		vkDestroyDescriptorSetLayout(device, layout, 0);
+		platform->free(free_slots);
+	}
+};
@@ -0,0 +1,206 @@
+#define CULL_MAX_BATCHES 256
+#define CULL_GROUP_SIZE 64
+
+// NOTE: must match the push constant block in cull.comp, 128 bytes is the guaranteed push constant limit
+struct CullBatchConstants {
+	Vec4 frustum_planes[6];
+	Vec4 bounding_sphere;
+	u32 input_first;
+	u32 instance_count;
+	u32 command_index;
+	u32 pad;
+};
+
+// NOTE: GPU frustum culling for instanced draws. Every batch is one compute dispatch that tests its instances'
+// bounding spheres against the frustum and appends the survivors to this frame's output region, bumping the
+// instanceCount of the batch's VkDrawIndexedIndirectCommand. The draw itself is a plain indirect draw, so the
+// cpu cost per batch is the same whether it holds ten instances or a hundred thousand.
+struct GpuCuller {
+	VkDevice device;
+	GpuMemoryAllocator *gpu_memory;
+	VkDescriptorSetLayout descriptor_set_layout; // NOTE: this and pipeline_layout belong to the renderer's layout cache
+	VkDescriptorPool descriptor_pool;
+	VkDescriptorSet descriptor_set;
+	VkPipelineLayout pipeline_layout;
+	VkPipeline pipeline;
+
+	VkBuffer output_buffer;
+	GpuAllocation output_allocation;
+	VkBuffer command_buffer;
+	GpuAllocation command_allocation;
+
+	u32 max_instances_per_frame;
+	u32 frame;
+	u32 output_head;
+	u32 batch_count;
+	VkDrawIndexedIndirectCommand commands[CULL_MAX_BATCHES];
+	CullBatchConstants batches[CULL_MAX_BATCHES];
+
+	VkBuffer createDeviceBuffer(Platform *platform, VkDeviceSize size, VkBufferUsageFlags usage, GpuAllocation *allocation) {
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = usage;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer result;
+		if(vkCreateBuffer(device, &buffer_create_info, 0, &result) != VK_SUCCESS) {
+			platform->error("Couldn't create culling buffer");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, result, &memory_requirements);
+		*allocation = gpu_memory->allocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if(allocation->memory == VK_NULL_HANDLE) {
+			platform->error("Couldn't allocate culling buffer memory");
+		}
+
+		vkBindBufferMemory(device, result, allocation->memory, allocation->offset);
+		return result;
+	}
+
+	// NOTE: input_buffer holds the uncompacted instances, output_buffer gets frame_count regions of max_instances_per_frame each
+	void init(Platform *platform, VkDevice device, GpuMemoryAllocator *gpu_memory, VkPipelineCache cache, VkShaderModule cull_shader, VkDescriptorSetLayout descriptor_set_layout, VkPipelineLayout pipeline_layout, u32 frame_count, u32 max_instances_per_frame, VkDeviceSize instance_size, VkBuffer input_buffer) {
+		this->device = device;
+		this->descriptor_set_layout = descriptor_set_layout;
+		this->pipeline_layout = pipeline_layout;
+		this->gpu_memory = gpu_memory;
+		this->max_instances_per_frame = max_instances_per_frame;
+
+		output_buffer = createDeviceBuffer(platform, instance_size * max_instances_per_frame * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &output_allocation);
+		command_buffer = createDeviceBuffer(platform, sizeof(VkDrawIndexedIndirectCommand) * CULL_MAX_BATCHES * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &command_allocation);
+
+		VkDescriptorPoolSize pool_size = {};
+		pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_size.descriptorCount = 3;
+
+		VkDescriptorPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &pool_size;
+		pool_info.maxSets = 1;
+		if(vkCreateDescriptorPool(device, &pool_info, 0, &descriptor_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create culling descriptor pool");
+		}
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = descriptor_pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &descriptor_set_layout;
+		if(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS) {
+			platform->error("Couldn't allocate culling descriptor set");
+		}
+
+		VkBuffer buffers[3] = {input_buffer, output_buffer, command_buffer};
+		VkDescriptorBufferInfo buffer_infos[3] = {};
+		VkWriteDescriptorSet writes[3] = {};
+		for(u32 i = 0; i < ArrayCount(writes); i++) {
+			buffer_infos[i].buffer = buffers[i];
+			buffer_infos[i].offset = 0;
+			buffer_infos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptor_set;
+			writes[i].dstBinding = i;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &buffer_infos[i];
+		}
+		vkUpdateDescriptorSets(device, ArrayCount(writes), writes, 0, 0);
+
+		createPipeline(platform, cache, cull_shader);
+
+		frame = 0;
+		output_head = 0;
+		batch_count = 0;
+	}
+
+	// NOTE: also how a reloaded shader gets swapped in, the old pipeline is the caller's to delete
+	void createPipeline(Platform *platform, VkPipelineCache cache, VkShaderModule cull_shader) {
+		VkComputePipelineCreateInfo pipeline_info = {};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_info.stage.module = cull_shader;
+		pipeline_info.stage.pName = "main";
+		pipeline_info.layout = pipeline_layout;
+		if(vkCreateComputePipelines(device, cache, 1, &pipeline_info, 0, &pipeline) != VK_SUCCESS) {
+			platform->error("Couldn't create culling pipeline");
+		}
+	}
+
+	void beginFrame(u32 frame) {
+		this->frame = frame;
+		output_head = 0;
+		batch_count = 0;
+	}
+
+	// NOTE: queues a batch for this frame, indirect_offset receives where its draw command lives in command_buffer
+	bool addBatch(Platform *platform, Vec4 bounding_sphere, u32 input_first, u32 instance_count, u32 index_count, u32 first_index, s32 vertex_offset, VkDeviceSize *indirect_offset) {
+		if(batch_count == CULL_MAX_BATCHES || output_head + instance_count > max_instances_per_frame) {
+			platform->error("Too many culled instances this frame");
+			return false;
+		}
+
+		u32 command_index = frame * CULL_MAX_BATCHES + batch_count;
+
+		VkDrawIndexedIndirectCommand *command = &commands[batch_count];
+		command->indexCount = index_count;
+		command->instanceCount = 0;
+		command->firstIndex = first_index;
+		command->vertexOffset = vertex_offset;
+		command->firstInstance = frame * max_instances_per_frame + output_head;
+
+		CullBatchConstants *batch = &batches[batch_count];
+		batch->bounding_sphere = bounding_sphere;
+		batch->input_first = input_first;
+		batch->instance_count = instance_count;
+		batch->command_index = command_index;
+
+		output_head += instance_count;
+		batch_count++;
+
+		*indirect_offset = sizeof(VkDrawIndexedIndirectCommand) * command_index;
+		return true;
+	}
+
+	// NOTE: recorded as its own render graph pass, the graph orders the draws after it. Planes are the camera frustum
+	// in world space pointing inwards.
+	void record(VkCommandBuffer cmd, const Vec4 *frustum_planes) {
+		if(batch_count == 0) return;
+
+		// NOTE: reset this frame's commands, instanceCount starts at zero and the shader counts the survivors up
+		VkDeviceSize commands_offset = sizeof(VkDrawIndexedIndirectCommand) * frame * CULL_MAX_BATCHES;
+		vkCmdUpdateBuffer(cmd, command_buffer, commands_offset, sizeof(VkDrawIndexedIndirectCommand) * batch_count, commands);
+
+		VkBufferMemoryBarrier reset_barrier = {};
+		reset_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		reset_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		reset_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		reset_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reset_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reset_barrier.buffer = command_buffer;
+		reset_barrier.offset = commands_offset;
+		reset_barrier.size = sizeof(VkDrawIndexedIndirectCommand) * batch_count;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 1, &reset_barrier, 0, 0);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, 0);
+		for(u32 i = 0; i < batch_count; i++) {
+			CullBatchConstants *batch = &batches[i];
+			memcpy(batch->frustum_planes, frustum_planes, sizeof(batch->frustum_planes));
+			vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullBatchConstants), batch);
+			vkCmdDispatch(cmd, (batch->instance_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+		}
+	}
+
+	void destroy() {
+		vkDestroyPipeline(device, pipeline, 0);
+		vkDestroyDescriptorPool(device, descriptor_pool, 0);
+		vkDestroyBuffer(device, command_buffer, 0);
+		gpu_memory->free(&command_allocation);
+		vkDestroyBuffer(device, output_buffer, 0);
+		gpu_memory->free(&output_allocation);
+	}
+};
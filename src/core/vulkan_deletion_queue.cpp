@@ -0,0 +1,137 @@
+enum class DeferredDeleteType {
+	Buffer,
+	Image,
+	ImageView,
+	Sampler,
+	Pipeline,
+	PipelineLayout,
+	RenderPass,
+	Framebuffer,
+	SwapChain,
+	Allocation,
+	HostMemory, // NOTE: platform->alloc memory that handles above still point into, e.g. swap chain image arrays
+	Callback, // NOTE: for things released back to the code that owns them rather than to vulkan, e.g. bindless slots
+};
+
+typedef void (*DeferredDeleteCallback)(void *data, u32 value);
+
+struct DeferredDelete {
+	DeferredDeleteType type;
+	union {
+		VkBuffer buffer;
+		VkImage image;
+		VkImageView image_view;
+		VkSampler sampler;
+		VkPipeline pipeline;
+		VkPipelineLayout pipeline_layout;
+		VkRenderPass render_pass;
+		VkFramebuffer framebuffer;
+		VkSwapchainKHR swap_chain;
+		void *host_memory;
+		struct {
+			DeferredDeleteCallback func;
+			void *data;
+			u32 value;
+		} callback;
+	};
+	GpuAllocation allocation;
+};
+
+// NOTE: Everything destroyed while a frame is being recorded goes in that frame's queue and is released once the
+// frame's fence has been waited on again. Fences signal in submission order so by then no earlier frame can be
+// using it either, nothing here ever needs the device idle. Entries are released in the order they were pushed.
+struct DeletionQueue {
+	VkDevice device;
+	GpuMemoryAllocator *gpu_memory;
+	Platform *platform;
+	DeferredDelete *entries;
+	u32 count;
+	u32 capacity;
+
+	void init(Platform *platform, VkDevice device, GpuMemoryAllocator *gpu_memory) {
+		this->platform = platform;
+		this->device = device;
+		this->gpu_memory = gpu_memory;
+		entries = 0;
+		count = 0;
+		capacity = 0;
+	}
+
+	DeferredDelete *push(DeferredDeleteType type) {
+		if(count == capacity) {
+			u32 new_capacity = capacity == 0 ? 64 : capacity * 2;
+			DeferredDelete *new_entries = (DeferredDelete *)platform->alloc(sizeof(DeferredDelete) * new_capacity);
+			if(entries) {
+				memcpy(new_entries, entries, sizeof(DeferredDelete) * count);
+				platform->free(entries);
+			}
+			entries = new_entries;
+			capacity = new_capacity;
+		}
+
+		DeferredDelete *entry = &entries[count++];
+		*entry = {};
+		entry->type = type;
+		return entry;
+	}
+
+	void buffer(VkBuffer buffer, GpuAllocation *allocation = 0) {
+		push(DeferredDeleteType::Buffer)->buffer = buffer;
+		if(allocation) this->allocation(allocation);
+	}
+
+	void image(VkImage image, GpuAllocation *allocation = 0) {
+		push(DeferredDeleteType::Image)->image = image;
+		if(allocation) this->allocation(allocation);
+	}
+
+	void imageView(VkImageView image_view) { push(DeferredDeleteType::ImageView)->image_view = image_view; }
+	void sampler(VkSampler sampler) { push(DeferredDeleteType::Sampler)->sampler = sampler; }
+	void pipeline(VkPipeline pipeline) { push(DeferredDeleteType::Pipeline)->pipeline = pipeline; }
+	void pipelineLayout(VkPipelineLayout pipeline_layout) { push(DeferredDeleteType::PipelineLayout)->pipeline_layout = pipeline_layout; }
+	void renderPass(VkRenderPass render_pass) { push(DeferredDeleteType::RenderPass)->render_pass = render_pass; }
+	void framebuffer(VkFramebuffer framebuffer) { push(DeferredDeleteType::Framebuffer)->framebuffer = framebuffer; }
+	void swapChain(VkSwapchainKHR swap_chain) { push(DeferredDeleteType::SwapChain)->swap_chain = swap_chain; }
+	void hostMemory(void *memory) { push(DeferredDeleteType::HostMemory)->host_memory = memory; }
+
+	void callback(DeferredDeleteCallback func, void *data, u32 value) {
+		DeferredDelete *entry = push(DeferredDeleteType::Callback);
+		entry->callback.func = func;
+		entry->callback.data = data;
+		entry->callback.value = value;
+	}
+
+	void allocation(GpuAllocation *allocation) {
+		push(DeferredDeleteType::Allocation)->allocation = *allocation;
+		*allocation = {};
+	}
+
+	// NOTE: call once the fence of the frame this queue belongs to has signalled
+	void flush() {
+		for(u32 i = 0; i < count; i++) {
+			DeferredDelete *entry = &entries[i];
+			switch(entry->type) {
+				case DeferredDeleteType::Buffer: vkDestroyBuffer(device, entry->buffer, 0); break;
+				case DeferredDeleteType::Image: vkDestroyImage(device, entry->image, 0); break;
+				case DeferredDeleteType::ImageView: vkDestroyImageView(device, entry->image_view, 0); break;
+				case DeferredDeleteType::Sampler: vkDestroySampler(device, entry->sampler, 0); break;
+				case DeferredDeleteType::Pipeline: vkDestroyPipeline(device, entry->pipeline, 0); break;
+				case DeferredDeleteType::PipelineLayout: vkDestroyPipelineLayout(device, entry->pipeline_layout, 0); break;
+				case DeferredDeleteType::RenderPass: vkDestroyRenderPass(device, entry->render_pass, 0); break;
+				case DeferredDeleteType::Framebuffer: vkDestroyFramebuffer(device, entry->framebuffer, 0); break;
+				case DeferredDeleteType::SwapChain: vkDestroySwapchainKHR(device, entry->swap_chain, 0); break;
+				case DeferredDeleteType::Allocation: gpu_memory->free(&entry->allocation); break;
+				case DeferredDeleteType::HostMemory: platform->free(entry->host_memory); break;
+				case DeferredDeleteType::Callback: entry->callback.func(entry->callback.data, entry->callback.value); break;
+			}
+		}
+		count = 0;
+	}
+
+	void destroy() {
+		flush();
+		if(entries) platform->free(entries);
+		entries = 0;
+		capacity = 0;
+	}
+};
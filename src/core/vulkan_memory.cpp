@@ -0,0 +1,477 @@
+#define GPU_MEMORY_BLOCK_SIZE Megabytes(64)
+#define GPU_MEMORY_MIN_BLOCK_SIZE Megabytes(1)
+#define GPU_MEMORY_MIN_ALLOC_SIZE 256
+#define GPU_MEMORY_MAX_LEVELS 24
+
+// NOTE: General allocations come from a buddy allocator inside large per memory type blocks.
+// Linear allocations are bump allocated from a single block per memory type that rewinds once
+// every linear allocation in it has been freed, which suits short lived staging memory.
+enum class GpuAllocationStrategy {
+	General,
+	Linear,
+};
+
+struct GpuAllocation {
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void *mapped; // NOTE: persistently mapped pointer for host visible memory, 0 otherwise
+	u32 memory_type;
+	s32 block_index; // NOTE: -1 for dedicated allocations
+	u32 level;
+	GpuAllocationStrategy strategy;
+};
+
+struct GpuMemoryBlock {
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	u8 *mapped;
+	u32 level_count;
+	u32 allocation_count;
+	VkDeviceSize allocated_bytes;
+	u64 *free_bits[GPU_MEMORY_MAX_LEVELS]; // NOTE: one bit per node, set when the node is free
+	u32 free_counts[GPU_MEMORY_MAX_LEVELS];
+	u32 first_free_word[GPU_MEMORY_MAX_LEVELS];
+
+	u64 nodeSize(u32 level) {
+		return size >> level;
+	}
+
+	void setFree(u32 level, u64 node) {
+		u32 word = (u32)(node / 64);
+		free_bits[level][word] |= (1ULL << (node % 64));
+		free_counts[level]++;
+		if(word < first_free_word[level]) first_free_word[level] = word;
+	}
+
+	bool isFree(u32 level, u64 node) {
+		return (free_bits[level][node / 64] & (1ULL << (node % 64))) != 0;
+	}
+
+	void clearFree(u32 level, u64 node) {
+		free_bits[level][node / 64] &= ~(1ULL << (node % 64));
+		free_counts[level]--;
+	}
+
+	u64 takeFreeNode(u32 level) {
+		u32 word_count = (u32)(((1ULL << level) + 63) / 64);
+		for(u32 w = first_free_word[level]; w < word_count; w++) {
+			u64 bits = free_bits[level][w];
+			if(bits != 0) {
+				first_free_word[level] = w;
+				u64 node = (u64)w * 64 + findFirstSetBit64(bits);
+				clearFree(level, node);
+				return node;
+			}
+		}
+		Assert(false);
+		return 0;
+	}
+
+	s64 allocNode(u32 level) {
+		u32 l = level;
+		while(free_counts[l] == 0) {
+			if(l == 0) return -1;
+			l--;
+		}
+
+		u64 node = takeFreeNode(l);
+		while(l < level) {
+			l++;
+			node *= 2;
+			setFree(l, node + 1);
+		}
+		return (s64)node;
+	}
+
+	void freeNode(u32 level, u64 node) {
+		while(level > 0) {
+			u64 buddy = node ^ 1;
+			if(!isFree(level, buddy)) break;
+			clearFree(level, buddy);
+			node /= 2;
+			level--;
+		}
+		setFree(level, node);
+	}
+};
+
+struct GpuLinearBlock {
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	VkDeviceSize top;
+	u8 *mapped;
+	u32 allocation_count;
+};
+
+struct GpuMemoryType {
+	GpuMemoryBlock *blocks;
+	u32 block_count;
+	u32 block_capacity;
+	VkDeviceSize block_size;
+	GpuLinearBlock linear;
+	u32 dedicated_count;
+	VkDeviceSize dedicated_bytes;
+};
+
+struct GpuMemoryStats {
+	u32 block_count;
+	u32 dedicated_count;
+	u32 allocation_count;
+	VkDeviceSize reserved_bytes;
+	VkDeviceSize allocated_bytes;
+	VkDeviceSize free_bytes;
+	VkDeviceSize largest_free_range;
+	u32 free_range_count;
+	f32 fragmentation; // NOTE: 1 - largest_free_range / free_bytes, 0 means all free memory is contiguous
+};
+
+struct GpuMemoryAllocator {
+	VkDevice device;
+	Platform *platform;
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	VkDeviceSize buffer_image_granularity;
+	u32 max_allocation_count;
+	u32 device_allocation_count;
+	GpuMemoryType types[VK_MAX_MEMORY_TYPES];
+
+	void init(Platform *platform, VkPhysicalDevice physical_device, VkDevice device) {
+		this->platform = platform;
+		this->device = device;
+		device_allocation_count = 0;
+
+		VkPhysicalDeviceProperties device_props;
+		vkGetPhysicalDeviceProperties(physical_device, &device_props);
+		buffer_image_granularity = device_props.limits.bufferImageGranularity;
+		max_allocation_count = device_props.limits.maxMemoryAllocationCount;
+
+		vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+		for(u32 i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+			types[i] = {};
+		}
+
+		for(u32 i = 0; i < memory_properties.memoryTypeCount; i++) {
+			VkDeviceSize heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize block_size = GPU_MEMORY_BLOCK_SIZE;
+			while(block_size > heap_size / 8 && block_size > GPU_MEMORY_MIN_BLOCK_SIZE) {
+				block_size >>= 1;
+			}
+			types[i].block_size = block_size;
+		}
+	}
+
+	u32 findMemoryType(u32 type_filter, VkMemoryPropertyFlags properties) {
+		for(u32 i = 0; i < memory_properties.memoryTypeCount; i++) {
+			if(type_filter & (1 << i) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		platform->error("Couldn't find memory type");
+
+		return UINT32_MAX;
+	}
+
+	bool isHostVisible(u32 memory_type) {
+		return (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, u32 memory_type, u8 **mapped) {
+		if(device_allocation_count >= max_allocation_count) {
+			platform->error("Exceeded maxMemoryAllocationCount");
+		}
+
+		VkMemoryAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = size;
+		alloc_info.memoryTypeIndex = memory_type;
+
+		VkDeviceMemory result;
+		if(vkAllocateMemory(device, &alloc_info, 0, &result) != VK_SUCCESS) {
+			platform->error("Couldn't allocate device memory");
+			return VK_NULL_HANDLE;
+		}
+		device_allocation_count++;
+
+		*mapped = 0;
+		if(isHostVisible(memory_type)) {
+			void *data;
+			if(vkMapMemory(device, result, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+				platform->error("Couldn't map device memory");
+			}
+			*mapped = (u8 *)data;
+		}
+
+		return result;
+	}
+
+	void freeDeviceMemory(VkDeviceMemory memory) {
+		vkFreeMemory(device, memory, 0);
+		device_allocation_count--;
+	}
+
+	GpuMemoryBlock *createBlock(u32 memory_type, u32 *block_index) {
+		GpuMemoryType *type = &types[memory_type];
+
+		u32 index = type->block_count;
+		for(u32 i = 0; i < type->block_count; i++) {
+			if(type->blocks[i].memory == VK_NULL_HANDLE) {
+				index = i;
+				break;
+			}
+		}
+
+		if(index == type->block_count) {
+			if(type->block_count == type->block_capacity) {
+				u32 new_capacity = type->block_capacity == 0 ? 4 : type->block_capacity * 2;
+				GpuMemoryBlock *new_blocks = (GpuMemoryBlock *)platform->alloc(sizeof(GpuMemoryBlock) * new_capacity);
+				if(type->blocks) {
+					memcpy(new_blocks, type->blocks, sizeof(GpuMemoryBlock) * type->block_count);
+					platform->free(type->blocks);
+				}
+				type->blocks = new_blocks;
+				type->block_capacity = new_capacity;
+			}
+			type->block_count++;
+		}
+
+		GpuMemoryBlock *block = &type->blocks[index];
+		*block = {};
+		block->size = type->block_size;
+		block->memory = allocateDeviceMemory(block->size, memory_type, &block->mapped);
+		block->level_count = log2Floor(block->size / GPU_MEMORY_MIN_ALLOC_SIZE) + 1;
+		Assert(block->level_count <= GPU_MEMORY_MAX_LEVELS);
+
+		u64 total_words = 0;
+		for(u32 l = 0; l < block->level_count; l++) {
+			total_words += ((1ULL << l) + 63) / 64;
+		}
+
+		u64 *bits = (u64 *)platform->alloc(sizeof(u64) * total_words);
+		memset(bits, 0, sizeof(u64) * total_words);
+		for(u32 l = 0; l < block->level_count; l++) {
+			block->free_bits[l] = bits;
+			bits += ((1ULL << l) + 63) / 64;
+		}
+
+		block->setFree(0, 0);
+
+		*block_index = index;
+		return block;
+	}
+
+	void destroyBlock(GpuMemoryBlock *block) {
+		freeDeviceMemory(block->memory);
+		platform->free(block->free_bits[0]);
+		*block = {};
+	}
+
+	u32 levelForSize(GpuMemoryBlock *block, VkDeviceSize size) {
+		VkDeviceSize node_size = nextPowerOfTwo(size);
+		if(node_size < GPU_MEMORY_MIN_ALLOC_SIZE) node_size = GPU_MEMORY_MIN_ALLOC_SIZE;
+		return log2Floor(block->size / node_size);
+	}
+
+	bool allocateGeneral(u32 memory_type, VkDeviceSize size, GpuAllocation *result) {
+		GpuMemoryType *type = &types[memory_type];
+
+		for(u32 i = 0; i < type->block_count; i++) {
+			GpuMemoryBlock *block = &type->blocks[i];
+			if(block->memory == VK_NULL_HANDLE) continue;
+
+			u32 level = levelForSize(block, size);
+			s64 node = block->allocNode(level);
+			if(node >= 0) {
+				result->memory = block->memory;
+				result->offset = (VkDeviceSize)node * block->nodeSize(level);
+				result->size = block->nodeSize(level);
+				result->mapped = block->mapped ? block->mapped + result->offset : 0;
+				result->block_index = (s32)i;
+				result->level = level;
+				block->allocation_count++;
+				block->allocated_bytes += result->size;
+				return true;
+			}
+		}
+
+		u32 block_index;
+		GpuMemoryBlock *block = createBlock(memory_type, &block_index);
+		if(block->memory == VK_NULL_HANDLE) return false;
+
+		u32 level = levelForSize(block, size);
+		s64 node = block->allocNode(level);
+		Assert(node >= 0);
+		result->memory = block->memory;
+		result->offset = (VkDeviceSize)node * block->nodeSize(level);
+		result->size = block->nodeSize(level);
+		result->mapped = block->mapped ? block->mapped + result->offset : 0;
+		result->block_index = (s32)block_index;
+		result->level = level;
+		block->allocation_count++;
+		block->allocated_bytes += result->size;
+		return true;
+	}
+
+	bool allocateLinear(u32 memory_type, VkDeviceSize size, VkDeviceSize alignment, GpuAllocation *result) {
+		GpuLinearBlock *linear = &types[memory_type].linear;
+		if(linear->memory == VK_NULL_HANDLE) {
+			linear->size = types[memory_type].block_size;
+			linear->memory = allocateDeviceMemory(linear->size, memory_type, &linear->mapped);
+			linear->top = 0;
+			linear->allocation_count = 0;
+		}
+
+		VkDeviceSize offset = AlignUp(linear->top, alignment);
+		if(offset + size > linear->size) return false;
+
+		linear->top = offset + size;
+		linear->allocation_count++;
+
+		result->memory = linear->memory;
+		result->offset = offset;
+		result->size = size;
+		result->mapped = linear->mapped ? linear->mapped + offset : 0;
+		result->block_index = 0;
+		result->level = 0;
+		return true;
+	}
+
+	GpuAllocation allocate(VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, GpuAllocationStrategy strategy = GpuAllocationStrategy::General) {
+		GpuAllocation result = {};
+		result.memory_type = findMemoryType(requirements.memoryTypeBits, properties);
+		result.strategy = strategy;
+
+		// NOTE: keeping every size and offset a multiple of bufferImageGranularity means linear and optimal resources never share a page
+		VkDeviceSize alignment = requirements.alignment;
+		if(alignment < buffer_image_granularity) alignment = buffer_image_granularity;
+		VkDeviceSize size = AlignUp(requirements.size, alignment);
+
+		GpuMemoryType *type = &types[result.memory_type];
+
+		if(strategy == GpuAllocationStrategy::Linear) {
+			if(allocateLinear(result.memory_type, size, alignment, &result)) return result;
+			result.strategy = GpuAllocationStrategy::General;
+		}
+
+		if(size <= type->block_size && alignment <= type->block_size) {
+			VkDeviceSize node_size = size > alignment ? size : alignment;
+			if(allocateGeneral(result.memory_type, node_size, &result)) return result;
+		}
+
+		u8 *mapped;
+		result.memory = allocateDeviceMemory(size, result.memory_type, &mapped);
+		result.offset = 0;
+		result.size = size;
+		result.mapped = mapped;
+		result.block_index = -1;
+		result.level = 0;
+		type->dedicated_count++;
+		type->dedicated_bytes += size;
+		return result;
+	}
+
+	void free(GpuAllocation *allocation) {
+		if(allocation->memory == VK_NULL_HANDLE) return;
+		GpuMemoryType *type = &types[allocation->memory_type];
+
+		if(allocation->block_index < 0) {
+			freeDeviceMemory(allocation->memory);
+			type->dedicated_count--;
+			type->dedicated_bytes -= allocation->size;
+		} else if(allocation->strategy == GpuAllocationStrategy::Linear) {
+			GpuLinearBlock *linear = &type->linear;
+			Assert(linear->allocation_count > 0);
+			linear->allocation_count--;
+			if(linear->allocation_count == 0) linear->top = 0;
+		} else {
+			GpuMemoryBlock *block = &type->blocks[allocation->block_index];
+			block->freeNode(allocation->level, allocation->offset / block->nodeSize(allocation->level));
+			block->allocation_count--;
+			block->allocated_bytes -= allocation->size;
+
+			// NOTE: keep one empty block around per type so alloc/free patterns don't thrash vkAllocateMemory
+			if(block->allocation_count == 0) {
+				u32 live_blocks = 0;
+				for(u32 i = 0; i < type->block_count; i++) {
+					if(type->blocks[i].memory != VK_NULL_HANDLE) live_blocks++;
+				}
+				if(live_blocks > 1) destroyBlock(block);
+			}
+		}
+
+		*allocation = {};
+	}
+
+	GpuMemoryStats getStats(u32 memory_type) {
+		GpuMemoryStats result = {};
+		GpuMemoryType *type = &types[memory_type];
+
+		result.dedicated_count = type->dedicated_count;
+		result.allocation_count = type->dedicated_count;
+		result.reserved_bytes = type->dedicated_bytes;
+		result.allocated_bytes = type->dedicated_bytes;
+
+		for(u32 i = 0; i < type->block_count; i++) {
+			GpuMemoryBlock *block = &type->blocks[i];
+			if(block->memory == VK_NULL_HANDLE) continue;
+
+			result.block_count++;
+			result.allocation_count += block->allocation_count;
+			result.reserved_bytes += block->size;
+			result.allocated_bytes += block->allocated_bytes;
+
+			for(u32 l = 0; l < block->level_count; l++) {
+				if(block->free_counts[l] == 0) continue;
+				result.free_range_count += block->free_counts[l];
+				result.free_bytes += block->free_counts[l] * block->nodeSize(l);
+				if(block->nodeSize(l) > result.largest_free_range) result.largest_free_range = block->nodeSize(l);
+			}
+		}
+
+		GpuLinearBlock *linear = &type->linear;
+		if(linear->memory != VK_NULL_HANDLE) {
+			result.block_count++;
+			result.allocation_count += linear->allocation_count;
+			result.reserved_bytes += linear->size;
+			result.allocated_bytes += linear->top;
+			VkDeviceSize linear_free = linear->size - linear->top;
+			if(linear_free > 0) {
+				result.free_range_count++;
+				result.free_bytes += linear_free;
+				if(linear_free > result.largest_free_range) result.largest_free_range = linear_free;
+			}
+		}
+
+		if(result.free_bytes > 0) {
+			result.fragmentation = 1.0f - (f32)((f64)result.largest_free_range / (f64)result.free_bytes);
+		}
+
+		return result;
+	}
+
+	void printStats() {
+		printf("=========== GPU Memory ===========\n");
+		printf("%u / %u device allocations\n", device_allocation_count, max_allocation_count);
+		for(u32 i = 0; i < memory_properties.memoryTypeCount; i++) {
+			GpuMemoryStats stats = getStats(i);
+			if(stats.block_count == 0 && stats.dedicated_count == 0) continue;
+			printf("type %u: %u blocks, %u dedicated, %u allocations, %.2fMB reserved, %.2fMB allocated, %u free ranges, largest free %.2fMB, fragmentation %.2f\n",
+				i, stats.block_count, stats.dedicated_count, stats.allocation_count,
+				(f64)stats.reserved_bytes / (f64)Megabytes(1), (f64)stats.allocated_bytes / (f64)Megabytes(1),
+				stats.free_range_count, (f64)stats.largest_free_range / (f64)Megabytes(1), stats.fragmentation);
+		}
+	}
+
+	void destroy() {
+		for(u32 t = 0; t < memory_properties.memoryTypeCount; t++) {
+			GpuMemoryType *type = &types[t];
+			for(u32 i = 0; i < type->block_count; i++) {
+				if(type->blocks[i].memory != VK_NULL_HANDLE) destroyBlock(&type->blocks[i]);
+			}
+			if(type->blocks) platform->free(type->blocks);
+			if(type->linear.memory != VK_NULL_HANDLE) freeDeviceMemory(type->linear.memory);
+			*type = {};
+		}
+	}
+};
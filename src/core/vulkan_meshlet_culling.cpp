@@ -0,0 +1,290 @@
+#define MESHLET_CULL_MAX_BATCHES 16
+
+// NOTE: std430 layout of GpuMeshlet in meshlet_cull.comp
+struct GpuMeshlet {
+	Vec4 bounding_sphere;
+	Vec4 cone; // NOTE: axis and cutoff
+	u32 vertex_offset;
+	u32 triangle_offset;
+	u32 vertex_count;
+	u32 triangle_count;
+};
+
+// NOTE: must match the push constant block in meshlet_cull.comp. Planes and camera are in mesh space so the
+// shader never needs the model matrix, which keeps this at the 128 byte push constant limit.
+struct MeshletCullConstants {
+	Vec4 frustum_planes[6];
+	Vec4 camera_position;
+	u32 meshlet_count;
+	u32 output_first;
+	u32 command_index;
+	u32 pad;
+};
+
+// NOTE: Meshlet culling for devices without mesh shaders. One workgroup per meshlet tests its bounding sphere against
+// the frustum and its normal cone against the camera, and survivors expand their triangles into this frame's region of
+// a compacted index buffer, bumping indexCount of the batch's VkDrawIndexedIndirectCommand. The draw is then an
+// ordinary indexed indirect draw of whatever survived, with the mesh's own vertex buffer.
+struct GpuMeshletCuller {
+	VkDevice device;
+	GpuMemoryAllocator *gpu_memory;
+	VkDescriptorSetLayout descriptor_set_layout; // NOTE: this and pipeline_layout belong to the renderer's layout cache
+	VkDescriptorPool descriptor_pool;
+	VkDescriptorSet descriptor_set;
+	VkPipelineLayout pipeline_layout;
+	VkPipeline pipeline;
+
+	VkBuffer meshlet_buffer;
+	GpuAllocation meshlet_allocation;
+	VkBuffer vertex_buffer;
+	GpuAllocation vertex_allocation;
+	VkBuffer triangle_buffer;
+	GpuAllocation triangle_allocation;
+	VkBuffer index_buffer;
+	GpuAllocation index_allocation;
+	VkBuffer command_buffer;
+	GpuAllocation command_allocation;
+
+	GpuMeshlet *gpu_meshlets;
+	u32 meshlet_count;
+	u32 mesh_index_count;
+	u32 batches_per_frame;
+	u32 max_indices_per_frame;
+	u32 frame;
+	u32 output_head;
+	u32 batch_count;
+	VkDrawIndexedIndirectCommand commands[MESHLET_CULL_MAX_BATCHES];
+	MeshletCullConstants batches[MESHLET_CULL_MAX_BATCHES];
+
+	VkBuffer createDeviceBuffer(Platform *platform, VkDeviceSize size, VkBufferUsageFlags usage, GpuAllocation *allocation) {
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = size;
+		buffer_create_info.usage = usage;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer result;
+		if(vkCreateBuffer(device, &buffer_create_info, 0, &result) != VK_SUCCESS) {
+			platform->error("Couldn't create meshlet culling buffer");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, result, &memory_requirements);
+		*allocation = gpu_memory->allocate(memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if(allocation->memory == VK_NULL_HANDLE) {
+			platform->error("Couldn't allocate meshlet culling buffer memory");
+		}
+
+		vkBindBufferMemory(device, result, allocation->memory, allocation->offset);
+		return result;
+	}
+
+	// NOTE: one mesh's meshlets. Every batch can keep the whole mesh, so the index buffer has room for batches_per_frame
+	// full copies of it in each of frame_count regions
+	void init(Platform *platform, VkDevice device, GpuMemoryAllocator *gpu_memory, VkPipelineCache cache, VkShaderModule cull_shader, VkDescriptorSetLayout descriptor_set_layout, VkPipelineLayout pipeline_layout, u32 frame_count, u32 batches_per_frame, MeshletMesh *mesh) {
+		this->device = device;
+		this->descriptor_set_layout = descriptor_set_layout;
+		this->pipeline_layout = pipeline_layout;
+		this->gpu_memory = gpu_memory;
+		this->batches_per_frame = batches_per_frame < MESHLET_CULL_MAX_BATCHES ? batches_per_frame : MESHLET_CULL_MAX_BATCHES;
+		meshlet_count = mesh->meshlet_count;
+		mesh_index_count = mesh->triangle_count * 3;
+		max_indices_per_frame = mesh_index_count * this->batches_per_frame;
+
+		gpu_meshlets = (GpuMeshlet *)platform->alloc(sizeof(GpuMeshlet) * (meshlet_count > 0 ? meshlet_count : 1));
+		for(u32 m = 0; m < meshlet_count; m++) {
+			Meshlet *meshlet = &mesh->meshlets[m];
+			MeshletBounds *bounds = &mesh->bounds[m];
+			GpuMeshlet *gpu_meshlet = &gpu_meshlets[m];
+			gpu_meshlet->bounding_sphere = Vec4(bounds->center, bounds->radius);
+			gpu_meshlet->cone = Vec4(bounds->cone_axis, bounds->cone_cutoff);
+			gpu_meshlet->vertex_offset = meshlet->vertex_offset;
+			gpu_meshlet->triangle_offset = meshlet->triangle_offset;
+			gpu_meshlet->vertex_count = meshlet->vertex_count;
+			gpu_meshlet->triangle_count = meshlet->triangle_count;
+		}
+
+		VkBufferUsageFlags static_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		meshlet_buffer = createDeviceBuffer(platform, sizeof(GpuMeshlet) * (meshlet_count > 0 ? meshlet_count : 1), static_usage, &meshlet_allocation);
+		vertex_buffer = createDeviceBuffer(platform, sizeof(u32) * (mesh->vertex_count > 0 ? mesh->vertex_count : 1), static_usage, &vertex_allocation);
+		triangle_buffer = createDeviceBuffer(platform, sizeof(u32) * (mesh->triangle_count > 0 ? mesh->triangle_count : 1), static_usage, &triangle_allocation);
+		index_buffer = createDeviceBuffer(platform, sizeof(u32) * (max_indices_per_frame > 0 ? max_indices_per_frame : 1) * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &index_allocation);
+		command_buffer = createDeviceBuffer(platform, sizeof(VkDrawIndexedIndirectCommand) * MESHLET_CULL_MAX_BATCHES * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &command_allocation);
+
+		VkDescriptorPoolSize pool_size = {};
+		pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_size.descriptorCount = 5;
+
+		VkDescriptorPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &pool_size;
+		pool_info.maxSets = 1;
+		if(vkCreateDescriptorPool(device, &pool_info, 0, &descriptor_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create meshlet culling descriptor pool");
+		}
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = descriptor_pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &descriptor_set_layout;
+		if(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS) {
+			platform->error("Couldn't allocate meshlet culling descriptor set");
+		}
+
+		VkBuffer buffers[5] = {meshlet_buffer, vertex_buffer, triangle_buffer, index_buffer, command_buffer};
+		VkDescriptorBufferInfo buffer_infos[5] = {};
+		VkWriteDescriptorSet writes[5] = {};
+		for(u32 i = 0; i < ArrayCount(writes); i++) {
+			buffer_infos[i].buffer = buffers[i];
+			buffer_infos[i].offset = 0;
+			buffer_infos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptor_set;
+			writes[i].dstBinding = i;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &buffer_infos[i];
+		}
+		vkUpdateDescriptorSets(device, ArrayCount(writes), writes, 0, 0);
+
+		createPipeline(platform, cache, cull_shader);
+
+		frame = 0;
+		output_head = 0;
+		batch_count = 0;
+	}
+
+	// NOTE: also how a reloaded shader gets swapped in, the old pipeline is the caller's to delete
+	void createPipeline(Platform *platform, VkPipelineCache cache, VkShaderModule cull_shader) {
+		VkComputePipelineCreateInfo pipeline_info = {};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_info.stage.module = cull_shader;
+		pipeline_info.stage.pName = "main";
+		pipeline_info.layout = pipeline_layout;
+		if(vkCreateComputePipelines(device, cache, 1, &pipeline_info, 0, &pipeline) != VK_SUCCESS) {
+			platform->error("Couldn't create meshlet culling pipeline");
+		}
+	}
+
+	// NOTE: record between beginSetupCommands and endSetupCommands, the cpu copies are freed once they're staged
+	void upload(Platform *platform, UploadManager *uploads, MeshletMesh *mesh) {
+		if(meshlet_count == 0) return;
+		uploads->uploadBuffer(platform, meshlet_buffer, 0, gpu_meshlets, sizeof(GpuMeshlet) * meshlet_count, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		uploads->uploadBuffer(platform, vertex_buffer, 0, mesh->vertices, sizeof(u32) * mesh->vertex_count, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		uploads->uploadBuffer(platform, triangle_buffer, 0, mesh->triangles, sizeof(u32) * mesh->triangle_count, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		platform->free(gpu_meshlets);
+		gpu_meshlets = 0;
+	}
+
+	void beginFrame(u32 frame) {
+		this->frame = frame;
+		output_head = 0;
+		batch_count = 0;
+	}
+
+	// NOTE: model is mesh to world with column vectors (not the transposed uniform copy) and is expected to be rigid
+	// with at most a uniform scale, the cone test isn't conservative under shear. world_planes point inwards.
+	bool addBatch(Platform *platform, Mat4 model, const Vec4 *world_planes, Vec3 world_camera, VkDeviceSize *indirect_offset) {
+		if(batch_count == batches_per_frame) {
+			platform->error("Too many meshlet culled draws this frame");
+			return false;
+		}
+
+		u32 command_index = frame * MESHLET_CULL_MAX_BATCHES + batch_count;
+		u32 output_first = frame * max_indices_per_frame + output_head;
+
+		VkDrawIndexedIndirectCommand *command = &commands[batch_count];
+		command->indexCount = 0;
+		command->instanceCount = 1;
+		command->firstIndex = output_first;
+		command->vertexOffset = 0;
+		command->firstInstance = 0;
+
+		MeshletCullConstants *batch = &batches[batch_count];
+		// NOTE: a world plane p dotted with model * x is (p * model) dotted with x, renormalised so distances are in mesh units
+		for(u32 p = 0; p < 6; p++) {
+			f32 plane[4];
+			f32 world[4] = {world_planes[p].x, world_planes[p].y, world_planes[p].z, world_planes[p].w};
+			for(u32 c = 0; c < 4; c++) {
+				plane[c] = world[0] * model.data2d[0][c] + world[1] * model.data2d[1][c] + world[2] * model.data2d[2][c] + world[3] * model.data2d[3][c];
+			}
+			f32 length = Math::squareRoot(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			batch->frustum_planes[p] = Vec4(plane[0] / length, plane[1] / length, plane[2] / length, plane[3] / length);
+		}
+		batch->camera_position = Vec4(inverseTransformPoint(model, world_camera), 1.0f);
+		batch->meshlet_count = meshlet_count;
+		batch->output_first = output_first;
+		batch->command_index = command_index;
+
+		output_head += mesh_index_count;
+		batch_count++;
+
+		*indirect_offset = sizeof(VkDrawIndexedIndirectCommand) * command_index;
+		return true;
+	}
+
+	// NOTE: inverse of the affine part by cofactors, only the camera goes through it once a batch
+	static Vec3 inverseTransformPoint(Mat4 m, Vec3 p) {
+		f32 a = m.data2d[0][0], b = m.data2d[0][1], c = m.data2d[0][2];
+		f32 d = m.data2d[1][0], e = m.data2d[1][1], f = m.data2d[1][2];
+		f32 g = m.data2d[2][0], h = m.data2d[2][1], i = m.data2d[2][2];
+		f32 determinant = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+		if(determinant == 0.0f) return Vec3(0.0f);
+		f32 inverse_determinant = 1.0f / determinant;
+
+		Vec3 q = Vec3(p.x - m.data2d[0][3], p.y - m.data2d[1][3], p.z - m.data2d[2][3]);
+		Vec3 result;
+		result.x = ((e * i - f * h) * q.x + (c * h - b * i) * q.y + (b * f - c * e) * q.z) * inverse_determinant;
+		result.y = ((f * g - d * i) * q.x + (a * i - c * g) * q.y + (c * d - a * f) * q.z) * inverse_determinant;
+		result.z = ((d * h - e * g) * q.x + (b * g - a * h) * q.y + (a * e - b * d) * q.z) * inverse_determinant;
+		return result;
+	}
+
+	// NOTE: recorded in the culling pass next to the instance culler, the graph orders the draws after it
+	void record(VkCommandBuffer cmd) {
+		if(batch_count == 0) return;
+
+		// NOTE: reset this frame's commands, indexCount starts at zero and the shader counts the surviving indices up
+		VkDeviceSize commands_offset = sizeof(VkDrawIndexedIndirectCommand) * frame * MESHLET_CULL_MAX_BATCHES;
+		vkCmdUpdateBuffer(cmd, command_buffer, commands_offset, sizeof(VkDrawIndexedIndirectCommand) * batch_count, commands);
+
+		VkBufferMemoryBarrier reset_barrier = {};
+		reset_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		reset_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		reset_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		reset_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reset_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		reset_barrier.buffer = command_buffer;
+		reset_barrier.offset = commands_offset;
+		reset_barrier.size = sizeof(VkDrawIndexedIndirectCommand) * batch_count;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 1, &reset_barrier, 0, 0);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, 0);
+		for(u32 i = 0; i < batch_count; i++) {
+			vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletCullConstants), &batches[i]);
+			vkCmdDispatch(cmd, meshlet_count, 1, 1);
+		}
+	}
+
+	void destroy(Platform *platform) {
+		if(gpu_meshlets) platform->free(gpu_meshlets);
+		vkDestroyPipeline(device, pipeline, 0);
+		vkDestroyDescriptorPool(device, descriptor_pool, 0);
+		vkDestroyBuffer(device, command_buffer, 0);
+		gpu_memory->free(&command_allocation);
+		vkDestroyBuffer(device, index_buffer, 0);
+		gpu_memory->free(&index_allocation);
+		vkDestroyBuffer(device, triangle_buffer, 0);
+		gpu_memory->free(&triangle_allocation);
+		vkDestroyBuffer(device, vertex_buffer, 0);
+		gpu_memory->free(&vertex_allocation);
+		vkDestroyBuffer(device, meshlet_buffer, 0);
+		gpu_memory->free(&meshlet_allocation);
+	}
+};
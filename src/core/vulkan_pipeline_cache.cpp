@@ -0,0 +1,100 @@
+#define PIPELINE_CACHE_MAGIC 0x48435050 // 'PPCH'
+#define PIPELINE_CACHE_VERSION 1
+
+// NOTE: written in front of the driver's blob. Vulkan 1.0 has no driverUUID so driverVersion stands in for it,
+// the blob's own header is still checked against the device's pipelineCacheUUID as the driver may not
+struct PipelineCacheFileHeader {
+	u32 magic;
+	u32 version;
+	u32 vendor_id;
+	u32 device_id;
+	u32 driver_version;
+	u8 pipeline_cache_uuid[VK_UUID_SIZE];
+	u32 reserved; // NOTE: written as 0, stands in for the padding before data_size so no stack bytes end up in the file
+	u64 data_size;
+};
+
+struct PipelineCache {
+	VkPipelineCache cache;
+	VkDevice device;
+	VkPhysicalDeviceProperties device_props;
+	char path[512];
+	bool loaded_from_disk;
+
+	bool isValid(FileData *file) {
+		if(file->size < sizeof(PipelineCacheFileHeader)) return false;
+
+		PipelineCacheFileHeader *header = (PipelineCacheFileHeader *)file->contents;
+		if(header->magic != PIPELINE_CACHE_MAGIC || header->version != PIPELINE_CACHE_VERSION) return false;
+		if(header->vendor_id != device_props.vendorID || header->device_id != device_props.deviceID) return false;
+		if(header->driver_version != device_props.driverVersion) return false;
+		if(memcmp(header->pipeline_cache_uuid, device_props.pipelineCacheUUID, VK_UUID_SIZE) != 0) return false;
+		if(header->data_size != file->size - sizeof(PipelineCacheFileHeader)) return false;
+		if(header->data_size < sizeof(VkPipelineCacheHeaderVersionOne)) return false;
+
+		VkPipelineCacheHeaderVersionOne *vk_header = (VkPipelineCacheHeaderVersionOne *)(header + 1);
+		if(vk_header->headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+		if(vk_header->vendorID != device_props.vendorID || vk_header->deviceID != device_props.deviceID) return false;
+		if(memcmp(vk_header->pipelineCacheUUID, device_props.pipelineCacheUUID, VK_UUID_SIZE) != 0) return false;
+
+		return true;
+	}
+
+	void init(Platform *platform, VkPhysicalDevice physical_device, VkDevice device, const char *path) {
+		this->device = device;
+		snprintf(this->path, sizeof(this->path), "%s", path);
+		vkGetPhysicalDeviceProperties(physical_device, &device_props);
+
+		FileData file = {};
+		loaded_from_disk = false;
+		if(platform->fileExists(path)) {
+			file = platform->readEntireFile(this->path);
+			loaded_from_disk = isValid(&file);
+			if(!loaded_from_disk) {
+				printf("Discarding stale pipeline cache %s\n", path);
+			}
+		}
+
+		VkPipelineCacheCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		if(loaded_from_disk) {
+			PipelineCacheFileHeader *header = (PipelineCacheFileHeader *)file.contents;
+			create_info.initialDataSize = (size_t)header->data_size;
+			create_info.pInitialData = header + 1;
+		}
+
+		if(vkCreatePipelineCache(device, &create_info, 0, &cache) != VK_SUCCESS) {
+			platform->error("Couldn't create pipeline cache");
+		}
+
+		if(file.contents) platform->free(file.contents);
+	}
+
+	void save(Platform *platform) {
+		size_t data_size = 0;
+		if(vkGetPipelineCacheData(device, cache, &data_size, 0) != VK_SUCCESS || data_size == 0) return;
+
+		u64 file_size = sizeof(PipelineCacheFileHeader) + data_size;
+		u8 *file_data = (u8 *)platform->alloc(file_size);
+
+		PipelineCacheFileHeader *header = (PipelineCacheFileHeader *)file_data;
+		*header = {};
+		header->magic = PIPELINE_CACHE_MAGIC;
+		header->version = PIPELINE_CACHE_VERSION;
+		header->vendor_id = device_props.vendorID;
+		header->device_id = device_props.deviceID;
+		header->driver_version = device_props.driverVersion;
+		memcpy(header->pipeline_cache_uuid, device_props.pipelineCacheUUID, VK_UUID_SIZE);
+		header->data_size = data_size;
+
+		if(vkGetPipelineCacheData(device, cache, &data_size, header + 1) == VK_SUCCESS) {
+			platform->writeStructureToFile(path, file_data, (s32)file_size);
+		}
+
+		platform->free(file_data);
+	}
+
+	void destroy() {
+		vkDestroyPipelineCache(device, cache, 0);
+	}
+};
@@ -0,0 +1,346 @@
+#include <core/platform.h>
+#include <atomic>
+
+#define PIPELINE_MAX_PERMUTATIONS 64
+#define PIPELINE_SPEC_CONSTANT_COUNT 3
+
+// NOTE: the constant_ids the graphics shaders declare, both stages get the same specialization info and ignore what they
+// don't declare
+enum PipelineSpecConstant {
+	SPEC_QUANTIZED_POSITIONS = 0,
+	SPEC_VERTEX_COLORS = 1,
+	SPEC_DEBUG_VIEW = 2,
+};
+
+enum class DebugView : u32 {
+	Shaded,
+	Normals,
+	Uvs,
+	Count,
+};
+
+enum class PipelineProgram : u32 {
+	Plain,
+	Instanced,
+	Count,
+};
+
+// NOTE: everything a graphics pipeline permutation is built from. Only u32s so it hashes and compares as raw bytes.
+struct PipelineDesc {
+	u32 program;
+	u32 spec_constants[PIPELINE_SPEC_CONSTANT_COUNT];
+	u32 cull_mode;
+
+	u64 hash() {
+		u64 result = 14695981039346656037ull;
+		u8 *bytes = (u8 *)this;
+		for(u32 i = 0; i < sizeof(PipelineDesc); i++) {
+			result ^= bytes[i];
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
+};
+
+// NOTE: ready is stored with release once pipeline is written and loaded with acquire before pipeline is read, so a
+// reader that sees it set from another thread sees the pipeline the prewarm thread built
+struct PipelinePermutation {
+	PipelineDesc desc;
+	u64 hash;
+	VkPipeline pipeline;
+	std::atomic<bool> ready;
+};
+
+// NOTE: a pair of shaders the permutations specialize, base is the first pipeline built from it and every later one
+// derives from it
+struct PipelineProgramShaders {
+	VkShaderModule vert;
+	VkShaderModule frag;
+	VkVertexInputAttributeDescription attributes[SHADER_MAX_INPUTS];
+	u32 attribute_count;
+	VkPipeline base;
+};
+
+// NOTE: Graphics pipelines keyed by the hash of a PipelineDesc. Features are specialization constants rather than
+// separate shaders, so the driver folds away the branches a permutation doesn't take. get() compiles a missing
+// permutation on the spot, prewarm() compiles a list of them on a background thread as derivatives of their program's
+// base pipeline, and get() draws with the base until they're done. Anything the prewarm thread reads only changes
+// after waitForPrewarm.
+struct PipelinePermutations {
+	Platform *platform;
+	VkDevice device;
+	VkPipelineCache cache;
+	VkRenderPass render_pass;
+	VkPipelineLayout layout;
+	VkVertexInputBindingDescription bindings[2];
+	u32 binding_count;
+
+	PipelineProgramShaders programs[(u32)PipelineProgram::Count];
+	PipelinePermutation permutations[PIPELINE_MAX_PERMUTATIONS];
+	u32 permutation_count;
+
+	PlatformThread prewarm_thread;
+	bool prewarming;
+	u32 prewarm_first;
+	u32 prewarm_end;
+
+	void init(Platform *platform, VkDevice device) {
+		this->platform = platform;
+		this->device = device;
+		permutation_count = 0;
+		prewarming = false;
+		for(u32 i = 0; i < (u32)PipelineProgram::Count; i++) programs[i] = {};
+	}
+
+	// NOTE: what every permutation is built against, set before the first get after a release
+	void setTarget(VkPipelineCache cache, VkRenderPass render_pass, VkPipelineLayout layout, VkVertexInputBindingDescription *bindings, u32 binding_count) {
+		waitForPrewarm();
+		this->cache = cache;
+		this->render_pass = render_pass;
+		this->layout = layout;
+		Assert(binding_count <= ArrayCount(this->bindings));
+		memcpy(this->bindings, bindings, sizeof(VkVertexInputBindingDescription) * binding_count);
+		this->binding_count = binding_count;
+	}
+
+	// NOTE: takes ownership of the modules, attributes are already matched against the vertex shader's inputs
+	void setProgram(PipelineProgram program, VkShaderModule vert, VkShaderModule frag, VkVertexInputAttributeDescription *attributes, u32 attribute_count) {
+		waitForPrewarm();
+		PipelineProgramShaders *shaders = &programs[(u32)program];
+		Assert(shaders->vert == VK_NULL_HANDLE);
+		shaders->vert = vert;
+		shaders->frag = frag;
+		memcpy(shaders->attributes, attributes, sizeof(VkVertexInputAttributeDescription) * attribute_count);
+		shaders->attribute_count = attribute_count;
+		shaders->base = VK_NULL_HANDLE;
+	}
+
+	PipelinePermutation *find(PipelineDesc *desc, u64 hash) {
+		for(u32 i = 0; i < permutation_count; i++) {
+			PipelinePermutation *permutation = &permutations[i];
+			if(permutation->hash == hash && memcmp(&permutation->desc, desc, sizeof(PipelineDesc)) == 0) return permutation;
+		}
+		return 0;
+	}
+
+	PipelinePermutation *add(PipelineDesc *desc, u64 hash) {
+		if(permutation_count == PIPELINE_MAX_PERMUTATIONS) {
+			platform->error("Too many pipeline permutations");
+			return 0;
+		}
+		PipelinePermutation *result = &permutations[permutation_count++];
+		result->desc = *desc;
+		result->hash = hash;
+		result->pipeline = VK_NULL_HANDLE;
+		result->ready.store(false, std::memory_order_relaxed);
+		return result;
+	}
+
+	VkPipeline build(PipelineDesc *desc) {
+		PipelineProgramShaders *shaders = &programs[desc->program];
+
+		VkSpecializationMapEntry spec_entries[PIPELINE_SPEC_CONSTANT_COUNT];
+		for(u32 i = 0; i < PIPELINE_SPEC_CONSTANT_COUNT; i++) {
+			spec_entries[i].constantID = i;
+			spec_entries[i].offset = i * sizeof(u32);
+			spec_entries[i].size = sizeof(u32);
+		}
+
+		VkSpecializationInfo spec_info = {};
+		spec_info.mapEntryCount = PIPELINE_SPEC_CONSTANT_COUNT;
+		spec_info.pMapEntries = spec_entries;
+		spec_info.dataSize = sizeof(desc->spec_constants);
+		spec_info.pData = desc->spec_constants;
+
+		VkPipelineShaderStageCreateInfo shader_stage_infos[2] = {};
+		shader_stage_infos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage_infos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shader_stage_infos[0].module = shaders->vert;
+		shader_stage_infos[0].pName = "main";
+		shader_stage_infos[0].pSpecializationInfo = &spec_info;
+
+		shader_stage_infos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage_infos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shader_stage_infos[1].module = shaders->frag;
+		shader_stage_infos[1].pName = "main";
+		shader_stage_infos[1].pSpecializationInfo = &spec_info;
+
+		VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
+		vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertex_input_info.vertexBindingDescriptionCount = binding_count;
+		vertex_input_info.pVertexBindingDescriptions = bindings;
+		vertex_input_info.vertexAttributeDescriptionCount = shaders->attribute_count;
+		vertex_input_info.pVertexAttributeDescriptions = shaders->attributes;
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {};
+		input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
+
+		VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {};
+		depth_stencil_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depth_stencil_create_info.depthTestEnable = VK_TRUE;
+		depth_stencil_create_info.depthWriteEnable = VK_TRUE;
+		depth_stencil_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
+		depth_stencil_create_info.depthBoundsTestEnable = VK_FALSE;
+		depth_stencil_create_info.minDepthBounds = 0.0f;
+		depth_stencil_create_info.maxDepthBounds = 1.0f;
+		depth_stencil_create_info.stencilTestEnable = VK_FALSE;
+
+		VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
+		viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewport_state_create_info.viewportCount = 1;
+		viewport_state_create_info.scissorCount = 1;
+
+		// NOTE: viewport and scissor are set per command buffer so the pipelines outlive swap chain resizes
+		VkDynamicState dynamic_states[] = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+
+		VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
+		dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamic_state_create_info.dynamicStateCount = ArrayCount(dynamic_states);
+		dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer_create_info = {};
+		rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer_create_info.depthClampEnable = VK_FALSE;
+		rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
+		rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer_create_info.cullMode = desc->cull_mode;
+		rasterizer_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer_create_info.depthBiasEnable = VK_FALSE;
+		rasterizer_create_info.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo msaa_state_create_info = {};
+		msaa_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		msaa_state_create_info.sampleShadingEnable = VK_FALSE;
+		msaa_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		msaa_state_create_info.minSampleShading = 1.0f;
+
+		VkPipelineColorBlendAttachmentState color_blend_attachment = {};
+		color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		color_blend_attachment.blendEnable = VK_FALSE;
+
+		VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {};
+		color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		color_blend_state_create_info.logicOpEnable = VK_FALSE;
+		color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
+		color_blend_state_create_info.attachmentCount = 1;
+		color_blend_state_create_info.pAttachments = &color_blend_attachment;
+
+		VkGraphicsPipelineCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		create_info.stageCount = ArrayCount(shader_stage_infos);
+		create_info.pStages = shader_stage_infos;
+		create_info.pVertexInputState = &vertex_input_info;
+		create_info.pInputAssemblyState = &input_assembly_create_info;
+		create_info.pViewportState = &viewport_state_create_info;
+		create_info.pRasterizationState = &rasterizer_create_info;
+		create_info.pMultisampleState = &msaa_state_create_info;
+		create_info.pDepthStencilState = &depth_stencil_create_info;
+		create_info.pColorBlendState = &color_blend_state_create_info;
+		create_info.pDynamicState = &dynamic_state_create_info;
+		create_info.layout = layout;
+		create_info.renderPass = render_pass;
+		create_info.subpass = 0;
+		create_info.basePipelineIndex = -1;
+		// NOTE: derivatives let the driver reuse what it already built for the base, which is what the prewarm relies on
+		if(shaders->base == VK_NULL_HANDLE) {
+			create_info.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+		} else {
+			create_info.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+			create_info.basePipelineHandle = shaders->base;
+		}
+
+		VkPipeline result = VK_NULL_HANDLE;
+		if(vkCreateGraphicsPipelines(device, cache, 1, &create_info, 0, &result) != VK_SUCCESS) {
+			platform->error(formatString("Couldn't create graphics pipeline permutation %016llx", (unsigned long long)desc->hash()));
+		}
+		if(shaders->base == VK_NULL_HANDLE) shaders->base = result;
+		return result;
+	}
+
+	// NOTE: the first permutation asked for of each program becomes its base, so get those on the main thread before
+	// prewarming any others of the same program
+	VkPipeline get(PipelineDesc *desc) {
+		u64 hash = desc->hash();
+		PipelinePermutation *permutation = find(desc, hash);
+		if(permutation) {
+			if(permutation->ready.load(std::memory_order_acquire)) return permutation->pipeline;
+			return programs[desc->program].base;
+		}
+
+		permutation = add(desc, hash);
+		if(permutation == 0) return programs[desc->program].base;
+		u64 start = platform->getPerformanceCounter();
+		permutation->pipeline = build(desc);
+		permutation->ready.store(true, std::memory_order_release);
+		f32 ms = (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f;
+		printf("Compiled pipeline permutation %016llx in %.3fms\n", (unsigned long long)hash, ms);
+		return permutation->pipeline;
+	}
+
+	static int prewarmMain(void *data) {
+		PipelinePermutations *pipelines = (PipelinePermutations *)data;
+		u64 start = pipelines->platform->getPerformanceCounter();
+		for(u32 i = pipelines->prewarm_first; i < pipelines->prewarm_end; i++) {
+			PipelinePermutation *permutation = &pipelines->permutations[i];
+			permutation->pipeline = pipelines->build(&permutation->desc);
+			permutation->ready.store(true, std::memory_order_release);
+		}
+		f32 ms = (f32)(pipelines->platform->getPerformanceCounter() - start) / (f32)pipelines->platform->getPerformanceFrequency() * 1000.0f;
+		printf("Prewarmed %u pipeline permutations in %.3fms\n", pipelines->prewarm_end - pipelines->prewarm_first, ms);
+		return 0;
+	}
+
+	// NOTE: queues whichever of descs don't exist yet, their programs need a base already
+	void prewarm(PipelineDesc *descs, u32 count) {
+		waitForPrewarm();
+		prewarm_first = permutation_count;
+		for(u32 i = 0; i < count; i++) {
+			Assert(programs[descs[i].program].base != VK_NULL_HANDLE);
+			u64 hash = descs[i].hash();
+			if(find(&descs[i], hash) == 0) add(&descs[i], hash);
+		}
+		prewarm_end = permutation_count;
+		if(prewarm_end == prewarm_first) return;
+		prewarm_thread = platform->createThread(prewarmMain, "pipeline prewarm", this);
+		prewarming = true;
+	}
+
+	void waitForPrewarm() {
+		if(!prewarming) return;
+		platform->waitThread(&prewarm_thread);
+		prewarming = false;
+	}
+
+	// NOTE: the pipelines wait in queue for the frames still using them, modules aren't needed once they're built
+	void release(DeletionQueue *queue) {
+		waitForPrewarm();
+		for(u32 i = 0; i < permutation_count; i++) {
+			if(permutations[i].pipeline != VK_NULL_HANDLE) queue->pipeline(permutations[i].pipeline);
+		}
+		permutation_count = 0;
+		destroyPrograms();
+	}
+
+	void destroyPrograms() {
+		for(u32 i = 0; i < (u32)PipelineProgram::Count; i++) {
+			PipelineProgramShaders *shaders = &programs[i];
+			if(shaders->vert != VK_NULL_HANDLE) vkDestroyShaderModule(device, shaders->vert, 0);
+			if(shaders->frag != VK_NULL_HANDLE) vkDestroyShaderModule(device, shaders->frag, 0);
+			*shaders = {};
+		}
+	}
+
+	void destroy() {
+		waitForPrewarm();
+		for(u32 i = 0; i < permutation_count; i++) {
+			if(permutations[i].pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, permutations[i].pipeline, 0);
+		}
+		permutation_count = 0;
+		destroyPrograms();
+	}
+};
@@ -0,0 +1,186 @@
+#define GPU_PROFILER_MAX_FRAMES 4
+#define GPU_PROFILER_MAX_SCOPES 32
+#define GPU_PROFILER_MAX_TIMINGS 32
+#define GPU_PROFILER_HISTORY 128
+
+// NOTE: one named timing, milliseconds is the latest sample and history is a ring of the last GPU_PROFILER_HISTORY
+struct GpuTiming {
+	const char *name;
+	f32 milliseconds;
+	f32 history[GPU_PROFILER_HISTORY];
+	u32 history_head;
+	u32 history_count;
+
+	void addSample(f32 sample) {
+		milliseconds = sample;
+		history[history_head] = sample;
+		history_head = (history_head + 1) % GPU_PROFILER_HISTORY;
+		if(history_count < GPU_PROFILER_HISTORY) history_count++;
+	}
+
+	f32 averageMilliseconds() {
+		if(history_count == 0) return 0.0f;
+		f32 total = 0.0f;
+		for(u32 i = 0; i < history_count; i++) total += history[i];
+		return total / (f32)history_count;
+	}
+
+	f32 maxMilliseconds() {
+		f32 result = 0.0f;
+		for(u32 i = 0; i < history_count; i++) {
+			if(history[i] > result) result = history[i];
+		}
+		return result;
+	}
+};
+
+// NOTE: Timestamp scopes written into the frame's command buffer. Every frame in flight owns its own range of the
+// query pool and its results are only read back once that frame's fence has been waited on again, so reading them
+// never stalls the cpu on the gpu. Names are expected to be string literals, they're compared by pointer first.
+struct GpuProfiler {
+	VkDevice device;
+	VkQueryPool query_pool;
+	bool enabled;
+	f32 timestamp_period; // NOTE: nanoseconds per tick
+	u64 timestamp_mask;
+	u32 frame_count;
+	u32 frame;
+
+	const char *scope_names[GPU_PROFILER_MAX_FRAMES][GPU_PROFILER_MAX_SCOPES];
+	u32 scope_counts[GPU_PROFILER_MAX_FRAMES];
+
+	GpuTiming timings[GPU_PROFILER_MAX_TIMINGS];
+	u32 timing_count;
+
+	void init(Platform *platform, VkPhysicalDevice physical_device, VkDevice device, u32 graphics_family, u32 frame_count) {
+		this->device = device;
+		this->frame_count = frame_count;
+		frame = 0;
+		timing_count = 0;
+		query_pool = VK_NULL_HANDLE;
+		enabled = false;
+		if(frame_count > GPU_PROFILER_MAX_FRAMES) {
+			platform->error("Too many frames in flight for the gpu profiler");
+			return;
+		}
+
+		VkPhysicalDeviceProperties device_props;
+		vkGetPhysicalDeviceProperties(physical_device, &device_props);
+		timestamp_period = device_props.limits.timestampPeriod;
+
+		u32 valid_bits = queueTimestampBits(platform, physical_device, graphics_family);
+		timestamp_mask = timestampMask(valid_bits);
+		enabled = valid_bits > 0 && timestamp_period > 0.0f;
+		if(!enabled) {
+			printf("GPU profiler disabled, graphics queue has no timestamps\n");
+			return;
+		}
+
+		VkQueryPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		pool_info.queryCount = frame_count * GPU_PROFILER_MAX_SCOPES * 2;
+		if(vkCreateQueryPool(device, &pool_info, 0, &query_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create gpu profiler query pool");
+		}
+
+		for(u32 f = 0; f < frame_count; f++) scope_counts[f] = 0;
+	}
+
+	static u32 queueTimestampBits(Platform *platform, VkPhysicalDevice physical_device, u32 family) {
+		u32 family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, 0);
+		VkQueueFamilyProperties *families = (VkQueueFamilyProperties *)platform->alloc(sizeof(VkQueueFamilyProperties) * family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families);
+		u32 result = family < family_count ? families[family].timestampValidBits : 0;
+		platform->free(families);
+		return result;
+	}
+
+	static u64 timestampMask(u32 valid_bits) {
+		return valid_bits >= 64 ? ~0ull : ((1ull << valid_bits) - 1);
+	}
+
+	f32 ticksToMilliseconds(u64 start, u64 end, u64 mask) {
+		u64 ticks = (end - start) & mask;
+		return (f32)((f64)ticks * timestamp_period / 1000000.0);
+	}
+
+	GpuTiming *findTiming(const char *name) {
+		for(u32 i = 0; i < timing_count; i++) {
+			if(timings[i].name == name || strcmp(timings[i].name, name) == 0) return &timings[i];
+		}
+		return 0;
+	}
+
+	// NOTE: also how timings measured outside the frame (upload batches) get into the same history
+	void addSample(const char *name, f32 milliseconds) {
+		GpuTiming *timing = findTiming(name);
+		if(timing == 0) {
+			if(timing_count >= GPU_PROFILER_MAX_TIMINGS) return;
+			timing = &timings[timing_count++];
+			*timing = {};
+			timing->name = name;
+		}
+		timing->addSample(milliseconds);
+	}
+
+	// NOTE: call once the frame's fence has signalled, collects what that frame recorded last time around
+	void beginFrame(u32 frame) {
+		this->frame = frame;
+		if(!enabled || scope_counts[frame] == 0) return;
+
+		u64 results[GPU_PROFILER_MAX_SCOPES * 2];
+		u32 query_count = scope_counts[frame] * 2;
+		VkResult result = vkGetQueryPoolResults(device, query_pool, frame * GPU_PROFILER_MAX_SCOPES * 2, query_count, sizeof(u64) * query_count, results, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+		if(result == VK_SUCCESS) {
+			for(u32 s = 0; s < scope_counts[frame]; s++) {
+				addSample(scope_names[frame][s], ticksToMilliseconds(results[s * 2], results[s * 2 + 1], timestamp_mask));
+			}
+		}
+		scope_counts[frame] = 0;
+	}
+
+	// NOTE: record at the start of the frame's command buffer, outside any render pass
+	void reset(VkCommandBuffer cmd) {
+		if(!enabled) return;
+		vkCmdResetQueryPool(cmd, query_pool, frame * GPU_PROFILER_MAX_SCOPES * 2, GPU_PROFILER_MAX_SCOPES * 2);
+	}
+
+	// NOTE: returns the scope to hand to endScope, scopes past GPU_PROFILER_MAX_SCOPES are dropped
+	u32 beginScope(VkCommandBuffer cmd, const char *name) {
+		if(!enabled || scope_counts[frame] >= GPU_PROFILER_MAX_SCOPES) return GPU_PROFILER_MAX_SCOPES;
+
+		u32 scope = scope_counts[frame]++;
+		scope_names[frame][scope] = name;
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, (frame * GPU_PROFILER_MAX_SCOPES + scope) * 2);
+		return scope;
+	}
+
+	void endScope(VkCommandBuffer cmd, u32 scope) {
+		if(scope >= GPU_PROFILER_MAX_SCOPES) return;
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, (frame * GPU_PROFILER_MAX_SCOPES + scope) * 2 + 1);
+	}
+
+	// NOTE: latest gpu milliseconds for a scope, zero until it has been measured
+	f32 getMilliseconds(const char *name) {
+		GpuTiming *timing = findTiming(name);
+		return timing ? timing->milliseconds : 0.0f;
+	}
+
+	f32 getAverageMilliseconds(const char *name) {
+		GpuTiming *timing = findTiming(name);
+		return timing ? timing->averageMilliseconds() : 0.0f;
+	}
+
+	void printTimings() {
+		for(u32 i = 0; i < timing_count; i++) {
+			GpuTiming *timing = &timings[i];
+			printf("GPU %-12s %8.3fms avg %8.3fms max over %u samples\n", timing->name, timing->averageMilliseconds(), timing->maxMilliseconds(), timing->history_count);
+		}
+	}
+
+	void destroy() {
+		if(query_pool != VK_NULL_HANDLE) vkDestroyQueryPool(device, query_pool, 0);
+	}
+};
@@ -0,0 +1,1670 @@
+#include <core/render_context.h>
+
+#define RENDER_CONTEXT_MAX_COMMANDS 65536 // NOTE: per frame, the command index is the low 16 bits of a sort key
+#define RENDER_CONTEXT_MAX_STATES 16384
+#define RENDER_CONTEXT_MAX_CLEARS 256
+#define RENDER_CONTEXT_MAX_SEGMENTS 64
+#define RENDER_CONTEXT_MAX_PIPELINES 256
+#define RENDER_CONTEXT_MAX_TEXTURE_SETS 1024 // NOTE: per frame
+#define RENDER_CONTEXT_MAX_CONSTANT_SETS 32
+#define RENDER_CONTEXT_MAX_RENDER_PASSES 16
+#define RENDER_CONTEXT_MAX_FRAMEBUFFERS 64
+#define RENDER_CONTEXT_MAX_TARGETS 4
+#define RENDER_CONTEXT_MAX_VERTEX_BUFFERS 4
+#define RENDER_CONTEXT_MAX_SLOTS 8 // NOTE: constant buffer, texture and sampler slots each
+#define RENDER_CONTEXT_CONSTANT_RANGE 1024 // NOTE: the most a constant buffer can hold, every descriptor covers this much
+#define RENDER_CONTEXT_CONSTANT_RING_SIZE Megabytes(4) // NOTE: per frame
+
+#define RENDER_CONTEXT_DIRTY_PIPELINE (1 << 0)
+#define RENDER_CONTEXT_DIRTY_CONSTANTS (1 << 1)
+#define RENDER_CONTEXT_DIRTY_TEXTURES (1 << 2)
+#define RENDER_CONTEXT_DIRTY_BUFFERS (1 << 3)
+#define RENDER_CONTEXT_DIRTY_VIEWPORT (1 << 4)
+#define RENDER_CONTEXT_DIRTY_SCISSOR (1 << 5)
+#define RENDER_CONTEXT_DIRTY_ALL 0xff
+
+u32 RenderContext::format_values[(u32)RenderContext::Format::MAX] = {
+	VK_FORMAT_R32G32_SFLOAT,
+	VK_FORMAT_R32G32B32_SFLOAT,
+	VK_FORMAT_R8G8B8A8_UNORM,
+	VK_FORMAT_R32_UINT,
+	VK_FORMAT_R16_UINT,
+	VK_FORMAT_R32G32B32A32_SFLOAT,
+	VK_FORMAT_D24_UNORM_S8_UINT,
+};
+
+u32 RenderContext::format_sizes[(u32)RenderContext::Format::MAX] = {8, 12, 4, 4, 2, 16, 4};
+
+u32 RenderContext::topologies[(u32)RenderContext::Topology::MAX] = {
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+};
+
+u32 RenderContext::buffer_types[(u32)RenderContext::BufferType::MAX] = {
+	VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+	VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+};
+
+internal_func u64 hashRenderContextKey(const void *data, u64 size) {
+	u64 hash = 14695981039346656037ull;
+	const u8 *bytes = (const u8 *)data;
+	for(u64 i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// NOTE: LSD radix sort, skipping the bytes every key has in common. scratch holds at least count keys.
+internal_func void radixSortKeys(u64 *keys, u64 *scratch, u32 count) {
+	u64 any_set = 0;
+	u64 all_set = ~0ull;
+	for(u32 i = 0; i < count; i++) {
+		any_set |= keys[i];
+		all_set &= keys[i];
+	}
+	u64 varying = any_set ^ all_set;
+
+	u64 *from = keys;
+	u64 *to = scratch;
+	for(u32 shift = 0; shift < 64; shift += 8) {
+		if(((varying >> shift) & 0xff) == 0) continue;
+		u32 offsets[256] = {};
+		for(u32 i = 0; i < count; i++) offsets[(from[i] >> shift) & 0xff]++;
+		u32 sum = 0;
+		for(u32 b = 0; b < 256; b++) {
+			u32 bucket_count = offsets[b];
+			offsets[b] = sum;
+			sum += bucket_count;
+		}
+		for(u32 i = 0; i < count; i++) to[offsets[(from[i] >> shift) & 0xff]++] = from[i];
+		u64 *swap = from;
+		from = to;
+		to = swap;
+	}
+	if(from != keys) memcpy(keys, from, sizeof(u64) * count);
+}
+
+// NOTE: what the handles in render_context.h point at
+
+struct VulkanContextBuffer {
+	VkBuffer buffer;
+	GpuAllocation allocation;
+};
+
+struct VulkanContextTexture {
+	VkImage image;
+	GpuAllocation allocation;
+	VkImageView view;
+	VkFormat format;
+	u32 width;
+	u32 height;
+	bool depth;
+};
+
+struct VulkanContextSampler {
+	VkSampler sampler;
+};
+
+// NOTE: the last data written, so a constant updated in an earlier frame is copied into this frame's ring partition
+// when a draw uses it
+struct VulkanContextConstant {
+	u32 size;
+	u32 offset;
+	u64 frame;
+	u8 *data;
+};
+
+struct VulkanContextShader {
+	u32 id; // NOTE: never reused, pipelines are keyed by it
+	VkShaderModule vert;
+	VkShaderModule frag;
+	ShaderInput inputs[SHADER_MAX_INPUTS];
+	u32 input_count;
+	VkPipelineLayout pipeline_layout;
+	VkDescriptorSetLayout texture_set_layout;
+	VkDescriptorSet constant_set;
+	u32 constant_bindings[RENDER_CONTEXT_MAX_SLOTS]; // NOTE: sorted, the order dynamic offsets are given in
+	u32 constant_binding_count;
+	u32 texture_bindings[RENDER_CONTEXT_MAX_SLOTS];
+	u32 texture_binding_count;
+};
+
+struct VulkanContextLayout {
+	u32 id;
+	VkVertexInputAttributeDescription attributes[SHADER_MAX_INPUTS];
+	u32 attribute_count;
+	VkVertexInputBindingDescription bindings[RENDER_CONTEXT_MAX_VERTEX_BUFFERS];
+	u32 binding_count;
+};
+
+struct VulkanContextRasterState {
+	bool scissor_enabled;
+	VkCullModeFlags cull_mode;
+};
+
+struct VulkanContextBlendState {
+	bool enabled;
+};
+
+struct VulkanContextDepthStencilState {
+	bool test;
+	bool write;
+};
+
+// NOTE: everything the immediate style bind calls set, draws snapshot it into a RenderContextState when it changed
+struct RenderContextBindings {
+	VulkanContextShader *shader;
+	VulkanContextLayout *layout;
+	VulkanContextRasterState *raster; // NOTE: 0 for the defaults, no scissor and back face culling
+	VulkanContextBlendState *blend; // NOTE: 0 for no blending
+	VulkanContextDepthStencilState *depth_stencil; // NOTE: 0 for a depth test and write
+	VulkanContextConstant *constants[RENDER_CONTEXT_MAX_SLOTS];
+	VulkanContextTexture *textures[RENDER_CONTEXT_MAX_SLOTS];
+	VulkanContextSampler *samplers[RENDER_CONTEXT_MAX_SLOTS];
+	VulkanContextBuffer *vertex_buffers[RENDER_CONTEXT_MAX_VERTEX_BUFFERS];
+	VulkanContextBuffer *index_buffer;
+	VkIndexType index_type;
+	VkViewport viewport;
+	bool viewport_set; // NOTE: the whole target otherwise
+	VkRect2D clip_rect;
+	RenderContext::Topology topology;
+};
+
+struct PlatformRenderState {
+	RenderContextBindings bindings;
+};
+
+// NOTE: back buffer when there's neither colours nor depth
+struct RenderContextTargets {
+	VulkanContextTexture *colors[RENDER_CONTEXT_MAX_TARGETS];
+	u32 color_count;
+	VulkanContextTexture *depth;
+};
+
+struct RenderContextTargetFormats {
+	u32 colors[RENDER_CONTEXT_MAX_TARGETS];
+	u32 color_count;
+	u32 depth;
+};
+
+struct RenderContextPipelineKey {
+	u32 shader;
+	u32 layout;
+	u32 topology;
+	u32 cull_mode;
+	u32 blend;
+	u32 depth_test;
+	u32 depth_write;
+	RenderContextTargetFormats formats;
+};
+
+struct RenderContextPipeline {
+	u64 hash;
+	RenderContextPipelineKey key;
+	VkPipeline pipeline;
+};
+
+struct RenderContextTextureSet {
+	u64 hash;
+	VkDescriptorSetLayout layout;
+	VkImageView views[RENDER_CONTEXT_MAX_SLOTS];
+	VkSampler samplers[RENDER_CONTEXT_MAX_SLOTS];
+	VkDescriptorSet set;
+};
+
+struct RenderContextConstantSet {
+	VkDescriptorSetLayout layout;
+	VkDescriptorSet set;
+};
+
+struct RenderContextRenderPass {
+	RenderContextTargetFormats formats;
+	VkRenderPass render_pass;
+};
+
+struct RenderContextFramebuffer {
+	VkImageView views[RENDER_CONTEXT_MAX_TARGETS + 1];
+	u32 view_count;
+	VkRenderPass render_pass;
+	VkFramebuffer framebuffer;
+};
+
+// NOTE: resolved Vulkan objects for a run of draws, a new one is only made when a bind changed something
+struct RenderContextState {
+	VkPipeline pipeline;
+	VkPipelineLayout pipeline_layout;
+	VkDescriptorSet constant_set;
+	VkDescriptorSet texture_set;
+	u32 constant_offsets[RENDER_CONTEXT_MAX_SLOTS];
+	u32 constant_offset_count;
+	VkBuffer vertex_buffers[RENDER_CONTEXT_MAX_VERTEX_BUFFERS];
+	u32 vertex_buffer_count;
+	VkBuffer index_buffer;
+	VkIndexType index_type;
+	VkViewport viewport;
+	u64 sort_key; // NOTE: pipeline, texture set and state, 0 for draws that have to keep their order
+};
+
+enum class RenderContextCommandType : u32 {
+	Draw,
+	DrawIndexed,
+	Clear,
+};
+
+struct RenderContextCommand {
+	RenderContextCommandType type;
+	u32 state; // NOTE: index into clears for a clear
+	VkRect2D scissor;
+	u32 count;
+	u32 first;
+	s32 vertex_offset;
+};
+
+struct RenderContextClear {
+	VkClearAttachment attachment;
+	VkRect2D rect;
+};
+
+// NOTE: a run of commands drawing to the same targets, each offscreen one becomes a render pass of its own
+struct RenderContextSegment {
+	RenderContextTargets targets;
+	u32 first_command;
+	u32 command_count;
+	u32 width;
+	u32 height;
+};
+
+// NOTE: RenderContext on top of VulkanRenderer. The bind calls only record what is bound, and draws copy a small
+// command into this frame's list, resolving pipelines and descriptor sets only when a bind changed them. Nothing
+// touches a command buffer until the renderer records the frame: offscreen targets get their render passes before
+// the frame graph runs, and back buffer draws go in a secondary command buffer executed after the scene in the main
+// pass. Runs of depth tested, unblended draws are sorted by pipeline, texture set and state on the way, everything
+// else keeps its order, and binds that wouldn't change anything are skipped. final so calls from the engine don't go
+// through the vtable, the game and imgui pay one indirect call per bind or draw and nothing more.
+//
+// Shaders are data/shaders/<name>.vert.spv and .frag.spv. Constant buffer slot N is set 0 binding N, texture and
+// sampler slot N are one combined image sampler at set 1 binding N, and a shader layout's elements are vertex input
+// locations in order. Clip space is Vulkan's, y points down.
+struct VulkanRenderContext final : RenderContext {
+	Platform *platform;
+	VulkanRenderer *renderer;
+	VkDevice device;
+
+	UniformRingBuffer constant_ring;
+	VkDescriptorPool constant_pool;
+	RenderContextConstantSet constant_sets[RENDER_CONTEXT_MAX_CONSTANT_SETS];
+	u32 constant_set_count;
+	VkDescriptorPool texture_pools[MAX_FRAMES_IN_FLIGHT];
+	RenderContextTextureSet texture_sets[RENDER_CONTEXT_MAX_TEXTURE_SETS];
+	u16 texture_set_table[RENDER_CONTEXT_MAX_TEXTURE_SETS * 2]; // NOTE: index + 1 into texture_sets, 0 is empty
+	u32 texture_set_count;
+	RenderContextPipeline pipelines[RENDER_CONTEXT_MAX_PIPELINES];
+	u32 pipeline_count;
+	RenderContextRenderPass render_passes[RENDER_CONTEXT_MAX_RENDER_PASSES];
+	u32 render_pass_count;
+	RenderContextFramebuffer framebuffers[RENDER_CONTEXT_MAX_FRAMEBUFFERS];
+	u32 framebuffer_count;
+	VkCommandPool command_pools[MAX_FRAMES_IN_FLIGHT];
+	VkCommandBuffer overlay_command_buffers[MAX_FRAMES_IN_FLIGHT];
+	VkFormat depth_format;
+	VulkanContextTexture *default_texture;
+	VulkanContextSampler *default_sampler;
+	u32 next_id;
+	u64 frame;
+
+	RenderContextBindings bound;
+	u32 dirty;
+	u32 current_state;
+	VkRect2D current_scissor;
+
+	RenderContextState *states;
+	u32 state_count;
+	RenderContextCommand *commands;
+	u64 *keys;
+	u64 *scratch_keys;
+	u32 command_count;
+	RenderContextClear clears[RENDER_CONTEXT_MAX_CLEARS];
+	u32 clear_count;
+	RenderContextSegment segments[RENDER_CONTEXT_MAX_SEGMENTS];
+	u32 segment_count;
+
+	void attach(Platform *platform, VulkanRenderer *renderer) {
+		this->platform = platform;
+		this->renderer = renderer;
+		device = renderer->device;
+	}
+
+	// NOTE: the renderer owns the swap chain, the size and refresh rate are whatever it picked
+	void init(s32 width, s32 height, s32 refresh_rate, PlatformWindow *window) {
+		depth_format = renderer->findDepthFormat(platform);
+		next_id = 1;
+		frame = 0;
+		constant_set_count = 0;
+		texture_set_count = 0;
+		pipeline_count = 0;
+		render_pass_count = 0;
+		framebuffer_count = 0;
+
+		VkPhysicalDeviceProperties device_props;
+		vkGetPhysicalDeviceProperties(renderer->physical_device, &device_props);
+		constant_ring.init(platform, device, &renderer->gpu_memory, MAX_FRAMES_IN_FLIGHT, RENDER_CONTEXT_CONSTANT_RING_SIZE, device_props.limits.minUniformBufferOffsetAlignment, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+		VkDescriptorPoolSize constant_pool_size = {};
+		constant_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		constant_pool_size.descriptorCount = RENDER_CONTEXT_MAX_CONSTANT_SETS * RENDER_CONTEXT_MAX_SLOTS;
+		VkDescriptorPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &constant_pool_size;
+		pool_info.maxSets = RENDER_CONTEXT_MAX_CONSTANT_SETS;
+		if(vkCreateDescriptorPool(device, &pool_info, 0, &constant_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create render context descriptor pool");
+		}
+
+		VkDescriptorPoolSize texture_pool_size = {};
+		texture_pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		texture_pool_size.descriptorCount = RENDER_CONTEXT_MAX_TEXTURE_SETS * RENDER_CONTEXT_MAX_SLOTS;
+		pool_info.pPoolSizes = &texture_pool_size;
+		pool_info.maxSets = RENDER_CONTEXT_MAX_TEXTURE_SETS;
+
+		VkCommandPoolCreateInfo command_pool_info = {};
+		command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		command_pool_info.queueFamilyIndex = (u32)renderer->graphics_queue_index;
+
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			if(vkCreateDescriptorPool(device, &pool_info, 0, &texture_pools[f]) != VK_SUCCESS) {
+				platform->error("Couldn't create render context descriptor pool");
+			}
+			if(vkCreateCommandPool(device, &command_pool_info, 0, &command_pools[f]) != VK_SUCCESS) {
+				platform->error("Couldn't create render context command pool");
+			}
+
+			VkCommandBufferAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.commandPool = command_pools[f];
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			alloc_info.commandBufferCount = 1;
+			if(vkAllocateCommandBuffers(device, &alloc_info, &overlay_command_buffers[f]) != VK_SUCCESS) {
+				platform->error("Couldn't allocate render context command buffer");
+			}
+		}
+
+		states = (RenderContextState *)platform->alloc(sizeof(RenderContextState) * RENDER_CONTEXT_MAX_STATES);
+		commands = (RenderContextCommand *)platform->alloc(sizeof(RenderContextCommand) * RENDER_CONTEXT_MAX_COMMANDS);
+		keys = (u64 *)platform->alloc(sizeof(u64) * RENDER_CONTEXT_MAX_COMMANDS);
+		scratch_keys = (u64 *)platform->alloc(sizeof(u64) * RENDER_CONTEXT_MAX_COMMANDS);
+
+		// NOTE: what an empty texture slot samples
+		u32 white = 0xffffffff;
+		Texture2D white_texture = createTexture2D(&white, 1, 1, Format::u32_unorm);
+		default_texture = (VulkanContextTexture *)white_texture.texture;
+		Sampler sampler = createSampler();
+		default_sampler = (VulkanContextSampler *)sampler.sampler;
+
+		renderer->context_offscreen_record = recordOffscreen;
+		renderer->context_overlay_record = recordOverlay;
+		renderer->context_data = this;
+		resetFrame();
+	}
+
+	// NOTE: anything the game still holds is its own to destroy first
+	void uninit() {
+		vkDeviceWaitIdle(device);
+		renderer->context_offscreen_record = 0;
+		renderer->context_overlay_record = 0;
+		renderer->context_data = 0;
+
+		Texture2D white_texture = {};
+		white_texture.texture = default_texture;
+		destroyTexture2D(&white_texture);
+		Sampler sampler = {};
+		sampler.sampler = default_sampler;
+		destroySampler(&sampler);
+
+		for(u32 i = 0; i < pipeline_count; i++) {
+			if(pipelines[i].pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipelines[i].pipeline, 0);
+		}
+		for(u32 i = 0; i < framebuffer_count; i++) vkDestroyFramebuffer(device, framebuffers[i].framebuffer, 0);
+		for(u32 i = 0; i < render_pass_count; i++) vkDestroyRenderPass(device, render_passes[i].render_pass, 0);
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			vkDestroyDescriptorPool(device, texture_pools[f], 0);
+			vkDestroyCommandPool(device, command_pools[f], 0);
+		}
+		vkDestroyDescriptorPool(device, constant_pool, 0);
+		constant_ring.destroy(device, &renderer->gpu_memory);
+
+		platform->free(states);
+		platform->free(commands);
+		platform->free(keys);
+		platform->free(scratch_keys);
+	}
+
+	// NOTE: after the renderer's startFrame, once this frame slot's fence has signalled
+	void beginFrame() {
+		u32 slot = renderer->current_frame;
+		frame++;
+		constant_ring.beginFrame(slot);
+		vkResetDescriptorPool(device, texture_pools[slot], 0);
+		vkResetCommandPool(device, command_pools[slot], 0);
+		texture_set_count = 0;
+		memset(texture_set_table, 0, sizeof(texture_set_table));
+		resetFrame();
+	}
+
+	void resetFrame() {
+		command_count = 0;
+		state_count = 0;
+		clear_count = 0;
+		segment_count = 0;
+		RenderContextTargets back_buffer = {};
+		beginSegment(&back_buffer);
+	}
+
+	// NOTE: the renderer presents and follows the window's size itself
+	void present() {}
+	void resizeBuffer(s32 width, s32 height) {}
+
+	VulkanContextTexture *createImageTexture(u32 width, u32 height, VkFormat format, VkImageUsageFlags usage, bool depth) {
+		VulkanContextTexture *result = (VulkanContextTexture *)platform->alloc(sizeof(VulkanContextTexture));
+		*result = {};
+		result->format = format;
+		result->width = width;
+		result->height = height;
+		result->depth = depth;
+		renderer->createImage(width, height, 1, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, result->image, result->allocation, platform);
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		if(depth) aspect = renderer->hasStencilComponent(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+		result->view = renderer->createImageView(result->image, format, aspect, 1, platform);
+		return result;
+	}
+
+	// NOTE: depth textures use the renderer's depth format, D24S8 isn't supported everywhere. Render textures start
+	// out in the layout their render passes expect and hold zeros until drawn to.
+	Texture2D createTexture2D(void *data, u32 width, u32 height, Format format, bool render_texture = false, bool depth = false) {
+		Texture2D result = {};
+		result.width = width;
+		result.height = height;
+
+		VulkanContextTexture *texture;
+		if(depth) {
+			texture = createImageTexture(width, height, depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true);
+			renderer->transitionImageLayout(texture->image, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, platform);
+		} else {
+			VkFormat vk_format = (VkFormat)format_values[(u32)format];
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			if(render_texture) usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			texture = createImageTexture(width, height, vk_format, usage, false);
+
+			if(data) {
+				VkDeviceSize size = (VkDeviceSize)width * height * format_sizes[(u32)format];
+				renderer->uploads.uploadImage(platform, texture->image, width, height, 1, 1, 0, data, size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			} else {
+				renderer->transitionImageLayout(texture->image, vk_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, platform);
+			}
+		}
+		result.texture = texture;
+		return result;
+	}
+
+	void destroyTexture2D(Texture2D *texture) {
+		VulkanContextTexture *vulkan_texture = (VulkanContextTexture *)texture->texture;
+		if(vulkan_texture == 0) return;
+		DeletionQueue *queue = renderer->frameDeletionQueue();
+		for(u32 i = 0; i < framebuffer_count;) {
+			bool uses = false;
+			for(u32 v = 0; v < framebuffers[i].view_count; v++) uses |= framebuffers[i].views[v] == vulkan_texture->view;
+			if(uses) {
+				queue->framebuffer(framebuffers[i].framebuffer);
+				framebuffers[i] = framebuffers[--framebuffer_count];
+			} else {
+				i++;
+			}
+		}
+		for(u32 i = 0; i < RENDER_CONTEXT_MAX_SLOTS; i++) {
+			if(bound.textures[i] == vulkan_texture) bound.textures[i] = 0;
+		}
+		// NOTE: segments recorded this frame still point at it and its view is in this frame's texture sets, which
+		// live in the frame's pool until beginFrame resets it after the fence, so all of it waits for the fence too
+		queue->imageView(vulkan_texture->view);
+		queue->image(vulkan_texture->image, &vulkan_texture->allocation);
+		queue->hostMemory(vulkan_texture);
+		*texture = {};
+	}
+
+	void bindTexture2D(Texture2D *texture, u32 slot) {
+		if(slot >= RENDER_CONTEXT_MAX_SLOTS) {
+			platform->error(formatString("Texture slot %u is past the %u the Vulkan backend has", slot, RENDER_CONTEXT_MAX_SLOTS));
+			return;
+		}
+		VulkanContextTexture *vulkan_texture = texture ? (VulkanContextTexture *)texture->texture : 0;
+		if(bound.textures[slot] == vulkan_texture) return;
+		bound.textures[slot] = vulkan_texture;
+		dirty |= RENDER_CONTEXT_DIRTY_TEXTURES;
+	}
+
+	void bindDefaultTextures() {
+		RenderContextTargets back_buffer = {};
+		beginSegment(&back_buffer);
+	}
+
+	RenderTexture createRenderTexture(u32 width, u32 height, Format format) {
+		RenderTexture result = {};
+		result.texture = createTexture2D(0, width, height, format, true);
+		result.render_texture = result.texture.texture;
+		return result;
+	}
+
+	DepthStencilTexture createDepthStencilTexture(u32 width, u32 height) {
+		DepthStencilTexture result = {};
+		result.texture = createTexture2D(0, width, height, Format::Depth24Stencil8, false, true);
+		result.depth_stencil = result.texture.texture;
+		return result;
+	}
+
+	// NOTE: no render textures and no depth goes back to the back buffer
+	void bindRenderTextures(Platform *platform, RenderTexture **rts, u32 count, DepthStencilTexture *dst) {
+		if(count > RENDER_CONTEXT_MAX_TARGETS) {
+			platform->error(formatString("Can't bind %u render textures, the Vulkan backend takes %u", count, RENDER_CONTEXT_MAX_TARGETS));
+			count = RENDER_CONTEXT_MAX_TARGETS;
+		}
+		RenderContextTargets targets = {};
+		for(u32 i = 0; i < count; i++) targets.colors[targets.color_count++] = (VulkanContextTexture *)rts[i]->render_texture;
+		targets.depth = dst ? (VulkanContextTexture *)dst->depth_stencil : 0;
+		beginSegment(&targets);
+	}
+
+	// NOTE: the main pass already clears the back buffer when it loads it, so this only picks the colour. Clearing
+	// inside the pass would wipe the scene the renderer drew before the context's draws.
+	void clear(float color[4]) {
+		renderer->setClearColor(color);
+	}
+
+	void clearRenderTexture(RenderTexture *rt, float color[4]) {
+		VkClearValue value = {};
+		memcpy(value.color.float32, color, sizeof(value.color.float32));
+		pushClear((VulkanContextTexture *)rt->render_texture, VK_IMAGE_ASPECT_COLOR_BIT, value);
+	}
+
+	void clearDepthStencilTexture(DepthStencilTexture *dst, float value) {
+		VkClearValue clear_value = {};
+		clear_value.depthStencil = {value, 0};
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if(renderer->hasStencilComponent(depth_format)) aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		pushClear((VulkanContextTexture *)dst->depth_stencil, aspect, clear_value);
+	}
+
+	Sampler createSampler() {
+		VkSamplerCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		create_info.magFilter = VK_FILTER_LINEAR;
+		create_info.minFilter = VK_FILTER_LINEAR;
+		create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		create_info.compareOp = VK_COMPARE_OP_ALWAYS;
+		create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+		VulkanContextSampler *sampler = (VulkanContextSampler *)platform->alloc(sizeof(VulkanContextSampler));
+		if(vkCreateSampler(device, &create_info, 0, &sampler->sampler) != VK_SUCCESS) {
+			platform->error("Couldn't create render context sampler");
+		}
+		Sampler result = {};
+		result.sampler = sampler;
+		return result;
+	}
+
+	void bindSampler(Sampler *sampler, u32 slot) {
+		if(slot >= RENDER_CONTEXT_MAX_SLOTS) {
+			platform->error(formatString("Sampler slot %u is past the %u the Vulkan backend has", slot, RENDER_CONTEXT_MAX_SLOTS));
+			return;
+		}
+		VulkanContextSampler *vulkan_sampler = sampler ? (VulkanContextSampler *)sampler->sampler : 0;
+		if(bound.samplers[slot] == vulkan_sampler) return;
+		bound.samplers[slot] = vulkan_sampler;
+		dirty |= RENDER_CONTEXT_DIRTY_TEXTURES;
+	}
+
+	void destroySampler(Sampler *sampler) {
+		VulkanContextSampler *vulkan_sampler = (VulkanContextSampler *)sampler->sampler;
+		if(vulkan_sampler == 0) return;
+		renderer->frameDeletionQueue()->sampler(vulkan_sampler->sampler);
+		platform->free(vulkan_sampler);
+		*sampler = {};
+	}
+
+	// NOTE: every constant set points at the ring with the same range, so one per set layout covers every shader
+	VkDescriptorSet constantSet(VkDescriptorSetLayout layout, VkDescriptorSetLayoutBinding *bindings, u32 binding_count) {
+		for(u32 i = 0; i < constant_set_count; i++) {
+			if(constant_sets[i].layout == layout) return constant_sets[i].set;
+		}
+		if(constant_set_count == RENDER_CONTEXT_MAX_CONSTANT_SETS) {
+			platform->error("Too many render context constant layouts");
+			return VK_NULL_HANDLE;
+		}
+
+		RenderContextConstantSet *result = &constant_sets[constant_set_count++];
+		result->layout = layout;
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = constant_pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+		if(vkAllocateDescriptorSets(device, &alloc_info, &result->set) != VK_SUCCESS) {
+			platform->error("Couldn't allocate render context constant set");
+		}
+
+		VkDescriptorBufferInfo buffer_info = {};
+		buffer_info.buffer = constant_ring.buffer;
+		buffer_info.offset = 0;
+		buffer_info.range = RENDER_CONTEXT_CONSTANT_RANGE;
+		VkWriteDescriptorSet writes[RENDER_CONTEXT_MAX_SLOTS];
+		for(u32 i = 0; i < binding_count; i++) {
+			writes[i] = {};
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = result->set;
+			writes[i].dstBinding = bindings[i].binding;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &buffer_info;
+		}
+		vkUpdateDescriptorSets(device, binding_count, writes, 0, 0);
+		return result->set;
+	}
+
+	Shader createShader(Platform *platform, const std::string &name) {
+		Shader result = {};
+		VulkanContextShader *shader = (VulkanContextShader *)platform->alloc(sizeof(VulkanContextShader));
+		*shader = {};
+		shader->id = next_id++;
+
+		char vert_path[256];
+		char frag_path[256];
+		snprintf(vert_path, sizeof(vert_path), "data/shaders/%s.vert.spv", name.c_str());
+		snprintf(frag_path, sizeof(frag_path), "data/shaders/%s.frag.spv", name.c_str());
+
+		ShaderReflection vert_reflection;
+		ShaderReflection frag_reflection;
+		shader->vert = createShaderModule(platform, device, vert_path, &vert_reflection);
+		shader->frag = createShaderModule(platform, device, frag_path, &frag_reflection);
+		memcpy(shader->inputs, vert_reflection.inputs, sizeof(ShaderInput) * vert_reflection.input_count);
+		shader->input_count = vert_reflection.input_count;
+
+		ShaderInterface shader_interface = {};
+		shader_interface.add(platform, &vert_reflection, vert_path);
+		shader_interface.add(platform, &frag_reflection, frag_path);
+		if(shader_interface.push_constants.size > 0 || shader_interface.set_count > 2) {
+			platform->error(formatString("Shader %s uses push constants or sets past 1, the render context only binds constant buffers and textures", name.c_str()));
+		}
+		for(u32 i = 0; i < shader_interface.binding_count; i++) {
+			ShaderBinding *binding = &shader_interface.bindings[i];
+			VkDescriptorType expected = binding->set == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			if(binding->type != expected || binding->count != 1 || binding->binding >= RENDER_CONTEXT_MAX_SLOTS) {
+				platform->error(formatString("Shader %s set %u binding %u isn't a %s slot the render context can bind", name.c_str(), binding->set, binding->binding, binding->set == 0 ? "constant buffer" : "texture"));
+			}
+		}
+
+		VkDescriptorSetLayoutBinding set_bindings[SHADER_MAX_BINDINGS];
+		u32 texture_binding_count = shader_interface.setBindings(1, set_bindings);
+		for(u32 i = 0; i < texture_binding_count && i < RENDER_CONTEXT_MAX_SLOTS; i++) {
+			shader->texture_bindings[shader->texture_binding_count++] = set_bindings[i].binding;
+		}
+
+		// NOTE: constants go in the ring, every draw gets the offset of what was bound
+		u32 constant_binding_count = shader_interface.setBindings(0, set_bindings);
+		for(u32 i = 0; i < constant_binding_count && i < RENDER_CONTEXT_MAX_SLOTS; i++) {
+			shader_interface.makeDynamic(platform, 0, set_bindings[i].binding);
+			shader->constant_bindings[shader->constant_binding_count++] = set_bindings[i].binding;
+		}
+		constant_binding_count = shader_interface.setBindings(0, set_bindings);
+
+		PipelineLayoutCache *layout_cache = &renderer->layout_cache;
+		shader->pipeline_layout = layout_cache->pipelineLayout(platform, &shader_interface, 0);
+		if(shader->constant_binding_count > 0) {
+			shader->constant_set = constantSet(layout_cache->setLayout(platform, &shader_interface, 0), set_bindings, shader->constant_binding_count);
+		}
+		if(shader->texture_binding_count > 0) {
+			shader->texture_set_layout = layout_cache->setLayout(platform, &shader_interface, 1);
+		}
+
+		result.vertex_shader = shader; // NOTE: both stages and their layouts live in the one record, pixel_shader is unused
+		return result;
+	}
+
+	void destroyShader(Shader *shader) {
+		VulkanContextShader *vulkan_shader = (VulkanContextShader *)shader->vertex_shader;
+		if(vulkan_shader == 0) return;
+		DeletionQueue *queue = renderer->frameDeletionQueue();
+		for(u32 i = 0; i < pipeline_count; i++) {
+			if(pipelines[i].pipeline != VK_NULL_HANDLE && pipelines[i].key.shader == vulkan_shader->id) {
+				queue->pipeline(pipelines[i].pipeline);
+				pipelines[i] = {};
+			}
+		}
+		// NOTE: the pipelines built from the modules are all that still need them
+		vkDestroyShaderModule(device, vulkan_shader->vert, 0);
+		vkDestroyShaderModule(device, vulkan_shader->frag, 0);
+		if(bound.shader == vulkan_shader) bound.shader = 0;
+		platform->free(vulkan_shader);
+		*shader = {};
+	}
+
+	void bindShader(Shader *shader) {
+		VulkanContextShader *vulkan_shader = (VulkanContextShader *)shader->vertex_shader;
+		if(bound.shader == vulkan_shader) return;
+		bound.shader = vulkan_shader;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE | RENDER_CONTEXT_DIRTY_CONSTANTS | RENDER_CONTEXT_DIRTY_TEXTURES;
+	}
+
+	void unbindShader() {
+		bound.shader = 0;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE;
+	}
+
+	// NOTE: element i is vertex input location i. inc_input_slot gives every element a vertex buffer of its own,
+	// otherwise they read the buffer their input_slot names. Without inc_byte_stride every element starts at offset 0.
+	ShaderLayout createShaderLayout(RenderContext::LayoutElement *elements, u32 count, Shader *shader, bool inc_input_slot = false, bool inc_byte_stride = true) {
+		VulkanContextShader *vulkan_shader = (VulkanContextShader *)shader->vertex_shader;
+		VulkanContextLayout *layout = (VulkanContextLayout *)platform->alloc(sizeof(VulkanContextLayout));
+		*layout = {};
+		layout->id = next_id++;
+
+		VkVertexInputAttributeDescription attributes[SHADER_MAX_INPUTS];
+		u32 strides[RENDER_CONTEXT_MAX_VERTEX_BUFFERS] = {};
+		if(count > SHADER_MAX_INPUTS) count = SHADER_MAX_INPUTS;
+		for(u32 i = 0; i < count; i++) {
+			u32 binding = inc_input_slot ? i : elements[i].input_slot;
+			if(binding >= RENDER_CONTEXT_MAX_VERTEX_BUFFERS) {
+				platform->error(formatString("Layout element %s reads vertex buffer %u, the Vulkan backend has %u", elements[i].name, binding, RENDER_CONTEXT_MAX_VERTEX_BUFFERS));
+				binding = 0;
+			}
+			attributes[i] = {};
+			attributes[i].location = i;
+			attributes[i].binding = binding;
+			attributes[i].format = (VkFormat)format_values[(u32)elements[i].format];
+			attributes[i].offset = inc_byte_stride ? strides[binding] : 0;
+			u32 size = format_sizes[(u32)elements[i].format];
+			strides[binding] = inc_byte_stride ? strides[binding] + size : (size > strides[binding] ? size : strides[binding]);
+			if(binding + 1 > layout->binding_count) layout->binding_count = binding + 1;
+		}
+
+		for(u32 b = 0; b < layout->binding_count; b++) {
+			layout->bindings[b] = {};
+			layout->bindings[b].binding = b;
+			layout->bindings[b].stride = strides[b];
+			layout->bindings[b].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		}
+
+		ShaderReflection reflection = {};
+		memcpy(reflection.inputs, vulkan_shader->inputs, sizeof(ShaderInput) * vulkan_shader->input_count);
+		reflection.input_count = vulkan_shader->input_count;
+		layout->attribute_count = reflection.vertexAttributes(platform, attributes, count, layout->attributes, "render context shader");
+
+		ShaderLayout result = {};
+		result.layout = layout;
+		return result;
+	}
+
+	void bindShaderLayout(ShaderLayout *layout) {
+		VulkanContextLayout *vulkan_layout = (VulkanContextLayout *)layout->layout;
+		if(bound.layout == vulkan_layout) return;
+		bound.layout = vulkan_layout;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE | RENDER_CONTEXT_DIRTY_BUFFERS; // NOTE: the layout decides how many streams get bound
+	}
+
+	ShaderConstant createShaderConstant(u32 buffer_size) {
+		if(buffer_size > RENDER_CONTEXT_CONSTANT_RANGE) {
+			platform->error(formatString("Constant buffers can hold %u bytes, not %u", RENDER_CONTEXT_CONSTANT_RANGE, buffer_size));
+			buffer_size = RENDER_CONTEXT_CONSTANT_RANGE;
+		}
+		VulkanContextConstant *constant = (VulkanContextConstant *)platform->alloc(sizeof(VulkanContextConstant) + buffer_size);
+		*constant = {};
+		constant->size = buffer_size;
+		constant->data = (u8 *)(constant + 1);
+		memset(constant->data, 0, buffer_size);
+		ShaderConstant result = {};
+		result.buffer = constant;
+		return result;
+	}
+
+	// NOTE: reserves the whole descriptor range so a shader's block can never read past the ring
+	void pushConstant(VulkanContextConstant *constant) {
+		u8 *destination = (u8 *)constant_ring.reserve(platform, RENDER_CONTEXT_CONSTANT_RANGE, &constant->offset);
+		if(destination) memcpy(destination, constant->data, constant->size);
+		constant->frame = frame;
+	}
+
+	void updateShaderConstant(ShaderConstant *constant, void *data) {
+		VulkanContextConstant *vulkan_constant = (VulkanContextConstant *)constant->buffer;
+		memcpy(vulkan_constant->data, data, vulkan_constant->size);
+		pushConstant(vulkan_constant);
+		dirty |= RENDER_CONTEXT_DIRTY_CONSTANTS;
+	}
+
+	// NOTE: stages share the slot numbers, a constant bound for either one is visible to both
+	void bindShaderConstant(ShaderConstant *constant, s32 vs_loc, s32 ps_loc) {
+		VulkanContextConstant *vulkan_constant = (VulkanContextConstant *)constant->buffer;
+		s32 slots[] = {vs_loc, ps_loc};
+		for(u32 i = 0; i < ArrayCount(slots); i++) {
+			if(slots[i] < 0) continue;
+			if(slots[i] >= RENDER_CONTEXT_MAX_SLOTS) {
+				platform->error(formatString("Constant slot %d is past the %u the Vulkan backend has", slots[i], RENDER_CONTEXT_MAX_SLOTS));
+				continue;
+			}
+			bound.constants[slots[i]] = vulkan_constant;
+		}
+		dirty |= RENDER_CONTEXT_DIRTY_CONSTANTS;
+	}
+
+	// NOTE: host visible, the game and imgui build these every frame
+	VertexBuffer createVertexBuffer(void *vertices, u32 vertex_size, u32 num_vertices, BufferType type = BufferType::Vertex) {
+		VulkanContextBuffer *buffer = (VulkanContextBuffer *)platform->alloc(sizeof(VulkanContextBuffer));
+		VkDeviceSize size = (VkDeviceSize)vertex_size * (num_vertices > 0 ? num_vertices : 1);
+		renderer->createBuffer(size, buffer_types[(u32)type], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer->buffer, buffer->allocation, platform);
+		if(vertices && buffer->allocation.mapped) memcpy(buffer->allocation.mapped, vertices, (size_t)vertex_size * num_vertices);
+
+		VertexBuffer result = {};
+		result.buffer = buffer;
+		result.vertex_size = vertex_size;
+		return result;
+	}
+
+	void destroyVertexBuffer(VertexBuffer *vb) {
+		VulkanContextBuffer *buffer = (VulkanContextBuffer *)vb->buffer;
+		if(buffer == 0) return;
+		renderer->frameDeletionQueue()->buffer(buffer->buffer, &buffer->allocation);
+		platform->free(buffer);
+		*vb = {};
+	}
+
+	void bindVertexBuffer(VertexBuffer *vb, u32 slot) {
+		if(slot >= RENDER_CONTEXT_MAX_VERTEX_BUFFERS) {
+			platform->error(formatString("Vertex buffer slot %u is past the %u the Vulkan backend has", slot, RENDER_CONTEXT_MAX_VERTEX_BUFFERS));
+			return;
+		}
+		VulkanContextBuffer *buffer = vb ? (VulkanContextBuffer *)vb->buffer : 0;
+		if(bound.vertex_buffers[slot] == buffer) return;
+		bound.vertex_buffers[slot] = buffer;
+		dirty |= RENDER_CONTEXT_DIRTY_BUFFERS;
+	}
+
+	void bindIndexBuffer(VertexBuffer *vb, Format format) {
+		VulkanContextBuffer *buffer = vb ? (VulkanContextBuffer *)vb->buffer : 0;
+		VkIndexType index_type = format == Format::u16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		if(bound.index_buffer == buffer && bound.index_type == index_type) return;
+		bound.index_buffer = buffer;
+		bound.index_type = index_type;
+		dirty |= RENDER_CONTEXT_DIRTY_BUFFERS;
+	}
+
+	// NOTE: depth_enabled asks for depth clipping, which Vulkan can't turn off without depthClamp, so it's ignored
+	RasterState createRasterState(bool scissor_enabled, bool depth_enabled) {
+		VulkanContextRasterState *state = (VulkanContextRasterState *)platform->alloc(sizeof(VulkanContextRasterState));
+		state->scissor_enabled = scissor_enabled;
+		state->cull_mode = VK_CULL_MODE_NONE;
+		RasterState result = {};
+		result.state = state;
+		return result;
+	}
+
+	void bindRasterState(RasterState *state) {
+		VulkanContextRasterState *raster = state ? (VulkanContextRasterState *)state->state : 0;
+		if(bound.raster == raster) return;
+		bound.raster = raster;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE | RENDER_CONTEXT_DIRTY_SCISSOR;
+	}
+
+	void destroyRasterState(RasterState *state) {
+		if(bound.raster == state->state) bindRasterState(0);
+		platform->free(state->state);
+		*state = {};
+	}
+
+	// NOTE: straight alpha, colour weighted by source alpha, the only blend the interface can ask for
+	BlendState createBlendState() {
+		VulkanContextBlendState *state = (VulkanContextBlendState *)platform->alloc(sizeof(VulkanContextBlendState));
+		state->enabled = true;
+		BlendState result = {};
+		result.state = state;
+		return result;
+	}
+
+	// NOTE: the blend never reads the constant factor and the sample mask is always all ones
+	void bindBlendState(BlendState *state, const float factor[4], u32 mask) {
+		VulkanContextBlendState *blend = state ? (VulkanContextBlendState *)state->state : 0;
+		if(bound.blend == blend) return;
+		bound.blend = blend;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE;
+	}
+
+	void destroyBlendState(BlendState *state) {
+		if(bound.blend == state->state) bindBlendState(0, 0, 0xffffffff);
+		platform->free(state->state);
+		*state = {};
+	}
+
+	// NOTE: no depth test or write, binding none gets them back
+	DepthStencilState createDepthStencilState() {
+		VulkanContextDepthStencilState *state = (VulkanContextDepthStencilState *)platform->alloc(sizeof(VulkanContextDepthStencilState));
+		state->test = false;
+		state->write = false;
+		DepthStencilState result = {};
+		result.state = state;
+		return result;
+	}
+
+	void bindDepthStencilState(DepthStencilState *state) {
+		VulkanContextDepthStencilState *depth_stencil = state ? (VulkanContextDepthStencilState *)state->state : 0;
+		if(bound.depth_stencil == depth_stencil) return;
+		bound.depth_stencil = depth_stencil;
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE;
+	}
+
+	void destroyDepthStencilState(DepthStencilState *state) {
+		if(bound.depth_stencil == state->state) bindDepthStencilState(0);
+		platform->free(state->state);
+		*state = {};
+	}
+
+	PlatformRenderState *saveRenderState() {
+		PlatformRenderState *result = (PlatformRenderState *)platform->alloc(sizeof(PlatformRenderState));
+		result->bindings = bound;
+		return result;
+	}
+
+	void reloadRenderState(PlatformRenderState *state) {
+		bound = state->bindings;
+		dirty = RENDER_CONTEXT_DIRTY_ALL;
+	}
+
+	void destroyRenderState(PlatformRenderState *state) {
+		platform->free(state);
+	}
+
+	// NOTE: x and y are the top left corner, w and h the bottom right one, the way imgui hands over its clip rects
+	void setClipRect(s32 x, s32 y, s32 w, s32 h) {
+		if(x < 0) x = 0;
+		if(y < 0) y = 0;
+		VkRect2D rect = {};
+		rect.offset = {x, y};
+		rect.extent = {(u32)(w > x ? w - x : 0), (u32)(h > y ? h - y : 0)};
+		if(memcmp(&rect, &bound.clip_rect, sizeof(VkRect2D)) == 0) return;
+		bound.clip_rect = rect;
+		dirty |= RENDER_CONTEXT_DIRTY_SCISSOR;
+	}
+
+	void setViewport(s32 width, s32 height, f32 min_depth, f32 max_depth) {
+		bound.viewport = {};
+		bound.viewport.width = (f32)width;
+		bound.viewport.height = (f32)height;
+		bound.viewport.minDepth = min_depth;
+		bound.viewport.maxDepth = max_depth;
+		bound.viewport_set = true;
+		dirty |= RENDER_CONTEXT_DIRTY_VIEWPORT;
+	}
+
+	void sendDraw(Topology topology, u32 num_vertices) {
+		pushDraw(RenderContextCommandType::Draw, topology, num_vertices, 0, 0);
+	}
+
+	void sendDrawIndexed(Topology topology, u32 num_indices, int vertex_offset = 0, int index_offset = 0) {
+		pushDraw(RenderContextCommandType::DrawIndexed, topology, num_indices, (u32)index_offset, vertex_offset);
+	}
+
+	RenderContextSegment *currentSegment() {
+		return &segments[segment_count - 1];
+	}
+
+	bool sameTargets(RenderContextTargets *a, RenderContextTargets *b) {
+		if(a->color_count != b->color_count || a->depth != b->depth) return false;
+		for(u32 i = 0; i < a->color_count; i++) {
+			if(a->colors[i] != b->colors[i]) return false;
+		}
+		return true;
+	}
+
+	void beginSegment(RenderContextTargets *targets) {
+		if(segment_count > 0 && sameTargets(&currentSegment()->targets, targets)) return;
+		// NOTE: an empty segment is just replaced, nothing was drawn to its targets
+		if(segment_count == 0 || currentSegment()->command_count > 0) {
+			if(segment_count == RENDER_CONTEXT_MAX_SEGMENTS) {
+				platform->error("Too many render target changes in one frame");
+				return;
+			}
+			segment_count++;
+		}
+
+		RenderContextSegment *segment = currentSegment();
+		segment->targets = *targets;
+		segment->first_command = command_count;
+		segment->command_count = 0;
+		VulkanContextTexture *first = targets->color_count > 0 ? targets->colors[0] : targets->depth;
+		segment->width = first ? first->width : renderer->extent.width;
+		segment->height = first ? first->height : renderer->extent.height;
+		for(u32 i = 0; i < targets->color_count; i++) {
+			if(targets->colors[i]->width != segment->width || targets->colors[i]->height != segment->height) {
+				platform->error("Render textures bound together have to be the same size");
+			}
+		}
+		dirty |= RENDER_CONTEXT_DIRTY_PIPELINE | RENDER_CONTEXT_DIRTY_VIEWPORT | RENDER_CONTEXT_DIRTY_SCISSOR;
+	}
+
+	// NOTE: clears render textures inside their pass, a target that isn't bound gets a segment of its own for it
+	void pushClear(VulkanContextTexture *target, VkImageAspectFlags aspect, VkClearValue value) {
+		if(clear_count == RENDER_CONTEXT_MAX_CLEARS || command_count == RENDER_CONTEXT_MAX_COMMANDS) {
+			platform->error("Too many render context clears in one frame");
+			return;
+		}
+
+		RenderContextTargets previous = currentSegment()->targets;
+		s32 attachment = -1;
+		if(aspect == VK_IMAGE_ASPECT_COLOR_BIT) {
+			for(u32 i = 0; i < previous.color_count; i++) {
+				if(previous.colors[i] == target) attachment = (s32)i;
+			}
+		} else if(previous.depth == target) {
+			attachment = 0;
+		}
+
+		if(attachment < 0) {
+			RenderContextTargets targets = {};
+			if(aspect == VK_IMAGE_ASPECT_COLOR_BIT) targets.colors[targets.color_count++] = target;
+			else targets.depth = target;
+			beginSegment(&targets);
+			attachment = 0;
+		}
+
+		RenderContextSegment *segment = currentSegment();
+		RenderContextClear *clear = &clears[clear_count];
+		clear->attachment = {};
+		clear->attachment.aspectMask = aspect;
+		clear->attachment.colorAttachment = (u32)attachment;
+		clear->attachment.clearValue = value;
+		clear->rect = {};
+		clear->rect.extent = {segment->width, segment->height};
+
+		RenderContextCommand *command = &commands[command_count];
+		*command = {};
+		command->type = RenderContextCommandType::Clear;
+		command->state = clear_count++;
+		keys[command_count] = command_count;
+		command_count++;
+		segment->command_count++;
+
+		beginSegment(&previous);
+	}
+
+	RenderContextTargetFormats targetFormats(RenderContextSegment *segment) {
+		RenderContextTargetFormats result = {};
+		if(segment->targets.color_count == 0 && segment->targets.depth == 0) {
+			result.colors[0] = renderer->surface_format.format;
+			result.color_count = 1;
+			result.depth = depth_format;
+			return result;
+		}
+		for(u32 i = 0; i < segment->targets.color_count; i++) result.colors[result.color_count++] = segment->targets.colors[i]->format;
+		result.depth = segment->targets.depth ? segment->targets.depth->format : VK_FORMAT_UNDEFINED;
+		return result;
+	}
+
+	// NOTE: everything keeps its layout across the pass, colours stay readable by shaders between passes
+	VkRenderPass targetRenderPass(RenderContextTargetFormats *formats) {
+		for(u32 i = 0; i < render_pass_count; i++) {
+			if(memcmp(&render_passes[i].formats, formats, sizeof(RenderContextTargetFormats)) == 0) return render_passes[i].render_pass;
+		}
+		if(render_pass_count == RENDER_CONTEXT_MAX_RENDER_PASSES) {
+			platform->error("Too many render texture format combinations");
+			return VK_NULL_HANDLE;
+		}
+
+		VkAttachmentDescription attachments[RENDER_CONTEXT_MAX_TARGETS + 1];
+		VkAttachmentReference color_refs[RENDER_CONTEXT_MAX_TARGETS];
+		VkAttachmentReference depth_ref = {};
+		u32 attachment_count = 0;
+		for(u32 i = 0; i < formats->color_count; i++) {
+			VkAttachmentDescription *attachment = &attachments[attachment_count];
+			*attachment = {};
+			attachment->format = (VkFormat)formats->colors[i];
+			attachment->samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment->initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			attachment->finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			color_refs[i] = {attachment_count++, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		}
+		if(formats->depth != VK_FORMAT_UNDEFINED) {
+			VkAttachmentDescription *attachment = &attachments[attachment_count];
+			*attachment = {};
+			attachment->format = (VkFormat)formats->depth;
+			attachment->samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment->initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachment->finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depth_ref = {attachment_count++, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = formats->color_count;
+		subpass.pColorAttachments = color_refs;
+		subpass.pDepthStencilAttachment = formats->depth != VK_FORMAT_UNDEFINED ? &depth_ref : 0;
+
+		// NOTE: waits for earlier passes and shader reads of the targets, later passes wait for these writes
+		VkPipelineStageFlags attachment_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		VkAccessFlags attachment_access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VkSubpassDependency dependencies[2] = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = attachment_stages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstStageMask = attachment_stages;
+		dependencies[0].dstAccessMask = attachment_access;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = attachment_stages;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = attachment_stages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].dstAccessMask = attachment_access | VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		create_info.attachmentCount = attachment_count;
+		create_info.pAttachments = attachments;
+		create_info.subpassCount = 1;
+		create_info.pSubpasses = &subpass;
+		create_info.dependencyCount = ArrayCount(dependencies);
+		create_info.pDependencies = dependencies;
+
+		RenderContextRenderPass *result = &render_passes[render_pass_count];
+		result->formats = *formats;
+		if(vkCreateRenderPass(device, &create_info, 0, &result->render_pass) != VK_SUCCESS) {
+			platform->error("Couldn't create render context render pass");
+		}
+		render_pass_count++;
+		return result->render_pass;
+	}
+
+	VkFramebuffer targetFramebuffer(RenderContextSegment *segment, VkRenderPass render_pass) {
+		VkImageView views[RENDER_CONTEXT_MAX_TARGETS + 1];
+		u32 view_count = 0;
+		for(u32 i = 0; i < segment->targets.color_count; i++) views[view_count++] = segment->targets.colors[i]->view;
+		if(segment->targets.depth) views[view_count++] = segment->targets.depth->view;
+
+		for(u32 i = 0; i < framebuffer_count; i++) {
+			RenderContextFramebuffer *cached = &framebuffers[i];
+			if(cached->render_pass == render_pass && cached->view_count == view_count && memcmp(cached->views, views, sizeof(VkImageView) * view_count) == 0) return cached->framebuffer;
+		}
+		if(framebuffer_count == RENDER_CONTEXT_MAX_FRAMEBUFFERS) {
+			platform->error("Too many render texture combinations");
+			return VK_NULL_HANDLE;
+		}
+
+		RenderContextFramebuffer *result = &framebuffers[framebuffer_count];
+		memcpy(result->views, views, sizeof(VkImageView) * view_count);
+		result->view_count = view_count;
+		result->render_pass = render_pass;
+
+		VkFramebufferCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		create_info.renderPass = render_pass;
+		create_info.attachmentCount = view_count;
+		create_info.pAttachments = result->views;
+		create_info.width = segment->width;
+		create_info.height = segment->height;
+		create_info.layers = 1;
+		if(vkCreateFramebuffer(device, &create_info, 0, &result->framebuffer) != VK_SUCCESS) {
+			platform->error("Couldn't create render context framebuffer");
+		}
+		framebuffer_count++;
+		return result->framebuffer;
+	}
+
+	VkPipeline createPipeline(RenderContextPipelineKey *key, VulkanContextShader *shader, VulkanContextLayout *layout, VkRenderPass render_pass) {
+		VkPipelineShaderStageCreateInfo shader_stage_infos[2] = {};
+		shader_stage_infos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage_infos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shader_stage_infos[0].module = shader->vert;
+		shader_stage_infos[0].pName = "main";
+		shader_stage_infos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage_infos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shader_stage_infos[1].module = shader->frag;
+		shader_stage_infos[1].pName = "main";
+
+		VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
+		vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertex_input_info.vertexBindingDescriptionCount = layout ? layout->binding_count : 0;
+		vertex_input_info.pVertexBindingDescriptions = layout ? layout->bindings : 0;
+		vertex_input_info.vertexAttributeDescriptionCount = layout ? layout->attribute_count : 0;
+		vertex_input_info.pVertexAttributeDescriptions = layout ? layout->attributes : 0;
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {};
+		input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		input_assembly_create_info.topology = (VkPrimitiveTopology)key->topology;
+
+		VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
+		viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewport_state_create_info.viewportCount = 1;
+		viewport_state_create_info.scissorCount = 1;
+
+		VkDynamicState dynamic_states[] = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+		VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
+		dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamic_state_create_info.dynamicStateCount = ArrayCount(dynamic_states);
+		dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer_create_info = {};
+		rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer_create_info.cullMode = key->cull_mode;
+		rasterizer_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer_create_info.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo msaa_state_create_info = {};
+		msaa_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		msaa_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		msaa_state_create_info.minSampleShading = 1.0f;
+
+		VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {};
+		depth_stencil_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depth_stencil_create_info.depthTestEnable = key->depth_test ? VK_TRUE : VK_FALSE;
+		depth_stencil_create_info.depthWriteEnable = key->depth_write ? VK_TRUE : VK_FALSE;
+		depth_stencil_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
+		depth_stencil_create_info.maxDepthBounds = 1.0f;
+
+		VkPipelineColorBlendAttachmentState blend_attachments[RENDER_CONTEXT_MAX_TARGETS];
+		for(u32 i = 0; i < key->formats.color_count; i++) {
+			VkPipelineColorBlendAttachmentState *blend = &blend_attachments[i];
+			*blend = {};
+			blend->colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			blend->blendEnable = key->blend ? VK_TRUE : VK_FALSE;
+			blend->srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			blend->dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			blend->colorBlendOp = VK_BLEND_OP_ADD;
+			blend->srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			blend->dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			blend->alphaBlendOp = VK_BLEND_OP_ADD;
+		}
+
+		VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {};
+		color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
+		color_blend_state_create_info.attachmentCount = key->formats.color_count;
+		color_blend_state_create_info.pAttachments = blend_attachments;
+
+		VkGraphicsPipelineCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		create_info.stageCount = ArrayCount(shader_stage_infos);
+		create_info.pStages = shader_stage_infos;
+		create_info.pVertexInputState = &vertex_input_info;
+		create_info.pInputAssemblyState = &input_assembly_create_info;
+		create_info.pViewportState = &viewport_state_create_info;
+		create_info.pRasterizationState = &rasterizer_create_info;
+		create_info.pMultisampleState = &msaa_state_create_info;
+		create_info.pDepthStencilState = &depth_stencil_create_info;
+		create_info.pColorBlendState = &color_blend_state_create_info;
+		create_info.pDynamicState = &dynamic_state_create_info;
+		create_info.layout = shader->pipeline_layout;
+		create_info.renderPass = render_pass;
+		create_info.subpass = 0;
+		create_info.basePipelineIndex = -1;
+
+		VkPipeline result = VK_NULL_HANDLE;
+		if(vkCreateGraphicsPipelines(device, renderer->pipeline_cache.cache, 1, &create_info, 0, &result) != VK_SUCCESS) {
+			platform->error("Couldn't create render context pipeline");
+		}
+		return result;
+	}
+
+	// NOTE: returns the index of the pipeline for the bound state, built the first time it's asked for
+	u32 resolvePipeline(RenderContextSegment *segment) {
+		RenderContextPipelineKey key = {};
+		key.shader = bound.shader->id;
+		key.layout = bound.layout ? bound.layout->id : 0;
+		key.topology = topologies[(u32)bound.topology];
+		key.cull_mode = bound.raster ? bound.raster->cull_mode : (VkCullModeFlags)VK_CULL_MODE_BACK_BIT;
+		key.blend = bound.blend ? bound.blend->enabled : false;
+		key.depth_test = bound.depth_stencil ? bound.depth_stencil->test : true;
+		key.depth_write = bound.depth_stencil ? bound.depth_stencil->write : true;
+		key.formats = targetFormats(segment);
+		u64 hash = hashRenderContextKey(&key, sizeof(key));
+
+		u32 free_slot = pipeline_count;
+		for(u32 i = 0; i < pipeline_count; i++) {
+			if(pipelines[i].pipeline == VK_NULL_HANDLE) {
+				if(free_slot == pipeline_count) free_slot = i;
+				continue;
+			}
+			if(pipelines[i].hash == hash && memcmp(&pipelines[i].key, &key, sizeof(key)) == 0) return i;
+		}
+		if(free_slot == RENDER_CONTEXT_MAX_PIPELINES) {
+			platform->error("Too many render context pipelines");
+			return 0;
+		}
+
+		bool back_buffer = segment->targets.color_count == 0 && segment->targets.depth == 0;
+		VkRenderPass render_pass = back_buffer ? renderer->render_pass : targetRenderPass(&key.formats);
+		RenderContextPipeline *pipeline = &pipelines[free_slot];
+		pipeline->hash = hash;
+		pipeline->key = key;
+		pipeline->pipeline = createPipeline(&key, bound.shader, bound.layout, render_pass);
+		if(free_slot == pipeline_count) pipeline_count++;
+		return free_slot;
+	}
+
+	// NOTE: returns the index of this frame's set for the bound textures, so draws sharing textures share a set
+	u32 resolveTextureSet() {
+		VulkanContextShader *shader = bound.shader;
+		RenderContextTextureSet key = {};
+		key.layout = shader->texture_set_layout;
+		for(u32 i = 0; i < shader->texture_binding_count; i++) {
+			u32 slot = shader->texture_bindings[i];
+			VulkanContextTexture *texture = bound.textures[slot] ? bound.textures[slot] : default_texture;
+			VulkanContextSampler *sampler = bound.samplers[slot] ? bound.samplers[slot] : default_sampler;
+			if(texture->depth) {
+				platform->error("Depth textures can't be sampled by the Vulkan backend");
+				texture = default_texture;
+			}
+			key.views[i] = texture->view;
+			key.samplers[i] = sampler->sampler;
+		}
+		u64 hash = hashRenderContextKey(&key.layout, sizeof(key.layout) + sizeof(key.views) + sizeof(key.samplers));
+
+		u32 mask = ArrayCount(texture_set_table) - 1;
+		u32 at = (u32)hash & mask;
+		while(texture_set_table[at] != 0) {
+			RenderContextTextureSet *existing = &texture_sets[texture_set_table[at] - 1];
+			if(existing->hash == hash && existing->layout == key.layout && memcmp(existing->views, key.views, sizeof(key.views)) == 0 && memcmp(existing->samplers, key.samplers, sizeof(key.samplers)) == 0) {
+				return texture_set_table[at] - 1;
+			}
+			at = (at + 1) & mask;
+		}
+		if(texture_set_count == RENDER_CONTEXT_MAX_TEXTURE_SETS) {
+			platform->error("Too many texture combinations in one frame");
+			return 0;
+		}
+
+		u32 result = texture_set_count++;
+		RenderContextTextureSet *set = &texture_sets[result];
+		*set = key;
+		set->hash = hash;
+		texture_set_table[at] = (u16)(result + 1);
+
+		VkDescriptorSetAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = texture_pools[renderer->current_frame];
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &set->layout;
+		if(vkAllocateDescriptorSets(device, &alloc_info, &set->set) != VK_SUCCESS) {
+			platform->error("Couldn't allocate render context texture set");
+		}
+
+		VkDescriptorImageInfo image_infos[RENDER_CONTEXT_MAX_SLOTS];
+		VkWriteDescriptorSet writes[RENDER_CONTEXT_MAX_SLOTS];
+		for(u32 i = 0; i < shader->texture_binding_count; i++) {
+			image_infos[i] = {};
+			image_infos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			image_infos[i].imageView = set->views[i];
+			image_infos[i].sampler = set->samplers[i];
+			writes[i] = {};
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = set->set;
+			writes[i].dstBinding = shader->texture_bindings[i];
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[i].descriptorCount = 1;
+			writes[i].pImageInfo = &image_infos[i];
+		}
+		vkUpdateDescriptorSets(device, shader->texture_binding_count, writes, 0, 0);
+		return result;
+	}
+
+	// NOTE: only redoes the parts the dirty bits say changed, and reuses the last state when nothing really did
+	void resolveState() {
+		RenderContextSegment *segment = currentSegment();
+		RenderContextState state = {};
+		if(state_count > 0) state = states[current_state];
+
+		if(dirty & RENDER_CONTEXT_DIRTY_PIPELINE) {
+			u32 pipeline = resolvePipeline(segment);
+			state.pipeline = pipelines[pipeline].pipeline;
+			state.pipeline_layout = bound.shader->pipeline_layout;
+			bool sortable = !pipelines[pipeline].key.blend && pipelines[pipeline].key.depth_test && pipelines[pipeline].key.depth_write;
+			state.sort_key = sortable ? ((u64)(pipeline + 1) << 48) | (state.sort_key & 0x0000ffff00000000ull) : 0;
+		}
+
+		if(dirty & RENDER_CONTEXT_DIRTY_CONSTANTS) {
+			VulkanContextShader *shader = bound.shader;
+			state.constant_set = shader->constant_set;
+			state.constant_offset_count = shader->constant_binding_count;
+			for(u32 i = 0; i < shader->constant_binding_count; i++) {
+				VulkanContextConstant *constant = bound.constants[shader->constant_bindings[i]];
+				if(constant == 0) {
+					platform->error(formatString("Shader %u reads constant slot %u but nothing is bound there", shader->id, shader->constant_bindings[i]));
+					state.constant_offsets[i] = 0;
+					continue;
+				}
+				if(constant->frame != frame) pushConstant(constant);
+				state.constant_offsets[i] = constant->offset;
+			}
+		}
+
+		if(dirty & RENDER_CONTEXT_DIRTY_TEXTURES) {
+			if(bound.shader->texture_binding_count > 0) {
+				u32 texture_set = resolveTextureSet();
+				state.texture_set = texture_sets[texture_set].set;
+				if(state.sort_key) state.sort_key = (state.sort_key & 0xffff000000000000ull) | ((u64)texture_set << 32);
+			} else {
+				state.texture_set = VK_NULL_HANDLE;
+			}
+		}
+
+		if(dirty & RENDER_CONTEXT_DIRTY_BUFFERS) {
+			state.vertex_buffer_count = bound.layout ? bound.layout->binding_count : 0;
+			for(u32 i = 0; i < state.vertex_buffer_count; i++) {
+				state.vertex_buffers[i] = bound.vertex_buffers[i] ? bound.vertex_buffers[i]->buffer : VK_NULL_HANDLE;
+			}
+			state.index_buffer = bound.index_buffer ? bound.index_buffer->buffer : VK_NULL_HANDLE;
+			state.index_type = bound.index_type;
+		}
+
+		if(dirty & RENDER_CONTEXT_DIRTY_VIEWPORT) {
+			if(bound.viewport_set) {
+				state.viewport = bound.viewport;
+			} else {
+				state.viewport = {};
+				state.viewport.width = (f32)segment->width;
+				state.viewport.height = (f32)segment->height;
+				state.viewport.maxDepth = 1.0f;
+			}
+		}
+
+		if(dirty & RENDER_CONTEXT_DIRTY_SCISSOR) {
+			current_scissor = {};
+			current_scissor.extent = {segment->width, segment->height};
+			if(bound.raster && bound.raster->scissor_enabled) current_scissor = bound.clip_rect;
+		}
+		dirty = 0;
+
+		// NOTE: the state index only breaks ties, it isn't part of what's compared
+		u64 sort_key = state.sort_key;
+		if(state_count > 0) {
+			state.sort_key = states[current_state].sort_key;
+			if(memcmp(&state, &states[current_state], sizeof(RenderContextState)) == 0) return;
+		}
+		if(state_count == RENDER_CONTEXT_MAX_STATES) {
+			platform->error("Too many render context state changes in one frame");
+			return;
+		}
+		state.sort_key = sort_key ? (sort_key & 0xffffffff00000000ull) | ((u64)state_count << 16) : 0;
+		current_state = state_count;
+		states[state_count++] = state;
+	}
+
+	void pushDraw(RenderContextCommandType type, Topology topology, u32 count, u32 first, s32 vertex_offset) {
+		if(bound.shader == 0) {
+			platform->error("Draw without a shader bound");
+			return;
+		}
+		if(command_count == RENDER_CONTEXT_MAX_COMMANDS) {
+			platform->error("Too many render context draws in one frame");
+			return;
+		}
+		if(topology != bound.topology) {
+			bound.topology = topology;
+			dirty |= RENDER_CONTEXT_DIRTY_PIPELINE;
+		}
+		if(state_count == 0) dirty = RENDER_CONTEXT_DIRTY_ALL;
+		if(dirty) resolveState();
+
+		RenderContextCommand *command = &commands[command_count];
+		command->type = type;
+		command->state = current_state;
+		command->scissor = current_scissor;
+		command->count = count;
+		command->first = first;
+		command->vertex_offset = vertex_offset;
+		keys[command_count] = states[current_state].sort_key | command_count;
+		command_count++;
+		currentSegment()->command_count++;
+	}
+
+	// NOTE: runs of sortable draws are sorted by their keys, clears and order dependent draws end a run
+	void sortSegment(RenderContextSegment *segment) {
+		u32 end = segment->first_command + segment->command_count;
+		u32 run_start = segment->first_command;
+		for(u32 i = segment->first_command; i <= end; i++) {
+			bool sortable = i < end && commands[i].type != RenderContextCommandType::Clear && states[commands[i].state].sort_key != 0;
+			if(sortable) continue;
+			if(i - run_start > 1) radixSortKeys(keys + run_start, scratch_keys, i - run_start);
+			run_start = i + 1;
+		}
+	}
+
+	void recordSegment(VkCommandBuffer command_buffer, RenderContextSegment *segment) {
+		sortSegment(segment);
+
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+		RenderContextState *bound_constants = 0;
+		VkDescriptorSet bound_texture_set = VK_NULL_HANDLE;
+		RenderContextState *bound_buffers = 0;
+		RenderContextState *bound_viewport = 0;
+		VkRect2D bound_scissor = {};
+		bool scissor_set = false;
+
+		u32 end = segment->first_command + segment->command_count;
+		for(u32 i = segment->first_command; i < end; i++) {
+			RenderContextCommand *command = &commands[keys[i] & 0xffff];
+			if(command->type == RenderContextCommandType::Clear) {
+				RenderContextClear *clear = &clears[command->state];
+				VkClearRect rect = {};
+				rect.rect = clear->rect;
+				rect.layerCount = 1;
+				vkCmdClearAttachments(command_buffer, 1, &clear->attachment, 1, &rect);
+				continue;
+			}
+
+			RenderContextState *state = &states[command->state];
+			if(state->pipeline != bound_pipeline) {
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state->pipeline);
+				bound_pipeline = state->pipeline;
+			}
+			if(state->pipeline_layout != bound_layout) {
+				bound_layout = state->pipeline_layout;
+				bound_constants = 0;
+				bound_texture_set = VK_NULL_HANDLE;
+			}
+			if(state->constant_set != VK_NULL_HANDLE && (bound_constants == 0 || bound_constants->constant_set != state->constant_set ||
+			   memcmp(bound_constants->constant_offsets, state->constant_offsets, sizeof(u32) * state->constant_offset_count) != 0)) {
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state->pipeline_layout, 0, 1, &state->constant_set, state->constant_offset_count, state->constant_offsets);
+				bound_constants = state;
+			}
+			if(state->texture_set != VK_NULL_HANDLE && state->texture_set != bound_texture_set) {
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state->pipeline_layout, 1, 1, &state->texture_set, 0, 0);
+				bound_texture_set = state->texture_set;
+			}
+			if(bound_buffers == 0 || bound_buffers->vertex_buffer_count != state->vertex_buffer_count ||
+			   memcmp(bound_buffers->vertex_buffers, state->vertex_buffers, sizeof(VkBuffer) * state->vertex_buffer_count) != 0 ||
+			   bound_buffers->index_buffer != state->index_buffer || bound_buffers->index_type != state->index_type) {
+				VkDeviceSize offsets[RENDER_CONTEXT_MAX_VERTEX_BUFFERS] = {};
+				if(state->vertex_buffer_count > 0) vkCmdBindVertexBuffers(command_buffer, 0, state->vertex_buffer_count, state->vertex_buffers, offsets);
+				if(state->index_buffer != VK_NULL_HANDLE) vkCmdBindIndexBuffer(command_buffer, state->index_buffer, 0, state->index_type);
+				bound_buffers = state;
+			}
+			if(bound_viewport == 0 || memcmp(&bound_viewport->viewport, &state->viewport, sizeof(VkViewport)) != 0) {
+				vkCmdSetViewport(command_buffer, 0, 1, &state->viewport);
+				bound_viewport = state;
+			}
+			if(!scissor_set || memcmp(&bound_scissor, &command->scissor, sizeof(VkRect2D)) != 0) {
+				vkCmdSetScissor(command_buffer, 0, 1, &command->scissor);
+				bound_scissor = command->scissor;
+				scissor_set = true;
+			}
+
+			if(command->type == RenderContextCommandType::DrawIndexed) {
+				vkCmdDrawIndexed(command_buffer, command->count, 1, command->first, command->vertex_offset, 0);
+			} else {
+				vkCmdDraw(command_buffer, command->count, 1, command->first, 0);
+			}
+		}
+	}
+
+	static void recordOffscreen(VkCommandBuffer command_buffer, u32 frame, u32 image_index, void *data) {
+		VulkanRenderContext *context = (VulkanRenderContext *)data;
+		for(u32 s = 0; s < context->segment_count; s++) {
+			RenderContextSegment *segment = &context->segments[s];
+			if(segment->command_count == 0 || (segment->targets.color_count == 0 && segment->targets.depth == 0)) continue;
+
+			RenderContextTargetFormats formats = context->targetFormats(segment);
+			VkRenderPass render_pass = context->targetRenderPass(&formats);
+			VkRenderPassBeginInfo begin_info = {};
+			begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			begin_info.renderPass = render_pass;
+			begin_info.framebuffer = context->targetFramebuffer(segment, render_pass);
+			begin_info.renderArea.extent = {segment->width, segment->height};
+			vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+			context->recordSegment(command_buffer, segment);
+			vkCmdEndRenderPass(command_buffer);
+		}
+	}
+
+	static VkCommandBuffer recordOverlay(u32 frame, u32 image_index, void *data) {
+		VulkanRenderContext *context = (VulkanRenderContext *)data;
+		u32 back_buffer_commands = 0;
+		for(u32 s = 0; s < context->segment_count; s++) {
+			RenderContextSegment *segment = &context->segments[s];
+			if(segment->targets.color_count == 0 && segment->targets.depth == 0) back_buffer_commands += segment->command_count;
+		}
+		if(back_buffer_commands == 0) return VK_NULL_HANDLE;
+
+		VulkanRenderer *renderer = context->renderer;
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance_info.renderPass = renderer->render_pass;
+		inheritance_info.subpass = 0;
+		inheritance_info.framebuffer = renderer->frame_graph.framebuffer(renderer->main_pass, image_index);
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_info.pInheritanceInfo = &inheritance_info;
+
+		VkCommandBuffer command_buffer = context->overlay_command_buffers[frame];
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+		for(u32 s = 0; s < context->segment_count; s++) {
+			RenderContextSegment *segment = &context->segments[s];
+			if(segment->command_count == 0 || segment->targets.color_count > 0 || segment->targets.depth) continue;
+			context->recordSegment(command_buffer, segment);
+		}
+		vkEndCommandBuffer(command_buffer);
+		return command_buffer;
+	}
+};
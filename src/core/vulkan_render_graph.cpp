@@ -0,0 +1,769 @@
+#define RENDER_GRAPH_MAX_RESOURCES 32
+#define RENDER_GRAPH_MAX_PASSES 32
+#define RENDER_GRAPH_MAX_ACCESSES 8
+#define RENDER_GRAPH_MAX_IMAGES 8 // NOTE: per imported image, one for each swap chain image
+#define RENDER_GRAPH_INVALID 0xFFFFFFFF // NOTE: handed back for a resource or pass that didn't fit, uses of it are ignored
+
+enum class RenderGraphAccess {
+	ColorAttachment,
+	DepthAttachment,
+	SampledRead, // NOTE: fragment shader
+	StorageRead, // NOTE: vertex shader storage buffer
+	IndirectRead,
+	IndexRead,
+	ComputeRead,
+	ComputeWrite,
+	TransferRead,
+	TransferWrite,
+};
+
+struct RenderGraphAccessInfo {
+	VkPipelineStageFlags stage;
+	VkAccessFlags access;
+	VkImageLayout layout;
+	VkImageUsageFlags usage;
+	bool write;
+	bool attachment;
+};
+
+internal_func RenderGraphAccessInfo renderGraphAccessInfo(RenderGraphAccess access) {
+	RenderGraphAccessInfo result = {};
+	switch(access) {
+		case RenderGraphAccess::ColorAttachment: {
+			result = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true};
+		} break;
+		case RenderGraphAccess::DepthAttachment: {
+			result = {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true};
+		} break;
+		case RenderGraphAccess::SampledRead: {
+			result = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, false};
+		} break;
+		case RenderGraphAccess::StorageRead: {
+			result = {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, false};
+		} break;
+		case RenderGraphAccess::IndirectRead: {
+			result = {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false, false};
+		} break;
+		case RenderGraphAccess::IndexRead: {
+			result = {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false, false};
+		} break;
+		case RenderGraphAccess::ComputeRead: {
+			result = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, false};
+		} break;
+		case RenderGraphAccess::ComputeWrite: {
+			result = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, false};
+		} break;
+		case RenderGraphAccess::TransferRead: {
+			result = {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, false};
+		} break;
+		case RenderGraphAccess::TransferWrite: {
+			result = {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, false};
+		} break;
+	}
+	return result;
+}
+
+// NOTE: the stage and access that have to be waited on to leave, or are made ready by entering, a layout.
+// Used for one off transitions outside the graph.
+internal_func void imageLayoutAccess(VkImageLayout layout, VkPipelineStageFlags *stage, VkAccessFlags *access) {
+	switch(layout) {
+		case VK_IMAGE_LAYOUT_UNDEFINED: {
+			*stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			*access = 0;
+		} break;
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: {
+			*stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			*access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		} break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: {
+			*stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			*access = VK_ACCESS_TRANSFER_READ_BIT;
+		} break;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: {
+			*stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			*access = VK_ACCESS_SHADER_READ_BIT;
+		} break;
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: {
+			*stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			*access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		} break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: {
+			*stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			*access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		} break;
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: {
+			*stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			*access = 0;
+		} break;
+		default: {
+			*stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			*access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		} break;
+	}
+}
+
+struct RenderGraphResource {
+	const char *name;
+	bool is_buffer;
+	bool imported;
+	bool output; // NOTE: kept, along with the passes writing it, even though nothing in the graph reads it
+	VkFormat format;
+	VkImageAspectFlags aspect;
+	VkImageUsageFlags usage;
+	u32 width;
+	u32 height;
+	VkImageLayout final_layout;
+	VkImage images[RENDER_GRAPH_MAX_IMAGES];
+	VkImageView views[RENDER_GRAPH_MAX_IMAGES];
+	u32 image_count;
+	VkBuffer buffer;
+
+	// NOTE: filled in by compile
+	s32 first_pass;
+	s32 last_pass;
+	s32 alias_slot;
+	VkMemoryRequirements requirements;
+};
+
+struct RenderGraphUse {
+	u32 resource;
+	RenderGraphAccess access;
+	bool clear;
+	VkClearValue clear_value;
+	u32 attachment; // NOTE: filled in by compile, where the pass keeps its clear value
+};
+
+typedef void (*RenderGraphRecordFunc)(VkCommandBuffer command_buffer, u32 frame, u32 image_index, void *data);
+
+struct RenderGraphPass {
+	const char *name;
+	RenderGraphRecordFunc record;
+	void *data;
+	VkSubpassContents contents;
+	RenderGraphUse uses[RENDER_GRAPH_MAX_ACCESSES];
+	u32 use_count;
+
+	// NOTE: filled in by compile, image barriers name their resource and get the image for the frame at execute time
+	bool culled;
+	bool has_attachments;
+	u32 width;
+	u32 height;
+	VkPipelineStageFlags barrier_src_stage;
+	VkPipelineStageFlags barrier_dst_stage;
+	VkImageMemoryBarrier image_barriers[RENDER_GRAPH_MAX_ACCESSES];
+	u32 image_barrier_resources[RENDER_GRAPH_MAX_ACCESSES];
+	u32 image_barrier_count;
+	VkBufferMemoryBarrier buffer_barriers[RENDER_GRAPH_MAX_ACCESSES];
+	u32 buffer_barrier_count;
+	VkClearValue clear_values[RENDER_GRAPH_MAX_ACCESSES];
+	u32 attachment_count;
+};
+
+// NOTE: everything compile creates. A graph rebuilt on resize hands these to the deletion queue since frames in
+// flight are still using them.
+struct RenderGraphObjects {
+	VkRenderPass render_passes[RENDER_GRAPH_MAX_PASSES];
+	VkFramebuffer framebuffers[RENDER_GRAPH_MAX_PASSES][RENDER_GRAPH_MAX_IMAGES];
+	u32 framebuffer_counts[RENDER_GRAPH_MAX_PASSES];
+	VkImage images[RENDER_GRAPH_MAX_RESOURCES];
+	VkImageView views[RENDER_GRAPH_MAX_RESOURCES];
+	u32 image_count;
+	GpuAllocation allocations[RENDER_GRAPH_MAX_RESOURCES];
+	u32 allocation_count;
+};
+
+internal_func void releaseRenderGraphObjects(DeletionQueue *queue, RenderGraphObjects *objects) {
+	for(u32 p = 0; p < RENDER_GRAPH_MAX_PASSES; p++) {
+		for(u32 i = 0; i < objects->framebuffer_counts[p]; i++) {
+			queue->framebuffer(objects->framebuffers[p][i]);
+		}
+		if(objects->render_passes[p] != VK_NULL_HANDLE) queue->renderPass(objects->render_passes[p]);
+	}
+	for(u32 i = 0; i < objects->image_count; i++) {
+		queue->imageView(objects->views[i]);
+		queue->image(objects->images[i]);
+	}
+	for(u32 i = 0; i < objects->allocation_count; i++) {
+		queue->allocation(&objects->allocations[i]);
+	}
+	*objects = {};
+}
+
+// NOTE: Passes declare what they read and write and the graph works out the rest when compiled: passes whose
+// results nobody uses are culled, transient images whose lifetimes don't overlap share memory, attachment load and
+// store ops come from whether the contents are needed before and after, and every barrier is derived from the
+// previous use of each resource. The uses in the graph stand in for the previous frame's, so resources shared
+// between frames in flight are covered too. Each resource can only be used once per pass.
+struct RenderGraph {
+	VkDevice device;
+	GpuMemoryAllocator *gpu_memory;
+	RenderGraphResource resources[RENDER_GRAPH_MAX_RESOURCES];
+	u32 resource_count;
+	RenderGraphPass passes[RENDER_GRAPH_MAX_PASSES];
+	u32 pass_count;
+	RenderGraphObjects objects;
+
+	void init(VkDevice device, GpuMemoryAllocator *gpu_memory) {
+		this->device = device;
+		this->gpu_memory = gpu_memory;
+		resource_count = 0;
+		pass_count = 0;
+		objects = {};
+	}
+
+	// NOTE: forgets every declaration, the compiled objects have to be released first
+	void reset() {
+		resource_count = 0;
+		pass_count = 0;
+	}
+
+	u32 addResource(Platform *platform, const char *name) {
+		if(resource_count >= RENDER_GRAPH_MAX_RESOURCES) {
+			platform->error("Too many render graph resources");
+			return RENDER_GRAPH_INVALID;
+		}
+		u32 result = resource_count++;
+		RenderGraphResource *resource = &resources[result];
+		*resource = {};
+		resource->name = name;
+		resource->alias_slot = -1;
+		return result;
+	}
+
+	// NOTE: an image owned outside the graph, one per swap chain image. Its contents aren't kept between frames and it's left in final_layout.
+	u32 importImage(Platform *platform, const char *name, VkFormat format, VkImageAspectFlags aspect, u32 width, u32 height, const VkImage *images, const VkImageView *views, u32 image_count, VkImageLayout final_layout) {
+		if(image_count > RENDER_GRAPH_MAX_IMAGES) {
+			platform->error("Too many images for one render graph resource");
+			return RENDER_GRAPH_INVALID;
+		}
+		u32 result = addResource(platform, name);
+		if(result == RENDER_GRAPH_INVALID) return result;
+		RenderGraphResource *resource = &resources[result];
+		resource->imported = true;
+		resource->output = final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		resource->format = format;
+		resource->aspect = aspect;
+		resource->width = width;
+		resource->height = height;
+		resource->final_layout = final_layout;
+		resource->image_count = image_count;
+		for(u32 i = 0; i < image_count; i++) {
+			resource->images[i] = images[i];
+			resource->views[i] = views[i];
+		}
+		return result;
+	}
+
+	u32 importBuffer(Platform *platform, const char *name, VkBuffer buffer) {
+		u32 result = addResource(platform, name);
+		if(result == RENDER_GRAPH_INVALID) return result;
+		RenderGraphResource *resource = &resources[result];
+		resource->imported = true;
+		resource->is_buffer = true;
+		resource->buffer = buffer;
+		return result;
+	}
+
+	// NOTE: an image that only lives for the frame, created by compile with the usage its passes need
+	u32 createImage(Platform *platform, const char *name, VkFormat format, VkImageAspectFlags aspect, u32 width, u32 height) {
+		u32 result = addResource(platform, name);
+		if(result == RENDER_GRAPH_INVALID) return result;
+		RenderGraphResource *resource = &resources[result];
+		resource->format = format;
+		resource->aspect = aspect;
+		resource->width = width;
+		resource->height = height;
+		resource->image_count = 1;
+		return result;
+	}
+
+	u32 addPass(Platform *platform, const char *name, RenderGraphRecordFunc record, void *data, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) {
+		if(pass_count >= RENDER_GRAPH_MAX_PASSES) {
+			platform->error("Too many render graph passes");
+			return RENDER_GRAPH_INVALID;
+		}
+		u32 result = pass_count++;
+		RenderGraphPass *pass = &passes[result];
+		*pass = {};
+		pass->name = name;
+		pass->record = record;
+		pass->data = data;
+		pass->contents = contents;
+		return result;
+	}
+
+	// NOTE: 0 if the pass or resource is RENDER_GRAPH_INVALID, the error was reported when it was added
+	RenderGraphUse *use(Platform *platform, u32 pass_index, u32 resource, RenderGraphAccess access) {
+		if(pass_index >= pass_count || resource >= resource_count) return 0;
+		RenderGraphPass *pass = &passes[pass_index];
+		if(pass->use_count >= RENDER_GRAPH_MAX_ACCESSES) {
+			platform->error("Too many resources used by one render graph pass");
+			return 0;
+		}
+		RenderGraphUse *use = &pass->uses[pass->use_count++];
+		*use = {};
+		use->resource = resource;
+		use->access = access;
+		return use;
+	}
+
+	// NOTE: an attachment the pass clears on load instead of keeping what was there
+	void useCleared(Platform *platform, u32 pass_index, u32 resource, RenderGraphAccess access, VkClearValue clear_value) {
+		RenderGraphUse *use = this->use(platform, pass_index, resource, access);
+		if(use == 0) return;
+		use->clear = true;
+		use->clear_value = clear_value;
+	}
+
+	// NOTE: changes what a cleared attachment is cleared to without recompiling, used from the next execute on
+	void setClearValue(u32 pass_index, u32 resource, VkClearValue clear_value) {
+		if(pass_index >= pass_count) return;
+		RenderGraphPass *pass = &passes[pass_index];
+		for(u32 u = 0; u < pass->use_count; u++) {
+			RenderGraphUse *use = &pass->uses[u];
+			if(use->resource != resource || !use->clear) continue;
+			use->clear_value = clear_value;
+			if(!pass->culled) pass->clear_values[use->attachment] = clear_value;
+		}
+	}
+
+	// NOTE: the next live pass after after_pass that uses resource, -1 if there isn't one
+	s32 nextUse(u32 resource, u32 after_pass, RenderGraphUse **use_out) {
+		for(u32 p = after_pass + 1; p < pass_count; p++) {
+			if(passes[p].culled) continue;
+			for(u32 u = 0; u < passes[p].use_count; u++) {
+				if(passes[p].uses[u].resource == resource) {
+					if(use_out) *use_out = &passes[p].uses[u];
+					return (s32)p;
+				}
+			}
+		}
+		return -1;
+	}
+
+	void cullPasses() {
+		bool needed[RENDER_GRAPH_MAX_RESOURCES];
+		for(u32 r = 0; r < resource_count; r++) needed[r] = resources[r].output;
+
+		for(s32 p = (s32)pass_count - 1; p >= 0; p--) {
+			RenderGraphPass *pass = &passes[p];
+			pass->culled = true;
+			for(u32 u = 0; u < pass->use_count; u++) {
+				if(renderGraphAccessInfo(pass->uses[u].access).write && needed[pass->uses[u].resource]) pass->culled = false;
+			}
+			if(pass->culled) continue;
+
+			// NOTE: anything a live pass reads, or an attachment it loads rather than clears, has to be produced earlier
+			for(u32 u = 0; u < pass->use_count; u++) {
+				RenderGraphAccessInfo info = renderGraphAccessInfo(pass->uses[u].access);
+				if(!info.write || (info.attachment && !pass->uses[u].clear)) needed[pass->uses[u].resource] = true;
+			}
+		}
+
+		for(u32 r = 0; r < resource_count; r++) {
+			resources[r].first_pass = -1;
+			resources[r].last_pass = -1;
+		}
+		for(u32 p = 0; p < pass_count; p++) {
+			if(passes[p].culled) continue;
+			for(u32 u = 0; u < passes[p].use_count; u++) {
+				RenderGraphResource *resource = &resources[passes[p].uses[u].resource];
+				if(resource->first_pass < 0) resource->first_pass = (s32)p;
+				resource->last_pass = (s32)p;
+				resource->usage |= renderGraphAccessInfo(passes[p].uses[u].access).usage;
+			}
+		}
+	}
+
+	// NOTE: Greedy first fit, largest images first. Two images can share a slot when no live pass uses both, each
+	// slot is one allocation sized for its largest member.
+	void allocateTransients(Platform *platform) {
+		u32 order[RENDER_GRAPH_MAX_RESOURCES];
+		u32 transient_count = 0;
+		VkDeviceSize unaliased_size = 0;
+		for(u32 r = 0; r < resource_count; r++) {
+			RenderGraphResource *resource = &resources[r];
+			if(resource->imported || resource->is_buffer || resource->first_pass < 0) continue;
+
+			VkImageCreateInfo create_info = {};
+			create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			create_info.imageType = VK_IMAGE_TYPE_2D;
+			create_info.extent = {resource->width, resource->height, 1};
+			create_info.mipLevels = 1;
+			create_info.arrayLayers = 1;
+			create_info.format = resource->format;
+			create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			create_info.usage = resource->usage;
+			create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if(vkCreateImage(device, &create_info, 0, &resource->images[0]) != VK_SUCCESS) {
+				platform->error(formatString("Couldn't create render graph image %s", resource->name));
+			}
+			objects.images[objects.image_count++] = resource->images[0];
+			vkGetImageMemoryRequirements(device, resource->images[0], &resource->requirements);
+			unaliased_size += resource->requirements.size;
+
+			u32 i = transient_count++;
+			while(i > 0 && resources[order[i - 1]].requirements.size < resource->requirements.size) {
+				order[i] = order[i - 1];
+				i--;
+			}
+			order[i] = r;
+		}
+
+		VkMemoryRequirements slots[RENDER_GRAPH_MAX_RESOURCES];
+		u32 slot_count = 0;
+		for(u32 t = 0; t < transient_count; t++) {
+			RenderGraphResource *resource = &resources[order[t]];
+			for(u32 s = 0; s < slot_count && resource->alias_slot < 0; s++) {
+				if((slots[s].memoryTypeBits & resource->requirements.memoryTypeBits) == 0) continue;
+
+				bool overlaps = false;
+				for(u32 o = 0; o < t; o++) {
+					RenderGraphResource *other = &resources[order[o]];
+					if(other->alias_slot == (s32)s && other->first_pass <= resource->last_pass && resource->first_pass <= other->last_pass) overlaps = true;
+				}
+				if(overlaps) continue;
+
+				resource->alias_slot = (s32)s;
+				slots[s].memoryTypeBits &= resource->requirements.memoryTypeBits;
+				if(resource->requirements.size > slots[s].size) slots[s].size = resource->requirements.size;
+				if(resource->requirements.alignment > slots[s].alignment) slots[s].alignment = resource->requirements.alignment;
+			}
+
+			if(resource->alias_slot < 0) {
+				resource->alias_slot = (s32)slot_count;
+				slots[slot_count++] = resource->requirements;
+			}
+		}
+
+		VkDeviceSize aliased_size = 0;
+		for(u32 s = 0; s < slot_count; s++) {
+			objects.allocations[s] = gpu_memory->allocate(slots[s], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if(objects.allocations[s].memory == VK_NULL_HANDLE) {
+				platform->error("Couldn't allocate render graph memory");
+			}
+			aliased_size += slots[s].size;
+		}
+		objects.allocation_count = slot_count;
+
+		u32 view_index = 0;
+		for(u32 r = 0; r < resource_count; r++) {
+			RenderGraphResource *resource = &resources[r];
+			if(resource->alias_slot < 0) continue;
+
+			GpuAllocation *allocation = &objects.allocations[resource->alias_slot];
+			vkBindImageMemory(device, resource->images[0], allocation->memory, allocation->offset);
+
+			VkImageViewCreateInfo view_info = {};
+			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			view_info.image = resource->images[0];
+			view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			view_info.format = resource->format;
+			view_info.subresourceRange.aspectMask = resource->aspect;
+			view_info.subresourceRange.levelCount = 1;
+			view_info.subresourceRange.layerCount = 1;
+			if(vkCreateImageView(device, &view_info, 0, &resource->views[0]) != VK_SUCCESS) {
+				platform->error(formatString("Couldn't create render graph image view %s", resource->name));
+			}
+			objects.views[view_index++] = resource->views[0];
+		}
+
+		printf("Render graph: %u transient images in %.2fMB (%.2fMB unaliased)\n", transient_count, aliased_size / (1024.0f * 1024.0f), unaliased_size / (1024.0f * 1024.0f));
+	}
+
+	void createRenderPass(Platform *platform, u32 pass_index, VkAttachmentDescription *attachments, VkAttachmentReference *color_refs, u32 color_count, VkAttachmentReference *depth_ref, VkSubpassDependency *dependencies) {
+		RenderGraphPass *pass = &passes[pass_index];
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = color_count;
+		subpass.pColorAttachments = color_refs;
+		subpass.pDepthStencilAttachment = depth_ref;
+
+		VkRenderPassCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		create_info.attachmentCount = pass->attachment_count;
+		create_info.pAttachments = attachments;
+		create_info.subpassCount = 1;
+		create_info.pSubpasses = &subpass;
+		create_info.dependencyCount = 2;
+		create_info.pDependencies = dependencies;
+		if(vkCreateRenderPass(device, &create_info, 0, &objects.render_passes[pass_index]) != VK_SUCCESS) {
+			platform->error(formatString("Couldn't create render pass for %s", pass->name));
+		}
+
+		// NOTE: attachments from imported images cycle with the swap chain, transient ones are the same every frame
+		u32 framebuffer_count = 1;
+		for(u32 u = 0; u < pass->use_count; u++) {
+			RenderGraphResource *resource = &resources[pass->uses[u].resource];
+			if(renderGraphAccessInfo(pass->uses[u].access).attachment && resource->image_count > framebuffer_count) framebuffer_count = resource->image_count;
+		}
+
+		for(u32 f = 0; f < framebuffer_count; f++) {
+			VkImageView views[RENDER_GRAPH_MAX_ACCESSES];
+			u32 view_count = 0;
+			for(u32 u = 0; u < pass->use_count; u++) {
+				RenderGraphResource *resource = &resources[pass->uses[u].resource];
+				if(renderGraphAccessInfo(pass->uses[u].access).attachment) views[view_count++] = resource->views[f % resource->image_count];
+			}
+
+			VkFramebufferCreateInfo framebuffer_info = {};
+			framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebuffer_info.renderPass = objects.render_passes[pass_index];
+			framebuffer_info.attachmentCount = view_count;
+			framebuffer_info.pAttachments = views;
+			framebuffer_info.width = pass->width;
+			framebuffer_info.height = pass->height;
+			framebuffer_info.layers = 1;
+			if(vkCreateFramebuffer(device, &framebuffer_info, 0, &objects.framebuffers[pass_index][f]) != VK_SUCCESS) {
+				platform->error(formatString("Couldn't create frame buffer for %s", pass->name));
+			}
+		}
+		objects.framebuffer_counts[pass_index] = framebuffer_count;
+	}
+
+	// NOTE: Walks the live passes in order tracking the layout and the accesses since the last barrier for every
+	// resource. Read after read in the same layout needs nothing, anything else waits on what came before.
+	// Attachments are transitioned by their render pass, whose final layout is already what the next use wants.
+	void deriveBarriers(Platform *platform) {
+		VkImageLayout layouts[RENDER_GRAPH_MAX_RESOURCES];
+		VkPipelineStageFlags stages[RENDER_GRAPH_MAX_RESOURCES];
+		VkAccessFlags accesses[RENDER_GRAPH_MAX_RESOURCES];
+		bool pending_write[RENDER_GRAPH_MAX_RESOURCES];
+		bool written[RENDER_GRAPH_MAX_RESOURCES];
+
+		// NOTE: start from every use in the frame, that's what the previous frame may still be doing. Aliased images
+		// also have to wait on everything else that lives in their memory.
+		for(u32 r = 0; r < resource_count; r++) {
+			layouts[r] = VK_IMAGE_LAYOUT_UNDEFINED;
+			stages[r] = 0;
+			accesses[r] = 0;
+			pending_write[r] = false;
+			written[r] = false;
+		}
+		for(u32 p = 0; p < pass_count; p++) {
+			if(passes[p].culled) continue;
+			for(u32 u = 0; u < passes[p].use_count; u++) {
+				RenderGraphAccessInfo info = renderGraphAccessInfo(passes[p].uses[u].access);
+				u32 r = passes[p].uses[u].resource;
+				for(u32 o = 0; o < resource_count; o++) {
+					bool same_memory = o == r || (resources[r].alias_slot >= 0 && resources[o].alias_slot == resources[r].alias_slot);
+					if(!same_memory) continue;
+					stages[o] |= info.stage;
+					accesses[o] |= info.access;
+					pending_write[o] = pending_write[o] || info.write;
+				}
+			}
+		}
+
+		for(u32 p = 0; p < pass_count; p++) {
+			RenderGraphPass *pass = &passes[p];
+			if(pass->culled) continue;
+
+			VkAttachmentDescription attachments[RENDER_GRAPH_MAX_ACCESSES];
+			VkAttachmentReference color_refs[RENDER_GRAPH_MAX_ACCESSES];
+			VkAttachmentReference depth_ref = {};
+			u32 color_count = 0;
+			bool has_depth = false;
+
+			VkSubpassDependency dependencies[2] = {};
+			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[0].dstSubpass = 0;
+			dependencies[1].srcSubpass = 0;
+			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+
+			pass->attachment_count = 0;
+			pass->image_barrier_count = 0;
+			pass->buffer_barrier_count = 0;
+			pass->barrier_src_stage = 0;
+			pass->barrier_dst_stage = 0;
+
+			for(u32 u = 0; u < pass->use_count; u++) {
+				RenderGraphUse *use = &pass->uses[u];
+				RenderGraphResource *resource = &resources[use->resource];
+				RenderGraphAccessInfo info = renderGraphAccessInfo(use->access);
+				u32 r = use->resource;
+
+				bool layout_change = !resource->is_buffer && layouts[r] != info.layout;
+				bool hazard = layout_change || pending_write[r] || info.write;
+				VkPipelineStageFlags src_stage = stages[r] ? stages[r] : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				VkAccessFlags src_access = pending_write[r] ? accesses[r] : 0;
+
+				if(info.attachment) {
+					pass->has_attachments = true;
+					pass->width = resource->width;
+					pass->height = resource->height;
+
+					RenderGraphUse *next = 0;
+					s32 next_pass = nextUse(r, p, &next);
+					VkImageLayout final_layout = info.layout;
+					if(next_pass >= 0) {
+						RenderGraphAccessInfo next_info = renderGraphAccessInfo(next->access);
+						if(!resource->is_buffer && next_info.layout != VK_IMAGE_LAYOUT_UNDEFINED) final_layout = next_info.layout;
+						dependencies[1].dstStageMask |= next_info.stage;
+						dependencies[1].dstAccessMask |= next_info.access;
+					} else if(resource->imported && resource->final_layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+						final_layout = resource->final_layout;
+					}
+					dependencies[1].srcStageMask |= info.stage;
+					dependencies[1].srcAccessMask |= info.access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+					VkAttachmentDescription *attachment = &attachments[pass->attachment_count];
+					*attachment = {};
+					attachment->format = resource->format;
+					attachment->samples = VK_SAMPLE_COUNT_1_BIT;
+					attachment->loadOp = use->clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (written[r] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+					attachment->storeOp = next_pass >= 0 || resource->output ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					attachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					attachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					attachment->initialLayout = attachment->loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? layouts[r] : VK_IMAGE_LAYOUT_UNDEFINED;
+					attachment->finalLayout = final_layout;
+
+					VkAttachmentReference reference = {pass->attachment_count, info.layout};
+					if(use->access == RenderGraphAccess::DepthAttachment) {
+						depth_ref = reference;
+						has_depth = true;
+					} else {
+						color_refs[color_count++] = reference;
+					}
+					pass->clear_values[pass->attachment_count] = use->clear_value;
+					use->attachment = pass->attachment_count;
+					pass->attachment_count++;
+
+					if(hazard) {
+						dependencies[0].srcStageMask |= src_stage;
+						dependencies[0].srcAccessMask |= src_access;
+						dependencies[0].dstStageMask |= info.stage;
+						dependencies[0].dstAccessMask |= info.access;
+					}
+
+					// NOTE: the outgoing dependency already makes the writes visible to the next use
+					layouts[r] = final_layout;
+					if(next_pass >= 0) {
+						stages[r] = renderGraphAccessInfo(next->access).stage;
+						accesses[r] = renderGraphAccessInfo(next->access).access;
+						pending_write[r] = false;
+					} else {
+						stages[r] = info.stage;
+						accesses[r] = info.access;
+						pending_write[r] = true;
+					}
+					written[r] = true;
+					continue;
+				}
+
+				if(hazard) {
+					pass->barrier_src_stage |= src_stage;
+					pass->barrier_dst_stage |= info.stage;
+					if(resource->is_buffer) {
+						VkBufferMemoryBarrier *barrier = &pass->buffer_barriers[pass->buffer_barrier_count++];
+						*barrier = {};
+						barrier->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+						barrier->srcAccessMask = src_access;
+						barrier->dstAccessMask = info.access;
+						barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier->buffer = resource->buffer;
+						barrier->size = VK_WHOLE_SIZE;
+					} else {
+						VkImageMemoryBarrier *barrier = &pass->image_barriers[pass->image_barrier_count];
+						pass->image_barrier_resources[pass->image_barrier_count++] = r;
+						*barrier = {};
+						barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+						barrier->srcAccessMask = src_access;
+						barrier->dstAccessMask = info.access;
+						barrier->oldLayout = written[r] ? layouts[r] : VK_IMAGE_LAYOUT_UNDEFINED;
+						barrier->newLayout = info.layout;
+						barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier->subresourceRange.aspectMask = resource->aspect;
+						barrier->subresourceRange.levelCount = 1;
+						barrier->subresourceRange.layerCount = 1;
+					}
+					stages[r] = info.stage;
+					accesses[r] = info.access;
+				} else {
+					stages[r] |= info.stage;
+					accesses[r] |= info.access;
+				}
+				if(!resource->is_buffer) layouts[r] = info.layout;
+				pending_write[r] = info.write;
+				written[r] = written[r] || info.write;
+			}
+
+			if(pass->has_attachments) {
+				if(dependencies[0].srcStageMask == 0) dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				if(dependencies[0].dstStageMask == 0) dependencies[0].dstStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				if(dependencies[1].dstStageMask == 0) dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+				createRenderPass(platform, p, attachments, color_refs, color_count, has_depth ? &depth_ref : 0, dependencies);
+			}
+		}
+	}
+
+	void compile(Platform *platform) {
+		cullPasses();
+		allocateTransients(platform);
+		deriveBarriers(platform);
+
+		u32 culled_count = 0;
+		for(u32 p = 0; p < pass_count; p++) {
+			if(passes[p].culled) {
+				culled_count++;
+				printf("Render graph: culled %s, nothing reads its output\n", passes[p].name);
+			}
+		}
+		printf("Render graph: %u passes, %u culled\n", pass_count, culled_count);
+	}
+
+	VkRenderPass renderPass(u32 pass) {
+		if(pass >= pass_count) return VK_NULL_HANDLE;
+		return objects.render_passes[pass];
+	}
+
+	VkFramebuffer framebuffer(u32 pass, u32 image_index) {
+		if(pass >= pass_count || objects.framebuffer_counts[pass] == 0) return VK_NULL_HANDLE;
+		return objects.framebuffers[pass][image_index % objects.framebuffer_counts[pass]];
+	}
+
+	void execute(VkCommandBuffer command_buffer, u32 frame, u32 image_index, GpuProfiler *profiler) {
+		for(u32 p = 0; p < pass_count; p++) {
+			RenderGraphPass *pass = &passes[p];
+			if(pass->culled) continue;
+
+			u32 scope = profiler->beginScope(command_buffer, pass->name);
+
+			if(pass->image_barrier_count > 0 || pass->buffer_barrier_count > 0) {
+				for(u32 b = 0; b < pass->image_barrier_count; b++) {
+					RenderGraphResource *resource = &resources[pass->image_barrier_resources[b]];
+					pass->image_barriers[b].image = resource->images[image_index % resource->image_count];
+				}
+				vkCmdPipelineBarrier(command_buffer, pass->barrier_src_stage, pass->barrier_dst_stage, 0, 0, 0, pass->buffer_barrier_count, pass->buffer_barriers, pass->image_barrier_count, pass->image_barriers);
+			}
+
+			if(pass->has_attachments) {
+				VkRenderPassBeginInfo begin_info = {};
+				begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				begin_info.renderPass = objects.render_passes[p];
+				begin_info.framebuffer = framebuffer(p, image_index);
+				begin_info.renderArea.offset = {0, 0};
+				begin_info.renderArea.extent = {pass->width, pass->height};
+				begin_info.clearValueCount = pass->attachment_count;
+				begin_info.pClearValues = pass->clear_values;
+				vkCmdBeginRenderPass(command_buffer, &begin_info, pass->contents);
+				pass->record(command_buffer, frame, image_index, pass->data);
+				vkCmdEndRenderPass(command_buffer);
+			} else {
+				pass->record(command_buffer, frame, image_index, pass->data);
+			}
+
+			profiler->endScope(command_buffer, scope);
+		}
+	}
+
+	// NOTE: the compiled objects are destroyed once no frame in flight can be using them, call before compiling again
+	void release(DeletionQueue *queue) {
+		releaseRenderGraphObjects(queue, &objects);
+	}
+};
@@ -1,5 +1,13 @@
 #define MAX_FRAMES_IN_FLIGHT 2
+#define UNIFORM_RING_FRAME_SIZE Megabytes(1)
+#define MAX_RECORD_THREADS 8
+#define DRAWS_PER_RECORD_THREAD 64
+#define MAX_DRAW_ITEMS 4096
+#define INSTANCE_RING_FRAME_SIZE Megabytes(8)
+#define INSTANCING_BENCH_COUNT 100000
+#define INSTANCING_BENCH_PER_DRAW 25000
 
+static_assert(MAX_FRAMES_IN_FLIGHT <= GPU_PROFILER_MAX_FRAMES, "the gpu profiler keeps queries for each frame in flight");
 
 internal_func VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* data, void* user_data) {
 	printf("validation layer: %s\n", data->pMessage);
@@ -27,16 +35,20 @@ struct SwapChainSupportDetails {
 		return formats[0];
 	}
 	
-	VkPresentModeKHR choosePresentMode() {
-		VkPresentModeKHR best_mode = VK_PRESENT_MODE_FIFO_KHR; // NOTE(nathan): guarenteed on all platforms
-		
+	bool supportsPresentMode(VkPresentModeKHR mode) {
 		for(u32 i = 0; i < present_mode_count; i++) {
-			if(present_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) 
-				return present_modes[i];
-			else if(present_modes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR)
-				best_mode = present_modes[i];
+			if(present_modes[i] == mode) return true;
 		}
-		return best_mode; 
+		return false;
+	}
+	
+	// NOTE: the preferred mode if the surface has it, otherwise the closest in latency, tearing is only picked when asked for
+	VkPresentModeKHR choosePresentMode(VkPresentModeKHR preferred) {
+		if(supportsPresentMode(preferred)) return preferred;
+		
+		if(preferred == VK_PRESENT_MODE_MAILBOX_KHR && supportsPresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR)) return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		if(preferred == VK_PRESENT_MODE_IMMEDIATE_KHR && supportsPresentMode(VK_PRESENT_MODE_MAILBOX_KHR)) return VK_PRESENT_MODE_MAILBOX_KHR;
+		return VK_PRESENT_MODE_FIFO_KHR; // NOTE(nathan): guarenteed on all platforms
 	}
 	
 	VkExtent2D chooseExtent(SDL_Window *window) {
@@ -68,13 +80,18 @@ internal_func SwapChainSupportDetails querySwapChainSupport(Platform *platform,
 	return result;
 }
 
-internal_func VkShaderModule createShaderModule(Platform *platform, const VkDevice &device, const char *filename) {
+// NOTE: reflection is optional, when given it's filled in from the same code the module is created from
+internal_func VkShaderModule createShaderModule(Platform *platform, const VkDevice &device, const char *filename, ShaderReflection *reflection = 0) {
 	FileData frag_file = platform->readEntireFile(filename);
+	if(reflection && !reflection->parse(platform, (u32 *)frag_file.contents, frag_file.size, filename)) {
+		platform->free(frag_file.contents);
+		return VK_NULL_HANDLE;
+	}
 	VkShaderModuleCreateInfo create_info = {};
 	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	create_info.codeSize = frag_file.size;
 	create_info.pCode = (u32 *)frag_file.contents;
-	VkShaderModule result;
+	VkShaderModule result = VK_NULL_HANDLE;
 	if(vkCreateShaderModule(device, &create_info, 0, &result) != VK_SUCCESS) {
 		platform->error(formatString("Couldn't create shader %s\n", filename));
 	}
@@ -82,16 +99,75 @@ internal_func VkShaderModule createShaderModule(Platform *platform, const VkDevi
 	return result;
 }
 
-struct Vertex {
-	Vec3 pos;
-	Vec3 color;	
-	Vec2 uv;
-};
+internal_func void reflectShaderFile(Platform *platform, const char *filename, ShaderReflection *reflection) {
+	FileData file = platform->readEntireFile(filename);
+	reflection->parse(platform, (u32 *)file.contents, file.size, filename);
+	platform->free(file.contents);
+}
 
 struct UniformBufferObject {
 	Mat4 model;
 	Mat4 view;
 	Mat4 projection;	
+	Vec4 position_scale;
+	Vec4 position_offset;
+};
+
+// NOTE: an uploaded mesh, position_scale and position_offset undo its layout's position quantization in the vertex shader
+struct GpuMesh {
+	VkBuffer vertex_buffer;
+	VkBuffer color_buffer;
+	VkBuffer index_buffer;
+	u32 index_count; // NOTE: of LOD 0, the coarser LODs follow it in the same index buffer
+	MeshLod lods[MESH_MAX_LODS];
+	u32 lod_count;
+	Vec4 position_scale;
+	Vec4 position_offset;
+	Vec4 bounding_sphere; // NOTE: xyz centre and w radius in mesh space
+};
+
+// NOTE: std430 layout of the instanced vertex shader's InstanceData, the first three rows of the model matrix
+// followed by a bindless texture slot. 64 bytes so a ring offset divides exactly into a firstInstance.
+struct InstanceData {
+	Vec4 model_rows[3];
+	u32 texture_index;
+	u32 pad[3];
+};
+
+inline InstanceData instanceFromModel(Mat4 model, u32 texture_index) {
+	InstanceData result = {};
+	for(u32 row = 0; row < 3; row++) {
+		result.model_rows[row] = Vec4(model.data2d[row][0], model.data2d[row][1], model.data2d[row][2], model.data2d[row][3]);
+	}
+	result.texture_index = texture_index;
+	return result;
+}
+
+struct DrawItem {
+	VkPipeline pipeline;
+	VkDescriptorSet descriptor_set;
+	VkBuffer indirect_buffer; // NOTE: set for gpu culled draws, the instance count comes from the culling pass
+	VkDeviceSize indirect_offset;
+	VkBuffer vertex_buffer;
+	VkBuffer color_buffer;
+	VkBuffer index_buffer;
+	u32 index_count;
+	u32 first_index;
+	s32 vertex_offset;
+	u32 uniform_offset;
+	u32 texture_index;
+	u32 instance_count;
+	u32 first_instance;
+};
+
+struct VulkanRenderer;
+
+struct RecordJob {
+	VulkanRenderer *renderer;
+	VkCommandBuffer command_buffer;
+	u32 image_index;
+	u32 first_draw;
+	u32 draw_count;
 };
 
 struct VulkanRenderer {
@@ -99,82 +175,193 @@ struct VulkanRenderer {
 	VkInstance instance;
 	VkSurfaceKHR surface;
 	VkSwapchainKHR swap_chain;
+	VkPresentModeKHR preferred_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+	VkPresentModeKHR present_mode;
+	FramePacer *pacer = 0; // NOTE: optional, gets the submit and present latency markers
+	// NOTE: optional, how a RenderContext gets its draws in. offscreen records render passes before the frame graph,
+	// overlay returns a secondary command buffer for the main pass, run after the scene, or VK_NULL_HANDLE
+	RenderGraphRecordFunc context_offscreen_record = 0;
+	VkCommandBuffer (*context_overlay_record)(u32 frame, u32 image_index, void *data) = 0;
+	void *context_data = 0;
 	VkRenderPass render_pass;
-	VkPipeline graphics_pipeline;
+	VkPipeline graphics_pipeline; // NOTE: this frame's permutations, picked from pipelines in startFrame
+	VkPipeline instanced_pipeline;
+	PipelinePermutations pipelines;
+	DebugView debug_view = DebugView::Shaded;
+	PipelineCache pipeline_cache;
+	bool benchmark_pipeline_cache = false;
+	ShaderHotReloader shader_reloader;
+	bool disable_shader_reload = false;
 	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
 	SwapChainSupportDetails swap_chain_details;
+	VkImage *swap_images;
 	VkImageView *swap_image_views;
-	VkFramebuffer *swap_chain_frame_buffers;
-	VkCommandBuffer *command_buffers;
+	RenderGraph frame_graph;
+	u32 cull_pass;
+	u32 main_pass;
+	u32 backbuffer;
+	VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}}; // NOTE: what the main pass clears the back buffer to
+	bool swap_chain_out_of_date = false;
+	bool headless = false;
+	u32 headless_width = 1280;
+	u32 headless_height = 720;
+	VkImage offscreen_images[MAX_FRAMES_IN_FLIGHT];
+	GpuAllocation offscreen_allocations[MAX_FRAMES_IN_FLIGHT];
+	VkBuffer readback_buffers[MAX_FRAMES_IN_FLIGHT];
+	GpuAllocation readback_allocations[MAX_FRAMES_IN_FLIGHT];
+	char readback_request[512] = {};
+	char readback_paths[MAX_FRAMES_IN_FLIGHT][512];
+	bool readback_pending[MAX_FRAMES_IN_FLIGHT] = {};
+	DeletionQueue deletion_queues[MAX_FRAMES_IN_FLIGHT];
+	VkCommandPool frame_command_pools[MAX_FRAMES_IN_FLIGHT];
+	VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+	VkCommandPool record_command_pools[MAX_FRAMES_IN_FLIGHT][MAX_RECORD_THREADS];
+	VkCommandBuffer secondary_command_buffers[MAX_FRAMES_IN_FLIGHT][MAX_RECORD_THREADS];
+	WorkerPool record_workers;
+	u32 record_thread_count;
+	RecordJob record_jobs[MAX_RECORD_THREADS];
 	VkSurfaceFormatKHR surface_format;
 	VkCommandPool command_pool;
 	VkExtent2D extent;
 	
-	VkImage depth_image;
-	VkDeviceMemory depth_image_memory;
-	VkImageView depth_image_view;
-	
 	VkSemaphore image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
 	VkSemaphore render_finished_semaphores[MAX_FRAMES_IN_FLIGHT];
 	VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
 
 	VkQueue graphics_queue;
 	VkQueue present_queue;
+	VkQueue transfer_queue;
 	
 	VkDescriptorSetLayout descriptor_set_layout;
 	VkDescriptorPool descriptor_pool;
 	VkPipelineLayout pipeline_layout;
+	ShaderInterface graphics_interface;
+	PipelineLayoutCache layout_cache;
 	
 	VkDebugUtilsMessengerEXT debug_callback;
+	bool has_debug_utils;
 	
 	s32 graphics_queue_index;
 	s32 present_queue_index;
+	s32 transfer_queue_index;
+	UploadManager uploads;
+	VkCommandBuffer setup_command_buffer = VK_NULL_HANDLE;
+	u64 startup_start;
+	u64 startup_stage_start;
 	u32 swap_image_count;
 	
 	u32 current_frame = 0;
 	
-	VkBuffer vertex_buffer;
-	VkDeviceMemory vertex_buffer_memory;
+	GpuMemoryAllocator gpu_memory;
 	
-	VkBuffer index_buffer;
-	VkDeviceMemory index_buffer_memory;
+	GpuMesh mesh;
+	VertexLayout vertex_layout;
+	bool full_vertices = false;
+	bool vertex_colors = false;
+	GpuAllocation vertex_buffer_allocation;
+	GpuAllocation color_buffer_allocation;
+	GpuAllocation index_buffer_allocation;
 	
 	VkImage texture_image;
-	VkDeviceMemory texture_image_memory;
+	VkFormat texture_format;
+	u32 texture_mip_levels;
+	bool supports_bc_textures;
+	bool force_cpu_mips = false;
+	bool disable_mips = false;
+	bool benchmark_mips = false;
+	u64 bench_frame_start;
+	u32 bench_frame_count = 0;
+	GpuAllocation texture_image_allocation;
 	VkImageView texture_image_view;
 	VkSampler texture_sampler;
-	
-	VkBuffer *uniform_buffers;
-	VkDeviceMemory *uniform_buffers_memory;
-	
-	VkDescriptorSet *descriptor_sets;
+	u32 texture_slot;
+	
+	BindlessTextureTable bindless_textures;
+	u32 api_version; // NOTE: of the instance, 1.1 only when the loader has it
+	bool use_bindless;
+	bool disable_bindless = false;
+	
+	UniformRingBuffer uniform_ring;
+	UniformRingBuffer instance_ring;
+	InstanceData *bench_instances = 0;
+	bool benchmark_instancing = false;
+	Mat4 camera_view;
+	Mat4 camera_projection;
+	DrawItem draw_items[MAX_DRAW_ITEMS];
+	u32 draw_count;
+	
+	VkDescriptorSet descriptor_set;
+	VkDescriptorSet culled_descriptor_set;
+	GpuCuller culler;
+	Vec4 frustum_planes[6];
+	Vec3 camera_position;
+	f32 lod_pixels_per_unit;
+	f32 lod_pixel_error = 1.0f;
+	bool disable_lods = false;
+	bool disable_gpu_culling = false;
+	GpuMeshletCuller meshlet_culler;
+	MeshletMesh meshlet_mesh;
+	bool disable_meshlet_culling = false;
+	GpuProfiler profiler;
+	bool supports_host_query_reset;
 	
 	Vertex *vertices;
 	u32 vertex_count;
 	
 	u32 *indices;
 	u32 index_count;
+	MeshLod lods[MESH_MAX_LODS]; // NOTE: ranges of indices, without any the whole of it is LOD 0
+	u32 lod_count = 0;
 	
-	char *wanted_layers[1] = {
+	const char *wanted_layers[1] = {
 		"VK_LAYER_LUNARG_standard_validation",	
 	};
+	const char *enabled_layers[1];
+	u32 enabled_layer_count;
 	
-	char *device_extensions[1] = {
+	const char *device_extensions[1] = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
+	u32 enabled_device_extension_count;
+	
+	bool instanceExtensionAvailable(Platform *platform, const char *name) {
+		u32 available_count = 0;
+		vkEnumerateInstanceExtensionProperties(0, &available_count, 0);
+		VkExtensionProperties *available = (VkExtensionProperties *)platform->alloc(sizeof(VkExtensionProperties) * available_count);
+		vkEnumerateInstanceExtensionProperties(0, &available_count, available);
+		
+		bool result = false;
+		for(u32 i = 0; i < available_count; i++) {
+			if(strcmp(available[i].extensionName, name) == 0) {
+				result = true;
+				break;
+			}
+		}
+		
+		platform->free(available);
+		return result;
+	}
 	
 	void createInstance(Platform *platform, PlatformWindow *window) {
-		SDL_Window *sdl_window = (SDL_Window *)window->handle;
+		// NOTE: headless has no surface so needs none of the window system extensions
 		u32 extension_count = 0;
-		if(!SDL_Vulkan_GetInstanceExtensions(sdl_window, &extension_count, 0)) 
-			platform->error("Couldn't get instance extensions");
-		const char **extensions = (const char **)platform->alloc(sizeof(const char *) * extension_count+1);
-		extensions[0] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
-		
-		if(!SDL_Vulkan_GetInstanceExtensions(sdl_window, &extension_count, extensions+1)) 
-			platform->error("Couldn't get instance extensions");
+		const char **extensions;
+		if(headless) {
+			extensions = (const char **)platform->alloc(sizeof(const char *));
+		} else {
+			SDL_Window *sdl_window = (SDL_Window *)window->handle;
+			if(!SDL_Vulkan_GetInstanceExtensions(sdl_window, &extension_count, 0)) 
+				platform->error("Couldn't get instance extensions");
+			extensions = (const char **)platform->alloc(sizeof(const char *) * (extension_count+1));
+			
+			if(!SDL_Vulkan_GetInstanceExtensions(sdl_window, &extension_count, extensions)) 
+				platform->error("Couldn't get instance extensions");
+		}
 		
-		extension_count += 1;
+		has_debug_utils = instanceExtensionAvailable(platform, VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		if(has_debug_utils) {
+			extensions[extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+		}
 		
 		printf("=========== Extensions ===========\n");
 		for(u32 i = 0; i < extension_count; i++) {
@@ -187,7 +374,14 @@ struct VulkanRenderer {
 		vk_app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		vk_app_info.pEngineName = "Engine22";
 		vk_app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		vk_app_info.apiVersion = VK_API_VERSION_1_0;
+		// NOTE: a 1.0 loader fails instance creation for anything above 1.0, and it has no vkEnumerateInstanceVersion to ask
+		api_version = VK_API_VERSION_1_0;
+		PFN_vkEnumerateInstanceVersion enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(0, "vkEnumerateInstanceVersion");
+		u32 loader_version = VK_API_VERSION_1_0;
+		if(enumerateInstanceVersion && enumerateInstanceVersion(&loader_version) == VK_SUCCESS && loader_version >= VK_API_VERSION_1_1) {
+			api_version = VK_API_VERSION_1_1;
+		}
+		vk_app_info.apiVersion = api_version;
 		
 		u32 vk_wanted_layer_count = ArrayCount(wanted_layers);
 		
@@ -197,6 +391,8 @@ struct VulkanRenderer {
 		vkEnumerateInstanceLayerProperties(&vk_valid_layer_count, vk_layers);
 		
 		
+		// NOTE: validation is only there when the sdk is installed, CI machines with just a driver run without it
+		enabled_layer_count = 0;
 		printf("=========== Valid Layers ===========\n");
 		for(u32 l = 0; l < vk_wanted_layer_count; l++) {
 			const char *wanted_layer = wanted_layers[l];
@@ -210,22 +406,26 @@ struct VulkanRenderer {
 			}	
 			
 			if(!layer_found) {
-				platform->error(formatString("Couldn't find %s", wanted_layer));
+				printf("Couldn't find %s, running without it\n", wanted_layer);
 			} else {
 				printf("Found %s\n", wanted_layer);
+				enabled_layers[enabled_layer_count++] = wanted_layers[l];
 			}
 		}
+		platform->free(vk_layers);
 		
 		VkInstanceCreateInfo vk_create_info = {};
 		vk_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 		vk_create_info.enabledExtensionCount = extension_count;
 		vk_create_info.ppEnabledExtensionNames = &extensions[0];
 		vk_create_info.pApplicationInfo = &vk_app_info;
-		vk_create_info.enabledLayerCount = ArrayCount(wanted_layers);
-		vk_create_info.ppEnabledLayerNames = &wanted_layers[0];
+		vk_create_info.enabledLayerCount = enabled_layer_count;
+		vk_create_info.ppEnabledLayerNames = &enabled_layers[0];
 		
 		if(vkCreateInstance(&vk_create_info, 0, &instance) != VK_SUCCESS) 
 			platform->error("Couldn't create vulkan instance");
+		
+		platform->free(extensions);
 	}
 	
 	void setupDebugUtils(Platform *platform) {
@@ -258,7 +458,9 @@ struct VulkanRenderer {
 		VkPhysicalDevice *physical_devices = (VkPhysicalDevice *)platform->alloc(sizeof(VkPhysicalDevice) * physical_device_count);
 		vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices);
 		
-		u32 wanted_device_extensions = ArrayCount(device_extensions);
+		// NOTE: offscreen rendering doesn't present, so the swap chain extension isn't required
+		enabled_device_extension_count = headless ? 0 : ArrayCount(device_extensions);
+		u32 wanted_device_extensions = enabled_device_extension_count;
 		
 		printf("=========== GPUS ===========\n");
 		for(u32 i = 0; i < physical_device_count; i++) {
@@ -297,7 +499,7 @@ struct VulkanRenderer {
 			
 			suitable = found_all_exts && device_features.samplerAnisotropy;
 			
-			if(suitable) {
+			if(suitable && !headless) {
 				SwapChainSupportDetails details = querySwapChainSupport(platform, phys_device, surface);
 				suitable = details.format_count > 0 && details.present_mode_count > 0;	
 				if(suitable) swap_chain_details = details;
@@ -328,6 +530,7 @@ struct VulkanRenderer {
 		
 		graphics_queue_index = -1;
 		present_queue_index = -1;
+		transfer_queue_index = -1;
 		
 		for(u32 i = 0; i < vk_queue_family_count; i++) {
 			VkQueueFamilyProperties &queue_family = vk_queue_families[i];
@@ -337,15 +540,52 @@ struct VulkanRenderer {
 			}
 			
 			VkBool32 present_support = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, surface, &present_support);
+			if(!headless) vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, surface, &present_support);
 			if(present_queue_index == -1 && queue_family.queueCount > 0 && present_support) {
 				present_queue_index = (s32)i;
 				
 			}
+			
+			// NOTE: prefer a family that can only transfer, that's the one backed by the copy engines
+			bool transfer_only = !(queue_family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+			if(queue_family.queueCount > 0 && queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT && !(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				if(transfer_queue_index == -1 || transfer_only) {
+					transfer_queue_index = (s32)i;
+				}
+			}
+		}
+		
+		if(transfer_queue_index == -1) {
+			transfer_queue_index = graphics_queue_index;
+		}
+		
+		if(headless) {
+			present_queue_index = graphics_queue_index;
 		}
 		
+		platform->free(vk_queue_families);
+		
 		printf("Using graphics queue %d\n", graphics_queue_index);
 		printf("Using present queue %d\n", present_queue_index);
+		printf("Using transfer queue %d\n", transfer_queue_index);
+	}
+	
+	bool deviceExtensionAvailable(Platform *platform, const char *name) {
+		u32 available_count = 0;
+		vkEnumerateDeviceExtensionProperties(physical_device, 0, &available_count, 0);
+		VkExtensionProperties *available = (VkExtensionProperties *)platform->alloc(sizeof(VkExtensionProperties) * available_count);
+		vkEnumerateDeviceExtensionProperties(physical_device, 0, &available_count, available);
+		
+		bool result = false;
+		for(u32 i = 0; i < available_count; i++) {
+			if(strcmp(available[i].extensionName, name) == 0) {
+				result = true;
+				break;
+			}
+		}
+		
+		platform->free(available);
+		return result;
 	}
 	
 	void createDevice(Platform *platform) {
@@ -353,7 +593,8 @@ struct VulkanRenderer {
 	
 		u32 queue_indices[] = {
 			(u32)graphics_queue_index,
-			(u32)present_queue_index
+			(u32)present_queue_index,
+			(u32)transfer_queue_index
 		};
 		
 		u32 queue_indices_count = ArrayCount(queue_indices);
@@ -381,18 +622,76 @@ struct VulkanRenderer {
 			}
 		}
 		
+		VkPhysicalDeviceFeatures supported_features;
+		vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+		supports_bc_textures = supported_features.textureCompressionBC == VK_TRUE;
+		
 		VkPhysicalDeviceFeatures device_features = {};
 		device_features.samplerAnisotropy = VK_TRUE;
+		device_features.textureCompressionBC = supported_features.textureCompressionBC;
+		
+		const char *extensions[3];
+		u32 extension_count = 0;
+		for(u32 i = 0; i < enabled_device_extension_count; i++) {
+			extensions[extension_count++] = device_extensions[i];
+		}
+		
+		// NOTE: descriptor indexing backs the bindless texture table, without it draws fall back to the single sampler binding
+		// the features2 queries need 1.1 from both the instance and the device, 1.0 takes the non bindless path
+		VkPhysicalDeviceProperties device_props;
+		vkGetPhysicalDeviceProperties(physical_device, &device_props);
+		bool has_vulkan_1_1 = api_version >= VK_API_VERSION_1_1 && device_props.apiVersion >= VK_API_VERSION_1_1;
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported_indexing = {};
+		supported_indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		if(has_vulkan_1_1 && deviceExtensionAvailable(platform, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+			VkPhysicalDeviceFeatures2 features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &supported_indexing;
+			vkGetPhysicalDeviceFeatures2(physical_device, &features2);
+		}
+		
+		use_bindless = !disable_bindless && supported_indexing.runtimeDescriptorArray && supported_indexing.descriptorBindingPartiallyBound && supported_indexing.descriptorBindingSampledImageUpdateAfterBind && supported_indexing.shaderSampledImageArrayNonUniformIndexing;
+		
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {};
+		indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		if(use_bindless) {
+			indexing_features.runtimeDescriptorArray = VK_TRUE;
+			indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+			indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			extensions[extension_count++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+		}
+		printf("Bindless textures %s\n", use_bindless ? "enabled" : "disabled");
+		
+		// NOTE: lets upload batches on a transfer only queue reset their timestamp queries from the cpu
+		VkPhysicalDeviceHostQueryResetFeaturesEXT supported_host_reset = {};
+		supported_host_reset.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+		if(has_vulkan_1_1 && deviceExtensionAvailable(platform, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME)) {
+			VkPhysicalDeviceFeatures2 features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &supported_host_reset;
+			vkGetPhysicalDeviceFeatures2(physical_device, &features2);
+		}
+		supports_host_query_reset = supported_host_reset.hostQueryReset == VK_TRUE;
+		
+		VkPhysicalDeviceHostQueryResetFeaturesEXT host_reset_features = {};
+		host_reset_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+		host_reset_features.pNext = use_bindless ? &indexing_features : 0;
+		if(supports_host_query_reset) {
+			host_reset_features.hostQueryReset = VK_TRUE;
+			extensions[extension_count++] = VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME;
+		}
 		
 		VkDeviceCreateInfo device_create_info = {};
 		device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		device_create_info.pNext = supports_host_query_reset ? (void *)&host_reset_features : host_reset_features.pNext;
 		device_create_info.pQueueCreateInfos = vk_queue_create_infos;
 		device_create_info.queueCreateInfoCount = queue_unique_count;
 		device_create_info.pEnabledFeatures = &device_features;
-		device_create_info.enabledLayerCount = ArrayCount(wanted_layers);
-		device_create_info.ppEnabledLayerNames = &wanted_layers[0];
-		device_create_info.ppEnabledExtensionNames = device_extensions;
-		device_create_info.enabledExtensionCount = ArrayCount(device_extensions);
+		device_create_info.enabledLayerCount = enabled_layer_count;
+		device_create_info.ppEnabledLayerNames = &enabled_layers[0];
+		device_create_info.ppEnabledExtensionNames = extensions;
+		device_create_info.enabledExtensionCount = extension_count;
 		
 		if(vkCreateDevice(physical_device, &device_create_info, 0, &device) != VK_SUCCESS) {
 			platform->error("Couldn't create logical device");
@@ -402,14 +701,15 @@ struct VulkanRenderer {
 	void createQueues() {
 		vkGetDeviceQueue(device, graphics_queue_index, 0, &graphics_queue);
 		vkGetDeviceQueue(device, present_queue_index, 0, &present_queue);
+		vkGetDeviceQueue(device, transfer_queue_index, 0, &transfer_queue);
 	}
 	
-	void createSwapChain(Platform *platform, PlatformWindow *window) {
+	void createSwapChain(Platform *platform, PlatformWindow *window, VkSwapchainKHR old_swap_chain = VK_NULL_HANDLE) {
 		SDL_Window *sdl_window = (SDL_Window *)window->handle;
 		swap_chain_details = querySwapChainSupport(platform, physical_device, surface);
 		
 		surface_format = swap_chain_details.chooseFormat();
-		VkPresentModeKHR present_mode = swap_chain_details.choosePresentMode();
+		present_mode = swap_chain_details.choosePresentMode(preferred_present_mode);
 		extent = swap_chain_details.chooseExtent(sdl_window);
 		u32 image_count = swap_chain_details.surface_capabilities.minImageCount+1;
 		if(swap_chain_details.surface_capabilities.maxImageCount > 0 && image_count > swap_chain_details.surface_capabilities.maxImageCount) 
@@ -442,7 +742,7 @@ struct VulkanRenderer {
 		vk_swap_chain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 		vk_swap_chain_create_info.presentMode = present_mode;
 		vk_swap_chain_create_info.clipped = VK_TRUE;
-		vk_swap_chain_create_info.oldSwapchain = VK_NULL_HANDLE;
+		vk_swap_chain_create_info.oldSwapchain = old_swap_chain;
 		
 		
 		if(vkCreateSwapchainKHR(device, &vk_swap_chain_create_info, 0, &swap_chain) != VK_SUCCESS) 
@@ -450,7 +750,7 @@ struct VulkanRenderer {
 		
 	}
 	
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, Platform *platform) {
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, u32 mip_levels, Platform *platform) {
 		VkImageViewCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		create_info.image = image;
@@ -458,7 +758,7 @@ struct VulkanRenderer {
 		create_info.format = format;
 		create_info.subresourceRange.aspectMask = aspect_flags;
 		create_info.subresourceRange.baseMipLevel = 0;
-		create_info.subresourceRange.levelCount = 1;
+		create_info.subresourceRange.levelCount = mip_levels;
 		create_info.subresourceRange.baseArrayLayer = 0;
 		create_info.subresourceRange.layerCount = 1;
 		
@@ -473,93 +773,180 @@ struct VulkanRenderer {
 	void createImageViews(Platform *platform) {	
 		swap_image_count = 0;
 		vkGetSwapchainImagesKHR(device, swap_chain, &swap_image_count, 0);
-		VkImage *vk_swap_images = (VkImage *)platform->alloc(sizeof(VkImage) * swap_image_count);
-		vkGetSwapchainImagesKHR(device, swap_chain, &swap_image_count, vk_swap_images);
+		swap_images = (VkImage *)platform->alloc(sizeof(VkImage) * swap_image_count);
+		vkGetSwapchainImagesKHR(device, swap_chain, &swap_image_count, swap_images);
 		
 		swap_image_views = (VkImageView *)platform->alloc(sizeof(VkImageView) * swap_image_count);
 		for(u32 i = 0; i < swap_image_count; i++) {
-			swap_image_views[i] = createImageView(vk_swap_images[i], surface_format.format, VK_IMAGE_ASPECT_COLOR_BIT, platform);
-		}
-	}
-	
-	void createRenderPass(Platform *platform) {
-		VkAttachmentDescription vk_color_attach_desc = {};
-		vk_color_attach_desc.format = surface_format.format;
-		vk_color_attach_desc.samples = VK_SAMPLE_COUNT_1_BIT;
-		vk_color_attach_desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		vk_color_attach_desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		vk_color_attach_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		vk_color_attach_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		vk_color_attach_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		vk_color_attach_desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		
-		VkAttachmentDescription depth_attach_desc = {};
-		depth_attach_desc.format = findDepthFormat(platform);
-		depth_attach_desc.samples = VK_SAMPLE_COUNT_1_BIT;
-		depth_attach_desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depth_attach_desc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depth_attach_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		depth_attach_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depth_attach_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		depth_attach_desc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		
-		VkAttachmentReference vk_color_attach_ref = {};
-		vk_color_attach_ref.attachment = 0;
-		vk_color_attach_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		
-		VkAttachmentReference depth_attach_ref = {};
-		depth_attach_ref.attachment = 1;
-		depth_attach_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		
-		VkSubpassDescription vk_subpass_desc = {};
-		vk_subpass_desc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		vk_subpass_desc.colorAttachmentCount = 1;
-		vk_subpass_desc.pColorAttachments = &vk_color_attach_ref;
-		vk_subpass_desc.pDepthStencilAttachment = &depth_attach_ref;
-		
-		VkSubpassDependency vk_dependency = {};
-		vk_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		vk_dependency.dstSubpass = 0;
-		vk_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		vk_dependency.srcAccessMask = 0;
-		vk_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		vk_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		
-		VkAttachmentDescription attachments[] = {
-			vk_color_attach_desc,
-			depth_attach_desc
-		};
-		
-		VkRenderPassCreateInfo render_pass_create_info = {};
-		render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		render_pass_create_info.attachmentCount = ArrayCount(attachments);
-		render_pass_create_info.pAttachments = &attachments[0];
-		render_pass_create_info.subpassCount = 1;
-		render_pass_create_info.pSubpasses = &vk_subpass_desc;
-		render_pass_create_info.dependencyCount = 1;
-		render_pass_create_info.pDependencies = &vk_dependency;
+			swap_image_views[i] = createImageView(swap_images[i], surface_format.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, platform);
+		}
+	}
+	
+	// NOTE: headless stand in for the swap chain, one colour target per frame in flight so a target is free again once its frame's fence has signalled
+	void createOffscreenTargets(Platform *platform) {
+		surface_format = {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+		extent = {headless_width, headless_height};
+		swap_chain = VK_NULL_HANDLE;
+		swap_image_count = MAX_FRAMES_IN_FLIGHT;
+		swap_images = 0;
+		swap_image_views = (VkImageView *)platform->alloc(sizeof(VkImageView) * swap_image_count);
 		
-		if(vkCreateRenderPass(device, &render_pass_create_info, 0, &render_pass) != VK_SUCCESS) {
-			platform->error("Couldn't create render pass");
+		for(u32 i = 0; i < swap_image_count; i++) {
+			createImage(
+				extent.width, extent.height, 1,
+				surface_format.format,
+				VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				offscreen_images[i], offscreen_allocations[i], platform
+			);
+			swap_image_views[i] = createImageView(offscreen_images[i], surface_format.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, platform);
+			
+			createBuffer(
+				(VkDeviceSize)extent.width * extent.height * 4,
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				readback_buffers[i],
+				readback_allocations[i],
+				platform
+			);
+		}
+	}
+	
+	void destroyOffscreenTargets() {
+		for(u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			vkDestroyImage(device, offscreen_images[i], 0);
+			gpu_memory.free(&offscreen_allocations[i]);
+			vkDestroyBuffer(device, readback_buffers[i], 0);
+			gpu_memory.free(&readback_allocations[i]);
 		}
 	}
 	
-	u32 findMemoryType(u32 type_filter, VkMemoryPropertyFlags properties, Platform *platform) {
-		VkPhysicalDeviceMemoryProperties memory_properties;
-		vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+	// NOTE: the next recorded frame gets copied out and written to path as a binary ppm once its fence signals
+	void requestReadback(Platform *platform, const char *path) {
+		if(!headless) {
+			platform->error("Frame readback needs -headless, swap chain images can't be copied from");
+			return;
+		}
 		
-		for(u32 i = 0; i < memory_properties.memoryTypeCount; i++) {
-			if(type_filter & (1 << i) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
+		strncpy(readback_request, path, sizeof(readback_request) - 1);
+	}
+	
+	void recordReadback(VkCommandBuffer command_buffer, u32 frame, u32 image_index) {
+		// NOTE: the render pass has already moved the target to TRANSFER_SRC, this only orders the copy after the colour writes
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = offscreen_images[image_index];
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+		
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = {extent.width, extent.height, 1};
+		vkCmdCopyImageToBuffer(command_buffer, offscreen_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffers[frame], 1, &region);
+		
+		// NOTE: make the copy visible to the host once the fence is waited on
+		VkBufferMemoryBarrier host_barrier = {};
+		host_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		host_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		host_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		host_barrier.buffer = readback_buffers[frame];
+		host_barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, 0, 1, &host_barrier, 0, 0);
+		
+		memcpy(readback_paths[frame], readback_request, sizeof(readback_request));
+		readback_pending[frame] = true;
+		readback_request[0] = 0;
+	}
+	
+	// NOTE: called once the frame's fence has signalled
+	void finishReadback(u32 frame, Platform *platform) {
+		if(!readback_pending[frame]) return;
+		readback_pending[frame] = false;
+		
+		u32 pixel_count = extent.width * extent.height;
+		u8 *bgra = (u8 *)readback_allocations[frame].mapped;
+		u8 *rgb = (u8 *)platform->alloc(pixel_count * 3);
+		for(u32 i = 0; i < pixel_count; i++) {
+			rgb[i * 3 + 0] = bgra[i * 4 + 2];
+			rgb[i * 3 + 1] = bgra[i * 4 + 1];
+			rgb[i * 3 + 2] = bgra[i * 4 + 0];
+		}
+		
+		void *file = platform->openFileForWriting(readback_paths[frame]);
+		if(file) {
+			char *header = formatString("P6\n%u %u\n255\n", extent.width, extent.height);
+			platform->writeToFile(file, header, (s32)strlen(header));
+			platform->writeToFile(file, rgb, (s32)(pixel_count * 3));
+			platform->closeOpenFile(file);
+			printf("Wrote frame to %s\n", readback_paths[frame]);
 		}
 		
-		platform->error("Couldn't find memory type");
+		platform->free(rgb);
+	}
+	
+	static void recordCullPass(VkCommandBuffer command_buffer, u32 frame, u32 image_index, void *data) {
+		VulkanRenderer *renderer = (VulkanRenderer *)data;
+		renderer->culler.record(command_buffer, renderer->frustum_planes);
+		renderer->meshlet_culler.record(command_buffer);
+	}
+	
+	static void recordMainPass(VkCommandBuffer command_buffer, u32 frame, u32 image_index, void *data) {
+		((VulkanRenderer *)data)->recordMainPassDraws(command_buffer, frame, image_index);
+	}
+	
+	// NOTE: rebuilt with the swap chain, the old graph's objects go on the deletion queue with the rest of it
+	void buildFrameGraph(Platform *platform) {
+		frame_graph.reset();
 		
-		return UINT32_MAX;
+		VkImage *targets = headless ? offscreen_images : swap_images;
+		backbuffer = frame_graph.importImage(platform, "backbuffer", surface_format.format, VK_IMAGE_ASPECT_COLOR_BIT, extent.width, extent.height, targets, swap_image_views, swap_image_count, headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		VkFormat depth_format = findDepthFormat(platform);
+		u32 depth = frame_graph.createImage(platform, "depth", depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, extent.width, extent.height);
+		u32 culled_instances = frame_graph.importBuffer(platform, "culled instances", culler.output_buffer);
+		u32 draw_commands = frame_graph.importBuffer(platform, "draw commands", culler.command_buffer);
+		u32 meshlet_indices = frame_graph.importBuffer(platform, "meshlet indices", meshlet_culler.index_buffer);
+		u32 meshlet_commands = frame_graph.importBuffer(platform, "meshlet commands", meshlet_culler.command_buffer);
+		
+		cull_pass = frame_graph.addPass(platform, "culling", recordCullPass, this);
+		frame_graph.use(platform, cull_pass, culled_instances, RenderGraphAccess::ComputeWrite);
+		frame_graph.use(platform, cull_pass, draw_commands, RenderGraphAccess::ComputeWrite);
+		frame_graph.use(platform, cull_pass, meshlet_indices, RenderGraphAccess::ComputeWrite);
+		frame_graph.use(platform, cull_pass, meshlet_commands, RenderGraphAccess::ComputeWrite);
+		
+		VkClearValue clear_depth = {};
+		clear_depth.depthStencil = {1.0f, 0};
+		
+		main_pass = frame_graph.addPass(platform, "main pass", recordMainPass, this, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		frame_graph.useCleared(platform, main_pass, backbuffer, RenderGraphAccess::ColorAttachment, clear_color);
+		frame_graph.useCleared(platform, main_pass, depth, RenderGraphAccess::DepthAttachment, clear_depth);
+		frame_graph.use(platform, main_pass, draw_commands, RenderGraphAccess::IndirectRead);
+		frame_graph.use(platform, main_pass, culled_instances, RenderGraphAccess::StorageRead);
+		frame_graph.use(platform, main_pass, meshlet_indices, RenderGraphAccess::IndexRead);
+		frame_graph.use(platform, main_pass, meshlet_commands, RenderGraphAccess::IndirectRead);
+		
+		frame_graph.compile(platform);
+		render_pass = frame_graph.renderPass(main_pass);
 	}
 	
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory, Platform *platform) {
+	// NOTE: used from the next frame recorded, rebuilds of the frame graph read it from clear_color
+	void setClearColor(f32 color[4]) {
+		memcpy(clear_color.color.float32, color, sizeof(clear_color.color.float32));
+		frame_graph.setClearValue(main_pass, backbuffer, clear_color);
+	}
+	
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, GpuAllocation &allocation, Platform *platform, GpuAllocationStrategy strategy = GpuAllocationStrategy::General) {
 		VkBufferCreateInfo buffer_create_info = {};
 		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		buffer_create_info.size = size;
@@ -573,133 +960,146 @@ struct VulkanRenderer {
 		VkMemoryRequirements memory_requirements;
 		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
 		
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = memory_requirements.size;
-		alloc_info.memoryTypeIndex = findMemoryType(memory_requirements.memoryTypeBits, properties, platform);
-		
-		if(vkAllocateMemory(device, &alloc_info, 0, &buffer_memory) != VK_SUCCESS) {
+		allocation = gpu_memory.allocate(memory_requirements, properties, strategy);
+		if(allocation.memory == VK_NULL_HANDLE) {
 			platform->error("Couldn't allocate buffer memory");
 		}
 		
-		vkBindBufferMemory(device, buffer, buffer_memory, 0);
+		vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
 	}
 	
-		
-	void copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size) {
-		
-		VkCommandBuffer command_buffer = beginSingleTimeCommands();
-		
-		VkBufferCopy copy_region = {};
-		copy_region.srcOffset = 0;
-		copy_region.dstOffset = 0;
-		copy_region.size = size;
-		
-		vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
-		
-		endSingleTimeCommands(command_buffer);
-	}
 	
 	void createVertexBuffer(Platform *platform) {
-		VkDeviceSize vb_size = sizeof(vertices[0]) * vertex_count;
+		vertex_layout.positionDequantize(vertices, vertex_count, &mesh.position_scale, &mesh.position_offset);
 		
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+		VkDeviceSize vb_size = (VkDeviceSize)vertex_layout.stride * vertex_count;
+		u8 *packed = (u8 *)platform->alloc(vb_size);
+		vertex_layout.pack(vertices, vertex_count, mesh.position_scale, mesh.position_offset, packed);
 		
 		createBuffer(
-             vb_size, 
-             VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-             staging_buffer, 
-             staging_buffer_memory,
-             platform
-         );
-		
-		void *data;
-		vkMapMemory(device, staging_buffer_memory, 0, vb_size, 0, &data);
-		memcpy(data, vertices, vb_size);
-		vkUnmapMemory(device, staging_buffer_memory);
+			vb_size, 
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			mesh.vertex_buffer,
+			vertex_buffer_allocation,
+			platform
+		);	
+		
+		uploads.uploadBuffer(platform, mesh.vertex_buffer, 0, packed, vb_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		platform->free(packed);
+		
+		// NOTE: without a color stream this is a single white texel read with a stride of 0
+		u32 color_count = vertex_layout.color_stream ? vertex_count : 1;
+		VkDeviceSize color_size = sizeof(u32) * color_count;
+		u32 *colors = (u32 *)platform->alloc(color_size);
+		if(vertex_layout.color_stream) {
+			vertex_layout.packColors(vertices, vertex_count, colors);
+		} else {
+			colors[0] = 0xffffffff;
+		}
 		
 		createBuffer(
-			vb_size, 
+			color_size, 
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			vertex_buffer,
-			vertex_buffer_memory,
+			mesh.color_buffer,
+			color_buffer_allocation,
 			platform
 		);	
 		
-		copyBuffer(staging_buffer, vertex_buffer, vb_size);
+		uploads.uploadBuffer(platform, mesh.color_buffer, 0, colors, color_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		platform->free(colors);
 		
-		vkDestroyBuffer(device, staging_buffer, 0);
-		vkFreeMemory(device, staging_buffer_memory, 0);
+		printf("Vertex layout: %u bytes a vertex (+%u color), %.2fmb\n", vertex_layout.stride, vertex_layout.color_stride, (f32)(vb_size + color_size) / (1024.0f * 1024.0f));
 	}
 	
 	void createIndexBuffer(Platform *platform) {
 		VkDeviceSize buffer_size = sizeof(indices[0]) * index_count;
 		
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
-		
-		createBuffer(
-             buffer_size, 
-             VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-             staging_buffer, 
-             staging_buffer_memory,
-             platform
-         );
-		
-		void *data;
-		vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, indices, buffer_size);
-		vkUnmapMemory(device, staging_buffer_memory);
-		
 		createBuffer(
 			buffer_size, 
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			index_buffer,
-			index_buffer_memory,
+			mesh.index_buffer,
+			index_buffer_allocation,
 			platform
 		);	
+		mesh.lod_count = lod_count;
+		memcpy(mesh.lods, lods, sizeof(MeshLod) * lod_count);
+		mesh.index_count = lods[0].index_count;
 		
-		copyBuffer(staging_buffer, index_buffer, buffer_size);
-		
-		vkDestroyBuffer(device, staging_buffer, 0);
-		vkFreeMemory(device, staging_buffer_memory, 0);
+		uploads.uploadBuffer(platform, mesh.index_buffer, 0, indices, buffer_size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 	}
 	
 	void createUniformBuffer(Platform *platform) {
-		VkDeviceSize buffer_size = sizeof(UniformBufferObject);
-		uniform_buffers = (VkBuffer *)platform->alloc(sizeof(VkBuffer) * swap_image_count);
-		uniform_buffers_memory = (VkDeviceMemory *)platform->alloc(sizeof(VkDeviceMemory) * swap_image_count);
+		VkPhysicalDeviceProperties device_props;
+		vkGetPhysicalDeviceProperties(physical_device, &device_props);
 		
-		for(u32 i = 0; i < swap_image_count; i++) {
-			createBuffer(
-	             buffer_size, 
-	             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-	             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-	             uniform_buffers[i], 
-	             uniform_buffers_memory[i], 
-	             platform
-             );
+		uniform_ring.init(platform, device, &gpu_memory, MAX_FRAMES_IN_FLIGHT, UNIFORM_RING_FRAME_SIZE, device_props.limits.minUniformBufferOffsetAlignment, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+		// NOTE: bound once as a plain storage buffer, draws select their range through firstInstance rather than a dynamic offset
+		instance_ring.init(platform, device, &gpu_memory, MAX_FRAMES_IN_FLIGHT, INSTANCE_RING_FRAME_SIZE, sizeof(InstanceData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	}
+	
+	// NOTE: compute shaders are laid out from their own reflection, push_constant_size is the renderer's side of the block
+	VkShaderModule createComputeShader(Platform *platform, const char *path, u32 push_constant_size, VkDescriptorSetLayout *set_layout, VkPipelineLayout *pipeline_layout) {
+		ShaderReflection reflection;
+		VkShaderModule result = createShaderModule(platform, device, path, &reflection);
+		if(reflection.push_constants.size != push_constant_size) {
+			platform->error(formatString("Shader %s has %u bytes of push constants, the renderer pushes %u", path, reflection.push_constants.size, push_constant_size));
 		}
+		
+		ShaderInterface shader_interface = {};
+		shader_interface.add(platform, &reflection, path);
+		*set_layout = layout_cache.setLayout(platform, &shader_interface, 0);
+		*pipeline_layout = layout_cache.pipelineLayout(platform, &shader_interface, 0);
+		return result;
 	}
 	
-	void createDescriptorPool(Platform *platform) {
-		VkDescriptorPoolSize pool_sizes[2] = {};
-		pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		pool_sizes[0].descriptorCount = swap_image_count;
+	void createCuller(Platform *platform) {
+		// NOTE: one bounding sphere around the whole mesh, centred on its bounds
+		Vec3 min_bound = vertices[0].pos;
+		Vec3 max_bound = vertices[0].pos;
+		for(u32 i = 1; i < vertex_count; i++) {
+			Vec3 pos = vertices[i].pos;
+			min_bound = Vec3::rmin(min_bound, pos);
+			max_bound = Vec3::rmax(max_bound, pos);
+		}
 		
-		pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		pool_sizes[1].descriptorCount = swap_image_count;
+		Vec3 center = (min_bound + max_bound) * 0.5f;
+		f32 radius_squared = 0.0f;
+		for(u32 i = 0; i < vertex_count; i++) {
+			Vec3 d = vertices[i].pos - center;
+			f32 distance_squared = d.x * d.x + d.y * d.y + d.z * d.z;
+			if(distance_squared > radius_squared) radius_squared = distance_squared;
+		}
+		mesh.bounding_sphere = Vec4(center, Math::squareRoot(radius_squared));
+		
+		VkDescriptorSetLayout cull_set_layout;
+		VkPipelineLayout cull_pipeline_layout;
+		VkShaderModule cull_shader = createComputeShader(platform, "data/shaders/cull.comp.spv", sizeof(CullBatchConstants), &cull_set_layout, &cull_pipeline_layout);
+		culler.init(platform, device, &gpu_memory, pipeline_cache.cache, cull_shader, cull_set_layout, cull_pipeline_layout, MAX_FRAMES_IN_FLIGHT, INSTANCE_RING_FRAME_SIZE / sizeof(InstanceData), sizeof(InstanceData), instance_ring.buffer);
+		vkDestroyShaderModule(device, cull_shader, 0);
+		
+		// NOTE: indices are already in vertex cache order so the meshlets come out spatially tight. The scene only draws
+		// the mesh once a frame through here, so the output has room for one full copy of it per frame.
+		meshlet_mesh.build(platform, indices, lods[0].index_count, vertices, vertex_count, sizeof(Vertex), offsetof(Vertex, pos));
+		VkDescriptorSetLayout meshlet_cull_set_layout;
+		VkPipelineLayout meshlet_cull_pipeline_layout;
+		VkShaderModule meshlet_cull_shader = createComputeShader(platform, "data/shaders/meshlet_cull.comp.spv", sizeof(MeshletCullConstants), &meshlet_cull_set_layout, &meshlet_cull_pipeline_layout);
+		meshlet_culler.init(platform, device, &gpu_memory, pipeline_cache.cache, meshlet_cull_shader, meshlet_cull_set_layout, meshlet_cull_pipeline_layout, MAX_FRAMES_IN_FLIGHT, 1, &meshlet_mesh);
+		vkDestroyShaderModule(device, meshlet_cull_shader, 0);
+	}
+	
+	void createDescriptorPool(Platform *platform) {
+		// NOTE: room for the plain and the culled descriptor set
+		VkDescriptorPoolSize pool_sizes[SHADER_MAX_BINDINGS];
+		u32 pool_size_count = graphics_interface.poolSizes(0, 2, pool_sizes);
 		
 		VkDescriptorPoolCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		create_info.poolSizeCount = ArrayCount(pool_sizes);
+		create_info.poolSizeCount = pool_size_count;
 		create_info.pPoolSizes = &pool_sizes[0];
-		create_info.maxSets = swap_image_count;
+		create_info.maxSets = 2;
 		
 		if(vkCreateDescriptorPool(device, &create_info, 0, &descriptor_pool) != VK_SUCCESS) {
 			platform->error("Couldn't create descriptor pool");
@@ -707,280 +1107,287 @@ struct VulkanRenderer {
 	}
 	
 	void createDescriptorSets(Platform *platform) {
-		VkDescriptorSetLayout *layouts = (VkDescriptorSetLayout *)platform->alloc(sizeof(VkDescriptorSetLayout) * swap_image_count);
-		for(u32 i = 0; i < swap_image_count; i++) {
-			layouts[i] = descriptor_set_layout;
-		}
-		
 		VkDescriptorSetAllocateInfo alloc_info = {};
 		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		alloc_info.descriptorPool = descriptor_pool;
-		alloc_info.descriptorSetCount = swap_image_count;
-		alloc_info.pSetLayouts = layouts;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &descriptor_set_layout;
 		
-		descriptor_sets = (VkDescriptorSet *)platform->alloc(sizeof(VkDescriptorSet) * swap_image_count);
-		if(vkAllocateDescriptorSets(device, &alloc_info, descriptor_sets) != VK_SUCCESS) {
+		if(vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS || vkAllocateDescriptorSets(device, &alloc_info, &culled_descriptor_set) != VK_SUCCESS) {
 			platform->error("Couldn't allocate descriptor sets");
 		}
 		
-		for(u32 i = 0; i < swap_image_count; i++) {
-			VkDescriptorBufferInfo buffer_info = {};
-			buffer_info.buffer = uniform_buffers[i];
-			buffer_info.offset = 0;
-			buffer_info.range = sizeof(UniformBufferObject);
-			
-			VkDescriptorImageInfo image_info = {};
-			image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			image_info.imageView = texture_image_view;
-			image_info.sampler = texture_sampler;
-			
-			VkWriteDescriptorSet descriptor_writes[2] = {};
-			
-			descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptor_writes[0].dstSet = descriptor_sets[i];
-			descriptor_writes[0].dstBinding = 0;
-			descriptor_writes[0].dstArrayElement = 0;
-			descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptor_writes[0].descriptorCount = 1;
-			descriptor_writes[0].pBufferInfo = &buffer_info;
-			descriptor_writes[0].pImageInfo = 0;
-			descriptor_writes[0].pTexelBufferView = 0;
-			
-			descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptor_writes[1].dstSet = descriptor_sets[i];
-			descriptor_writes[1].dstBinding = 1;
-			descriptor_writes[1].dstArrayElement = 0;
-			descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptor_writes[1].descriptorCount = 1;
-			descriptor_writes[1].pImageInfo = &image_info;
-			descriptor_writes[1].pTexelBufferView = 0;
-			
-			
-			vkUpdateDescriptorSets(device, ArrayCount(descriptor_writes), &descriptor_writes[0], 0, 0);
+		// NOTE: identical apart from binding 2, culled draws read the compacted survivors instead of the raw instance ring
+		writeDescriptorSet(descriptor_set, instance_ring.buffer);
+		writeDescriptorSet(culled_descriptor_set, culler.output_buffer);
+	}
+	
+	void writeDescriptorSet(VkDescriptorSet set, VkBuffer instance_buffer) {
+		VkDescriptorBufferInfo buffer_info = {};
+		buffer_info.buffer = uniform_ring.buffer;
+		buffer_info.offset = 0;
+		buffer_info.range = sizeof(UniformBufferObject);
+		
+		VkDescriptorImageInfo image_info = {};
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_info.imageView = texture_image_view;
+		image_info.sampler = texture_sampler;
+		
+		VkDescriptorBufferInfo instance_buffer_info = {};
+		instance_buffer_info.buffer = instance_buffer;
+		instance_buffer_info.offset = 0;
+		instance_buffer_info.range = VK_WHOLE_SIZE;
+		
+		VkWriteDescriptorSet descriptor_writes[3] = {};
+		
+		descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptor_writes[0].dstSet = set;
+		descriptor_writes[0].dstBinding = 0;
+		descriptor_writes[0].dstArrayElement = 0;
+		descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptor_writes[0].descriptorCount = 1;
+		descriptor_writes[0].pBufferInfo = &buffer_info;
+		descriptor_writes[0].pImageInfo = 0;
+		descriptor_writes[0].pTexelBufferView = 0;
+		
+		descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptor_writes[1].dstSet = set;
+		descriptor_writes[1].dstBinding = 1;
+		descriptor_writes[1].dstArrayElement = 0;
+		descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptor_writes[1].descriptorCount = 1;
+		descriptor_writes[1].pImageInfo = &image_info;
+		descriptor_writes[1].pTexelBufferView = 0;
+		
+		descriptor_writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptor_writes[2].dstSet = set;
+		descriptor_writes[2].dstBinding = 2;
+		descriptor_writes[2].dstArrayElement = 0;
+		descriptor_writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptor_writes[2].descriptorCount = 1;
+		descriptor_writes[2].pBufferInfo = &instance_buffer_info;
+		
+		// NOTE: the layout only has what the shaders declare, the bindless ones never sample binding 1
+		u32 write_count = 0;
+		for(u32 i = 0; i < ArrayCount(descriptor_writes); i++) {
+			if(graphics_interface.find(0, descriptor_writes[i].dstBinding)) descriptor_writes[write_count++] = descriptor_writes[i];
 		}
+		vkUpdateDescriptorSets(device, write_count, &descriptor_writes[0], 0, 0);
 	}
 	
+	const char *vertexShaderPath(bool instanced) {
+		return instanced ? "data/shaders/instanced.vert.spv" : "data/shaders/vert.spv";
+	}
+	
+	const char *fragmentShaderPath(bool instanced) {
+		if(!use_bindless) return "data/shaders/frag.spv";
+		return instanced ? "data/shaders/instanced_bindless.frag.spv" : "data/shaders/bindless.frag.spv";
+	}
+	
+	// NOTE: the draws bind their descriptor sets to either graphics pipeline, so set 0 is laid out from every graphics shader at once
 	void createDescriptorSetLayout(Platform *platform) {
-		VkDescriptorSetLayoutBinding ubo_layout_binding = {};
-		ubo_layout_binding.binding = 0;
-		ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		ubo_layout_binding.descriptorCount = 1;
-		ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-		ubo_layout_binding.pImmutableSamplers = 0;
-		
-		VkDescriptorSetLayoutBinding sampler_layout_binding = {};
-		sampler_layout_binding.binding = 1;
-		sampler_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		sampler_layout_binding.descriptorCount = 1;
-		sampler_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-		sampler_layout_binding.pImmutableSamplers = 0;
-		
-		VkDescriptorSetLayoutBinding layouts[] = {
-			ubo_layout_binding,
-			sampler_layout_binding	
+		const char *shader_paths[] = {
+			vertexShaderPath(false),
+			fragmentShaderPath(false),
+			vertexShaderPath(true),
+			fragmentShaderPath(true),
 		};
 		
-		VkDescriptorSetLayoutCreateInfo layout_info = {};
-		layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layout_info.bindingCount = ArrayCount(layouts);
-		layout_info.pBindings = &layouts[0];
-		
-		if(vkCreateDescriptorSetLayout(device, &layout_info, 0, &descriptor_set_layout) != VK_SUCCESS) {
-			platform->error("Couldn't create descriptor set layout");
+		graphics_interface = {};
+		for(u32 i = 0; i < ArrayCount(shader_paths); i++) {
+			ShaderReflection reflection;
+			reflectShaderFile(platform, shader_paths[i], &reflection);
+			graphics_interface.add(platform, &reflection, shader_paths[i]);
+		}
+		// NOTE: every draw gets its own offset into the uniform ring
+		graphics_interface.makeDynamic(platform, 0, 0);
+		descriptor_set_layout = layout_cache.setLayout(platform, &graphics_interface, 0);
+	}
+	
+	void createPipelineLayout(Platform *platform) {
+		// NOTE: the bindless texture table brings its own layout for set 1, its capacity and binding flags aren't in the shaders
+		VkDescriptorSetLayout external_sets[SHADER_MAX_SETS] = {};
+		if(use_bindless) {
+			ShaderBinding *table = graphics_interface.find(1, 0);
+			if(table == 0 || table->type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || table->count != 0) {
+				platform->error("The bindless shaders don't declare the texture table as set 1 binding 0");
+			}
+			external_sets[1] = bindless_textures.layout;
 		}
+		pipeline_layout = layout_cache.pipelineLayout(platform, &graphics_interface, external_sets);
+	}
+	
+	void loadPipelineProgram(Platform *platform, PipelineProgram program) {
+		bool instanced = program == PipelineProgram::Instanced;
+		const char *vert_path = vertexShaderPath(instanced);
+		ShaderReflection vert_reflection;
+		VkShaderModule vert_shader_module = createShaderModule(platform, device, vert_path, &vert_reflection);
+		VkShaderModule frag_shader_module = createShaderModule(platform, device, fragmentShaderPath(instanced));
+		
+		VkVertexInputAttributeDescription layout_attributes[4];
+		u32 layout_attribute_count = vertex_layout.attributeDescriptions(layout_attributes);
+		VkVertexInputAttributeDescription attributes[SHADER_MAX_INPUTS];
+		u32 attribute_count = vert_reflection.vertexAttributes(platform, layout_attributes, layout_attribute_count, attributes, vert_path);
+		pipelines.setProgram(program, vert_shader_module, frag_shader_module, attributes, attribute_count);
 	}
 	
+	void setPipelineTarget() {
+		VkVertexInputBindingDescription bindings[2];
+		u32 binding_count = vertex_layout.bindingDescriptions(bindings);
+		pipelines.setTarget(pipeline_cache.cache, render_pass, pipeline_layout, bindings, binding_count);
+	}
+	
+	PipelineDesc pipelineDesc(PipelineProgram program, DebugView view) {
+		PipelineDesc result = {};
+		result.program = (u32)program;
+		result.spec_constants[SPEC_QUANTIZED_POSITIONS] = vertex_layout.position_format != VertexPositionFormat::Float32;
+		result.spec_constants[SPEC_VERTEX_COLORS] = vertex_layout.color_stream;
+		result.spec_constants[SPEC_DEBUG_VIEW] = (u32)view;
+		result.cull_mode = VK_CULL_MODE_BACK_BIT;
+		return result;
+	}
+	
+	void selectPipelines() {
+		PipelineDesc plain = pipelineDesc(PipelineProgram::Plain, debug_view);
+		PipelineDesc instanced = pipelineDesc(PipelineProgram::Instanced, debug_view);
+		graphics_pipeline = pipelines.get(&plain);
+		instanced_pipeline = pipelines.get(&instanced);
+	}
+	
+	// NOTE: both programs share one layout, the instanced one reads its transforms from the instance buffer at binding 2.
+	// The layout comes out of the cache, so recreating the pipelines keeps it. The permutations selected now are built
+	// here and become the bases, the rest of the debug views are derived from them in the background.
 	void createGraphicsPipeline(Platform *platform) {
-		VkShaderModule vert_shader_module = createShaderModule(platform, device, "data/shaders/vert.spv");
-		VkShaderModule frag_shader_module = createShaderModule(platform, device, "data/shaders/frag.spv");
-		
-		VkPipelineShaderStageCreateInfo vk_vert_shader_stage_create_info = {};
-		vk_vert_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vk_vert_shader_stage_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vk_vert_shader_stage_create_info.module = vert_shader_module;
-		vk_vert_shader_stage_create_info.pName = "main";
-		
-		VkPipelineShaderStageCreateInfo vk_frag_shader_stage_create_info = {};
-		vk_frag_shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vk_frag_shader_stage_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		vk_frag_shader_stage_create_info.module = frag_shader_module;
-		vk_frag_shader_stage_create_info.pName = "main";
-		
-		VkPipelineShaderStageCreateInfo shader_stage_infos[] = {
-			vk_vert_shader_stage_create_info,
-			vk_frag_shader_stage_create_info
-		};
+		createPipelineLayout(platform);
+		setPipelineTarget();
+		loadPipelineProgram(platform, PipelineProgram::Plain);
+		loadPipelineProgram(platform, PipelineProgram::Instanced);
+		selectPipelines();
+		
+		PipelineDesc descs[(u32)PipelineProgram::Count * (u32)DebugView::Count];
+		u32 desc_count = 0;
+		for(u32 program = 0; program < (u32)PipelineProgram::Count; program++) {
+			for(u32 view = 0; view < (u32)DebugView::Count; view++) {
+				descs[desc_count++] = pipelineDesc((PipelineProgram)program, (DebugView)view);
+			}
+		}
+		pipelines.prewarm(descs, desc_count);
+	}
+	
+	void destroyGraphicsPipeline() {
+		pipelines.destroy();
+	}
+	
+	f32 timeGraphicsPipelineCreation(Platform *platform) {
+		u64 start = platform->getPerformanceCounter();
+		createGraphicsPipeline(platform);
+		return (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f;
+	}
+	
+	// NOTE: mirrors the glslangValidator lines in build.sh and build.bat
+	void watchShaders(Platform *platform) {
+		shader_reloader.init(platform);
+		shader_reloader.watch(platform, "src/shaders/main.vert", "data/shaders/vert.spv");
+		shader_reloader.watch(platform, "src/shaders/main.frag", "data/shaders/frag.spv");
+		shader_reloader.watch(platform, "src/shaders/main_bindless.frag", "data/shaders/bindless.frag.spv");
+		shader_reloader.watch(platform, "src/shaders/main_instanced.vert", "data/shaders/instanced.vert.spv");
+		shader_reloader.watch(platform, "src/shaders/main_instanced_bindless.frag", "data/shaders/instanced_bindless.frag.spv");
+		shader_reloader.watch(platform, "src/shaders/cull.comp", "data/shaders/cull.comp.spv");
+		shader_reloader.watch(platform, "src/shaders/meshlet_cull.comp", "data/shaders/meshlet_cull.comp.spv");
+	}
+	
+	// NOTE: New pipelines are swapped in between frames, and the old ones wait in this frame's deletion queue until
+	// no frame in flight can still use them. Layouts and descriptor sets stay as they are, so a shader whose
+	// bindings or push constants changed needs a restart.
+	void reloadChangedShaders(Platform *platform) {
+		if(!shader_reloader.poll(platform)) return;
 		
+		if(shader_reloader.changed(vertexShaderPath(false)) || shader_reloader.changed(fragmentShaderPath(false)) ||
+		   shader_reloader.changed(vertexShaderPath(true)) || shader_reloader.changed(fragmentShaderPath(true))) {
+			reloadGraphicsPipelines(platform);
+		}
 		
-		VkVertexInputBindingDescription vk_binding_description = {};
-		vk_binding_description.binding = 0;
-		vk_binding_description.stride = sizeof(Vertex);
-		vk_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		const char *cull_path = "data/shaders/cull.comp.spv";
+		if(shader_reloader.changed(cull_path)) {
+			VkShaderModule shader = reloadComputeShader(platform, cull_path, sizeof(CullBatchConstants), culler.pipeline_layout);
+			if(shader) {
+				frameDeletionQueue()->pipeline(culler.pipeline);
+				culler.createPipeline(platform, pipeline_cache.cache, shader);
+				vkDestroyShaderModule(device, shader, 0);
+			}
+		}
 		
-		VkVertexInputAttributeDescription vk_attribute_descriptions[3] = {};
-		vk_attribute_descriptions[0].binding = 0;
-		vk_attribute_descriptions[0].location = 0;
-		vk_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vk_attribute_descriptions[0].offset = offsetof(Vertex, pos);
+		const char *meshlet_cull_path = "data/shaders/meshlet_cull.comp.spv";
+		if(shader_reloader.changed(meshlet_cull_path)) {
+			VkShaderModule shader = reloadComputeShader(platform, meshlet_cull_path, sizeof(MeshletCullConstants), meshlet_culler.pipeline_layout);
+			if(shader) {
+				frameDeletionQueue()->pipeline(meshlet_culler.pipeline);
+				meshlet_culler.createPipeline(platform, pipeline_cache.cache, shader);
+				vkDestroyShaderModule(device, shader, 0);
+			}
+		}
+	}
+	
+	void reloadGraphicsPipelines(Platform *platform) {
+		ShaderInterface previous_interface = graphics_interface;
+		VkDescriptorSetLayout previous_set_layout = descriptor_set_layout;
+		VkPipelineLayout previous_layout = pipeline_layout;
+		// NOTE: the layout cache hands back the same layouts for an unchanged interface
+		createDescriptorSetLayout(platform);
+		createPipelineLayout(platform);
+		if(descriptor_set_layout != previous_set_layout || pipeline_layout != previous_layout) {
+			printf("Graphics shader bindings changed, restart to use them\n");
+			graphics_interface = previous_interface;
+			descriptor_set_layout = previous_set_layout;
+			pipeline_layout = previous_layout;
+			return;
+		}
 		
-		vk_attribute_descriptions[1].binding = 0;
-		vk_attribute_descriptions[1].location = 1;
-		vk_attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vk_attribute_descriptions[1].offset = offsetof(Vertex, color);
+		u64 start = platform->getPerformanceCounter();
+		pipelines.release(frameDeletionQueue());
+		createGraphicsPipeline(platform);
+		printf("Graphics pipelines reloaded in %.3fms\n", (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f);
+	}
+	
+	// NOTE: 0 when the shader's layout isn't the one its pipeline was built with
+	VkShaderModule reloadComputeShader(Platform *platform, const char *path, u32 push_constant_size, VkPipelineLayout current_layout) {
+		VkDescriptorSetLayout set_layout;
+		VkPipelineLayout layout;
+		VkShaderModule result = createComputeShader(platform, path, push_constant_size, &set_layout, &layout);
+		if(layout != current_layout) {
+			printf("Shader %s bindings changed, restart to use them\n", path);
+			vkDestroyShaderModule(device, result, 0);
+			return 0;
+		}
+		return result;
+	}
+	
+	void createPipelineCache(Platform *platform) {
+		pipeline_cache.init(platform, physical_device, device, formatString("%spipeline_cache.bin", platform->getExePath()));
+		printf("Pipeline cache %s\n", pipeline_cache.loaded_from_disk ? "loaded from disk" : "starting cold");
+	}
+	
+	// NOTE: compares creating the pipelines against an empty cache with creating them against the one loaded from disk
+	void benchmarkPipelineCache(Platform *platform) {
+		PipelineCache warm_cache = pipeline_cache;
 		
-		vk_attribute_descriptions[2].binding = 0;
-		vk_attribute_descriptions[2].location = 2;
-		vk_attribute_descriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		vk_attribute_descriptions[2].offset = offsetof(Vertex, uv);
+		VkPipelineCacheCreateInfo create_info = {};
+		create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		if(vkCreatePipelineCache(device, &create_info, 0, &pipeline_cache.cache) != VK_SUCCESS) {
+			platform->error("Couldn't create pipeline cache");
+		}
 		
-
+		destroyGraphicsPipeline();
+		f32 cold_ms = timeGraphicsPipelineCreation(platform);
+		pipelines.waitForPrewarm();
 		
-		VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
-		vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertex_input_info.vertexBindingDescriptionCount = 1;
-		vertex_input_info.pVertexBindingDescriptions  = &vk_binding_description;
-		vertex_input_info.vertexAttributeDescriptionCount = ArrayCount(vk_attribute_descriptions);
-		vertex_input_info.pVertexAttributeDescriptions = &vk_attribute_descriptions[0];
-		
-		VkPipelineInputAssemblyStateCreateInfo  input_assembly_create_info = {};
-		input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
-		
-		VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {};
-		depth_stencil_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depth_stencil_create_info.depthTestEnable = VK_TRUE;
-		depth_stencil_create_info.depthWriteEnable = VK_TRUE;
-		depth_stencil_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
-		depth_stencil_create_info.depthBoundsTestEnable = VK_FALSE;
-		depth_stencil_create_info.minDepthBounds = 0.0f;
-		depth_stencil_create_info.maxDepthBounds = 1.0f;
-		depth_stencil_create_info.stencilTestEnable = VK_FALSE;
-		depth_stencil_create_info.front = {};
-		depth_stencil_create_info.back = {};
-		
-		VkViewport vk_viewport = {};
-		vk_viewport.x = 0;
-		vk_viewport.y = 0;
-		vk_viewport.width = extent.width;
-		vk_viewport.height = extent.height;
-		vk_viewport.minDepth = 0.0f;
-		vk_viewport.maxDepth = 1.0f;
-		
-		VkRect2D vk_scissor = {};
-		vk_scissor.offset = {0, 0};
-		vk_scissor.extent = extent;
-			
-		VkPipelineViewportStateCreateInfo vk_viewport_state_create_info = {};
-		vk_viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		vk_viewport_state_create_info.viewportCount = 1;
-		vk_viewport_state_create_info.pViewports = &vk_viewport;
-		vk_viewport_state_create_info.scissorCount = 1;
-		vk_viewport_state_create_info.pScissors = &vk_scissor;
-		
-		VkPipelineRasterizationStateCreateInfo vk_rasterizer_create_info = {};
-		vk_rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		vk_rasterizer_create_info.depthClampEnable = VK_FALSE;
-		vk_rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
-		vk_rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
-		vk_rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
-		vk_rasterizer_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		
-		vk_rasterizer_create_info.depthBiasEnable = VK_FALSE;
-		vk_rasterizer_create_info.depthBiasConstantFactor = 0.0f;
-		vk_rasterizer_create_info.depthBiasClamp = 0.0f;
-		vk_rasterizer_create_info.depthBiasSlopeFactor = 0.0f;
-		vk_rasterizer_create_info.lineWidth = 1.0f;
-		
-		VkPipelineMultisampleStateCreateInfo vk_msaa_state_create_info = {};
-		vk_msaa_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		vk_msaa_state_create_info.sampleShadingEnable = VK_FALSE;
-		vk_msaa_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		vk_msaa_state_create_info.minSampleShading = 1.0f;
-		vk_msaa_state_create_info.pSampleMask = 0;
-		vk_msaa_state_create_info.alphaToCoverageEnable = VK_FALSE;
-		vk_msaa_state_create_info.alphaToOneEnable = VK_FALSE;
-		
-		VkPipelineColorBlendAttachmentState vk_color_blend_attachment = {};
-		vk_color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		vk_color_blend_attachment.blendEnable = VK_FALSE;
-		vk_color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-		vk_color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-		vk_color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
-		vk_color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		vk_color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		vk_color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
-		
-		VkPipelineColorBlendStateCreateInfo vk_color_blend_state_create_info = {};
-		vk_color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		vk_color_blend_state_create_info.logicOpEnable = VK_FALSE;
-		vk_color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
-		vk_color_blend_state_create_info.attachmentCount = 1;
-		vk_color_blend_state_create_info.pAttachments = &vk_color_blend_attachment;
-		vk_color_blend_state_create_info.blendConstants[0] = 0.0f;
-		vk_color_blend_state_create_info.blendConstants[1] = 0.0f;
-		vk_color_blend_state_create_info.blendConstants[2] = 0.0f;
-		vk_color_blend_state_create_info.blendConstants[3] = 0.0f;
-		
-		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
-		pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_create_info.setLayoutCount = 1;
-		pipeline_layout_create_info.pSetLayouts = &descriptor_set_layout;
-		pipeline_layout_create_info.pushConstantRangeCount = 0;
-		pipeline_layout_create_info.pPushConstantRanges = 0;
-		
-		if(vkCreatePipelineLayout(device, &pipeline_layout_create_info, 0, &pipeline_layout) != VK_SUCCESS) {
-			platform->error("Couldn't create pipeline layout");
-		}
-		
-		VkGraphicsPipelineCreateInfo vk_graphics_pipeline_create_info = {};
-		vk_graphics_pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		vk_graphics_pipeline_create_info.stageCount = 2;
-		vk_graphics_pipeline_create_info.pStages = shader_stage_infos;
-		vk_graphics_pipeline_create_info.pVertexInputState = &vertex_input_info;
-		vk_graphics_pipeline_create_info.pInputAssemblyState = &input_assembly_create_info;
-		vk_graphics_pipeline_create_info.pViewportState = &vk_viewport_state_create_info;
-		vk_graphics_pipeline_create_info.pRasterizationState = &vk_rasterizer_create_info;
-		vk_graphics_pipeline_create_info.pMultisampleState = &vk_msaa_state_create_info;
-		vk_graphics_pipeline_create_info.pDepthStencilState = 0;
-		vk_graphics_pipeline_create_info.pColorBlendState = &vk_color_blend_state_create_info;
-		vk_graphics_pipeline_create_info.pDynamicState = 0;
-		vk_graphics_pipeline_create_info.layout = pipeline_layout;
-		vk_graphics_pipeline_create_info.renderPass = render_pass;
-		vk_graphics_pipeline_create_info.subpass = 0;
-		vk_graphics_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
-		vk_graphics_pipeline_create_info.basePipelineIndex = -1;
-		vk_graphics_pipeline_create_info.pDepthStencilState = &depth_stencil_create_info;
-		
-		
-		if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &vk_graphics_pipeline_create_info, 0, &graphics_pipeline) != VK_SUCCESS) {
-			platform->error("Couldn't create graphics pipeline");
-		}
-		
-		vkDestroyShaderModule(device, vert_shader_module, 0);
-		vkDestroyShaderModule(device, frag_shader_module, 0);
-	}
-	
-	void createFramebuffers(Platform *platform) {
-		swap_chain_frame_buffers = (VkFramebuffer *)platform->alloc(sizeof(VkFramebuffer) * swap_image_count);
-		for(u32 i = 0; i < swap_image_count; i++) {
-			VkImageView attachments[] = {
-				swap_image_views[i],
-				depth_image_view
-			};
-			
-			VkFramebufferCreateInfo vk_frame_buffer_create_info = {};
-			vk_frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			vk_frame_buffer_create_info.renderPass = render_pass;
-			vk_frame_buffer_create_info.attachmentCount = ArrayCount(attachments);
-			vk_frame_buffer_create_info.pAttachments = attachments;
-			vk_frame_buffer_create_info.width = extent.width;
-			vk_frame_buffer_create_info.height = extent.height;
-			vk_frame_buffer_create_info.layers = 1;
-			if(vkCreateFramebuffer(device, &vk_frame_buffer_create_info, 0, &swap_chain_frame_buffers[i]) != VK_SUCCESS) {
-				platform->error("Couldn't create frame buffer");
-			}
-		}
+		vkDestroyPipelineCache(device, pipeline_cache.cache, 0);
+		pipeline_cache = warm_cache;
+		
+		destroyGraphicsPipeline();
+		f32 warm_ms = timeGraphicsPipelineCreation(platform);
+		
+		printf("Pipeline creation: cold %.3fms, warm %.3fms%s\n", cold_ms, warm_ms, pipeline_cache.loaded_from_disk ? "" : " (cache was not on disk, warm run reuses this session's cache)");
 	}
 	
 	void createCommandPool(Platform *platform) {
@@ -994,6 +1401,20 @@ struct VulkanRenderer {
 		if(vkCreateCommandPool(device, &vk_pool_create_info, 0, &command_pool) != VK_SUCCESS) {
 			platform->error("Couldn't create command pool");
 		}
+		
+		// NOTE: per frame pools are reset wholesale once the frame's fence has signalled
+		vk_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			if(vkCreateCommandPool(device, &vk_pool_create_info, 0, &frame_command_pools[f]) != VK_SUCCESS) {
+				platform->error("Couldn't create command pool");
+			}
+			
+			for(u32 t = 0; t < record_thread_count; t++) {
+				if(vkCreateCommandPool(device, &vk_pool_create_info, 0, &record_command_pools[f][t]) != VK_SUCCESS) {
+					platform->error("Couldn't create command pool");
+				}
+			}
+		}
 	}
 	
 	VkCommandBuffer beginSingleTimeCommands() {
@@ -1029,62 +1450,221 @@ struct VulkanRenderer {
 		vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
 	}
 	
-	void createAndRecordCommandBuffers(Platform *platform) {
-			
-		command_buffers = (VkCommandBuffer *)platform->alloc(sizeof(VkCommandBuffer) * swap_image_count);
+	// NOTE: while a setup batch is open, one off graphics work is recorded into it instead of being submitted and waited on one at a time
+	void beginSetupCommands() {
+		setup_command_buffer = beginSingleTimeCommands();
+	}
+	
+	void endSetupCommands(Platform *platform) {
+		vkEndCommandBuffer(setup_command_buffer);
 		
-		VkCommandBufferAllocateInfo vk_cmd_buffer_alloc_info = {};
-		vk_cmd_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		vk_cmd_buffer_alloc_info.commandPool = command_pool;
-		vk_cmd_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		vk_cmd_buffer_alloc_info.commandBufferCount = swap_image_count;
+		VkFenceCreateInfo fence_create_info = {};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence setup_fence;
+		if(vkCreateFence(device, &fence_create_info, 0, &setup_fence) != VK_SUCCESS) {
+			platform->error("Couldn't create setup fence");
+		}
+		
+		u64 upload_id = uploads.flush();
+		uploads.submitPendingAcquires();
+		
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &setup_command_buffer;
 		
-		if(vkAllocateCommandBuffers(device, &vk_cmd_buffer_alloc_info, command_buffers) != VK_SUCCESS) {
-			platform->error("Couldn't allocate command buffers");
+		if(vkQueueSubmit(graphics_queue, 1, &submit_info, setup_fence) != VK_SUCCESS) {
+			platform->error("Couldn't submit setup commands");
 		}
 		
-		for(u32 i = 0; i < swap_image_count; i++) {
-			VkCommandBufferBeginInfo begin_info = {};
-			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-			begin_info.pInheritanceInfo = 0;
+		vkWaitForFences(device, 1, &setup_fence, VK_TRUE, UINT64_MAX);
+		uploads.wait(upload_id);
+		
+		vkDestroyFence(device, setup_fence, 0);
+		vkFreeCommandBuffers(device, command_pool, 1, &setup_command_buffer);
+		setup_command_buffer = VK_NULL_HANDLE;
+	}
+	
+	void markStartupStage(Platform *platform, const char *name) {
+		u64 now = platform->getPerformanceCounter();
+		f32 frequency = (f32)platform->getPerformanceFrequency();
+		printf("Startup: %-20s %8.3fms (%.3fms total)\n", name, (f32)(now - startup_stage_start) / frequency * 1000.0f, (f32)(now - startup_start) / frequency * 1000.0f);
+		startup_stage_start = now;
+	}
+	
+	void createCommandBuffers(Platform *platform) {
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			VkCommandBufferAllocateInfo vk_cmd_buffer_alloc_info = {};
+			vk_cmd_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			vk_cmd_buffer_alloc_info.commandPool = frame_command_pools[f];
+			vk_cmd_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			vk_cmd_buffer_alloc_info.commandBufferCount = 1;
 			
-			if(vkBeginCommandBuffer(command_buffers[i], &begin_info) != VK_SUCCESS) {
-				platform->error("Couldn't begin recording command buffer");
+			if(vkAllocateCommandBuffers(device, &vk_cmd_buffer_alloc_info, &command_buffers[f]) != VK_SUCCESS) {
+				platform->error("Couldn't allocate command buffers");
 			}
 			
-			VkClearValue clear_values[] = {
-				{0.0f, 0.0f, 0.0f, 1.0f},
-				{1.0f, 0.0f}
-			};
-			
-			VkRenderPassBeginInfo render_pass_begin_info = {};
-			render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			render_pass_begin_info.renderPass = render_pass;
-			render_pass_begin_info.framebuffer = swap_chain_frame_buffers[i];
-			render_pass_begin_info.renderArea.offset = {0, 0};
-			render_pass_begin_info.renderArea.extent = extent;
-			render_pass_begin_info.clearValueCount = ArrayCount(clear_values);
-			render_pass_begin_info.pClearValues = &clear_values[0];
-			
-			vkCmdBeginRenderPass(command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-			
-			vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+			for(u32 t = 0; t < record_thread_count; t++) {
+				vk_cmd_buffer_alloc_info.commandPool = record_command_pools[f][t];
+				vk_cmd_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				
+				if(vkAllocateCommandBuffers(device, &vk_cmd_buffer_alloc_info, &secondary_command_buffers[f][t]) != VK_SUCCESS) {
+					platform->error("Couldn't allocate secondary command buffers");
+				}
+			}
+		}
+	}
+	
+	void createRecordWorkers(Platform *platform) {
+		record_thread_count = platform->getProcessorCount();
+		if(record_thread_count > MAX_RECORD_THREADS) record_thread_count = MAX_RECORD_THREADS;
+		if(record_thread_count < 1) record_thread_count = 1;
+		
+		record_workers.init(platform, record_thread_count - 1);
+		printf("Recording with %u threads\n", record_thread_count);
+	}
+	
+	static void recordDrawsJob(void *data, u32 job_index) {
+		RecordJob *job = ((RecordJob *)data) + job_index;
+		job->renderer->recordDraws(job);
+	}
+	
+	void recordDraws(RecordJob *job) {
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance_info.renderPass = render_pass;
+		inheritance_info.subpass = 0;
+		inheritance_info.framebuffer = frame_graph.framebuffer(main_pass, job->image_index);
+		
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_info.pInheritanceInfo = &inheritance_info;
+		
+		VkCommandBuffer command_buffer = job->command_buffer;
+		vkBeginCommandBuffer(command_buffer, &begin_info);
+		
+		VkViewport viewport = {};
+		viewport.x = 0;
+		viewport.y = 0;
+		viewport.width = (f32)extent.width;
+		viewport.height = (f32)extent.height;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		
+		VkRect2D scissor = {};
+		scissor.offset = {0, 0};
+		scissor.extent = extent;
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+		
+		if(use_bindless) {
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &bindless_textures.set, 0, 0);
+		}
+		
+		VkPipeline bound_pipeline = VK_NULL_HANDLE;
+		VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+		VkBuffer bound_color_buffer = VK_NULL_HANDLE;
+		VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+		u32 bound_texture_index = BINDLESS_INVALID_SLOT;
+		for(u32 i = job->first_draw; i < job->first_draw + job->draw_count; i++) {
+			DrawItem *draw = &draw_items[i];
+			if(draw->pipeline != bound_pipeline) {
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw->pipeline);
+				bound_pipeline = draw->pipeline;
+			}
 			
-			VkBuffer vertex_buffers[] = {vertex_buffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(command_buffers[i], 0, 1, vertex_buffers, offsets);
+			if(draw->vertex_buffer != bound_vertex_buffer || draw->color_buffer != bound_color_buffer) {
+				VkBuffer vertex_buffers[] = {draw->vertex_buffer, draw->color_buffer};
+				VkDeviceSize offsets[] = {0, 0};
+				vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
+				bound_vertex_buffer = draw->vertex_buffer;
+				bound_color_buffer = draw->color_buffer;
+			}
 			
-			vkCmdBindIndexBuffer(command_buffers[i], index_buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_sets[i], 0, 0);
-			vkCmdDrawIndexed(command_buffers[i], index_count, 1, 0, 0, 0);
+			if(draw->index_buffer != bound_index_buffer) {
+				vkCmdBindIndexBuffer(command_buffer, draw->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+				bound_index_buffer = draw->index_buffer;
+			}
 			
-			vkCmdEndRenderPass(command_buffers[i]);
+			if(use_bindless && draw->texture_index != bound_texture_index) {
+				vkCmdPushConstants(command_buffer, pipeline_layout, graphics_interface.push_constants.stageFlags, 0, sizeof(u32), &draw->texture_index);
+				bound_texture_index = draw->texture_index;
+			}
 			
-			if(vkEndCommandBuffer(command_buffers[i]) != VK_SUCCESS) {
-				platform->error("Couldn't record command buffer");
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &draw->descriptor_set, 1, &draw->uniform_offset);
+			if(draw->indirect_buffer != VK_NULL_HANDLE) {
+				vkCmdDrawIndexedIndirect(command_buffer, draw->indirect_buffer, draw->indirect_offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+			} else {
+				vkCmdDrawIndexed(command_buffer, draw->index_count, draw->instance_count, draw->first_index, draw->vertex_offset, draw->first_instance);
 			}
 		}
+		
+		vkEndCommandBuffer(command_buffer);
+	}
+	
+	void recordMainPassDraws(VkCommandBuffer command_buffer, u32 frame, u32 image_index) {
+		VkCommandBuffer overlay = context_overlay_record ? context_overlay_record(frame, image_index, context_data) : VK_NULL_HANDLE;
+		if(draw_count == 0) {
+			if(overlay != VK_NULL_HANDLE) vkCmdExecuteCommands(command_buffer, 1, &overlay);
+			return;
+		}
+		
+		// NOTE: only fan out once there is enough work to cover the cost of waking the workers
+		u32 job_count = (draw_count + DRAWS_PER_RECORD_THREAD - 1) / DRAWS_PER_RECORD_THREAD;
+		if(job_count > record_thread_count) job_count = record_thread_count;
+		
+		u32 draws_per_job = (draw_count + job_count - 1) / job_count;
+		u32 first_draw = 0;
+		for(u32 j = 0; j < job_count; j++) {
+			RecordJob *job = &record_jobs[j];
+			job->renderer = this;
+			job->command_buffer = secondary_command_buffers[frame][j];
+			job->image_index = image_index;
+			job->first_draw = first_draw;
+			job->draw_count = draw_count - first_draw < draws_per_job ? draw_count - first_draw : draws_per_job;
+			first_draw += job->draw_count;
+		}
+		
+		record_workers.run(recordDrawsJob, record_jobs, job_count);
+		vkCmdExecuteCommands(command_buffer, job_count, secondary_command_buffers[frame]);
+		if(overlay != VK_NULL_HANDLE) vkCmdExecuteCommands(command_buffer, 1, &overlay);
+	}
+	
+	void recordCommandBuffer(u32 frame, u32 image_index, Platform *platform) {
+		VkCommandBuffer command_buffer = command_buffers[frame];
+		
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		begin_info.pInheritanceInfo = 0;
+		
+		if(vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+			platform->error("Couldn't begin recording command buffer");
+		}
+		
+		profiler.reset(command_buffer);
+		u32 frame_scope = profiler.beginScope(command_buffer, "frame");
+		
+		if(context_offscreen_record) {
+			u32 context_scope = profiler.beginScope(command_buffer, "render context targets");
+			context_offscreen_record(command_buffer, frame, image_index, context_data);
+			profiler.endScope(command_buffer, context_scope);
+		}
+		
+		frame_graph.execute(command_buffer, frame, image_index, &profiler);
+		
+		if(headless && readback_request[0]) {
+			u32 readback_scope = profiler.beginScope(command_buffer, "readback");
+			recordReadback(command_buffer, frame, image_index);
+			profiler.endScope(command_buffer, readback_scope);
+		}
+		
+		profiler.endScope(command_buffer, frame_scope);
+		
+		if(vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+			platform->error("Couldn't record command buffer");
+		}
 	}
 	
 	void createSyncObjects(Platform *platform) {
@@ -1106,52 +1686,60 @@ struct VulkanRenderer {
 		}
 	}
 	
-	void cleanupSwapChain() {
-		
-		vkDestroyImageView(device, depth_image_view, 0);
-		vkDestroyImage(device, depth_image, 0);
-		vkFreeMemory(device, depth_image_memory, 0);
-		
-		for(u32 i = 0; i < swap_image_count; i++) {
-			vkDestroyFramebuffer(device, swap_chain_frame_buffers[i], 0);	
-		}
-		
-		vkFreeCommandBuffers(device, command_pool, swap_image_count, command_buffers);
-		
-		vkDestroyPipeline(device, graphics_pipeline, 0);
-		vkDestroyPipelineLayout(device, pipeline_layout, 0);
-		vkDestroyRenderPass(device, render_pass, 0);
-		
+	// NOTE: resources destroyed while recording this frame, released once its fence signals again
+	DeletionQueue *frameDeletionQueue() {
+		return &deletion_queues[current_frame];
+	}
+	
+	// NOTE: everything tied to the current swap chain, the handles are left for the caller to replace
+	void releaseSwapChainResources(DeletionQueue *queue) {
+		frame_graph.release(queue);
 		
 		for(u32 i = 0; i < swap_image_count; i++) {
-			vkDestroyImageView(device, swap_image_views[i], 0);	
+			queue->imageView(swap_image_views[i]);
 		}
-		
-		vkDestroySwapchainKHR(device, swap_chain, 0);
+		queue->hostMemory(swap_image_views);
+		if(swap_images) queue->hostMemory(swap_images);
+		if(swap_chain != VK_NULL_HANDLE) queue->swapChain(swap_chain);
 	}
 	
 	void recreateSwapChain(Platform *platform, PlatformWindow *window) {
-		vkDeviceWaitIdle(device);
+		VkSurfaceCapabilitiesKHR capabilities;
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, surface, &capabilities);
+		if(capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0) {
+			// NOTE: minimised, keep the old swap chain and try again next frame
+			swap_chain_out_of_date = true;
+			return;
+		}
 		
-		cleanupSwapChain();
+		// NOTE: the old swap chain is handed to the new one first and only destroyed with the rest once this frame's fence signals
+		VkSwapchainKHR old_swap_chain = swap_chain;
+		releaseSwapChainResources(frameDeletionQueue());
 		
-		createSwapChain(platform, window);
+		VkFormat old_format = surface_format.format;
+		createSwapChain(platform, window, old_swap_chain);
 		createImageViews(platform);
-		createRenderPass(platform);
-		createGraphicsPipeline(platform);
-		createDepthResources(platform);
-		createFramebuffers(platform);
-		createAndRecordCommandBuffers(platform);
+		
+		// NOTE: the new render passes only differ in load/store ops and layouts, so the pipelines stay compatible
+		buildFrameGraph(platform);
+		setPipelineTarget();
+		
+		if(surface_format.format != old_format) {
+			pipelines.release(frameDeletionQueue());
+			createGraphicsPipeline(platform);
+		}
+		
+		swap_chain_out_of_date = false;
 	}
 	
-	void createImage(u32 width, u32 height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &image_memory, Platform *platform) {
+	void createImage(u32 width, u32 height, u32 mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, GpuAllocation &allocation, Platform *platform) {
 		VkImageCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		create_info.imageType = VK_IMAGE_TYPE_2D;
 		create_info.extent.width = width;
 		create_info.extent.height = height;
 		create_info.extent.depth = 1;
-		create_info.mipLevels = 1;
+		create_info.mipLevels = mip_levels;
 		create_info.arrayLayers = 1;
 		create_info.format = format;
 		create_info.tiling = tiling;
@@ -1168,21 +1756,30 @@ struct VulkanRenderer {
 		VkMemoryRequirements memory_requirements;
 		vkGetImageMemoryRequirements(device, image, &memory_requirements);
 		
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = memory_requirements.size;
-		alloc_info.memoryTypeIndex = findMemoryType(memory_requirements.memoryTypeBits, properties, platform);
-		
-		if(vkAllocateMemory(device, &alloc_info, 0, &image_memory) != VK_SUCCESS) {
+		allocation = gpu_memory.allocate(memory_requirements, properties);
+		if(allocation.memory == VK_NULL_HANDLE) {
 			platform->error("Couldn't allocate image memory");
 		}
 		
-		vkBindImageMemory(device, image, image_memory, 0);
+		vkBindImageMemory(device, image, allocation.memory, allocation.offset);
 	}
 	
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, Platform *platform) {
-		VkCommandBuffer command_buffer = beginSingleTimeCommands();
+	// NOTE: graphics queue work that has to see finished uploads, folded into the setup batch while one is open
+	VkCommandBuffer beginGraphicsCommands() {
+		if(setup_command_buffer) return setup_command_buffer;
 		
+		uploads.flush();
+		uploads.submitPendingAcquires();
+		return beginSingleTimeCommands();
+	}
+	
+	void endGraphicsCommands(VkCommandBuffer command_buffer) {
+		if(command_buffer != setup_command_buffer) {
+			endSingleTimeCommands(command_buffer);
+		}
+	}
+	
+	void recordImageTransition(VkCommandBuffer command_buffer, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, u32 base_mip, u32 mip_count, Platform *platform) {
 		VkImageMemoryBarrier barrier = {};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.oldLayout = old_layout;
@@ -1192,76 +1789,143 @@ struct VulkanRenderer {
 		
 		barrier.image = image;
 		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseMipLevel = base_mip;
+		barrier.subresourceRange.levelCount = mip_count;
 		barrier.subresourceRange.baseArrayLayer = 0;
 		barrier.subresourceRange.layerCount = 1;
 		
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = 0;
-		
-		VkPipelineStageFlags source_stage;
-		VkPipelineStageFlags destination_stage;
-		
 		if(new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
 			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 			
 			if(hasStencilComponent(format)) {
 				barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
 			}
-		} else {
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		}
 		
-		if(old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		// NOTE: wait on whatever the old layout implies was last done to the image, make it ready for what the new one is for
+		VkPipelineStageFlags source_stage;
+		VkPipelineStageFlags destination_stage;
+		imageLayoutAccess(old_layout, &source_stage, &barrier.srcAccessMask);
+		imageLayoutAccess(new_layout, &destination_stage, &barrier.dstAccessMask);
+		barrier.srcAccessMask &= VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		
+		vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, 0, 0, 0, 1, &barrier);
+	}
+	
+	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, Platform *platform, u32 base_mip = 0, u32 mip_count = 1) {
+		VkCommandBuffer command_buffer = beginGraphicsCommands();
+		recordImageTransition(command_buffer, image, format, old_layout, new_layout, base_mip, mip_count, platform);
+		endGraphicsCommands(command_buffer);
+	}
+	
+	bool canBlitMips(VkFormat format) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
+		VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		return (props.optimalTilingFeatures & needed) == needed;
+	}
+	
+	// NOTE: every level must be in TRANSFER_DST_OPTIMAL with level 0 filled in, all levels end up SHADER_READ_ONLY_OPTIMAL
+	void generateMipmaps(VkImage image, VkFormat format, u32 width, u32 height, u32 mip_levels, Platform *platform) {
+		VkCommandBuffer command_buffer = beginGraphicsCommands();
+		
+		s32 mip_width = (s32)width;
+		s32 mip_height = (s32)height;
+		for(u32 level = 1; level < mip_levels; level++) {
+			recordImageTransition(command_buffer, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level - 1, 1, platform);
 			
-			source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		} else if(old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			s32 next_width = mip_width > 1 ? mip_width / 2 : 1;
+			s32 next_height = mip_height > 1 ? mip_height / 2 : 1;
 			
-			source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		} else if(old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			VkImageBlit blit = {};
+			blit.srcOffsets[0] = {0, 0, 0};
+			blit.srcOffsets[1] = {mip_width, mip_height, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = level - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[0] = {0, 0, 0};
+			blit.dstOffsets[1] = {next_width, next_height, 1};
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = level;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
 			
-			source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destination_stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		} else {
-			platform->error("Unsupported layout transition");
+			vkCmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+			
+			recordImageTransition(command_buffer, image, format, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level - 1, 1, platform);
+			
+			mip_width = next_width;
+			mip_height = next_height;
 		}
 		
-		vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, 0, 0, 0, 1, &barrier);
+		recordImageTransition(command_buffer, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_levels - 1, 1, platform);
 		
-		endSingleTimeCommands(command_buffer);
+		endGraphicsCommands(command_buffer);
+	}
+	
+	VkFormat cookedTextureVkFormat(CookedTextureFormat format) {
+		switch(format) {
+			case CookedTextureFormat::BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			case CookedTextureFormat::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+			case CookedTextureFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+			case CookedTextureFormat::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+			default: return VK_FORMAT_UNDEFINED;
+		}
 	}
 	
-	void copyBufferToImage(VkBuffer buffer, VkImage image, u32 width, u32 height) {
-		VkCommandBuffer command_buffer = beginSingleTimeCommands();
+	// NOTE: everything uploadImage trusts, so a truncated or corrupt file falls back to the source image instead of
+	// reading past the end of it
+	bool cookedTextureValid(CookedTextureHeader *header, u64 file_size) {
+		if(file_size < sizeof(CookedTextureHeader)) return false;
+		if(header->magic != COOKED_TEXTURE_MAGIC || header->version != COOKED_TEXTURE_VERSION || header->format >= CookedTextureFormat::Count) return false;
+		if(header->width == 0 || header->height == 0 || header->width > COOKED_TEXTURE_MAX_DIMENSION || header->height > COOKED_TEXTURE_MAX_DIMENSION) return false;
+		if(header->level_count == 0 || header->level_count > COOKED_TEXTURE_MAX_LEVELS || header->level_count > mipLevelCount(header->width, header->height)) return false;
+		if(header->data_size != file_size - sizeof(CookedTextureHeader)) return false;
+		for(u32 level = 0; level < header->level_count; level++) {
+			u64 expected_size = cookedTextureLevelSize(header->format, mipDimension(header->width, level), mipDimension(header->height, level));
+			if(header->level_sizes[level] != expected_size) return false;
+			if(header->level_offsets[level] > header->data_size || header->level_sizes[level] > header->data_size - header->level_offsets[level]) return false;
+		}
+		return true;
+	}
+	
+	// NOTE: uploads the blocks of a texture built by tools/texture_cooker as is, returns false if the file can't be used
+	bool createCookedTextureImage(Platform *platform, const char *path) {
+		if(!supports_bc_textures || !platform->fileExists(path)) return false;
+		
+		u64 start = platform->getPerformanceCounter();
+		FileData file = platform->readEntireFile(path);
+		CookedTextureHeader *header = (CookedTextureHeader *)file.contents;
+		if(!cookedTextureValid(header, file.size)) {
+			printf("Ignoring invalid cooked texture %s\n", path);
+			if(file.contents) platform->free(file.contents);
+			return false;
+		}
 		
-		VkBufferImageCopy region = {};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
+		texture_format = cookedTextureVkFormat(header->format);
+		texture_mip_levels = disable_mips ? 1 : header->level_count;
 		
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
+		createImage(header->width, header->height, texture_mip_levels, texture_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image, texture_image_allocation, platform);
 		
-		region.imageOffset = {0, 0, 0};
-		region.imageExtent = {width, height, 1};
+		VkDeviceSize level_offsets[COOKED_TEXTURE_MAX_LEVELS];
+		VkDeviceSize upload_size = 0;
+		for(u32 level = 0; level < texture_mip_levels; level++) {
+			level_offsets[level] = header->level_offsets[level];
+			VkDeviceSize level_end = header->level_offsets[level] + header->level_sizes[level];
+			if(level_end > upload_size) upload_size = level_end;
+		}
 		
-		vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		uploads.uploadImage(platform, texture_image, header->width, header->height, texture_mip_levels, texture_mip_levels, level_offsets, header + 1, upload_size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 		
-		endSingleTimeCommands(command_buffer);
+		printf("Texture %ux%u %s, %u mips, %.2fMB loaded in %.3fms\n", header->width, header->height, cookedTextureFormatName(header->format), texture_mip_levels, upload_size / (1024.0f * 1024.0f), (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f);
+		platform->free(file.contents);
+		return true;
 	}
 	
 	void createTextureImage(Platform *platform) {
+		if(createCookedTextureImage(platform, "data/textures/chalet.ptex")) return;
+		
 		int width, height, channels;
 		u8 *pixels = stbi_load("data/textures/chalet.jpg", &width, &height, &channels, STBI_rgb_alpha);
 		VkDeviceSize image_size = width * height * 4;
@@ -1270,29 +1934,41 @@ struct VulkanRenderer {
 			platform->error("Couldn't load image");
 		}
 		
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
-		createBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory, platform);
+		texture_mip_levels = disable_mips ? 1 : mipLevelCount((u32)width, (u32)height);
+		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+		texture_format = format;
 		
-		void *data;
-		vkMapMemory(device, staging_buffer_memory, 0, image_size, 0, &data);
-		memcpy(data, pixels, (size_t)image_size);
-		vkUnmapMemory(device, staging_buffer_memory);
-		stbi_image_free(pixels);
-		
-		createImage((u32)width, (u32)height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image, texture_image_memory, platform);
+		createImage((u32)width, (u32)height, texture_mip_levels, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image, texture_image_allocation, platform);
 		
-		transitionImageLayout(texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, platform);
-		copyBufferToImage(staging_buffer, texture_image, (u32)width, (u32)height);
-		
-		transitionImageLayout(texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, platform);
+		u64 start = platform->getPerformanceCounter();
+		if(texture_mip_levels == 1) {
+			uploads.uploadImage(platform, texture_image, (u32)width, (u32)height, 1, 1, 0, pixels, image_size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		} else if(canBlitMips(format) && !force_cpu_mips) {
+			uploads.uploadImage(platform, texture_image, (u32)width, (u32)height, texture_mip_levels, 1, 0, pixels, image_size, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+			generateMipmaps(texture_image, format, (u32)width, (u32)height, texture_mip_levels, platform);
+		} else {
+			VkDeviceSize chain_size = mipChainSize((u32)width, (u32)height, texture_mip_levels);
+			u8 *chain = (u8 *)platform->alloc(chain_size);
+			memcpy(chain, pixels, (size_t)image_size);
+			generateMipChainRGBA8(chain, (u32)width, (u32)height, texture_mip_levels);
+			
+			VkDeviceSize level_offsets[32];
+			VkDeviceSize offset = 0;
+			for(u32 level = 0; level < texture_mip_levels; level++) {
+				level_offsets[level] = offset;
+				offset += (VkDeviceSize)mipDimension((u32)width, level) * mipDimension((u32)height, level) * 4;
+			}
+			
+			uploads.uploadImage(platform, texture_image, (u32)width, (u32)height, texture_mip_levels, texture_mip_levels, level_offsets, chain, chain_size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			platform->free(chain);
+		}
 		
-		vkDestroyBuffer(device, staging_buffer, 0);
-		vkFreeMemory(device, staging_buffer_memory, 0);
+		printf("Texture %dx%d, %u mips %s in %.3fms\n", width, height, texture_mip_levels, texture_mip_levels == 1 ? "" : (canBlitMips(format) && !force_cpu_mips ? "blitted" : "filtered on cpu"), (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency() * 1000.0f);
+		stbi_image_free(pixels);
 	}
 	
 	void createTextureImageView(Platform *platform) {
-		texture_image_view = createImageView(texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, platform);
+		texture_image_view = createImageView(texture_image, texture_format, VK_IMAGE_ASPECT_COLOR_BIT, texture_mip_levels, platform);
 	}
 	
 	void createTextureSampler(Platform *platform) {
@@ -1314,7 +1990,7 @@ struct VulkanRenderer {
 		create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		create_info.mipLodBias = 0.0f;
 		create_info.minLod = 0.0f;
-		create_info.maxLod = 0.0f;
+		create_info.maxLod = (f32)texture_mip_levels;
 		
 		if(vkCreateSampler(device, &create_info, 0, &texture_sampler) != VK_SUCCESS) {
 			platform->error("Couldn't create texture sampler");
@@ -1349,103 +2025,421 @@ struct VulkanRenderer {
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
 	
-	void createDepthResources(Platform *platform) {
-		VkFormat depth_format = findDepthFormat(platform);
-		createImage(
-            extent.width, extent.height, 
-            depth_format, 
-            VK_IMAGE_TILING_OPTIMAL, 
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            depth_image, depth_image_memory, platform
-        );
-        depth_image_view = createImageView(depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, platform);
-        
-        transitionImageLayout(depth_image, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, platform);
-	}
-	
 	void init(Platform *platform, PlatformWindow *window) {
+		startup_start = platform->getPerformanceCounter();
+		startup_stage_start = startup_start;
+		vertex_layout = full_vertices ? VertexLayout::full(vertex_colors) : VertexLayout::compact(vertex_colors);
+		if(lod_count == 0) {
+			lods[0] = {0, index_count, 0.0f};
+			lod_count = 1;
+		}
+		
 		createInstance(platform, window);	
-		setupDebugUtils(platform);
-		createSurface(platform, window);
+		if(has_debug_utils) setupDebugUtils(platform);
+		if(!headless) createSurface(platform, window);
 		pickPhysicalDevice(platform);
 		pickQueues(platform);
 		createDevice(platform);
+		gpu_memory.init(platform, physical_device, device);
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			deletion_queues[f].init(platform, device, &gpu_memory);
+		}
 		createQueues();
-		createSwapChain(platform, window);
-		createImageViews(platform);
-		createRenderPass(platform);
+		markStartupStage(platform, "device");
+		if(headless) {
+			createOffscreenTargets(platform);
+		} else {
+			createSwapChain(platform, window);
+			createImageViews(platform);
+		}
+		layout_cache.init(device);
+		pipelines.init(platform, device);
 		createDescriptorSetLayout(platform);
-		createGraphicsPipeline(platform);
+		if(use_bindless) {
+			bindless_textures.init(platform, physical_device, device, BINDLESS_MAX_TEXTURES);
+		}
+		createPipelineCache(platform);
+		createUniformBuffer(platform);
+		createCuller(platform);
+		frame_graph.init(device, &gpu_memory);
+		buildFrameGraph(platform);
+		markStartupStage(platform, "swap chain");
+		f32 pipeline_ms = timeGraphicsPipelineCreation(platform);
+		printf("Graphics pipeline created in %.3fms\n", pipeline_ms);
+		if(benchmark_pipeline_cache) {
+			benchmarkPipelineCache(platform);
+		}
+		if(!disable_shader_reload) watchShaders(platform);
+		markStartupStage(platform, "pipelines");
+		createRecordWorkers(platform);
 		createCommandPool(platform);
-		createDepthResources(platform);
-		createFramebuffers(platform);
+		uploads.init(platform, device, &gpu_memory, transfer_queue, (u32)transfer_queue_index, graphics_queue, (u32)graphics_queue_index);
+		profiler.init(platform, physical_device, device, (u32)graphics_queue_index, MAX_FRAMES_IN_FLIGHT);
+		PFN_vkResetQueryPoolEXT host_reset_query_pool = supports_host_query_reset ? (PFN_vkResetQueryPoolEXT)vkGetDeviceProcAddr(device, "vkResetQueryPoolEXT") : 0;
+		uploads.enableTiming(platform, physical_device, &profiler, host_reset_query_pool);
+		
+		beginSetupCommands();
 		createTextureImage(platform);
 		createTextureImageView(platform);
 		createTextureSampler(platform);
+		texture_slot = use_bindless ? bindless_textures.add(texture_image_view, texture_sampler) : 0;
 		createVertexBuffer(platform);
 		createIndexBuffer(platform);
-		createUniformBuffer(platform);
+		meshlet_culler.upload(platform, &uploads, &meshlet_mesh);
+		markStartupStage(platform, "record uploads");
+		endSetupCommands(platform);
+		markStartupStage(platform, "wait uploads");
+		
 		createDescriptorPool(platform);
 		createDescriptorSets(platform);
-		createAndRecordCommandBuffers(platform);
+		createCommandBuffers(platform);
 		createSyncObjects(platform);
+		markStartupStage(platform, "frame resources");
+		
+		gpu_memory.printStats();
 	}	
 	
-	void startFrame() {
+	void startFrame(Platform *platform) {
 		vkWaitForFences(device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX);
+		deletion_queues[current_frame].flush();
+		finishReadback(current_frame, platform);
+		if(!disable_shader_reload) reloadChangedShaders(platform);
+		selectPipelines();
+		profiler.beginFrame(current_frame);
+		
+		uploads.update();
+		uniform_ring.beginFrame(current_frame);
+		instance_ring.beginFrame(current_frame);
+		culler.beginFrame(current_frame);
+		meshlet_culler.beginFrame(current_frame);
+		draw_count = 0;
+		updateCamera();
 	}
 	
-	void recreateIfFailed(VkResult result, Platform *platform, PlatformWindow *window, char *error) {
-		
-		if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapChain(platform, window);
-			return;
-		} else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+	void checkSwapChainResult(VkResult result, Platform *platform, const char *error) {
+		if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+			swap_chain_out_of_date = true;
+		} else if(result != VK_SUCCESS) {
 			platform->error(error);
 		}
 	}
 	
 	f32 rotation = 0.0f;
 	
-	void updateUniformBuffers(u32 current_image, float delta) {
-		UniformBufferObject ubo = {};
-		rotation += delta * 10.0f;
-		ubo.model = Mat4::transpose(Mat4::translate(Vec3(0.0f, 0.0f, 0.0f)) * Mat4::rotateY(Math::Pi32) * Mat4::rotateZ(Math::toRadians(rotation)));
-		
-		Vec3 camera_position = Vec3(2.0f, 0.0f, -2.0f);
+	void updateCamera() {
+		camera_position = Vec3(2.0f, 0.0f, -2.0f);
 		Vec3 forward = Vec3::normalize(-camera_position);
 		
-		ubo.view = Mat4::transpose(Mat4::lookAt(camera_position, forward, Vec3(0.0f, 0.0f, 1.0f)));
-		// ubo.view = Mat4();
-		ubo.projection = Mat4::transpose(Mat4::perspective(45.0f, (f32)extent.width / (f32)extent.height, 0.1f, 10.0f));
-		// ubo.projection = Mat4();
+		camera_view = Mat4::transpose(Mat4::lookAt(camera_position, forward, Vec3(0.0f, 0.0f, 1.0f)));
+		camera_projection = Mat4::transpose(Mat4::perspective(45.0f, (f32)extent.width / (f32)extent.height, 0.1f, 10.0f));
+		lod_pixels_per_unit = camera_projection.data2d[1][1] * (f32)extent.height * 0.5f;
+		
+		// NOTE: planes come straight from the rows of view * projection, the near plane assumes a -w..w clip range which
+		// is only ever looser than vulkan's 0..w so culling stays conservative either way
+		Mat4 view_projection = Mat4::transpose(camera_projection) * Mat4::transpose(camera_view);
+		for(u32 p = 0; p < 6; p++) {
+			u32 row = p / 2;
+			f32 sign = (p & 1) ? -1.0f : 1.0f;
+			f32 plane[4];
+			for(u32 c = 0; c < 4; c++) {
+				plane[c] = view_projection.data2d[3][c] + sign * view_projection.data2d[row][c];
+			}
+			
+			f32 length = Math::squareRoot(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			frustum_planes[p] = Vec4(plane[0] / length, plane[1] / length, plane[2] / length, plane[3] / length);
+		}
+	}
+	
+	UniformBufferObject meshUniforms(GpuMesh *draw_mesh, Mat4 model) {
+		UniformBufferObject result = {};
+		result.model = model;
+		result.view = camera_view;
+		result.projection = camera_projection;
+		result.position_scale = draw_mesh->position_scale;
+		result.position_offset = draw_mesh->position_offset;
+		return result;
+	}
+	
+	// NOTE: the LOD for a mesh drawn with this model matrix (as uploaded, transposed), picked by its projected error
+	u32 selectLod(GpuMesh *draw_mesh, Mat4 model) {
+		if(disable_lods) return 0;
+		Mat4 m = Mat4::transpose(model);
+		Vec4 center = Mat4::transform(m, Vec4(draw_mesh->bounding_sphere.x, draw_mesh->bounding_sphere.y, draw_mesh->bounding_sphere.z, 1.0f));
+		f32 scale = modelScale(m);
+		f32 distance = Vec3::length(Vec3(center.x, center.y, center.z) - camera_position) - draw_mesh->bounding_sphere.w * scale;
+		return selectMeshLod(draw_mesh->lods, draw_mesh->lod_count, scale, distance, lod_pixels_per_unit, lod_pixel_error);
+	}
+	
+	// NOTE: an instanced batch draws one LOD for all of them, so it's picked for whichever instance is nearest
+	u32 selectLod(GpuMesh *draw_mesh, const InstanceData *instances, u32 instance_count) {
+		if(disable_lods) return 0;
+		f32 nearest = 0.0f;
+		f32 nearest_scale = 1.0f;
+		for(u32 i = 0; i < instance_count; i++) {
+			Mat4 m = Mat4();
+			for(u32 row = 0; row < 3; row++) {
+				for(u32 column = 0; column < 4; column++) m.data2d[row][column] = instances[i].model_rows[row].xyzw[column];
+			}
+			Vec4 center = Mat4::transform(m, Vec4(draw_mesh->bounding_sphere.x, draw_mesh->bounding_sphere.y, draw_mesh->bounding_sphere.z, 1.0f));
+			f32 scale = modelScale(m);
+			f32 distance = Vec3::length(Vec3(center.x, center.y, center.z) - camera_position) - draw_mesh->bounding_sphere.w * scale;
+			if(i == 0 || distance < nearest) {
+				nearest = distance;
+				nearest_scale = scale;
+			}
+		}
+		return selectMeshLod(draw_mesh->lods, draw_mesh->lod_count, nearest_scale, nearest, lod_pixels_per_unit, lod_pixel_error);
+	}
+	
+	// NOTE: the largest axis scale, so errors and bounds stay conservative under non uniform scale
+	static f32 modelScale(Mat4 m) {
+		f32 result = 0.0f;
+		for(u32 column = 0; column < 3; column++) {
+			f32 length = Vec3::length(Vec3(m.data2d[0][column], m.data2d[1][column], m.data2d[2][column]));
+			if(length > result) result = length;
+		}
+		return result;
+	}
+	
+	// NOTE: queue a draw for this frame, valid between startFrame and renderFrame. texture_index is a bindless slot and is
+	// ignored without bindless support, where every draw uses the single bound texture
+	void drawIndexed(Platform *platform, GpuMesh *draw_mesh, u32 draw_index_count, Mat4 model, u32 texture_index, u32 first_index = 0, s32 vertex_offset = 0) {
+		if(draw_count >= MAX_DRAW_ITEMS) {
+			platform->error("Too many draws this frame");
+			return;
+		}
 		
-		void *data;
-		vkMapMemory(device, uniform_buffers_memory[current_image], 0, sizeof(ubo), 0, &data);
-		memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(device, uniform_buffers_memory[current_image]);
+		UniformBufferObject ubo = meshUniforms(draw_mesh, model);
+		
+		DrawItem *draw = &draw_items[draw_count++];
+		draw->pipeline = graphics_pipeline;
+		draw->descriptor_set = descriptor_set;
+		draw->indirect_buffer = VK_NULL_HANDLE;
+		draw->vertex_buffer = draw_mesh->vertex_buffer;
+		draw->color_buffer = draw_mesh->color_buffer;
+		draw->index_buffer = draw_mesh->index_buffer;
+		draw->index_count = draw_index_count;
+		draw->first_index = first_index;
+		draw->vertex_offset = vertex_offset;
+		draw->texture_index = texture_index;
+		draw->instance_count = 1;
+		draw->first_instance = 0;
+		draw->uniform_offset = uniform_ring.push(platform, &ubo, sizeof(ubo));
+	}
+	
+	// NOTE: one draw for every instance, transforms and texture slots are copied into this frame's part of the instance ring
+	void drawInstanced(Platform *platform, GpuMesh *draw_mesh, u32 draw_index_count, const InstanceData *instances, u32 instance_count, u32 first_index = 0) {
+		if(instance_count == 0) return; // NOTE: the draw takes its texture from instances[0]
+		if(draw_count >= MAX_DRAW_ITEMS) {
+			platform->error("Too many draws this frame");
+			return;
+		}
+		
+		u32 instance_offset;
+		void *instance_data = instance_ring.reserve(platform, sizeof(InstanceData) * instance_count, &instance_offset);
+		if(instance_data == 0) return;
+		memcpy(instance_data, instances, sizeof(InstanceData) * instance_count);
+		
+		UniformBufferObject ubo = meshUniforms(draw_mesh, Mat4());
+		
+		DrawItem *draw = &draw_items[draw_count++];
+		draw->pipeline = instanced_pipeline;
+		draw->descriptor_set = descriptor_set;
+		draw->indirect_buffer = VK_NULL_HANDLE;
+		draw->vertex_buffer = draw_mesh->vertex_buffer;
+		draw->color_buffer = draw_mesh->color_buffer;
+		draw->index_buffer = draw_mesh->index_buffer;
+		draw->index_count = draw_index_count;
+		draw->first_index = first_index;
+		draw->vertex_offset = 0;
+		draw->texture_index = instances[0].texture_index;
+		draw->instance_count = instance_count;
+		draw->first_instance = instance_offset / sizeof(InstanceData);
+		draw->uniform_offset = uniform_ring.push(platform, &ubo, sizeof(ubo));
+	}
+	
+	// NOTE: like drawInstanced but the instances are frustum culled on the gpu against the mesh's bounding sphere first.
+	// Cpu cost is one dispatch and one indirect draw no matter how many instances there are.
+	void drawInstancedCulled(Platform *platform, GpuMesh *draw_mesh, u32 draw_index_count, const InstanceData *instances, u32 instance_count, u32 first_index = 0) {
+		if(instance_count == 0) return; // NOTE: the draw takes its texture from instances[0]
+		if(draw_count >= MAX_DRAW_ITEMS) {
+			platform->error("Too many draws this frame");
+			return;
+		}
+		
+		u32 instance_offset;
+		void *instance_data = instance_ring.reserve(platform, sizeof(InstanceData) * instance_count, &instance_offset);
+		if(instance_data == 0) return;
+		memcpy(instance_data, instances, sizeof(InstanceData) * instance_count);
+		
+		VkDeviceSize indirect_offset;
+		if(!culler.addBatch(platform, draw_mesh->bounding_sphere, instance_offset / sizeof(InstanceData), instance_count, draw_index_count, first_index, 0, &indirect_offset)) return;
+		
+		UniformBufferObject ubo = meshUniforms(draw_mesh, Mat4());
+		
+		DrawItem *draw = &draw_items[draw_count++];
+		draw->pipeline = instanced_pipeline;
+		draw->descriptor_set = culled_descriptor_set;
+		draw->indirect_buffer = culler.command_buffer;
+		draw->indirect_offset = indirect_offset;
+		draw->vertex_buffer = draw_mesh->vertex_buffer;
+		draw->color_buffer = draw_mesh->color_buffer;
+		draw->index_buffer = draw_mesh->index_buffer;
+		draw->index_count = draw_index_count;
+		draw->first_index = first_index;
+		draw->vertex_offset = 0;
+		draw->texture_index = instances[0].texture_index;
+		draw->instance_count = 0;
+		draw->first_instance = 0;
+		draw->uniform_offset = uniform_ring.push(platform, &ubo, sizeof(ubo));
+	}
+	
+	// NOTE: like drawIndexed for the whole mesh, but only the meshlets that survive frustum and backface cone culling on
+	// the gpu are drawn, as one indirect draw over the compacted index list. Needs no mesh shader support.
+	void drawMeshletsCulled(Platform *platform, GpuMesh *draw_mesh, Mat4 model, u32 texture_index) {
+		if(draw_count >= MAX_DRAW_ITEMS) {
+			platform->error("Too many draws this frame");
+			return;
+		}
+		
+		VkDeviceSize indirect_offset;
+		if(!meshlet_culler.addBatch(platform, Mat4::transpose(model), frustum_planes, camera_position, &indirect_offset)) return;
+		
+		UniformBufferObject ubo = meshUniforms(draw_mesh, model);
+		
+		DrawItem *draw = &draw_items[draw_count++];
+		draw->pipeline = graphics_pipeline;
+		draw->descriptor_set = descriptor_set;
+		draw->indirect_buffer = meshlet_culler.command_buffer;
+		draw->indirect_offset = indirect_offset;
+		draw->vertex_buffer = draw_mesh->vertex_buffer;
+		draw->color_buffer = draw_mesh->color_buffer;
+		draw->index_buffer = meshlet_culler.index_buffer;
+		draw->index_count = 0;
+		draw->first_index = 0;
+		draw->vertex_offset = 0;
+		draw->texture_index = texture_index;
+		draw->instance_count = 0;
+		draw->first_instance = 0;
+		draw->uniform_offset = uniform_ring.push(platform, &ubo, sizeof(ubo));
+	}
+	
+	// NOTE: a field of small, distant copies so nearly every texel fetch is heavily minified, run with and without -no-mips to compare
+	void drawMipBenchScene(Platform *platform) {
+		const s32 grid_size = 16;
+		for(s32 y = 0; y < grid_size; y++) {
+			for(s32 x = 0; x < grid_size; x++) {
+				Vec3 position = Vec3(-(f32)x * 0.4f, ((f32)y - grid_size * 0.5f) * 0.4f, 0.0f);
+				Mat4 model = Mat4::transpose(Mat4::translate(position) * Mat4::rotateY(Math::Pi32) * Mat4::rotateZ(Math::toRadians(rotation)) * Mat4::scale(Vec3(0.15f)));
+				MeshLod *lod = &mesh.lods[selectLod(&mesh, model)];
+				drawIndexed(platform, &mesh, lod->index_count, model, texture_slot, lod->first_index);
+			}
+		}
+		
+		u64 now = platform->getPerformanceCounter();
+		if(bench_frame_count == 0) bench_frame_start = now;
+		if(++bench_frame_count == 501) {
+			f32 seconds = (f32)(now - bench_frame_start) / (f32)platform->getPerformanceFrequency();
+			printf("Mip bench: %.3fms/frame over 500 frames (%u mips)\n", seconds * 1000.0f / 500.0f, texture_mip_levels);
+			bench_frame_count = 0;
+		}
+	}
+	
+	// NOTE: INSTANCING_BENCH_COUNT copies of the chalet in a grid, drawn INSTANCING_BENCH_PER_DRAW at a time so the record workers share them
+	void drawInstancingBenchScene(Platform *platform) {
+		u32 grid_size = (u32)Math::squareRoot((f32)INSTANCING_BENCH_COUNT) + 1;
+		if(bench_instances == 0) {
+			bench_instances = (InstanceData *)platform->alloc(sizeof(InstanceData) * INSTANCING_BENCH_COUNT);
+			for(u32 i = 0; i < INSTANCING_BENCH_COUNT; i++) {
+				f32 x = (f32)(i % grid_size);
+				f32 y = (f32)(i / grid_size) - grid_size * 0.5f;
+				Mat4 model = Mat4::translate(Vec3(-x * 0.1f, y * 0.1f, 0.0f)) * Mat4::rotateY(Math::Pi32) * Mat4::scale(Vec3(0.04f));
+				bench_instances[i] = instanceFromModel(model, texture_slot);
+			}
+		}
+		
+		for(u32 first = 0; first < INSTANCING_BENCH_COUNT; first += INSTANCING_BENCH_PER_DRAW) {
+			u32 count = INSTANCING_BENCH_COUNT - first < INSTANCING_BENCH_PER_DRAW ? INSTANCING_BENCH_COUNT - first : INSTANCING_BENCH_PER_DRAW;
+			MeshLod *lod = &mesh.lods[selectLod(&mesh, bench_instances + first, count)];
+			if(disable_gpu_culling) {
+				drawInstanced(platform, &mesh, lod->index_count, bench_instances + first, count, lod->first_index);
+			} else {
+				drawInstancedCulled(platform, &mesh, lod->index_count, bench_instances + first, count, lod->first_index);
+			}
+		}
+		
+		u64 now = platform->getPerformanceCounter();
+		if(bench_frame_count == 0) bench_frame_start = now;
+		if(++bench_frame_count == 101) {
+			f32 seconds = (f32)(now - bench_frame_start) / (f32)platform->getPerformanceFrequency();
+			printf("Instancing bench: %u instances in %u draws, %.3fms/frame over 100 frames\n", INSTANCING_BENCH_COUNT, draw_count, seconds * 1000.0f / 100.0f);
+			bench_frame_count = 0;
+		}
+	}
+	
+	void drawScene(Platform *platform, float delta) {
+		rotation += delta * 10.0f;
+		if(benchmark_mips) {
+			drawMipBenchScene(platform);
+			return;
+		}
+		
+		if(benchmark_instancing) {
+			drawInstancingBenchScene(platform);
+			return;
+		}
+		
+		Mat4 model = Mat4::transpose(Mat4::translate(Vec3(0.0f, 0.0f, 0.0f)) * Mat4::rotateY(Math::Pi32) * Mat4::rotateZ(Math::toRadians(rotation)));
+		// NOTE: meshlets are only built for LOD 0, coarser LODs are small enough to draw whole
+		u32 lod = selectLod(&mesh, model);
+		if(lod == 0 && !disable_meshlet_culling) {
+			drawMeshletsCulled(platform, &mesh, model, texture_slot);
+		} else {
+			drawIndexed(platform, &mesh, mesh.lods[lod].index_count, model, texture_slot, mesh.lods[lod].first_index);
+		}
 	}
 	
 	void renderFrame(Platform *platform, PlatformWindow *window, float delta) {
-		u32 image_index;
-		VkResult result = vkAcquireNextImageKHR(device, swap_chain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
-		recreateIfFailed(result, platform, window, "Failed to acquire swap chain image");
+		// NOTE: headless targets are per frame in flight and never go out of date
+		u32 image_index = current_frame;
+		VkResult result;
+		if(!headless) {
+			if(swap_chain_out_of_date) {
+				recreateSwapChain(platform, window);
+				if(swap_chain_out_of_date) return;
+			}
+			
+			result = vkAcquireNextImageKHR(device, swap_chain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
+			checkSwapChainResult(result, platform, "Failed to acquire swap chain image");
+			if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+				// NOTE: nothing was acquired so nothing can be submitted, skip the frame and rebuild on the next one
+				return;
+			}
+		}
 				
 		VkSemaphore wait_semaphores[] = {image_available_semaphores[current_frame]};
 		VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 		VkSemaphore signal_semaphores[] = {render_finished_semaphores[current_frame]};
 		
-		updateUniformBuffers(image_index, delta);
+		drawScene(platform, delta);
+		
+		vkResetCommandPool(device, frame_command_pools[current_frame], 0);
+		for(u32 t = 0; t < record_thread_count; t++) {
+			vkResetCommandPool(device, record_command_pools[current_frame][t], 0);
+		}
+		recordCommandBuffer(current_frame, image_index, platform);
+		
+		uploads.flush();
+		uploads.submitPendingAcquires();
 		
 		VkSubmitInfo vk_submit_info = {};
 		vk_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		vk_submit_info.waitSemaphoreCount = 1;
+		vk_submit_info.waitSemaphoreCount = headless ? 0 : 1;
 		vk_submit_info.pWaitSemaphores = wait_semaphores;
 		vk_submit_info.pWaitDstStageMask = wait_stages;
 		vk_submit_info.commandBufferCount = 1;
-		vk_submit_info.pCommandBuffers = &command_buffers[image_index];
-		vk_submit_info.signalSemaphoreCount = 1;
+		vk_submit_info.pCommandBuffers = &command_buffers[current_frame];
+		vk_submit_info.signalSemaphoreCount = headless ? 0 : 1;
 		vk_submit_info.pSignalSemaphores = signal_semaphores;
 		
 		vkResetFences(device, 1, &in_flight_fences[current_frame]);
@@ -1453,6 +2447,9 @@ struct VulkanRenderer {
 		if(vkQueueSubmit(graphics_queue, 1, &vk_submit_info, in_flight_fences[current_frame]) != VK_SUCCESS) {
 			platform->error("Couldn't submit draw command buffer");
 		}
+		if(pacer) pacer->mark(LatencyMarker::Submit);
+		
+		if(headless) return;
 		
 		VkSwapchainKHR swap_chains[] = {swap_chain};
 		
@@ -1466,36 +2463,52 @@ struct VulkanRenderer {
 		vk_present_info.pResults = 0;
 		
 		result = vkQueuePresentKHR(present_queue, &vk_present_info);
-		recreateIfFailed(result, platform, window, "Failed to present swap chain images");
+		if(pacer) pacer->mark(LatencyMarker::Present);
+		checkSwapChainResult(result, platform, "Failed to present swap chain images");
 	}
 	
 	void endFrame() {
 		current_frame = (current_frame + 1)  % MAX_FRAMES_IN_FLIGHT;
 	}
 	
-	void cleanup() {
+	void cleanup(Platform *platform) {
 		vkDeviceWaitIdle(device);
 		
-		cleanupSwapChain();
+		releaseSwapChainResources(frameDeletionQueue());
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			deletion_queues[f].destroy();
+			if(headless) finishReadback(f, platform);
+		}
+		if(headless) destroyOffscreenTargets();
+		
+		destroyGraphicsPipeline();
 
 		vkDestroySampler(device, texture_sampler, 0);
 		vkDestroyImageView(device, texture_image_view, 0);
 		vkDestroyImage(device, texture_image, 0);
-		vkFreeMemory(device, texture_image_memory, 0);
+		gpu_memory.free(&texture_image_allocation);
 
 		vkDestroyDescriptorPool(device, descriptor_pool, 0);
-		vkDestroyDescriptorSetLayout(device, descriptor_set_layout, 0);
-
-		for(u32 i = 0; i < swap_image_count; i++) {
-			vkDestroyBuffer(device, uniform_buffers[i], 0);
-			vkFreeMemory(device, uniform_buffers_memory[i], 0);
+		if(use_bindless) {
+			bindless_textures.destroy(platform);
 		}
 
-		vkDestroyBuffer(device, index_buffer, 0);
-		vkFreeMemory(device, index_buffer_memory, 0);
+		uniform_ring.destroy(device, &gpu_memory);
+		instance_ring.destroy(device, &gpu_memory);
+		culler.destroy();
+		meshlet_culler.destroy(platform);
+		layout_cache.destroy();
+		meshlet_mesh.destroy(platform);
+		if(bench_instances) platform->free(bench_instances);
+
+		vkDestroyBuffer(device, mesh.index_buffer, 0);
+		gpu_memory.free(&index_buffer_allocation);
 
-		vkDestroyBuffer(device, vertex_buffer, 0);
-		vkFreeMemory(device, vertex_buffer_memory, 0);
+		vkDestroyBuffer(device, mesh.vertex_buffer, 0);
+		gpu_memory.free(&vertex_buffer_allocation);
+		
+		vkDestroyBuffer(device, mesh.color_buffer, 0);
+		gpu_memory.free(&color_buffer_allocation);
 		PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
 
 		
@@ -1506,10 +2519,24 @@ struct VulkanRenderer {
 		}
 		
 		vkDestroyCommandPool(device, command_pool, 0);
+		for(u32 f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+			vkDestroyCommandPool(device, frame_command_pools[f], 0);
+			for(u32 t = 0; t < record_thread_count; t++) {
+				vkDestroyCommandPool(device, record_command_pools[f][t], 0);
+			}
+		}
+		record_workers.uninit();
+		
+		uploads.destroy();
+		profiler.destroy();
+		
+		pipeline_cache.save(platform);
+		pipeline_cache.destroy();
 		
+		gpu_memory.destroy();
 		vkDestroyDevice(device, 0);
-		vkDestroyDebugUtilsMessengerEXT(instance, debug_callback, 0);
-		vkDestroySurfaceKHR(instance, surface, 0);
+		if(has_debug_utils) vkDestroyDebugUtilsMessengerEXT(instance, debug_callback, 0);
+		if(!headless) vkDestroySurfaceKHR(instance, surface, 0);
 		vkDestroyInstance(instance, 0);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+// NOTE: One persistently mapped buffer split into one partition per frame in flight. Each frame pushes
+// its constants into its own partition and binds them through dynamic offsets, the partition is only
+// rewound once the frame's fence has signalled so the gpu is never reading what gets overwritten.
+struct UniformRingBuffer {
+	VkBuffer buffer;
+	GpuAllocation allocation;
+	VkDeviceSize frame_size;
+	VkDeviceSize alignment;
+	VkDeviceSize head;
+	VkDeviceSize frame_end;
+	u8 *mapped;
+
+	void init(Platform *platform, VkDevice device, GpuMemoryAllocator *gpu_memory, u32 frame_count, VkDeviceSize size_per_frame, VkDeviceSize min_offset_alignment, VkBufferUsageFlags usage) {
+		alignment = min_offset_alignment > 0 ? min_offset_alignment : 1;
+		frame_size = AlignUp(size_per_frame, alignment);
+
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = frame_size * frame_count;
+		buffer_create_info.usage = usage;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if(vkCreateBuffer(device, &buffer_create_info, 0, &buffer) != VK_SUCCESS) {
+			platform->error("Couldn't create ring buffer");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
+
+		allocation = gpu_memory->allocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if(allocation.memory == VK_NULL_HANDLE || allocation.mapped == 0) {
+			platform->error("Couldn't allocate ring buffer memory");
+		}
+
+		vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+		mapped = (u8 *)allocation.mapped;
+
+		head = 0;
+		frame_end = frame_size;
+	}
+
+	void beginFrame(u32 frame) {
+		head = frame_size * frame;
+		frame_end = head + frame_size;
+	}
+
+	// NOTE: returns the dynamic offset of the copied data, the bound descriptor range must be >= size
+	u32 push(Platform *platform, const void *data, VkDeviceSize size) {
+		VkDeviceSize offset = head;
+		if(offset + size > frame_end) {
+			platform->error("Ring buffer frame partition overflowed");
+			return 0;
+		}
+
+		memcpy(mapped + offset, data, (size_t)size);
+		head = AlignUp(offset + size, alignment);
+		return (u32)offset;
+	}
+
+	// NOTE: reserves space for the caller to write into directly, offset receives the dynamic offset
+	void *reserve(Platform *platform, VkDeviceSize size, u32 *offset) {
+		*offset = (u32)head;
+		if(head + size > frame_end) {
+			platform->error("Ring buffer frame partition overflowed");
+			*offset = 0;
+			return 0;
+		}
+
+		void *result = mapped + head;
+		head = AlignUp(head + size, alignment);
+		return result;
+	}
+
+	void destroy(VkDevice device, GpuMemoryAllocator *gpu_memory) {
+		vkDestroyBuffer(device, buffer, 0);
+		gpu_memory->free(&allocation);
+	}
+};
@@ -0,0 +1,644 @@
+#define SHADER_MAX_SETS 4
+#define SHADER_MAX_BINDINGS 16
+#define SHADER_MAX_INPUTS 16
+#define LAYOUT_CACHE_MAX_SET_LAYOUTS 32
+#define LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS 32
+
+#define SPIRV_MAGIC 0x07230203
+
+#define SPIRV_OP_ENTRY_POINT 15
+#define SPIRV_OP_TYPE_BOOL 20
+#define SPIRV_OP_TYPE_INT 21
+#define SPIRV_OP_TYPE_FLOAT 22
+#define SPIRV_OP_TYPE_VECTOR 23
+#define SPIRV_OP_TYPE_MATRIX 24
+#define SPIRV_OP_TYPE_IMAGE 25
+#define SPIRV_OP_TYPE_SAMPLER 26
+#define SPIRV_OP_TYPE_SAMPLED_IMAGE 27
+#define SPIRV_OP_TYPE_ARRAY 28
+#define SPIRV_OP_TYPE_RUNTIME_ARRAY 29
+#define SPIRV_OP_TYPE_STRUCT 30
+#define SPIRV_OP_TYPE_POINTER 32
+#define SPIRV_OP_CONSTANT 43
+#define SPIRV_OP_VARIABLE 59
+#define SPIRV_OP_DECORATE 71
+#define SPIRV_OP_MEMBER_DECORATE 72
+
+#define SPIRV_DECORATION_BLOCK 2
+#define SPIRV_DECORATION_BUFFER_BLOCK 3
+#define SPIRV_DECORATION_ARRAY_STRIDE 6
+#define SPIRV_DECORATION_MATRIX_STRIDE 7
+#define SPIRV_DECORATION_BUILT_IN 11
+#define SPIRV_DECORATION_LOCATION 30
+#define SPIRV_DECORATION_BINDING 33
+#define SPIRV_DECORATION_DESCRIPTOR_SET 34
+#define SPIRV_DECORATION_OFFSET 35
+
+#define SPIRV_STORAGE_UNIFORM_CONSTANT 0
+#define SPIRV_STORAGE_INPUT 1
+#define SPIRV_STORAGE_UNIFORM 2
+#define SPIRV_STORAGE_PUSH_CONSTANT 9
+#define SPIRV_STORAGE_STORAGE_BUFFER 12
+
+#define SPIRV_DIM_BUFFER 5
+#define SPIRV_DIM_SUBPASS_DATA 6
+
+struct ShaderBinding {
+	u32 set;
+	u32 binding;
+	VkDescriptorType type;
+	u32 count; // NOTE: 0 for a runtime array, the layout of its set has to come from whoever owns the table
+	VkShaderStageFlags stages;
+};
+
+enum class ShaderInputType {
+	Float,
+	Int,
+	Uint,
+};
+
+struct ShaderInput {
+	u32 location;
+	ShaderInputType type;
+	u32 components;
+};
+
+// NOTE: what a module reads per id while parsing, only the parts the reflection needs
+struct SpirvId {
+	u32 opcode;
+	u32 type; // NOTE: component, column, element or pointee type, the result type of constants and variables
+	u32 value; // NOTE: component or column count, array length id, constant value, storage class of pointers and variables
+	u32 width; // NOTE: of ints and floats, image sampled mode
+	u32 signedness; // NOTE: of ints, image dimension
+	u32 set;
+	u32 binding;
+	u32 location;
+	u32 array_stride;
+	u32 first_word; // NOTE: of the instruction, structs read their member types from it
+	bool has_binding;
+	bool has_location;
+	bool built_in;
+	bool block;
+	bool buffer_block;
+};
+
+// NOTE: the interface of one SPIR-V module, its descriptor bindings, push constant block and vertex inputs
+struct ShaderReflection {
+	VkShaderStageFlags stage;
+	ShaderBinding bindings[SHADER_MAX_BINDINGS];
+	u32 binding_count;
+	VkPushConstantRange push_constants; // NOTE: size 0 without a push constant block
+	ShaderInput inputs[SHADER_MAX_INPUTS];
+	u32 input_count;
+
+	const u32 *code;
+	u32 word_count;
+	SpirvId *ids;
+	u32 id_bound;
+
+	SpirvId *id(Platform *platform, u32 index, const char *name) {
+		// NOTE: id 0 is never a valid id, so its slot stands in for broken ones
+		if(index >= id_bound) {
+			platform->error(formatString("Shader %s has an id out of bounds", name));
+			return &ids[0];
+		}
+		return &ids[index];
+	}
+
+	u32 memberDecoration(u32 struct_id, u32 member, u32 decoration) {
+		for(u32 word = 5; word < word_count;) {
+			u32 opcode = code[word] & 0xffff;
+			u32 length = code[word] >> 16;
+			if(length == 0 || word + length > word_count) break;
+			if(opcode == SPIRV_OP_MEMBER_DECORATE && length >= 5 && code[word + 1] == struct_id && code[word + 2] == member && code[word + 3] == decoration) {
+				return code[word + 4];
+			}
+			word += length;
+		}
+		return 0;
+	}
+
+	// NOTE: std140 and std430 sizes come out of the offset and stride decorations, so only the scalars need sizing here
+	u32 typeSize(Platform *platform, u32 type_id, u32 matrix_stride, const char *name) {
+		SpirvId *type = id(platform, type_id, name);
+		switch(type->opcode) {
+			case SPIRV_OP_TYPE_BOOL: return 4;
+			case SPIRV_OP_TYPE_INT:
+			case SPIRV_OP_TYPE_FLOAT: return type->width / 8;
+			case SPIRV_OP_TYPE_VECTOR: return type->value * typeSize(platform, type->type, 0, name);
+			case SPIRV_OP_TYPE_MATRIX: return type->value * (matrix_stride ? matrix_stride : typeSize(platform, type->type, 0, name));
+			case SPIRV_OP_TYPE_ARRAY: {
+				u32 length = id(platform, type->value, name)->value;
+				return length * (type->array_stride ? type->array_stride : typeSize(platform, type->type, 0, name));
+			}
+			case SPIRV_OP_TYPE_STRUCT: {
+				u32 result = 0;
+				u32 member_count = (code[type->first_word] >> 16) - 2;
+				for(u32 m = 0; m < member_count; m++) {
+					u32 member_type = code[type->first_word + 2 + m];
+					u32 end = memberDecoration(type_id, m, SPIRV_DECORATION_OFFSET) + typeSize(platform, member_type, memberDecoration(type_id, m, SPIRV_DECORATION_MATRIX_STRIDE), name);
+					if(end > result) result = end;
+				}
+				return result;
+			}
+		}
+		return 0;
+	}
+
+	VkDescriptorType descriptorType(Platform *platform, SpirvId *type, u32 storage_class, const char *name) {
+		switch(type->opcode) {
+			case SPIRV_OP_TYPE_STRUCT: {
+				if(storage_class == SPIRV_STORAGE_STORAGE_BUFFER || type->buffer_block) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+			case SPIRV_OP_TYPE_SAMPLED_IMAGE: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			case SPIRV_OP_TYPE_SAMPLER: return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case SPIRV_OP_TYPE_IMAGE: {
+				if(type->signedness == SPIRV_DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				if(type->signedness == SPIRV_DIM_BUFFER) return type->width == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				return type->width == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+		}
+		platform->error(formatString("Shader %s has a resource of an unsupported type", name));
+		return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	}
+
+	void addBinding(Platform *platform, SpirvId *variable, const char *name) {
+		SpirvId *type = id(platform, id(platform, variable->type, name)->type, name);
+		u32 count = 1;
+		if(type->opcode == SPIRV_OP_TYPE_ARRAY) {
+			count = id(platform, type->value, name)->value;
+			type = id(platform, type->type, name);
+		} else if(type->opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+			count = 0;
+			type = id(platform, type->type, name);
+		}
+
+		if(variable->set >= SHADER_MAX_SETS) {
+			platform->error(formatString("Shader %s uses descriptor set %u, only %u are supported", name, variable->set, SHADER_MAX_SETS));
+			return;
+		}
+		if(binding_count == SHADER_MAX_BINDINGS) {
+			platform->error(formatString("Shader %s has too many bindings", name));
+			return;
+		}
+		ShaderBinding *binding = &bindings[binding_count++];
+		binding->set = variable->set;
+		binding->binding = variable->binding;
+		binding->type = descriptorType(platform, type, variable->value, name);
+		binding->count = count;
+		binding->stages = stage;
+	}
+
+	void addInput(Platform *platform, SpirvId *variable, const char *name) {
+		SpirvId *type = id(platform, id(platform, variable->type, name)->type, name);
+		u32 components = 1;
+		if(type->opcode == SPIRV_OP_TYPE_VECTOR) {
+			components = type->value;
+			type = id(platform, type->type, name);
+		}
+		if(type->opcode != SPIRV_OP_TYPE_FLOAT && type->opcode != SPIRV_OP_TYPE_INT) {
+			platform->error(formatString("Shader %s has a vertex input at location %u that isn't a scalar or vector", name, variable->location));
+		}
+
+		if(input_count == SHADER_MAX_INPUTS) {
+			platform->error(formatString("Shader %s has too many vertex inputs", name));
+			return;
+		}
+		ShaderInput *input = &inputs[input_count++];
+		input->location = variable->location;
+		input->components = components;
+		input->type = type->opcode == SPIRV_OP_TYPE_FLOAT ? ShaderInputType::Float : (type->signedness ? ShaderInputType::Int : ShaderInputType::Uint);
+	}
+
+	// NOTE: in words including the opcode, the fewest the operands parse reads need. Anything not listed isn't read.
+	static u32 minimumLength(u32 opcode) {
+		switch(opcode) {
+			case SPIRV_OP_TYPE_BOOL:
+			case SPIRV_OP_TYPE_SAMPLER:
+			case SPIRV_OP_TYPE_STRUCT: return 2;
+			case SPIRV_OP_DECORATE:
+			case SPIRV_OP_TYPE_FLOAT:
+			case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+			case SPIRV_OP_TYPE_RUNTIME_ARRAY: return 3;
+			case SPIRV_OP_ENTRY_POINT:
+			case SPIRV_OP_TYPE_INT:
+			case SPIRV_OP_TYPE_VECTOR:
+			case SPIRV_OP_TYPE_MATRIX:
+			case SPIRV_OP_TYPE_ARRAY:
+			case SPIRV_OP_TYPE_POINTER:
+			case SPIRV_OP_CONSTANT:
+			case SPIRV_OP_VARIABLE: return 4;
+			case SPIRV_OP_TYPE_IMAGE: return 9;
+			default: return 1;
+		}
+	}
+
+	// NOTE: size is in bytes, a module with more than one entry point is reflected as its first one. Returns false and
+	// leaves the reflection empty if the module is broken.
+	bool parse(Platform *platform, const u32 *code, u64 size, const char *name) {
+		*this = {};
+		this->code = code;
+		word_count = (u32)(size / sizeof(u32));
+		if(word_count < 5 || code[0] != SPIRV_MAGIC || code[3] == 0) {
+			platform->error(formatString("Shader %s isn't SPIR-V", name));
+			return false;
+		}
+		id_bound = code[3];
+		ids = (SpirvId *)platform->alloc(sizeof(SpirvId) * id_bound);
+		memset(ids, 0, sizeof(SpirvId) * id_bound);
+
+		bool has_entry_point = false;
+		bool valid = true;
+		for(u32 word = 5; word < word_count;) {
+			u32 opcode = code[word] & 0xffff;
+			u32 length = code[word] >> 16;
+			if(length == 0 || word + length > word_count) {
+				platform->error(formatString("Shader %s is truncated", name));
+				valid = false;
+				break;
+			}
+			if(length < minimumLength(opcode)) {
+				platform->error(formatString("Shader %s has an instruction too short for its opcode %u", name, opcode));
+				valid = false;
+				break;
+			}
+			const u32 *operands = &code[word + 1];
+
+			switch(opcode) {
+				case SPIRV_OP_ENTRY_POINT: {
+					if(has_entry_point) break;
+					has_entry_point = true;
+					switch(operands[0]) {
+						case 0: stage = VK_SHADER_STAGE_VERTEX_BIT; break;
+						case 4: stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+						case 5: stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+						default: platform->error(formatString("Shader %s has an unsupported execution model", name));
+					}
+				} break;
+				case SPIRV_OP_DECORATE: {
+					SpirvId *target = id(platform, operands[0], name);
+					u32 literal = length > 3 ? operands[2] : 0;
+					switch(operands[1]) {
+						case SPIRV_DECORATION_BLOCK: target->block = true; break;
+						case SPIRV_DECORATION_BUFFER_BLOCK: target->buffer_block = true; break;
+						case SPIRV_DECORATION_ARRAY_STRIDE: target->array_stride = literal; break;
+						case SPIRV_DECORATION_BUILT_IN: target->built_in = true; break;
+						case SPIRV_DECORATION_LOCATION: target->location = literal; target->has_location = true; break;
+						case SPIRV_DECORATION_BINDING: target->binding = literal; target->has_binding = true; break;
+						case SPIRV_DECORATION_DESCRIPTOR_SET: target->set = literal; break;
+					}
+				} break;
+				case SPIRV_OP_TYPE_BOOL:
+				case SPIRV_OP_TYPE_SAMPLER:
+				case SPIRV_OP_TYPE_STRUCT: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->first_word = word;
+				} break;
+				case SPIRV_OP_TYPE_INT:
+				case SPIRV_OP_TYPE_FLOAT: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->width = operands[1];
+					result->signedness = opcode == SPIRV_OP_TYPE_INT ? operands[2] : 1;
+				} break;
+				case SPIRV_OP_TYPE_VECTOR:
+				case SPIRV_OP_TYPE_MATRIX:
+				case SPIRV_OP_TYPE_ARRAY: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->type = operands[1];
+					result->value = operands[2];
+				} break;
+				case SPIRV_OP_TYPE_IMAGE: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->signedness = operands[2];
+					result->width = operands[6];
+				} break;
+				case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+				case SPIRV_OP_TYPE_RUNTIME_ARRAY: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->type = operands[1];
+				} break;
+				case SPIRV_OP_TYPE_POINTER: {
+					SpirvId *result = id(platform, operands[0], name);
+					result->opcode = opcode;
+					result->value = operands[1];
+					result->type = operands[2];
+				} break;
+				case SPIRV_OP_CONSTANT: {
+					SpirvId *result = id(platform, operands[1], name);
+					result->opcode = opcode;
+					result->type = operands[0];
+					result->value = operands[2];
+				} break;
+				case SPIRV_OP_VARIABLE: {
+					SpirvId *result = id(platform, operands[1], name);
+					result->opcode = opcode;
+					result->type = operands[0];
+					result->value = operands[2];
+				} break;
+			}
+			word += length;
+		}
+		if(valid && !has_entry_point) {
+			platform->error(formatString("Shader %s has no entry point", name));
+			valid = false;
+		}
+		if(!valid) {
+			platform->free(ids);
+			*this = {};
+			return false;
+		}
+
+		// NOTE: decorations can come before the ids they decorate, so the variables are only read once every id is known
+		for(u32 i = 0; i < id_bound; i++) {
+			SpirvId *variable = &ids[i];
+			if(variable->opcode != SPIRV_OP_VARIABLE) continue;
+
+			switch(variable->value) {
+				case SPIRV_STORAGE_UNIFORM_CONSTANT:
+				case SPIRV_STORAGE_UNIFORM:
+				case SPIRV_STORAGE_STORAGE_BUFFER: {
+					if(variable->has_binding) addBinding(platform, variable, name);
+				} break;
+				case SPIRV_STORAGE_PUSH_CONSTANT: {
+					push_constants.stageFlags = stage;
+					push_constants.offset = 0;
+					push_constants.size = typeSize(platform, id(platform, variable->type, name)->type, 0, name);
+				} break;
+				case SPIRV_STORAGE_INPUT: {
+					if(stage == VK_SHADER_STAGE_VERTEX_BIT && variable->has_location && !variable->built_in) addInput(platform, variable, name);
+				} break;
+			}
+		}
+
+		platform->free(ids);
+		ids = 0;
+		this->code = 0;
+		return true;
+	}
+
+	// NOTE: picks the attributes the shader reads out of everything the vertex layout provides, the layout decides the
+	// formats since quantized ones never match the shader's types, only their kind of number has to agree
+	u32 vertexAttributes(Platform *platform, const VkVertexInputAttributeDescription *layout_attributes, u32 layout_attribute_count, VkVertexInputAttributeDescription *out, const char *name) {
+		u32 result = 0;
+		for(u32 i = 0; i < input_count; i++) {
+			ShaderInput *input = &inputs[i];
+			const VkVertexInputAttributeDescription *attribute = 0;
+			for(u32 a = 0; a < layout_attribute_count; a++) {
+				if(layout_attributes[a].location == input->location) attribute = &layout_attributes[a];
+			}
+			if(attribute == 0) {
+				platform->error(formatString("Shader %s reads vertex input location %u that the vertex layout doesn't provide", name, input->location));
+				continue;
+			}
+			if(formatInputType(attribute->format) != input->type) {
+				platform->error(formatString("Shader %s reads vertex input location %u as a different kind of number than the vertex layout stores", name, input->location));
+			}
+			out[result++] = *attribute;
+		}
+		return result;
+	}
+
+	static ShaderInputType formatInputType(VkFormat format) {
+		switch(format) {
+			case VK_FORMAT_R8_SINT: case VK_FORMAT_R8G8_SINT: case VK_FORMAT_R8G8B8A8_SINT:
+			case VK_FORMAT_R16_SINT: case VK_FORMAT_R16G16_SINT: case VK_FORMAT_R16G16B16A16_SINT:
+			case VK_FORMAT_R32_SINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32A32_SINT:
+				return ShaderInputType::Int;
+			case VK_FORMAT_R8_UINT: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8B8A8_UINT:
+			case VK_FORMAT_R16_UINT: case VK_FORMAT_R16G16_UINT: case VK_FORMAT_R16G16B16A16_UINT:
+			case VK_FORMAT_R32_UINT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32A32_UINT:
+			case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+				return ShaderInputType::Uint;
+			default:
+				return ShaderInputType::Float;
+		}
+	}
+};
+
+// NOTE: the bindings and push constants of every shader that shares a pipeline layout, merged so descriptor sets
+// allocated from it can be bound to any of their pipelines
+struct ShaderInterface {
+	ShaderBinding bindings[SHADER_MAX_SETS * SHADER_MAX_BINDINGS];
+	u32 binding_count;
+	VkPushConstantRange push_constants; // NOTE: one range over every stage's block, pushes use all of its stages
+	u32 set_count; // NOTE: one past the highest set used, sets in between get empty layouts
+
+	ShaderBinding *find(u32 set, u32 binding) {
+		for(u32 i = 0; i < binding_count; i++) {
+			if(bindings[i].set == set && bindings[i].binding == binding) return &bindings[i];
+		}
+		return 0;
+	}
+
+	void add(Platform *platform, ShaderReflection *reflection, const char *name) {
+		for(u32 i = 0; i < reflection->binding_count; i++) {
+			ShaderBinding *binding = &reflection->bindings[i];
+			ShaderBinding *existing = find(binding->set, binding->binding);
+			if(existing) {
+				if(existing->type != binding->type || existing->count != binding->count) {
+					platform->error(formatString("Shader %s declares set %u binding %u differently from the shaders sharing its layout", name, binding->set, binding->binding));
+				}
+				existing->stages |= binding->stages;
+				continue;
+			}
+			if(binding->set >= SHADER_MAX_SETS) continue; // NOTE: reported when the module was reflected
+			u32 set_bindings = 0;
+			for(u32 b = 0; b < binding_count; b++) {
+				if(bindings[b].set == binding->set) set_bindings++;
+			}
+			if(set_bindings == SHADER_MAX_BINDINGS) {
+				platform->error(formatString("Too many bindings in set %u of one shader interface", binding->set));
+				continue;
+			}
+			bindings[binding_count++] = *binding;
+			if(binding->set + 1 > set_count) set_count = binding->set + 1;
+		}
+
+		VkPushConstantRange *range = &reflection->push_constants;
+		if(range->size > 0) {
+			if(push_constants.size == 0) {
+				push_constants = *range;
+			} else {
+				u32 end = push_constants.offset + push_constants.size;
+				if(range->offset + range->size > end) end = range->offset + range->size;
+				if(range->offset < push_constants.offset) push_constants.offset = range->offset;
+				push_constants.size = end - push_constants.offset;
+				push_constants.stageFlags |= range->stageFlags;
+			}
+		}
+	}
+
+	// NOTE: SPIR-V can't tell a dynamic buffer from a plain one, that's down to how the renderer binds it
+	void makeDynamic(Platform *platform, u32 set, u32 binding) {
+		ShaderBinding *existing = find(set, binding);
+		if(existing && existing->type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) existing->type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		else if(existing && existing->type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) existing->type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		else platform->error(formatString("No buffer at set %u binding %u to make dynamic", set, binding));
+	}
+
+	bool hasRuntimeArray(u32 set) {
+		for(u32 i = 0; i < binding_count; i++) {
+			if(bindings[i].set == set && bindings[i].count == 0) return true;
+		}
+		return false;
+	}
+
+	// NOTE: sorted by binding so identical sets compare equal whatever order the shaders declared them in
+	u32 setBindings(u32 set, VkDescriptorSetLayoutBinding *out) {
+		u32 count = 0;
+		for(u32 i = 0; i < binding_count; i++) {
+			if(bindings[i].set != set) continue;
+			VkDescriptorSetLayoutBinding binding = {};
+			binding.binding = bindings[i].binding;
+			binding.descriptorType = bindings[i].type;
+			binding.descriptorCount = bindings[i].count;
+			binding.stageFlags = bindings[i].stages;
+
+			u32 at = count++;
+			while(at > 0 && out[at - 1].binding > binding.binding) {
+				out[at] = out[at - 1];
+				at--;
+			}
+			out[at] = binding;
+		}
+		return count;
+	}
+
+	// NOTE: enough for sets_to_allocate copies of the set
+	u32 poolSizes(u32 set, u32 sets_to_allocate, VkDescriptorPoolSize *out) {
+		u32 count = 0;
+		for(u32 i = 0; i < binding_count; i++) {
+			if(bindings[i].set != set) continue;
+			u32 p = 0;
+			while(p < count && out[p].type != bindings[i].type) p++;
+			if(p == count) {
+				out[count] = {};
+				out[count++].type = bindings[i].type;
+			}
+			out[p].descriptorCount += bindings[i].count * sets_to_allocate;
+		}
+		return count;
+	}
+};
+
+struct CachedSetLayout {
+	VkDescriptorSetLayoutBinding bindings[SHADER_MAX_BINDINGS];
+	u32 binding_count;
+	VkDescriptorSetLayout layout;
+};
+
+struct CachedPipelineLayout {
+	VkDescriptorSetLayout set_layouts[SHADER_MAX_SETS];
+	u32 set_count;
+	VkPushConstantRange push_constants;
+	VkPipelineLayout layout;
+};
+
+// NOTE: hands out one set layout per distinct set of bindings and one pipeline layout per distinct combination of
+// set layouts and push constants, so pipelines built from shaders with the same interface share their layouts and
+// recreating a pipeline reuses the layout it had. Owns everything it created until destroy.
+struct PipelineLayoutCache {
+	VkDevice device;
+	CachedSetLayout set_layouts[LAYOUT_CACHE_MAX_SET_LAYOUTS];
+	u32 set_layout_count;
+	CachedPipelineLayout pipeline_layouts[LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS];
+	u32 pipeline_layout_count;
+
+	void init(VkDevice device) {
+		this->device = device;
+		set_layout_count = 0;
+		pipeline_layout_count = 0;
+	}
+
+	VkDescriptorSetLayout setLayout(Platform *platform, ShaderInterface *shader_interface, u32 set) {
+		if(shader_interface->hasRuntimeArray(set)) {
+			platform->error(formatString("Set %u holds a runtime array, its layout has to be passed in by the table that owns it", set));
+		}
+		VkDescriptorSetLayoutBinding bindings[SHADER_MAX_BINDINGS];
+		u32 binding_count = shader_interface->setBindings(set, bindings);
+
+		for(u32 i = 0; i < set_layout_count; i++) {
+			CachedSetLayout *cached = &set_layouts[i];
+			if(cached->binding_count != binding_count) continue;
+			bool same = true;
+			for(u32 b = 0; b < binding_count && same; b++) {
+				same = cached->bindings[b].binding == bindings[b].binding && cached->bindings[b].descriptorType == bindings[b].descriptorType &&
+					cached->bindings[b].descriptorCount == bindings[b].descriptorCount && cached->bindings[b].stageFlags == bindings[b].stageFlags;
+			}
+			if(same) return cached->layout;
+		}
+
+		if(set_layout_count == LAYOUT_CACHE_MAX_SET_LAYOUTS) {
+			platform->error("Too many descriptor set layouts");
+			return VK_NULL_HANDLE;
+		}
+		CachedSetLayout *cached = &set_layouts[set_layout_count];
+		memcpy(cached->bindings, bindings, sizeof(VkDescriptorSetLayoutBinding) * binding_count);
+		cached->binding_count = binding_count;
+
+		VkDescriptorSetLayoutCreateInfo layout_info = {};
+		layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_info.bindingCount = binding_count;
+		layout_info.pBindings = cached->bindings;
+		if(vkCreateDescriptorSetLayout(device, &layout_info, 0, &cached->layout) != VK_SUCCESS) {
+			platform->error("Couldn't create descriptor set layout");
+		}
+		set_layout_count++;
+		return cached->layout;
+	}
+
+	// NOTE: external_sets can be 0, a non null entry is used for that set instead of one built from the bindings
+	VkPipelineLayout pipelineLayout(Platform *platform, ShaderInterface *shader_interface, const VkDescriptorSetLayout *external_sets) {
+		VkDescriptorSetLayout layouts[SHADER_MAX_SETS] = {};
+		u32 set_count = shader_interface->set_count < SHADER_MAX_SETS ? shader_interface->set_count : SHADER_MAX_SETS;
+		for(u32 s = 0; s < set_count; s++) {
+			layouts[s] = (external_sets && external_sets[s]) ? external_sets[s] : setLayout(platform, shader_interface, s);
+		}
+		VkPushConstantRange push_constants = shader_interface->push_constants;
+
+		for(u32 i = 0; i < pipeline_layout_count; i++) {
+			CachedPipelineLayout *cached = &pipeline_layouts[i];
+			if(cached->set_count != set_count || cached->push_constants.size != push_constants.size) continue;
+			if(push_constants.size > 0 && (cached->push_constants.offset != push_constants.offset || cached->push_constants.stageFlags != push_constants.stageFlags)) continue;
+			if(memcmp(cached->set_layouts, layouts, sizeof(VkDescriptorSetLayout) * cached->set_count) == 0) return cached->layout;
+		}
+
+		if(pipeline_layout_count == LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS) {
+			platform->error("Too many pipeline layouts");
+			return VK_NULL_HANDLE;
+		}
+		CachedPipelineLayout *cached = &pipeline_layouts[pipeline_layout_count];
+		memcpy(cached->set_layouts, layouts, sizeof(layouts));
+		cached->set_count = set_count;
+		cached->push_constants = push_constants;
+
+		VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+		pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.setLayoutCount = cached->set_count;
+		pipeline_layout_info.pSetLayouts = cached->set_layouts;
+		pipeline_layout_info.pushConstantRangeCount = push_constants.size > 0 ? 1 : 0;
+		pipeline_layout_info.pPushConstantRanges = push_constants.size > 0 ? &cached->push_constants : 0;
+		if(vkCreatePipelineLayout(device, &pipeline_layout_info, 0, &cached->layout) != VK_SUCCESS) {
+			platform->error("Couldn't create pipeline layout");
+		}
+		pipeline_layout_count++;
+		return cached->layout;
+	}
+
+	void destroy() {
+		for(u32 i = 0; i < pipeline_layout_count; i++) {
+			vkDestroyPipelineLayout(device, pipeline_layouts[i].layout, 0);
+		}
+		for(u32 i = 0; i < set_layout_count; i++) {
+			vkDestroyDescriptorSetLayout(device, set_layouts[i].layout, 0);
+		}
+		pipeline_layout_count = 0;
+		set_layout_count = 0;
+	}
+};
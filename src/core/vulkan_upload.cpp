@@ -0,0 +1,507 @@
+#define UPLOAD_STAGING_SIZE Megabytes(32)
+#define UPLOAD_BATCH_COUNT 4
+#define MAX_UPLOAD_TEMP_BUFFERS 8
+
+// NOTE: staging memory for uploads that don't fit in the ring, freed when the batch retires
+struct UploadTempBuffer {
+	VkBuffer buffer;
+	GpuAllocation allocation;
+};
+
+struct UploadBatch {
+	u64 id;
+	VkCommandBuffer transfer_command_buffer;
+	VkCommandBuffer acquire_command_buffer;
+	VkFence transfer_fence;
+	VkFence acquire_fence;
+	VkSemaphore transfer_done;
+	u64 ring_end;
+	UploadTempBuffer temp_buffers[MAX_UPLOAD_TEMP_BUFFERS];
+	u32 temp_buffer_count;
+	u32 upload_count;
+	bool recording;
+	bool in_flight;
+	bool acquire_submitted;
+};
+
+// NOTE: Copies are recorded into a batch on the transfer queue and submitted without waiting. When the transfer
+// family differs from the graphics family every resource is released by the transfer queue and acquired by the
+// graphics queue, the acquire barriers are submitted on the graphics queue behind a semaphore so the frame that
+// follows sees the data without the cpu ever blocking on the copy.
+struct UploadManager {
+	VkDevice device;
+	GpuMemoryAllocator *gpu_memory;
+	VkQueue transfer_queue;
+	VkQueue graphics_queue;
+	u32 transfer_family;
+	u32 graphics_family;
+	bool dedicated_transfer;
+
+	VkCommandPool transfer_command_pool;
+	VkCommandPool acquire_command_pool;
+
+	VkBuffer staging_buffer;
+	GpuAllocation staging_allocation;
+	u8 *staging_mapped;
+	u64 ring_head;
+	u64 ring_tail;
+
+	UploadBatch batches[UPLOAD_BATCH_COUNT];
+	s32 open_batch;
+	u32 next_slot;
+	u64 next_batch_id;
+	u64 completed_batch_id;
+
+	// NOTE: optional gpu timing of each batch, two timestamps per batch slot reported to the profiler as "uploads"
+	GpuProfiler *profiler;
+	VkQueryPool query_pool;
+	u64 timestamp_mask;
+	PFN_vkResetQueryPoolEXT host_reset_query_pool;
+
+	void init(Platform *platform, VkDevice device, GpuMemoryAllocator *gpu_memory, VkQueue transfer_queue, u32 transfer_family, VkQueue graphics_queue, u32 graphics_family) {
+		this->device = device;
+		this->gpu_memory = gpu_memory;
+		this->transfer_queue = transfer_queue;
+		this->transfer_family = transfer_family;
+		this->graphics_queue = graphics_queue;
+		this->graphics_family = graphics_family;
+		dedicated_transfer = transfer_family != graphics_family;
+
+		VkCommandPoolCreateInfo pool_create_info = {};
+		pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		pool_create_info.queueFamilyIndex = transfer_family;
+		if(vkCreateCommandPool(device, &pool_create_info, 0, &transfer_command_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create upload command pool");
+		}
+
+		pool_create_info.queueFamilyIndex = graphics_family;
+		if(vkCreateCommandPool(device, &pool_create_info, 0, &acquire_command_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create upload command pool");
+		}
+
+		VkBufferCreateInfo buffer_create_info = {};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = UPLOAD_STAGING_SIZE;
+		buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if(vkCreateBuffer(device, &buffer_create_info, 0, &staging_buffer) != VK_SUCCESS) {
+			platform->error("Couldn't create upload staging buffer");
+		}
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(device, staging_buffer, &memory_requirements);
+		staging_allocation = gpu_memory->allocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if(staging_allocation.memory == VK_NULL_HANDLE || staging_allocation.mapped == 0) {
+			platform->error("Couldn't allocate upload staging memory");
+		}
+		vkBindBufferMemory(device, staging_buffer, staging_allocation.memory, staging_allocation.offset);
+		staging_mapped = (u8 *)staging_allocation.mapped;
+		ring_head = 0;
+		ring_tail = 0;
+
+		VkFenceCreateInfo fence_create_info = {};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VkSemaphoreCreateInfo semaphore_create_info = {};
+		semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		for(u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+			UploadBatch *batch = &batches[i];
+			*batch = {};
+
+			VkCommandBufferAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			alloc_info.commandBufferCount = 1;
+			alloc_info.commandPool = transfer_command_pool;
+			VkResult first_result = vkAllocateCommandBuffers(device, &alloc_info, &batch->transfer_command_buffer);
+			alloc_info.commandPool = acquire_command_pool;
+			VkResult second_result = vkAllocateCommandBuffers(device, &alloc_info, &batch->acquire_command_buffer);
+
+			VkResult third_result = vkCreateFence(device, &fence_create_info, 0, &batch->transfer_fence);
+			VkResult fourth_result = vkCreateFence(device, &fence_create_info, 0, &batch->acquire_fence);
+			VkResult fifth_result = vkCreateSemaphore(device, &semaphore_create_info, 0, &batch->transfer_done);
+			if(first_result != VK_SUCCESS || second_result != VK_SUCCESS || third_result != VK_SUCCESS || fourth_result != VK_SUCCESS || fifth_result != VK_SUCCESS) {
+				platform->error("Couldn't create upload batch");
+			}
+		}
+
+		profiler = 0;
+		query_pool = VK_NULL_HANDLE;
+		host_reset_query_pool = 0;
+
+		open_batch = -1;
+		next_slot = 0;
+		next_batch_id = 1;
+		completed_batch_id = 0;
+
+		printf("Uploading on %s queue family %u\n", dedicated_transfer ? "dedicated transfer" : "graphics", transfer_family);
+	}
+
+	// NOTE: queries can only be reset in a command buffer on a graphics or compute family, a transfer only family needs host reset
+	void enableTiming(Platform *platform, VkPhysicalDevice physical_device, GpuProfiler *profiler, PFN_vkResetQueryPoolEXT host_reset_query_pool) {
+		u32 valid_bits = GpuProfiler::queueTimestampBits(platform, physical_device, transfer_family);
+		if(!profiler->enabled || valid_bits == 0 || (dedicated_transfer && host_reset_query_pool == 0)) {
+			printf("Upload timing disabled\n");
+			return;
+		}
+
+		VkQueryPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		pool_info.queryCount = UPLOAD_BATCH_COUNT * 2;
+		if(vkCreateQueryPool(device, &pool_info, 0, &query_pool) != VK_SUCCESS) {
+			platform->error("Couldn't create upload query pool");
+		}
+
+		this->profiler = profiler;
+		this->host_reset_query_pool = dedicated_transfer ? host_reset_query_pool : 0;
+		timestamp_mask = GpuProfiler::timestampMask(valid_bits);
+		if(this->host_reset_query_pool) this->host_reset_query_pool(device, query_pool, 0, UPLOAD_BATCH_COUNT * 2);
+	}
+
+	u32 batchSlot(UploadBatch *batch) {
+		return (u32)(batch - batches);
+	}
+
+	void retireBatch(UploadBatch *batch) {
+		if(profiler) {
+			u64 timestamps[2];
+			u32 first_query = batchSlot(batch) * 2;
+			if(vkGetQueryPoolResults(device, query_pool, first_query, 2, sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				profiler->addSample("uploads", profiler->ticksToMilliseconds(timestamps[0], timestamps[1], timestamp_mask));
+			}
+			if(host_reset_query_pool) host_reset_query_pool(device, query_pool, first_query, 2);
+		}
+
+		for(u32 i = 0; i < batch->temp_buffer_count; i++) {
+			vkDestroyBuffer(device, batch->temp_buffers[i].buffer, 0);
+			gpu_memory->free(&batch->temp_buffers[i].allocation);
+		}
+		batch->temp_buffer_count = 0;
+		batch->in_flight = false;
+
+		ring_tail = batch->ring_end;
+		completed_batch_id = batch->id;
+	}
+
+	void submitAcquire(UploadBatch *batch) {
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &batch->transfer_done;
+		submit_info.pWaitDstStageMask = &wait_stage;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &batch->acquire_command_buffer;
+
+		vkQueueSubmit(graphics_queue, 1, &submit_info, batch->acquire_fence);
+		batch->acquire_submitted = true;
+	}
+
+	void waitBatch(UploadBatch *batch) {
+		if(!batch->in_flight) return;
+
+		if(dedicated_transfer) {
+			if(!batch->acquire_submitted) submitAcquire(batch);
+			vkWaitForFences(device, 1, &batch->acquire_fence, VK_TRUE, UINT64_MAX);
+		}
+		vkWaitForFences(device, 1, &batch->transfer_fence, VK_TRUE, UINT64_MAX);
+		retireBatch(batch);
+	}
+
+	UploadBatch *oldestInFlight() {
+		UploadBatch *result = 0;
+		for(u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+			UploadBatch *batch = &batches[i];
+			if(batch->in_flight && (result == 0 || batch->id < result->id)) result = batch;
+		}
+		return result;
+	}
+
+	UploadBatch *beginBatch() {
+		if(open_batch >= 0) return &batches[open_batch];
+
+		UploadBatch *batch = &batches[next_slot];
+		waitBatch(batch);
+
+		vkResetFences(device, 1, &batch->transfer_fence);
+		vkResetFences(device, 1, &batch->acquire_fence);
+		vkResetCommandBuffer(batch->transfer_command_buffer, 0);
+		vkResetCommandBuffer(batch->acquire_command_buffer, 0);
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(batch->transfer_command_buffer, &begin_info);
+		if(dedicated_transfer) {
+			vkBeginCommandBuffer(batch->acquire_command_buffer, &begin_info);
+		}
+
+		if(profiler) {
+			u32 first_query = next_slot * 2;
+			if(host_reset_query_pool == 0) vkCmdResetQueryPool(batch->transfer_command_buffer, query_pool, first_query, 2);
+			vkCmdWriteTimestamp(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, first_query);
+		}
+
+		batch->id = next_batch_id++;
+		batch->upload_count = 0;
+		batch->recording = true;
+		batch->acquire_submitted = false;
+
+		open_batch = (s32)next_slot;
+		next_slot = (next_slot + 1) % UPLOAD_BATCH_COUNT;
+		return batch;
+	}
+
+	// NOTE: submits the open batch, returns its id or the last submitted id if nothing was recorded
+	u64 flush() {
+		if(open_batch < 0) return next_batch_id - 1;
+
+		UploadBatch *batch = &batches[open_batch];
+		open_batch = -1;
+
+		if(profiler) {
+			vkCmdWriteTimestamp(batch->transfer_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, batchSlot(batch) * 2 + 1);
+		}
+		vkEndCommandBuffer(batch->transfer_command_buffer);
+		if(dedicated_transfer) {
+			vkEndCommandBuffer(batch->acquire_command_buffer);
+		}
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &batch->transfer_command_buffer;
+		if(dedicated_transfer) {
+			submit_info.signalSemaphoreCount = 1;
+			submit_info.pSignalSemaphores = &batch->transfer_done;
+		}
+
+		vkQueueSubmit(transfer_queue, 1, &submit_info, batch->transfer_fence);
+
+		batch->ring_end = ring_head;
+		batch->recording = false;
+		batch->in_flight = true;
+		return batch->id;
+	}
+
+	// NOTE: hands the graphics queue the ownership acquires for everything flushed so far, call before submitting work that uses the uploads
+	void submitPendingAcquires() {
+		if(!dedicated_transfer) return;
+
+		for(u64 id = completed_batch_id + 1; id < next_batch_id; id++) {
+			for(u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+				UploadBatch *batch = &batches[i];
+				if(batch->id == id && batch->in_flight && !batch->acquire_submitted) {
+					submitAcquire(batch);
+				}
+			}
+		}
+	}
+
+	// NOTE: retires every batch the gpu has finished with, never blocks
+	void update() {
+		while(UploadBatch *batch = oldestInFlight()) {
+			if(vkGetFenceStatus(device, batch->transfer_fence) != VK_SUCCESS) break;
+			if(dedicated_transfer && (!batch->acquire_submitted || vkGetFenceStatus(device, batch->acquire_fence) != VK_SUCCESS)) break;
+			retireBatch(batch);
+		}
+	}
+
+	bool isComplete(u64 id) {
+		return id <= completed_batch_id;
+	}
+
+	void wait(u64 id) {
+		if(open_batch >= 0 && batches[open_batch].id <= id) flush();
+
+		while(!isComplete(id)) {
+			UploadBatch *batch = oldestInFlight();
+			if(batch == 0) break;
+			waitBatch(batch);
+		}
+	}
+
+	// NOTE: returns a pointer into staging memory and the buffer/offset to copy from, data must be written before the next flush
+	u8 *allocateStaging(Platform *platform, VkDeviceSize size, VkDeviceSize alignment, VkBuffer *src_buffer, VkDeviceSize *src_offset) {
+		if(size > UPLOAD_STAGING_SIZE / 2) {
+			UploadBatch *batch = beginBatch();
+			if(batch->temp_buffer_count == MAX_UPLOAD_TEMP_BUFFERS) {
+				flush();
+				batch = beginBatch();
+			}
+
+			UploadTempBuffer *temp = &batch->temp_buffers[batch->temp_buffer_count++];
+
+			VkBufferCreateInfo buffer_create_info = {};
+			buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			buffer_create_info.size = size;
+			buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if(vkCreateBuffer(device, &buffer_create_info, 0, &temp->buffer) != VK_SUCCESS) {
+				platform->error("Couldn't create upload staging buffer");
+			}
+
+			VkMemoryRequirements memory_requirements;
+			vkGetBufferMemoryRequirements(device, temp->buffer, &memory_requirements);
+			temp->allocation = gpu_memory->allocate(memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, GpuAllocationStrategy::Linear);
+			if(temp->allocation.memory == VK_NULL_HANDLE || temp->allocation.mapped == 0) {
+				platform->error("Couldn't allocate upload staging memory");
+			}
+			vkBindBufferMemory(device, temp->buffer, temp->allocation.memory, temp->allocation.offset);
+
+			*src_buffer = temp->buffer;
+			*src_offset = 0;
+			return (u8 *)temp->allocation.mapped;
+		}
+
+		while(true) {
+			u64 offset = AlignUp(ring_head, alignment);
+			u64 ring_offset = offset % UPLOAD_STAGING_SIZE;
+			if(ring_offset + size > UPLOAD_STAGING_SIZE) {
+				offset += UPLOAD_STAGING_SIZE - ring_offset;
+				ring_offset = 0;
+			}
+
+			if(offset + size - ring_tail <= UPLOAD_STAGING_SIZE) {
+				ring_head = offset + size;
+				*src_buffer = staging_buffer;
+				*src_offset = ring_offset;
+				return staging_mapped + ring_offset;
+			}
+
+			// NOTE: ring is full, the only way forward is to wait for the oldest copies to finish
+			UploadBatch *oldest = oldestInFlight();
+			if(oldest) {
+				waitBatch(oldest);
+			} else if(open_batch >= 0) {
+				flush();
+			} else {
+				ring_tail = ring_head;
+			}
+		}
+	}
+
+	u64 uploadBuffer(Platform *platform, VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+		VkBuffer src_buffer;
+		VkDeviceSize src_offset;
+		u8 *staging = allocateStaging(platform, size, 16, &src_buffer, &src_offset);
+		memcpy(staging, data, (size_t)size);
+
+		UploadBatch *batch = beginBatch();
+		batch->upload_count++;
+
+		VkBufferCopy copy_region = {};
+		copy_region.srcOffset = src_offset;
+		copy_region.dstOffset = dst_offset;
+		copy_region.size = size;
+		vkCmdCopyBuffer(batch->transfer_command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.buffer = dst_buffer;
+		barrier.offset = dst_offset;
+		barrier.size = size;
+
+		if(dedicated_transfer) {
+			barrier.srcQueueFamilyIndex = transfer_family;
+			barrier.dstQueueFamilyIndex = graphics_family;
+			barrier.dstAccessMask = 0;
+			vkCmdPipelineBarrier(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0, 1, &barrier, 0, 0);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(batch->acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dst_stage, 0, 0, 0, 1, &barrier, 0, 0);
+		} else {
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage, 0, 0, 0, 1, &barrier, 0, 0);
+		}
+
+		return batch->id;
+	}
+
+	// NOTE: uploads the first level_count mips of a colour image with mip_levels levels and leaves every level in final_layout.
+	// level_offsets gives where each level starts in data, null means data only holds level 0. The image must be in VK_IMAGE_LAYOUT_UNDEFINED
+	u64 uploadImage(Platform *platform, VkImage image, u32 width, u32 height, u32 mip_levels, u32 level_count, const VkDeviceSize *level_offsets, const void *data, VkDeviceSize size, VkImageLayout final_layout, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+		VkBuffer src_buffer;
+		VkDeviceSize src_offset;
+		u8 *staging = allocateStaging(platform, size, 16, &src_buffer, &src_offset);
+		memcpy(staging, data, (size_t)size);
+
+		UploadBatch *batch = beginBatch();
+		batch->upload_count++;
+
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mip_levels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+		for(u32 level = 0; level < level_count; level++) {
+			VkBufferImageCopy region = {};
+			region.bufferOffset = src_offset + (level_offsets ? level_offsets[level] : 0);
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = {width >> level > 0 ? width >> level : 1, height >> level > 0 ? height >> level : 1, 1};
+			vkCmdCopyBufferToImage(batch->transfer_command_buffer, src_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+
+		// NOTE: the layout change rides along with the ownership transfer, both halves must describe it identically
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = final_layout;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		if(dedicated_transfer) {
+			barrier.srcQueueFamilyIndex = transfer_family;
+			barrier.dstQueueFamilyIndex = graphics_family;
+			barrier.dstAccessMask = 0;
+			vkCmdPipelineBarrier(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(batch->acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dst_stage, 0, 0, 0, 0, 0, 1, &barrier);
+		} else {
+			barrier.dstAccessMask = dst_access;
+			vkCmdPipelineBarrier(batch->transfer_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage, 0, 0, 0, 0, 0, 1, &barrier);
+		}
+
+		return batch->id;
+	}
+
+	void destroy() {
+		wait(next_batch_id - 1);
+
+		for(u32 i = 0; i < UPLOAD_BATCH_COUNT; i++) {
+			UploadBatch *batch = &batches[i];
+			vkDestroyFence(device, batch->transfer_fence, 0);
+			vkDestroyFence(device, batch->acquire_fence, 0);
+			vkDestroySemaphore(device, batch->transfer_done, 0);
+		}
+
+		if(query_pool != VK_NULL_HANDLE) vkDestroyQueryPool(device, query_pool, 0);
+		vkDestroyCommandPool(device, transfer_command_pool, 0);
+		vkDestroyCommandPool(device, acquire_command_pool, 0);
+
+		vkDestroyBuffer(device, staging_buffer, 0);
+		gpu_memory->free(&staging_allocation);
+	}
+};
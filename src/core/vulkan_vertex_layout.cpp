@@ -0,0 +1,236 @@
+// NOTE: the source vertex as loaded, meshes are packed into a VertexLayout before they're uploaded
+struct Vertex {
+	Vec3 pos;
+	Vec3 color;
+	Vec2 uv;
+	Vec3 normal;
+};
+
+enum class VertexPositionFormat {
+	Float32,
+	Snorm16, // NOTE: relative to the mesh bounds, the shader undoes it with the ubo's position_scale and position_offset
+};
+
+// NOTE: normals are octahedral encoded into two components either way, this only picks their precision
+enum class VertexNormalFormat {
+	Float32,
+	Snorm16,
+};
+
+enum class VertexUvFormat {
+	Float32,
+	Half,
+};
+
+// NOTE: how a mesh is stored on the gpu, binding 0 interleaves position, normal and uv and binding 1 is the color
+// stream. Without a color stream binding 1 has a stride of 0 and every vertex reads the same white texel, so the
+// shaders are the same either way.
+struct VertexLayout {
+	VertexPositionFormat position_format;
+	VertexNormalFormat normal_format;
+	VertexUvFormat uv_format;
+	bool color_stream;
+
+	u32 position_offset;
+	u32 normal_offset;
+	u32 uv_offset;
+	u32 stride;
+	u32 color_stride;
+
+	static VertexLayout make(VertexPositionFormat position_format, VertexNormalFormat normal_format, VertexUvFormat uv_format, bool color_stream) {
+		VertexLayout result = {};
+		result.position_format = position_format;
+		result.normal_format = normal_format;
+		result.uv_format = uv_format;
+		result.color_stream = color_stream;
+
+		// NOTE: 16 bit positions take 4 components, three component 16 bit formats aren't required for vertex buffers
+		result.position_offset = 0;
+		result.normal_offset = result.position_offset + (position_format == VertexPositionFormat::Float32 ? 12 : 8);
+		result.uv_offset = result.normal_offset + (normal_format == VertexNormalFormat::Float32 ? 8 : 4);
+		result.stride = result.uv_offset + (uv_format == VertexUvFormat::Float32 ? 8 : 4);
+		result.color_stride = color_stream ? sizeof(u32) : 0;
+		return result;
+	}
+
+	// NOTE: 28 bytes a vertex, what the meshes used before they were quantized
+	static VertexLayout full(bool color_stream) {
+		return make(VertexPositionFormat::Float32, VertexNormalFormat::Float32, VertexUvFormat::Float32, color_stream);
+	}
+
+	// NOTE: 16 bytes a vertex
+	static VertexLayout compact(bool color_stream) {
+		return make(VertexPositionFormat::Snorm16, VertexNormalFormat::Snorm16, VertexUvFormat::Half, color_stream);
+	}
+
+	u32 bindingDescriptions(VkVertexInputBindingDescription *out) {
+		out[0] = {};
+		out[0].binding = 0;
+		out[0].stride = stride;
+		out[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		out[1] = {};
+		out[1].binding = 1;
+		out[1].stride = color_stride;
+		out[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return 2;
+	}
+
+	// NOTE: locations match the vertex shaders, 0 position, 1 color, 2 uv, 3 octahedral normal
+	u32 attributeDescriptions(VkVertexInputAttributeDescription *out) {
+		out[0] = {};
+		out[0].binding = 0;
+		out[0].location = 0;
+		out[0].format = position_format == VertexPositionFormat::Float32 ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R16G16B16A16_SNORM;
+		out[0].offset = position_offset;
+
+		out[1] = {};
+		out[1].binding = 1;
+		out[1].location = 1;
+		out[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		out[1].offset = 0;
+
+		out[2] = {};
+		out[2].binding = 0;
+		out[2].location = 2;
+		out[2].format = uv_format == VertexUvFormat::Float32 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R16G16_SFLOAT;
+		out[2].offset = uv_offset;
+
+		out[3] = {};
+		out[3].binding = 0;
+		out[3].location = 3;
+		out[3].format = normal_format == VertexNormalFormat::Float32 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R16G16_SNORM;
+		out[3].offset = normal_offset;
+		return 4;
+	}
+
+	// NOTE: what the shader multiplies and adds to get mesh space positions back, identity for float positions
+	void positionDequantize(const Vertex *vertices, u32 vertex_count, Vec4 *scale, Vec4 *offset) {
+		*scale = Vec4(1.0f, 1.0f, 1.0f, 0.0f);
+		*offset = Vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		if(position_format == VertexPositionFormat::Float32 || vertex_count == 0) return;
+
+		Vec3 min_bound = vertices[0].pos;
+		Vec3 max_bound = vertices[0].pos;
+		for(u32 i = 1; i < vertex_count; i++) {
+			min_bound = Vec3::rmin(min_bound, vertices[i].pos);
+			max_bound = Vec3::rmax(max_bound, vertices[i].pos);
+		}
+
+		Vec3 center = (min_bound + max_bound) * 0.5f;
+		Vec3 half_extent = (max_bound - min_bound) * 0.5f;
+		// NOTE: a flat axis would divide by zero, any scale works since every vertex sits on the centre
+		if(half_extent.x <= 0.0f) half_extent.x = 1.0f;
+		if(half_extent.y <= 0.0f) half_extent.y = 1.0f;
+		if(half_extent.z <= 0.0f) half_extent.z = 1.0f;
+		*scale = Vec4(half_extent, 0.0f);
+		*offset = Vec4(center, 0.0f);
+	}
+
+	// NOTE: out needs stride * vertex_count bytes
+	void pack(const Vertex *vertices, u32 vertex_count, Vec4 scale, Vec4 offset, u8 *out) {
+		for(u32 i = 0; i < vertex_count; i++) {
+			const Vertex *vertex = &vertices[i];
+			u8 *packed = out + (u64)i * stride;
+
+			if(position_format == VertexPositionFormat::Float32) {
+				f32 *position = (f32 *)(packed + position_offset);
+				position[0] = vertex->pos.x;
+				position[1] = vertex->pos.y;
+				position[2] = vertex->pos.z;
+			} else {
+				s16 *position = (s16 *)(packed + position_offset);
+				position[0] = packSnorm16((vertex->pos.x - offset.x) / scale.x);
+				position[1] = packSnorm16((vertex->pos.y - offset.y) / scale.y);
+				position[2] = packSnorm16((vertex->pos.z - offset.z) / scale.z);
+				position[3] = 0;
+			}
+
+			Vec2 octahedral = octahedralEncode(vertex->normal);
+			if(normal_format == VertexNormalFormat::Float32) {
+				f32 *normal = (f32 *)(packed + normal_offset);
+				normal[0] = octahedral.x;
+				normal[1] = octahedral.y;
+			} else {
+				s16 *normal = (s16 *)(packed + normal_offset);
+				normal[0] = packSnorm16(octahedral.x);
+				normal[1] = packSnorm16(octahedral.y);
+			}
+
+			if(uv_format == VertexUvFormat::Float32) {
+				f32 *uv = (f32 *)(packed + uv_offset);
+				uv[0] = vertex->uv.x;
+				uv[1] = vertex->uv.y;
+			} else {
+				u16 *uv = (u16 *)(packed + uv_offset);
+				uv[0] = packHalf(vertex->uv.x);
+				uv[1] = packHalf(vertex->uv.y);
+			}
+		}
+	}
+
+	// NOTE: rgba8 per vertex, only meaningful with a color stream
+	void packColors(const Vertex *vertices, u32 vertex_count, u32 *out) {
+		for(u32 i = 0; i < vertex_count; i++) {
+			Vec3 color = vertices[i].color;
+			out[i] = (u32)packUnorm8(color.x) | ((u32)packUnorm8(color.y) << 8) | ((u32)packUnorm8(color.z) << 16) | (0xffu << 24);
+		}
+	}
+
+	static s16 packSnorm16(f32 value) {
+		if(value > 1.0f) value = 1.0f;
+		if(value < -1.0f) value = -1.0f;
+		f32 scaled = value * 32767.0f;
+		return (s16)(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+	}
+
+	static u8 packUnorm8(f32 value) {
+		if(value > 1.0f) value = 1.0f;
+		if(value < 0.0f) value = 0.0f;
+		return (u8)(value * 255.0f + 0.5f);
+	}
+
+	// NOTE: round to nearest even, overflow goes to infinity and anything below the smallest denormal flushes to zero
+	static u16 packHalf(f32 value) {
+		u32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		u32 sign = (bits >> 16) & 0x8000;
+		u32 exponent = (bits >> 23) & 0xff;
+		u32 mantissa = bits & 0x7fffff;
+
+		if(exponent == 0xff) return (u16)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+		s32 half_exponent = (s32)exponent - 127 + 15;
+		if(half_exponent >= 31) return (u16)(sign | 0x7c00);
+		if(half_exponent <= 0) {
+			if(half_exponent < -10) return (u16)sign;
+			mantissa |= 0x800000;
+			u32 shift = (u32)(14 - half_exponent);
+			u32 half_mantissa = mantissa >> shift;
+			u32 remainder = mantissa & ((1u << shift) - 1);
+			u32 halfway = 1u << (shift - 1);
+			if(remainder > halfway || (remainder == halfway && (half_mantissa & 1))) half_mantissa++;
+			return (u16)(sign | half_mantissa);
+		}
+
+		u32 result = sign | ((u32)half_exponent << 10) | (mantissa >> 13);
+		u32 remainder = mantissa & 0x1fff;
+		if(remainder > 0x1000 || (remainder == 0x1000 && (result & 1))) result++; // NOTE: carries into the exponent correctly
+		return (u16)result;
+	}
+
+	// NOTE: folds the unit sphere onto an octahedron and unwraps it into [-1, 1]^2
+	static Vec2 octahedralEncode(Vec3 normal) {
+		f32 l1 = Math::abs(normal.x) + Math::abs(normal.y) + Math::abs(normal.z);
+		if(l1 <= 0.0f) return Vec2(0.0f, 0.0f);
+		f32 x = normal.x / l1;
+		f32 y = normal.y / l1;
+		if(normal.z < 0.0f) {
+			f32 folded_x = (1.0f - Math::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			f32 folded_y = (1.0f - Math::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = folded_x;
+			y = folded_y;
+		}
+		return Vec2(x, y);
+	}
+};
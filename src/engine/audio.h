@@ -15,7 +15,6 @@ struct SoundEffect {
 		size = memory_size;
 		wav = new SoLoud::Wav();
 		wav->loadMem(mem, size, false, false);
-		printf("");
 	}
 };
 
@@ -0,0 +1,50 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#define COOKED_TEXTURE_MAGIC 0x58455450 // 'PTEX'
+#define COOKED_TEXTURE_VERSION 1
+#define COOKED_TEXTURE_MAX_LEVELS 16
+#define COOKED_TEXTURE_MAX_DIMENSION 16384
+
+enum class CookedTextureFormat : u32 {
+	BC1, // NOTE: rgb, 1 bit alpha, 8 bytes per block
+	BC3, // NOTE: rgba, 16 bytes per block
+	BC5, // NOTE: two channel, normal maps, 16 bytes per block
+	BC7, // NOTE: rgba, higher quality, 16 bytes per block
+	Count
+};
+
+// NOTE: the file is this header followed by each level's blocks, largest level first
+struct CookedTextureHeader {
+	u32 magic;
+	u32 version;
+	CookedTextureFormat format;
+	u32 width;
+	u32 height;
+	u32 level_count;
+	u64 level_offsets[COOKED_TEXTURE_MAX_LEVELS]; // NOTE: relative to the end of the header
+	u64 level_sizes[COOKED_TEXTURE_MAX_LEVELS];
+	u64 data_size;
+};
+
+inline u32 cookedTextureBlockSize(CookedTextureFormat format) {
+	return format == CookedTextureFormat::BC1 ? 8 : 16;
+}
+
+inline u64 cookedTextureLevelSize(CookedTextureFormat format, u32 width, u32 height) {
+	u64 blocks_x = (width + 3) / 4;
+	u64 blocks_y = (height + 3) / 4;
+	return blocks_x * blocks_y * cookedTextureBlockSize(format);
+}
+
+inline const char *cookedTextureFormatName(CookedTextureFormat format) {
+	switch(format) {
+		case CookedTextureFormat::BC1: return "bc1";
+		case CookedTextureFormat::BC3: return "bc3";
+		case CookedTextureFormat::BC5: return "bc5";
+		case CookedTextureFormat::BC7: return "bc7";
+		default: return "unknown";
+	}
+}
+
+#endif // COOKED_TEXTURE_H
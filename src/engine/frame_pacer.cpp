@@ -0,0 +1,166 @@
+#include <core/platform.h>
+
+#define FRAME_PACER_HISTORY 128
+
+enum class LatencyMarker {
+	InputSample,
+	Submit,
+	Present,
+	Count
+};
+
+// NOTE: a ring of the last FRAME_PACER_HISTORY samples in milliseconds
+struct FrameStat {
+	f32 history[FRAME_PACER_HISTORY];
+	u32 head;
+	u32 count;
+
+	void addSample(f32 sample) {
+		history[head] = sample;
+		head = (head + 1) % FRAME_PACER_HISTORY;
+		if(count < FRAME_PACER_HISTORY) count++;
+	}
+
+	f32 mean() {
+		if(count == 0) return 0.0f;
+		f32 total = 0.0f;
+		for(u32 i = 0; i < count; i++) total += history[i];
+		return total / (f32)count;
+	}
+
+	f32 variance() {
+		if(count < 2) return 0.0f;
+		f32 average = mean();
+		f32 total = 0.0f;
+		for(u32 i = 0; i < count; i++) {
+			f32 difference = history[i] - average;
+			total += difference * difference;
+		}
+		return total / (f32)(count - 1);
+	}
+
+	f32 max() {
+		f32 result = 0.0f;
+		for(u32 i = 0; i < count; i++) {
+			if(history[i] > result) result = history[i];
+		}
+		return result;
+	}
+};
+
+// NOTE: Paces the main loop to a fixed rate on an absolute schedule, so an early or late wake doesn't push every later
+// frame back. The wait sleeps on the platform's high resolution timer, waking early by a running estimate of how late
+// the scheduler tends to wake us, then finishes with sleeps of half the time left until the deadline has passed. Only
+// the last couple of microseconds are spun. wait_errors records where the wait really returned relative to the
+// deadline. A target of zero leaves pacing to the present mode (FIFO blocks on vblank by itself).
+// Latency markers are cpu timestamps within one frame: input sampled, command buffer submitted, present queued.
+struct FramePacer {
+	Platform *platform;
+	u64 frequency;
+	u64 period; // NOTE: in performance counter ticks, 0 when uncapped
+	u64 next_deadline;
+	u64 last_frame_start;
+	f64 wake_latency; // NOTE: seconds the timer overshoots by, smoothed
+	u64 markers[(u32)LatencyMarker::Count];
+
+	FrameStat frame_times;
+	FrameStat wait_errors; // NOTE: how far past the deadline the wait returned, negative if it returned early
+	FrameStat input_to_submit;
+	FrameStat input_to_present;
+
+	void init(Platform *platform, f32 target_rate) {
+		this->platform = platform;
+		frequency = platform->getPerformanceFrequency();
+		setTargetRate(target_rate);
+		wake_latency = 0.0;
+		last_frame_start = 0;
+		next_deadline = 0;
+		for(u32 i = 0; i < (u32)LatencyMarker::Count; i++) markers[i] = 0;
+		frame_times = {};
+		wait_errors = {};
+		input_to_submit = {};
+		input_to_present = {};
+	}
+
+	void setTargetRate(f32 target_rate) {
+		period = target_rate > 0.0f ? (u64)((f64)frequency / (f64)target_rate) : 0;
+	}
+
+	f32 ticksToMilliseconds(u64 ticks) {
+		return (f32)((f64)ticks * 1000.0 / (f64)frequency);
+	}
+
+	void waitUntil(u64 deadline) {
+		u64 now = platform->getPerformanceCounter();
+		if(now >= deadline) return;
+
+		f64 remaining = (f64)(deadline - now) / (f64)frequency - wake_latency;
+		if(remaining > 0.0) {
+			u64 requested = (u64)(remaining * 1000000.0);
+			u64 before = now;
+			platform->sleepMicroseconds(requested);
+			u64 after = platform->getPerformanceCounter();
+
+			// NOTE: only the overshoot past what was asked for, the 1/8 weight rides out the odd long wake
+			f64 overshoot = (f64)(after - before) / (f64)frequency - (f64)requested / 1000000.0;
+			if(overshoot < 0.0) overshoot = 0.0;
+			wake_latency += (overshoot - wake_latency) * 0.125;
+		}
+
+		// NOTE: the estimate usually leaves us a little early, each of these sleeps is short enough to overshoot by far less
+		now = platform->getPerformanceCounter();
+		while(now < deadline) {
+			u64 left = (deadline - now) * 1000000 / frequency;
+			platform->sleepMicroseconds(left / 2);
+			now = platform->getPerformanceCounter();
+		}
+	}
+
+	// NOTE: call at the top of the frame before input is sampled, returns the seconds since the previous frame started
+	f32 beginFrame() {
+		if(period > 0) {
+			u64 now = platform->getPerformanceCounter();
+			if(next_deadline == 0 || now > next_deadline + period) {
+				// NOTE: first frame or a hitch longer than a whole period, restart the schedule instead of rushing to catch up
+				next_deadline = now;
+			} else {
+				waitUntil(next_deadline);
+			}
+			u64 woke = platform->getPerformanceCounter();
+			wait_errors.addSample(woke >= next_deadline ? ticksToMilliseconds(woke - next_deadline) : -ticksToMilliseconds(next_deadline - woke));
+			next_deadline += period;
+		}
+
+		u64 frame_start = platform->getPerformanceCounter();
+		f32 delta = 0.0f;
+		if(last_frame_start != 0) {
+			delta = (f32)((f64)(frame_start - last_frame_start) / (f64)frequency);
+			frame_times.addSample(delta * 1000.0f);
+		}
+		last_frame_start = frame_start;
+
+		for(u32 i = 0; i < (u32)LatencyMarker::Count; i++) markers[i] = 0;
+		return delta;
+	}
+
+	void mark(LatencyMarker marker) {
+		markers[(u32)marker] = platform->getPerformanceCounter();
+	}
+
+	// NOTE: after present, frames that never reached a marker (minimised, out of date swap chain) don't count
+	void endFrame() {
+		u64 input = markers[(u32)LatencyMarker::InputSample];
+		u64 submit = markers[(u32)LatencyMarker::Submit];
+		u64 present = markers[(u32)LatencyMarker::Present];
+		if(input == 0) return;
+		if(submit >= input) input_to_submit.addSample(ticksToMilliseconds(submit - input));
+		if(present >= input) input_to_present.addSample(ticksToMilliseconds(present - input));
+	}
+
+	void printStats() {
+		printf("Frame time   %8.3fms avg %8.3fms max, std dev %.3fms (variance %.4fms^2)\n", frame_times.mean(), frame_times.max(), Math::squareRoot(frame_times.variance()), frame_times.variance());
+		if(period > 0) printf("Pacing wait  %8.3fms avg %8.3fms max late, wake estimate %.3fms\n", wait_errors.mean(), wait_errors.max(), (f32)(wake_latency * 1000.0));
+		printf("Input->submit  %6.3fms avg %8.3fms max\n", input_to_submit.mean(), input_to_submit.max());
+		printf("Input->present %6.3fms avg %8.3fms max\n", input_to_present.mean(), input_to_present.max());
+	}
+};
@@ -17,9 +17,9 @@ struct MouseState {
 
 class InputManager {
 	private:
-		ButtonState buttons[2][Key::KeyCount];
-		ButtonState (*old_buttons)[Key::KeyCount];
-		ButtonState (*new_buttons)[Key::KeyCount];
+		ButtonState buttons[2][(u32)Key::KeyCount];
+		ButtonState (*old_buttons)[(u32)Key::KeyCount];
+		ButtonState (*new_buttons)[(u32)Key::KeyCount];
 		MouseState mouse_states[2];
 		MouseState *old_mouse;
 		MouseState *new_mouse;
@@ -0,0 +1,85 @@
+#include <core/platform.h>
+
+#define MAX_WORKER_THREADS 16
+
+typedef void (JobFunc)(void *data, u32 job_index);
+
+struct WorkerPool;
+
+struct WorkerThread {
+	WorkerPool *pool;
+	PlatformThread thread;
+	PlatformSemaphore start;
+	u32 job_index;
+};
+
+// NOTE: a fork/join pool, run() hands job i to worker i-1 and runs job 0 on the calling thread
+struct WorkerPool {
+	Platform *platform;
+	WorkerThread workers[MAX_WORKER_THREADS];
+	u32 worker_count;
+	PlatformSemaphore done;
+	JobFunc *job;
+	void *job_data;
+	volatile bool running;
+
+	static int workerMain(void *data) {
+		WorkerThread *worker = (WorkerThread *)data;
+		WorkerPool *pool = worker->pool;
+		while(true) {
+			pool->platform->waitSemaphore(&worker->start);
+			if(!pool->running) break;
+			pool->job(pool->job_data, worker->job_index);
+			pool->platform->signalSemaphore(&pool->done);
+		}
+		return 0;
+	}
+
+	void init(Platform *platform, u32 thread_count) {
+		this->platform = platform;
+		running = true;
+		worker_count = thread_count > MAX_WORKER_THREADS ? MAX_WORKER_THREADS : thread_count;
+		done = platform->createSemaphore(0);
+
+		for(u32 i = 0; i < worker_count; i++) {
+			WorkerThread *worker = &workers[i];
+			worker->pool = this;
+			worker->job_index = i + 1;
+			worker->start = platform->createSemaphore(0);
+			worker->thread = platform->createThread(workerMain, "worker", worker);
+		}
+	}
+
+	u32 getMaxJobCount() {
+		return worker_count + 1;
+	}
+
+	void run(JobFunc *func, void *data, u32 job_count) {
+		Assert(job_count > 0 && job_count <= getMaxJobCount());
+		job = func;
+		job_data = data;
+
+		for(u32 i = 1; i < job_count; i++) {
+			platform->signalSemaphore(&workers[i - 1].start);
+		}
+
+		func(data, 0);
+
+		for(u32 i = 1; i < job_count; i++) {
+			platform->waitSemaphore(&done);
+		}
+	}
+
+	void uninit() {
+		running = false;
+		for(u32 i = 0; i < worker_count; i++) {
+			platform->signalSemaphore(&workers[i].start);
+		}
+		for(u32 i = 0; i < worker_count; i++) {
+			platform->waitThread(&workers[i].thread);
+			platform->destroySemaphore(&workers[i].start);
+		}
+		platform->destroySemaphore(&done);
+		worker_count = 0;
+	}
+};
@@ -112,9 +112,12 @@ struct Vec3 {
 		struct { f32 x, y, z; };
 		struct { f32 u, v, w; };
 		struct { f32 r, g, b; };
+#ifdef _MSC_VER
+		// NOTE: members with constructors in an anonymous struct are an msvc extension
 		struct { Vec2 xy; f32 _z; };
 		struct { f32 _x; Vec2 yz; };
 		struct { Vec2 uv; f32 _w; };
+#endif
 		f32 xyz[3];
 	};
 
@@ -197,16 +200,18 @@ Vec3 operator/(f32 i, Vec3 a) {
 struct Vec4 {
 	Vec4(f32 x, f32 y, f32 z, f32 w) { this->x = x; this->y = y; this->z = z; this->w = w;}
 	Vec4() { this->x = 0.0f; this->y = 0.0f; this->z = 0.0f; this->w = 0.0f; }
-	Vec4(Vec2 xy, Vec2 zw) { this->xy = xy; this->zw = zw;}
-	Vec4(Vec2 xy, f32 z, f32 w) { this->xy = xy; this->z = z; this->w = w;}
-	Vec4(Vec3 xyz, f32 w) { this->xyz = xyz; this->w = w;}
+	Vec4(Vec2 xy, Vec2 zw) { this->x = xy.x; this->y = xy.y; this->z = zw.x; this->w = zw.y;}
+	Vec4(Vec2 xy, f32 z, f32 w) { this->x = xy.x; this->y = xy.y; this->z = z; this->w = w;}
+	Vec4(Vec3 xyz, f32 w) { this->x = xyz.x; this->y = xyz.y; this->z = xyz.z; this->w = w;}
 	Vec4(f32 x) { this->x = x; this->y = x; this->z = x; this->w = x;}
 
 	union {
 		struct { f32 x, y, z, w;};
 		struct { f32 r, g, b, a;};
+#ifdef _MSC_VER
 		struct { Vec2 xy; Vec2 zw; };
 		struct { Vec3 xyz; f32 _w; };
+#endif
 		f32 xyzw[4];
 	};
 
@@ -0,0 +1,155 @@
+#include <core/platform.h>
+
+#define MESH_MAX_LODS 5
+#define MESH_LODS_MAGIC 0x444f4c50 // 'PLOD'
+#define MESH_LODS_VERSION 1
+#define MESH_LOD_MAX_ERROR 0.05f // NOTE: of the mesh extent, past this a LOD isn't worth drawing at any distance
+#define MESH_LOD_MIN_TRIANGLES 64
+
+// NOTE: a range of the mesh's index buffer, error is how far in mesh units its surface can be from the full detail one
+struct MeshLod {
+	u32 first_index;
+	u32 index_count;
+	f32 error;
+};
+
+// NOTE: the cooked file is this header followed by the indices of every LOD after the first, LOD 0 is the source index
+// buffer itself. source_hash covers the vertices and indices it was built from so an edited model cooks again.
+struct MeshLodsHeader {
+	u32 magic;
+	u32 version;
+	u64 source_hash;
+	u32 lod_count;
+	u32 index_count;
+	MeshLod lods[MESH_MAX_LODS];
+};
+
+internal_func u64 hashMeshSource(const void *vertices, u32 vertex_count, u32 vertex_size, const u32 *indices, u32 index_count) {
+	u64 hash = 14695981039346656037ull;
+	const u8 *bytes = (const u8 *)vertices;
+	for(u64 i = 0; i < (u64)vertex_count * vertex_size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	bytes = (const u8 *)indices;
+	for(u64 i = 0; i < (u64)index_count * sizeof(u32); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// NOTE: each LOD halves the triangles of the one before, simplifying from it rather than the source so the whole chain
+// costs about twice the first step. Errors add up along the chain. Stops early when a step can't get under
+// MESH_LOD_MAX_ERROR or barely removes anything. Returns the indices of LODs 1 and up, laid out after the source ones.
+internal_func u32 *generateMeshLods(Platform *platform, const void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset, const u32 *indices, u32 index_count, MeshLod *lods, u32 *lod_count, u32 *lod_index_count) {
+	u64 start = platform->getPerformanceCounter();
+	f32 scale = simplifyScale(vertices, vertex_count, vertex_size, position_offset);
+
+	lods[0].first_index = 0;
+	lods[0].index_count = index_count;
+	lods[0].error = 0.0f;
+	*lod_count = 1;
+	*lod_index_count = 0;
+
+	// NOTE: every LOD after the first is at most half the one before, so they all fit in index_count
+	u32 *result = (u32 *)platform->alloc(sizeof(u32) * (index_count > 0 ? index_count : 1));
+	u32 *scratch = (u32 *)platform->alloc(sizeof(u32) * (index_count > 0 ? index_count : 1));
+	const u32 *previous = indices;
+	u32 previous_count = index_count;
+	f32 previous_error = 0.0f;
+	while(*lod_count < MESH_MAX_LODS && previous_count / 3 > MESH_LOD_MIN_TRIANGLES) {
+		f32 error;
+		u32 count = simplifyMesh(platform, scratch, previous, previous_count, vertices, vertex_count, vertex_size, position_offset, (previous_count / 6) * 3, MESH_LOD_MAX_ERROR - previous_error, &error);
+		if(count == 0 || count > previous_count - previous_count / 8) break;
+
+		u32 *lod_indices = result + *lod_index_count;
+		optimizeVertexCache(platform, lod_indices, scratch, count, vertex_count);
+
+		MeshLod *lod = &lods[(*lod_count)++];
+		lod->first_index = index_count + *lod_index_count;
+		lod->index_count = count;
+		previous_error += error;
+		lod->error = previous_error * scale;
+		*lod_index_count += count;
+
+		previous = lod_indices;
+		previous_count = count;
+	}
+	platform->free(scratch);
+
+	f32 seconds = (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency();
+	printf("Generated %u LODs in %.3fms\n", *lod_count, seconds * 1000.0f);
+	return result;
+}
+
+// NOTE: 0 if the file is missing, damaged or was cooked from a different source
+internal_func u32 *loadMeshLods(Platform *platform, const char *path, u64 source_hash, u32 index_count, MeshLod *lods, u32 *lod_count, u32 *lod_index_count) {
+	if(!platform->fileExists(path)) return 0;
+
+	FileData file = platform->readEntireFile(path);
+	MeshLodsHeader *header = (MeshLodsHeader *)file.contents;
+	if(file.size < sizeof(MeshLodsHeader) || header->magic != MESH_LODS_MAGIC || header->version != MESH_LODS_VERSION ||
+	   header->source_hash != source_hash || header->lod_count == 0 || header->lod_count > MESH_MAX_LODS ||
+	   header->lods[0].index_count != index_count || file.size != sizeof(MeshLodsHeader) + sizeof(u32) * (u64)header->index_count) {
+		printf("Discarding stale mesh LODs %s\n", path);
+		if(file.contents) platform->free(file.contents);
+		return 0;
+	}
+
+	u32 *result = (u32 *)platform->alloc(sizeof(u32) * (header->index_count > 0 ? header->index_count : 1));
+	memcpy(result, header + 1, sizeof(u32) * header->index_count);
+	memcpy(lods, header->lods, sizeof(MeshLod) * header->lod_count);
+	*lod_count = header->lod_count;
+	*lod_index_count = header->index_count;
+	platform->free(file.contents);
+	return result;
+}
+
+internal_func void saveMeshLods(Platform *platform, const char *path, u64 source_hash, const MeshLod *lods, u32 lod_count, const u32 *lod_indices, u32 lod_index_count) {
+	u64 file_size = sizeof(MeshLodsHeader) + sizeof(u32) * (u64)lod_index_count;
+	u8 *file_data = (u8 *)platform->alloc(file_size);
+
+	MeshLodsHeader *header = (MeshLodsHeader *)file_data;
+	memset(header, 0, sizeof(MeshLodsHeader));
+	header->magic = MESH_LODS_MAGIC;
+	header->version = MESH_LODS_VERSION;
+	header->source_hash = source_hash;
+	header->lod_count = lod_count;
+	header->index_count = lod_index_count;
+	memcpy(header->lods, lods, sizeof(MeshLod) * lod_count);
+	memcpy(header + 1, lod_indices, sizeof(u32) * lod_index_count);
+
+	platform->writeStructureToFile(path, file_data, (s32)file_size);
+	platform->free(file_data);
+}
+
+// NOTE: LODs are generated offline the first time a model loads and cooked next to it, later loads just read them back.
+// Returns the indices to append to the source index buffer, free with platform->free.
+internal_func u32 *buildMeshLods(Platform *platform, const char *path, bool force_rebuild, const void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset, const u32 *indices, u32 index_count, MeshLod *lods, u32 *lod_count, u32 *lod_index_count) {
+	u64 source_hash = hashMeshSource(vertices, vertex_count, vertex_size, indices, index_count);
+	u32 *result = force_rebuild ? 0 : loadMeshLods(platform, path, source_hash, index_count, lods, lod_count, lod_index_count);
+	if(result == 0) {
+		result = generateMeshLods(platform, vertices, vertex_count, vertex_size, position_offset, indices, index_count, lods, lod_count, lod_index_count);
+		saveMeshLods(platform, path, source_hash, lods, *lod_count, result, *lod_index_count);
+	}
+
+	for(u32 i = 0; i < *lod_count; i++) {
+		printf("LOD %u: %8u triangles, error %.5f\n", i, lods[i].index_count / 3, lods[i].error);
+	}
+	return result;
+}
+
+// NOTE: the coarsest LOD whose error stays under max_pixel_error pixels on screen. error_scale takes mesh units to
+// world units, distance is to the nearest point of the bounds and pixels_per_unit is pixels per world unit at a
+// distance of one, so anything that close or inside the bounds gets full detail.
+internal_func u32 selectMeshLod(const MeshLod *lods, u32 lod_count, f32 error_scale, f32 distance, f32 pixels_per_unit, f32 max_pixel_error) {
+	if(distance <= 0.0f) return 0;
+	u32 result = 0;
+	for(u32 i = 1; i < lod_count; i++) {
+		f32 pixels = lods[i].error * error_scale * pixels_per_unit / distance;
+		if(pixels > max_pixel_error) break;
+		result = i;
+	}
+	return result;
+}
@@ -0,0 +1,401 @@
+#include <core/platform.h>
+
+#define MESH_CACHE_SIZE 16
+#define MESH_INVALID_INDEX 0xffffffff
+
+// NOTE: average cache miss ratio is misses per triangle (0.5 is ideal for big regular meshes, 3 is no reuse at all),
+// average transform to vertex ratio is misses per vertex (1 is ideal)
+struct VertexCacheStats {
+	u32 misses;
+	f32 acmr;
+	f32 atvr;
+};
+
+// NOTE: simulates a fifo post transform cache of cache_size entries, timestamps stand in for the queue
+internal_func VertexCacheStats analyzeVertexCache(Platform *platform, const u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size) {
+	VertexCacheStats result = {};
+	if(index_count == 0 || vertex_count == 0) return result;
+
+	u32 *cache_times = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	memset(cache_times, 0, sizeof(u32) * vertex_count);
+	u32 time = cache_size + 1;
+
+	for(u32 i = 0; i < index_count; i++) {
+		u32 v = indices[i];
+		if(time - cache_times[v] > cache_size) {
+			cache_times[v] = time++;
+			result.misses++;
+		}
+	}
+	platform->free(cache_times);
+
+	result.acmr = (f32)result.misses / (f32)(index_count / 3);
+	result.atvr = (f32)result.misses / (f32)vertex_count;
+	return result;
+}
+
+internal_func u32 hashVertex(const u8 *vertex, u32 vertex_size) {
+	u32 hash = 2166136261u;
+	for(u32 i = 0; i < vertex_size; i++) {
+		hash ^= vertex[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// NOTE: bytewise identical vertices share an index, remap[old] is the new index in order of first use or
+// MESH_INVALID_INDEX for vertices no triangle references. Returns the unique vertex count.
+internal_func u32 generateVertexRemap(Platform *platform, u32 *remap, const u32 *indices, u32 index_count, const void *vertices, u32 vertex_count, u32 vertex_size) {
+	for(u32 i = 0; i < vertex_count; i++) remap[i] = MESH_INVALID_INDEX;
+
+	// NOTE: open addressing, the table holds the first old index seen for each unique vertex
+	u32 table_size = 1;
+	while(table_size < vertex_count * 2) table_size <<= 1;
+	u32 *table = (u32 *)platform->alloc(sizeof(u32) * table_size);
+	for(u32 i = 0; i < table_size; i++) table[i] = MESH_INVALID_INDEX;
+
+	const u8 *bytes = (const u8 *)vertices;
+	u32 unique_count = 0;
+	for(u32 i = 0; i < index_count; i++) {
+		u32 v = indices[i];
+		if(remap[v] != MESH_INVALID_INDEX) continue;
+
+		const u8 *vertex = bytes + (u64)v * vertex_size;
+		u32 slot = hashVertex(vertex, vertex_size) & (table_size - 1);
+		while(table[slot] != MESH_INVALID_INDEX && memcmp(bytes + (u64)table[slot] * vertex_size, vertex, vertex_size) != 0) {
+			slot = (slot + 1) & (table_size - 1);
+		}
+
+		if(table[slot] == MESH_INVALID_INDEX) {
+			table[slot] = v;
+			remap[v] = unique_count++;
+		} else {
+			remap[v] = remap[table[slot]];
+		}
+	}
+
+	platform->free(table);
+	return unique_count;
+}
+
+// NOTE: dst can alias indices
+internal_func void remapIndexBuffer(u32 *dst, const u32 *indices, u32 index_count, const u32 *remap) {
+	for(u32 i = 0; i < index_count; i++) dst[i] = remap[indices[i]];
+}
+
+// NOTE: dst can't alias vertices, several old vertices can land on the same new one
+internal_func void remapVertexBuffer(void *dst, const void *vertices, u32 vertex_count, u32 vertex_size, const u32 *remap) {
+	for(u32 i = 0; i < vertex_count; i++) {
+		if(remap[i] == MESH_INVALID_INDEX) continue;
+		memcpy((u8 *)dst + (u64)remap[i] * vertex_size, (const u8 *)vertices + (u64)i * vertex_size, vertex_size);
+	}
+}
+
+// NOTE: Forsyth's linear speed vertex cache optimisation. Triangles are emitted greedily by the summed score of their
+// vertices, recently used vertices score high so neighbours follow each other, and vertices with few triangles left
+// score high so they get finished off rather than left stranded for a later cache miss. dst can't alias indices.
+internal_func void optimizeVertexCache(Platform *platform, u32 *dst, const u32 *indices, u32 index_count, u32 vertex_count) {
+	u32 triangle_count = index_count / 3;
+	if(triangle_count == 0) return;
+
+	f32 cache_scores[MESH_CACHE_SIZE];
+	for(u32 i = 0; i < MESH_CACHE_SIZE; i++) {
+		// NOTE: the last triangle's vertices get a flat score so it isn't immediately reused the other way round
+		if(i < 3) {
+			cache_scores[i] = 0.75f;
+		} else {
+			f32 scaled = 1.0f - (f32)(i - 3) / (f32)(MESH_CACHE_SIZE - 3);
+			cache_scores[i] = Math::pow(scaled, 1.5f);
+		}
+	}
+
+	u32 *live_counts = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u32 *adjacency_offsets = (u32 *)platform->alloc(sizeof(u32) * (vertex_count + 1));
+	u32 *adjacency = (u32 *)platform->alloc(sizeof(u32) * index_count);
+	s32 *cache_positions = (s32 *)platform->alloc(sizeof(s32) * vertex_count);
+	f32 *vertex_scores = (f32 *)platform->alloc(sizeof(f32) * vertex_count);
+	f32 *triangle_scores = (f32 *)platform->alloc(sizeof(f32) * triangle_count);
+	bool *emitted = (bool *)platform->alloc(sizeof(bool) * triangle_count);
+
+	memset(live_counts, 0, sizeof(u32) * vertex_count);
+	for(u32 i = 0; i < index_count; i++) live_counts[indices[i]]++;
+
+	adjacency_offsets[0] = 0;
+	for(u32 v = 0; v < vertex_count; v++) adjacency_offsets[v + 1] = adjacency_offsets[v] + live_counts[v];
+	for(u32 v = 0; v < vertex_count; v++) live_counts[v] = 0;
+	for(u32 t = 0; t < triangle_count; t++) {
+		for(u32 k = 0; k < 3; k++) {
+			u32 v = indices[t * 3 + k];
+			adjacency[adjacency_offsets[v] + live_counts[v]++] = t;
+		}
+	}
+
+	#define VERTEX_SCORE(v) ((cache_positions[v] >= 0 ? cache_scores[cache_positions[v]] : 0.0f) + (live_counts[v] > 0 ? 2.0f / Math::squareRoot((f32)live_counts[v]) : 0.0f))
+
+	for(u32 v = 0; v < vertex_count; v++) {
+		cache_positions[v] = -1;
+		vertex_scores[v] = VERTEX_SCORE(v);
+	}
+
+	u32 best_triangle = MESH_INVALID_INDEX;
+	f32 best_score = -1.0f;
+	for(u32 t = 0; t < triangle_count; t++) {
+		emitted[t] = false;
+		triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+		if(triangle_scores[t] > best_score) {
+			best_score = triangle_scores[t];
+			best_triangle = t;
+		}
+	}
+
+	u32 cache[MESH_CACHE_SIZE + 3];
+	u32 cache_count = 0;
+	u32 scan_cursor = 0;
+	u32 output_count = 0;
+
+	while(output_count < triangle_count) {
+		if(best_triangle == MESH_INVALID_INDEX) {
+			// NOTE: nothing in the cache has triangles left, carry on from the next untouched one in input order
+			while(emitted[scan_cursor]) scan_cursor++;
+			best_triangle = scan_cursor;
+		}
+
+		u32 t = best_triangle;
+		emitted[t] = true;
+		u32 triangle[3] = {indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]};
+		dst[output_count * 3 + 0] = triangle[0];
+		dst[output_count * 3 + 1] = triangle[1];
+		dst[output_count * 3 + 2] = triangle[2];
+		output_count++;
+
+		// NOTE: drop the triangle from its vertices' live lists, order within a list doesn't matter
+		for(u32 k = 0; k < 3; k++) {
+			u32 v = triangle[k];
+			u32 *list = adjacency + adjacency_offsets[v];
+			for(u32 i = 0; i < live_counts[v]; i++) {
+				if(list[i] == t) {
+					list[i] = list[--live_counts[v]];
+					break;
+				}
+			}
+		}
+
+		// NOTE: the triangle's vertices move to the front of the lru cache, the overflow past MESH_CACHE_SIZE is scored
+		// once more as evicted before it's forgotten
+		u32 new_cache[MESH_CACHE_SIZE + 3];
+		u32 new_cache_count = 0;
+		for(u32 k = 0; k < 3; k++) new_cache[new_cache_count++] = triangle[k];
+		for(u32 i = 0; i < cache_count; i++) {
+			u32 v = cache[i];
+			if(v != triangle[0] && v != triangle[1] && v != triangle[2]) new_cache[new_cache_count++] = v;
+		}
+
+		for(u32 i = 0; i < new_cache_count; i++) {
+			u32 v = new_cache[i];
+			cache_positions[v] = i < MESH_CACHE_SIZE ? (s32)i : -1;
+			vertex_scores[v] = VERTEX_SCORE(v);
+		}
+
+		best_triangle = MESH_INVALID_INDEX;
+		best_score = -1.0f;
+		for(u32 i = 0; i < new_cache_count; i++) {
+			u32 v = new_cache[i];
+			u32 *list = adjacency + adjacency_offsets[v];
+			for(u32 j = 0; j < live_counts[v]; j++) {
+				u32 neighbour = list[j];
+				f32 score = vertex_scores[indices[neighbour * 3 + 0]] + vertex_scores[indices[neighbour * 3 + 1]] + vertex_scores[indices[neighbour * 3 + 2]];
+				triangle_scores[neighbour] = score;
+				if(score > best_score) {
+					best_score = score;
+					best_triangle = neighbour;
+				}
+			}
+		}
+
+		cache_count = new_cache_count < MESH_CACHE_SIZE ? new_cache_count : MESH_CACHE_SIZE;
+		for(u32 i = 0; i < cache_count; i++) cache[i] = new_cache[i];
+	}
+
+	#undef VERTEX_SCORE
+
+	platform->free(emitted);
+	platform->free(triangle_scores);
+	platform->free(vertex_scores);
+	platform->free(cache_positions);
+	platform->free(adjacency);
+	platform->free(adjacency_offsets);
+	platform->free(live_counts);
+}
+
+struct MeshCluster {
+	u32 first_triangle;
+	u32 triangle_count;
+	f32 sort_key;
+};
+
+internal_func int compareClusters(const void *a, const void *b) {
+	f32 key_a = ((const MeshCluster *)a)->sort_key;
+	f32 key_b = ((const MeshCluster *)b)->sort_key;
+	if(key_a > key_b) return -1;
+	if(key_a < key_b) return 1;
+	return 0;
+}
+
+// NOTE: Reorders the clusters of a cache optimised index buffer so the ones facing out from the mesh centre draw first
+// and occlude the rest, which cuts overdraw from most view directions. Clusters start wherever the fifo cache missed a
+// whole triangle, and are split further wherever their acmr so far is within threshold of the cluster's own, so
+// threshold trades cache efficiency (1.0 keeps it intact) for smaller clusters that sort better. dst can't alias indices.
+internal_func void optimizeOverdraw(Platform *platform, u32 *dst, const u32 *indices, u32 index_count, const void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset, f32 threshold) {
+	u32 triangle_count = index_count / 3;
+	if(triangle_count == 0) return;
+
+	#define POSITION(v) ((const f32 *)((const u8 *)vertices + (u64)(v) * vertex_size + position_offset))
+
+	u32 *cache_times = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u8 *triangle_misses = (u8 *)platform->alloc(triangle_count);
+	memset(cache_times, 0, sizeof(u32) * vertex_count);
+	u32 time = MESH_CACHE_SIZE + 1;
+	for(u32 t = 0; t < triangle_count; t++) {
+		u8 misses = 0;
+		for(u32 k = 0; k < 3; k++) {
+			u32 v = indices[t * 3 + k];
+			if(time - cache_times[v] > MESH_CACHE_SIZE) {
+				cache_times[v] = time++;
+				misses++;
+			}
+		}
+		triangle_misses[t] = misses;
+	}
+
+	MeshCluster *clusters = (MeshCluster *)platform->alloc(sizeof(MeshCluster) * triangle_count);
+	u32 cluster_count = 0;
+	u32 hard_start = 0;
+	while(hard_start < triangle_count) {
+		u32 hard_end = hard_start + 1;
+		u32 hard_misses = triangle_misses[hard_start];
+		while(hard_end < triangle_count && triangle_misses[hard_end] < 3) hard_misses += triangle_misses[hard_end++];
+		f32 target_acmr = (f32)hard_misses / (f32)(hard_end - hard_start) * threshold;
+
+		// NOTE: a split restarts the cache, so it only happens where the running acmr says there's room for it
+		u32 soft_start = hard_start;
+		u32 soft_misses = 0;
+		for(u32 t = hard_start; t < hard_end; t++) {
+			soft_misses += triangle_misses[t];
+			u32 soft_count = t + 1 - soft_start;
+			bool last = t + 1 == hard_end;
+			if(last || (soft_count >= 32 && (f32)soft_misses / (f32)soft_count <= target_acmr)) {
+				MeshCluster *cluster = &clusters[cluster_count++];
+				cluster->first_triangle = soft_start;
+				cluster->triangle_count = soft_count;
+				soft_start = t + 1;
+				soft_misses = 0;
+			}
+		}
+		hard_start = hard_end;
+	}
+
+	Vec3 mesh_centroid = Vec3(0.0f);
+	for(u32 i = 0; i < index_count; i++) {
+		const f32 *p = POSITION(indices[i]);
+		mesh_centroid = mesh_centroid + Vec3(p[0], p[1], p[2]);
+	}
+	mesh_centroid = mesh_centroid * (1.0f / (f32)index_count);
+
+	for(u32 c = 0; c < cluster_count; c++) {
+		MeshCluster *cluster = &clusters[c];
+		Vec3 centroid = Vec3(0.0f);
+		Vec3 normal = Vec3(0.0f);
+		f32 area_total = 0.0f;
+		for(u32 t = cluster->first_triangle; t < cluster->first_triangle + cluster->triangle_count; t++) {
+			const f32 *p0 = POSITION(indices[t * 3 + 0]);
+			const f32 *p1 = POSITION(indices[t * 3 + 1]);
+			const f32 *p2 = POSITION(indices[t * 3 + 2]);
+			Vec3 a = Vec3(p0[0], p0[1], p0[2]);
+			Vec3 b = Vec3(p1[0], p1[1], p1[2]);
+			Vec3 e = Vec3(p2[0], p2[1], p2[2]);
+			Vec3 face = Vec3::cross(b - a, e - a); // NOTE: length is twice the area, so the sum is area weighted
+			f32 area = Vec3::length(face);
+			centroid = centroid + (a + b + e) * (area / 3.0f);
+			normal = normal + face;
+			area_total += area;
+		}
+
+		f32 normal_length = Vec3::length(normal);
+		if(area_total > 0.0f) centroid = centroid * (1.0f / area_total);
+		if(normal_length > 0.0f) normal = normal * (1.0f / normal_length);
+		cluster->sort_key = Vec3::dot(centroid - mesh_centroid, normal);
+	}
+
+	qsort(clusters, cluster_count, sizeof(MeshCluster), compareClusters);
+
+	u32 output = 0;
+	for(u32 c = 0; c < cluster_count; c++) {
+		MeshCluster *cluster = &clusters[c];
+		memcpy(dst + output, indices + cluster->first_triangle * 3, sizeof(u32) * 3 * cluster->triangle_count);
+		output += 3 * cluster->triangle_count;
+	}
+
+	#undef POSITION
+
+	platform->free(clusters);
+	platform->free(triangle_misses);
+	platform->free(cache_times);
+}
+
+// NOTE: numbers vertices in the order the index buffer first touches them so vertex fetches walk memory forwards.
+// Returns the referenced vertex count, apply with remapIndexBuffer and remapVertexBuffer.
+internal_func u32 optimizeVertexFetchRemap(u32 *remap, const u32 *indices, u32 index_count, u32 vertex_count) {
+	for(u32 i = 0; i < vertex_count; i++) remap[i] = MESH_INVALID_INDEX;
+	u32 next = 0;
+	for(u32 i = 0; i < index_count; i++) {
+		u32 v = indices[i];
+		if(remap[v] == MESH_INVALID_INDEX) remap[v] = next++;
+	}
+	return next;
+}
+
+internal_func void printVertexCacheStats(const char *stage, VertexCacheStats stats, u32 vertex_count) {
+	printf("Mesh %-14s %8u vertices, acmr %.3f, atvr %.3f\n", stage, vertex_count, stats.acmr, stats.atvr);
+}
+
+// NOTE: Dedups the vertices, then reorders triangles for the post transform cache and overdraw and vertices for fetch
+// locality, all in place. Returns the new vertex count, the index count doesn't change. Prints acmr/atvr after every
+// stage, measured against a MESH_CACHE_SIZE entry fifo.
+internal_func u32 optimizeMesh(Platform *platform, void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset, u32 *indices, u32 index_count) {
+	if(index_count == 0 || vertex_count == 0) return vertex_count;
+	u64 start = platform->getPerformanceCounter();
+
+	printVertexCacheStats("unoptimized", analyzeVertexCache(platform, indices, index_count, vertex_count, MESH_CACHE_SIZE), vertex_count);
+
+	u32 *remap = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u32 *scratch_indices = (u32 *)platform->alloc(sizeof(u32) * index_count);
+	void *scratch_vertices = platform->alloc((u64)vertex_count * vertex_size);
+
+	u32 unique_count = generateVertexRemap(platform, remap, indices, index_count, vertices, vertex_count, vertex_size);
+	remapIndexBuffer(indices, indices, index_count, remap);
+	memcpy(scratch_vertices, vertices, (u64)vertex_count * vertex_size);
+	remapVertexBuffer(vertices, scratch_vertices, vertex_count, vertex_size, remap);
+	vertex_count = unique_count;
+	printVertexCacheStats("deduplicated", analyzeVertexCache(platform, indices, index_count, vertex_count, MESH_CACHE_SIZE), vertex_count);
+
+	optimizeVertexCache(platform, scratch_indices, indices, index_count, vertex_count);
+	printVertexCacheStats("vertex cache", analyzeVertexCache(platform, scratch_indices, index_count, vertex_count, MESH_CACHE_SIZE), vertex_count);
+
+	optimizeOverdraw(platform, indices, scratch_indices, index_count, vertices, vertex_count, vertex_size, position_offset, 1.05f);
+	printVertexCacheStats("overdraw", analyzeVertexCache(platform, indices, index_count, vertex_count, MESH_CACHE_SIZE), vertex_count);
+
+	// NOTE: fetch order doesn't change which vertices are in the cache, the stats only move if vertices went unused
+	vertex_count = optimizeVertexFetchRemap(remap, indices, index_count, vertex_count);
+	remapIndexBuffer(indices, indices, index_count, remap);
+	memcpy(scratch_vertices, vertices, (u64)unique_count * vertex_size);
+	remapVertexBuffer(vertices, scratch_vertices, unique_count, vertex_size, remap);
+	printVertexCacheStats("vertex fetch", analyzeVertexCache(platform, indices, index_count, vertex_count, MESH_CACHE_SIZE), vertex_count);
+
+	platform->free(scratch_vertices);
+	platform->free(scratch_indices);
+	platform->free(remap);
+
+	f32 seconds = (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency();
+	printf("Mesh optimized in %.3fms\n", seconds * 1000.0f);
+	return vertex_count;
+}
@@ -0,0 +1,419 @@
+#include <core/platform.h>
+
+// NOTE: open edges count this much more than faces so borders and attribute seams hold their shape
+#define SIMPLIFY_EDGE_WEIGHT 10.0f
+
+enum class SimplifyVertexKind : u8 {
+	Manifold, // NOTE: surrounded by triangles, collapses onto any neighbour
+	Border, // NOTE: on an open edge, only collapses along it
+	Seam, // NOTE: one of two vertices at a position split by a uv or normal seam, both collapse together along the seam
+	Locked, // NOTE: never removed, where seams and borders meet and anything non manifold
+	Count
+};
+
+// NOTE: can_collapse[from][to], anything can collapse onto a locked vertex but a locked vertex never moves
+global_variable const bool simplify_can_collapse[(u32)SimplifyVertexKind::Count][(u32)SimplifyVertexKind::Count] = {
+	{true, true, true, true},
+	{false, true, false, true},
+	{false, false, true, true},
+	{false, false, false, false},
+};
+
+// NOTE: the weighted sum of squared distances to a set of planes, p.A.p + 2 b.p + c with A symmetric
+struct Quadric {
+	f32 a00, a11, a22;
+	f32 a10, a20, a21;
+	f32 b0, b1, b2;
+	f32 c;
+	f32 weight;
+
+	static Quadric fromPlane(Vec3 normal, f32 distance, f32 weight) {
+		Quadric result;
+		result.a00 = weight * normal.x * normal.x;
+		result.a11 = weight * normal.y * normal.y;
+		result.a22 = weight * normal.z * normal.z;
+		result.a10 = weight * normal.y * normal.x;
+		result.a20 = weight * normal.z * normal.x;
+		result.a21 = weight * normal.z * normal.y;
+		result.b0 = weight * distance * normal.x;
+		result.b1 = weight * distance * normal.y;
+		result.b2 = weight * distance * normal.z;
+		result.c = weight * distance * distance;
+		result.weight = weight;
+		return result;
+	}
+
+	void add(const Quadric &other) {
+		a00 += other.a00;
+		a11 += other.a11;
+		a22 += other.a22;
+		a10 += other.a10;
+		a20 += other.a20;
+		a21 += other.a21;
+		b0 += other.b0;
+		b1 += other.b1;
+		b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	// NOTE: divided by the total weight so it's a mean squared distance and compares across vertices
+	f32 error(Vec3 p) {
+		f32 rx = a00 * p.x + a10 * p.y + a20 * p.z;
+		f32 ry = a10 * p.x + a11 * p.y + a21 * p.z;
+		f32 rz = a20 * p.x + a21 * p.y + a22 * p.z;
+		f32 result = rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		return weight > 0.0f ? Math::abs(result) / weight : 0.0f;
+	}
+};
+
+// NOTE: a list per vertex of one value for each triangle corner on it. Either the half edges leaving each vertex,
+// a -> b for every corner a followed by b, or with position keys the triangles touching each position.
+struct SimplifyAdjacency {
+	u32 *offsets;
+	u32 *targets;
+
+	void init(Platform *platform, u32 vertex_count, u32 index_count) {
+		offsets = (u32 *)platform->alloc(sizeof(u32) * (vertex_count + 1));
+		targets = (u32 *)platform->alloc(sizeof(u32) * (index_count > 0 ? index_count : 1));
+	}
+
+	// NOTE: keys remap each corner's vertex first, 0 to use them as they are
+	void build(const u32 *indices, u32 index_count, u32 vertex_count, const u32 *keys, bool triangles) {
+		memset(offsets, 0, sizeof(u32) * (vertex_count + 1));
+		for(u32 i = 0; i < index_count; i++) offsets[(keys ? keys[indices[i]] : indices[i]) + 1]++;
+		for(u32 v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+
+		// NOTE: filling walks each offset up to the next vertex's, shifting back down restores them
+		for(u32 i = 0; i < index_count; i++) {
+			u32 a = keys ? keys[indices[i]] : indices[i];
+			targets[offsets[a]++] = triangles ? i / 3 : indices[i - i % 3 + (i + 1) % 3];
+		}
+		for(u32 v = vertex_count; v > 0; v--) offsets[v] = offsets[v - 1];
+		offsets[0] = 0;
+	}
+
+	bool hasEdge(u32 a, u32 b) {
+		for(u32 i = offsets[a]; i < offsets[a + 1]; i++) {
+			if(targets[i] == b) return true;
+		}
+		return false;
+	}
+
+	void destroy(Platform *platform) {
+		platform->free(targets);
+		platform->free(offsets);
+	}
+};
+
+struct SimplifyCollapse {
+	u32 from;
+	u32 to;
+	f32 error;
+};
+
+internal_func int compareCollapses(const void *a, const void *b) {
+	f32 error_a = ((const SimplifyCollapse *)a)->error;
+	f32 error_b = ((const SimplifyCollapse *)b)->error;
+	if(error_a < error_b) return -1;
+	if(error_a > error_b) return 1;
+	return 0;
+}
+
+// NOTE: the largest extent of the mesh bounds, simplifier errors are relative to it
+internal_func f32 simplifyScale(const void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset) {
+	if(vertex_count == 0) return 0.0f;
+	const f32 *first = (const f32 *)((const u8 *)vertices + position_offset);
+	Vec3 min_bound = Vec3(first[0], first[1], first[2]);
+	Vec3 max_bound = min_bound;
+	for(u32 i = 1; i < vertex_count; i++) {
+		const f32 *p = (const f32 *)((const u8 *)vertices + (u64)i * vertex_size + position_offset);
+		min_bound = Vec3::rmin(min_bound, Vec3(p[0], p[1], p[2]));
+		max_bound = Vec3::rmax(max_bound, Vec3(p[0], p[1], p[2]));
+	}
+	Vec3 extent = max_bound - min_bound;
+	f32 result = extent.x > extent.y ? extent.x : extent.y;
+	return result > extent.z ? result : extent.z;
+}
+
+// NOTE: the vertex at the other end of v's one open edge in each direction, MESH_INVALID_INDEX for none and v itself
+// when there's more than one
+internal_func void findOpenEdges(SimplifyAdjacency *adjacency, u32 vertex_count, u32 *open_in, u32 *open_out) {
+	for(u32 v = 0; v < vertex_count; v++) {
+		open_in[v] = MESH_INVALID_INDEX;
+		open_out[v] = MESH_INVALID_INDEX;
+	}
+	for(u32 v = 0; v < vertex_count; v++) {
+		for(u32 i = adjacency->offsets[v]; i < adjacency->offsets[v + 1]; i++) {
+			u32 target = adjacency->targets[i];
+			if(adjacency->hasEdge(target, v)) continue;
+			open_in[target] = open_in[target] == MESH_INVALID_INDEX ? v : target;
+			open_out[v] = open_out[v] == MESH_INVALID_INDEX ? target : v;
+		}
+	}
+}
+
+// NOTE: Quadric error edge collapse simplification. Vertices are never moved or created, each collapse folds one vertex
+// into a neighbour, so every remaining vertex keeps its exact uv and normal and the result indexes the same vertex
+// buffer as the input. Vertices that share a position but differ in attributes are a seam, the pair only collapses
+// along the seam and both halves go together so uv islands stay stitched. Runs in passes, each pass sorts every edge
+// by error and takes the cheapest collapses that don't touch each other or flip a triangle, until target_index_count
+// is reached or the next collapse would cost more than target_error. Errors are relative to simplifyScale, result_error
+// is the largest collapse taken. Returns the new index count, dst needs index_count entries and can alias indices.
+internal_func u32 simplifyMesh(Platform *platform, u32 *dst, const u32 *indices, u32 index_count, const void *vertices, u32 vertex_count, u32 vertex_size, u32 position_offset, u32 target_index_count, f32 target_error, f32 *result_error) {
+	*result_error = 0.0f;
+	if(index_count == 0 || vertex_count == 0) return 0;
+	u64 start = platform->getPerformanceCounter();
+
+	// NOTE: positions rescaled to the unit cube so quadric errors don't depend on the mesh's size
+	f32 scale = simplifyScale(vertices, vertex_count, vertex_size, position_offset);
+	f32 inverse_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+	Vec3 *positions = (Vec3 *)platform->alloc(sizeof(Vec3) * vertex_count);
+	for(u32 i = 0; i < vertex_count; i++) {
+		const f32 *p = (const f32 *)((const u8 *)vertices + (u64)i * vertex_size + position_offset);
+		positions[i] = Vec3(p[0], p[1], p[2]) * inverse_scale;
+	}
+
+	// NOTE: remap is the first vertex at each position and wedge links all the vertices at a position in a ring
+	u32 *remap = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u32 *wedge = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	{
+		u32 table_size = 1;
+		while(table_size < vertex_count * 2) table_size <<= 1;
+		u32 *table = (u32 *)platform->alloc(sizeof(u32) * table_size);
+		for(u32 i = 0; i < table_size; i++) table[i] = MESH_INVALID_INDEX;
+
+		const u8 *bytes = (const u8 *)vertices;
+		for(u32 v = 0; v < vertex_count; v++) {
+			const u8 *position = bytes + (u64)v * vertex_size + position_offset;
+			u32 slot = hashVertex(position, sizeof(f32) * 3) & (table_size - 1);
+			while(table[slot] != MESH_INVALID_INDEX && memcmp(bytes + (u64)table[slot] * vertex_size + position_offset, position, sizeof(f32) * 3) != 0) {
+				slot = (slot + 1) & (table_size - 1);
+			}
+			if(table[slot] == MESH_INVALID_INDEX) table[slot] = v;
+
+			u32 first = table[slot];
+			remap[v] = first;
+			wedge[v] = v;
+			if(first != v) {
+				wedge[v] = wedge[first];
+				wedge[first] = v;
+			}
+		}
+		platform->free(table);
+	}
+
+	// NOTE: triangles with two corners at one position can't be classified or collapsed, drop them up front
+	u32 *current = (u32 *)platform->alloc(sizeof(u32) * index_count);
+	u32 current_count = 0;
+	for(u32 i = 0; i + 2 < index_count; i += 3) {
+		u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if(remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) continue;
+		current[current_count++] = a;
+		current[current_count++] = b;
+		current[current_count++] = c;
+	}
+
+	SimplifyAdjacency adjacency;
+	adjacency.init(platform, vertex_count, index_count);
+	adjacency.build(current, current_count, vertex_count, 0, false);
+
+	u32 *open_in = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u32 *open_out = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	findOpenEdges(&adjacency, vertex_count, open_in, open_out);
+
+	SimplifyVertexKind *kinds = (SimplifyVertexKind *)platform->alloc(sizeof(SimplifyVertexKind) * vertex_count);
+	for(u32 v = 0; v < vertex_count; v++) {
+		SimplifyVertexKind kind = SimplifyVertexKind::Locked;
+		u32 in = open_in[v], out = open_out[v];
+		if(wedge[v] == v) {
+			if(in == MESH_INVALID_INDEX && out == MESH_INVALID_INDEX) {
+				kind = SimplifyVertexKind::Manifold;
+			} else if(in != MESH_INVALID_INDEX && out != MESH_INVALID_INDEX && in != v && out != v && remap[in] != remap[out]) {
+				kind = SimplifyVertexKind::Border;
+			}
+		} else if(wedge[wedge[v]] == v) {
+			// NOTE: a seam when both halves have one open edge each way and the two sides run between the same positions
+			u32 w = wedge[v];
+			u32 w_in = open_in[w], w_out = open_out[w];
+			if(in != MESH_INVALID_INDEX && out != MESH_INVALID_INDEX && w_in != MESH_INVALID_INDEX && w_out != MESH_INVALID_INDEX &&
+			   in != v && out != v && w_in != w && w_out != w &&
+			   remap[in] == remap[w_out] && remap[out] == remap[w_in] && remap[in] != remap[out]) {
+				kind = SimplifyVertexKind::Seam;
+			}
+		}
+		kinds[v] = kind;
+	}
+
+	Quadric *quadrics = (Quadric *)platform->alloc(sizeof(Quadric) * vertex_count);
+	memset(quadrics, 0, sizeof(Quadric) * vertex_count);
+	for(u32 i = 0; i < current_count; i += 3) {
+		Vec3 p0 = positions[current[i]], p1 = positions[current[i + 1]], p2 = positions[current[i + 2]];
+		Vec3 normal = Vec3::cross(p1 - p0, p2 - p0);
+		f32 area = Vec3::length(normal);
+		if(area <= 0.0f) continue;
+		normal = normal * (1.0f / area);
+
+		Quadric face = Quadric::fromPlane(normal, -Vec3::dot(normal, p0), area);
+		for(u32 k = 0; k < 3; k++) quadrics[remap[current[i + k]]].add(face);
+
+		// NOTE: a plane through each open edge at right angles to the face keeps collapses from pulling the edge inwards
+		for(u32 k = 0; k < 3; k++) {
+			u32 a = current[i + k];
+			u32 b = current[i + (k + 1) % 3];
+			if(adjacency.hasEdge(b, a)) continue;
+
+			Vec3 edge = positions[b] - positions[a];
+			f32 length = Vec3::length(edge);
+			Vec3 edge_normal = Vec3::cross(edge, normal);
+			f32 edge_normal_length = Vec3::length(edge_normal);
+			if(edge_normal_length <= 0.0f) continue;
+			edge_normal = edge_normal * (1.0f / edge_normal_length);
+
+			Quadric border = Quadric::fromPlane(edge_normal, -Vec3::dot(edge_normal, positions[a]), length * SIMPLIFY_EDGE_WEIGHT);
+			quadrics[remap[a]].add(border);
+			quadrics[remap[b]].add(border);
+		}
+	}
+
+	u32 *collapse_remap = (u32 *)platform->alloc(sizeof(u32) * vertex_count);
+	u8 *collapse_locked = (u8 *)platform->alloc(vertex_count);
+	SimplifyCollapse *collapses = (SimplifyCollapse *)platform->alloc(sizeof(SimplifyCollapse) * (index_count / 3 + 1) * 3);
+	SimplifyAdjacency triangles_at;
+	triangles_at.init(platform, vertex_count, index_count);
+
+	f32 error_limit = target_error * target_error;
+	f32 max_error = 0.0f;
+	u32 pass_count = 0;
+	while(current_count > target_index_count) {
+		// NOTE: collapses move the open edges around, the vertex kinds from the original mesh still hold
+		if(pass_count > 0) {
+			adjacency.build(current, current_count, vertex_count, 0, false);
+			findOpenEdges(&adjacency, vertex_count, open_in, open_out);
+		}
+		triangles_at.build(current, current_count, vertex_count, remap, true);
+
+		// NOTE: one candidate per edge, whichever direction is allowed and cheaper
+		u32 collapse_count = 0;
+		for(u32 i = 0; i < current_count; i += 3) {
+			for(u32 k = 0; k < 3; k++) {
+				u32 a = current[i + k];
+				u32 b = current[i + (k + 1) % 3];
+
+				SimplifyCollapse best = {MESH_INVALID_INDEX, MESH_INVALID_INDEX, 0.0f};
+				for(u32 direction = 0; direction < 2; direction++) {
+					u32 from = direction ? b : a;
+					u32 to = direction ? a : b;
+					SimplifyVertexKind from_kind = kinds[from];
+					if(!simplify_can_collapse[(u32)from_kind][(u32)kinds[to]]) continue;
+					if((from_kind == SimplifyVertexKind::Border || from_kind == SimplifyVertexKind::Seam) && open_out[from] != to && open_in[from] != to) continue;
+
+					f32 error = quadrics[remap[from]].error(positions[to]);
+					if(best.from == MESH_INVALID_INDEX || error < best.error) {
+						best.from = from;
+						best.to = to;
+						best.error = error;
+					}
+				}
+				if(best.from != MESH_INVALID_INDEX) collapses[collapse_count++] = best;
+			}
+		}
+		if(collapse_count == 0) break;
+		qsort(collapses, collapse_count, sizeof(SimplifyCollapse), compareCollapses);
+
+		// NOTE: most collapses take two triangles with them. Past the cheapest goal's worth, only take ones not much
+		// worse so a pass doesn't trade quality for speed.
+		u32 triangle_goal = (current_count - target_index_count) / 3;
+		u32 edge_goal = triangle_goal / 2 > 0 ? triangle_goal / 2 : 1;
+		f32 pass_limit = error_limit;
+		if(edge_goal < collapse_count && collapses[edge_goal].error * 1.5f < pass_limit) pass_limit = collapses[edge_goal].error * 1.5f;
+
+		for(u32 v = 0; v < vertex_count; v++) collapse_remap[v] = v;
+		memset(collapse_locked, 0, vertex_count);
+
+		u32 removed_triangles = 0;
+		for(u32 c = 0; c < collapse_count && removed_triangles < triangle_goal; c++) {
+			SimplifyCollapse *collapse = &collapses[c];
+			if(collapse->error > pass_limit) break;
+
+			u32 from_position = remap[collapse->from];
+			u32 to_position = remap[collapse->to];
+			if(collapse_locked[from_position] || collapse_locked[to_position]) continue;
+
+			// NOTE: reject if any triangle that survives the collapse would turn more than ~75 degrees, a plain 90 degree
+			// test lets a series of near 90 degree collapses turn a triangle over
+			bool flips = false;
+			for(u32 t = triangles_at.offsets[from_position]; t < triangles_at.offsets[from_position + 1] && !flips; t++) {
+				const u32 *triangle = &current[triangles_at.targets[t] * 3];
+				u32 corner_positions[3] = {remap[triangle[0]], remap[triangle[1]], remap[triangle[2]]};
+				if(corner_positions[0] == to_position || corner_positions[1] == to_position || corner_positions[2] == to_position) continue;
+
+				Vec3 before[3], after[3];
+				for(u32 k = 0; k < 3; k++) {
+					before[k] = positions[corner_positions[k]];
+					after[k] = corner_positions[k] == from_position ? positions[to_position] : before[k];
+				}
+				Vec3 normal_before = Vec3::cross(before[1] - before[0], before[2] - before[0]);
+				Vec3 normal_after = Vec3::cross(after[1] - after[0], after[2] - after[0]);
+				f32 cos_scale = Math::squareRoot(Vec3::lengthSquared(normal_before) * Vec3::lengthSquared(normal_after));
+				if(Vec3::dot(normal_before, normal_after) <= 0.25f * cos_scale) flips = true;
+			}
+			if(flips) continue;
+
+			if(kinds[collapse->from] == SimplifyVertexKind::Seam) {
+				// NOTE: the other half follows the matching edge on its side of the seam
+				u32 sibling = wedge[collapse->from];
+				u32 sibling_to = collapse->to == open_out[collapse->from] ? open_in[sibling] : open_out[sibling];
+				if(sibling_to == MESH_INVALID_INDEX || sibling_to == sibling || remap[sibling_to] != to_position) continue;
+				collapse_remap[sibling] = sibling_to;
+			}
+			collapse_remap[collapse->from] = collapse->to;
+			quadrics[to_position].add(quadrics[from_position]);
+
+			// NOTE: neighbours are locked too so the flip test above only ever sees triangles as they were this pass
+			for(u32 t = triangles_at.offsets[from_position]; t < triangles_at.offsets[from_position + 1]; t++) {
+				const u32 *triangle = &current[triangles_at.targets[t] * 3];
+				for(u32 k = 0; k < 3; k++) collapse_locked[remap[triangle[k]]] = 1;
+			}
+			collapse_locked[to_position] = 1;
+
+			removed_triangles += kinds[collapse->from] == SimplifyVertexKind::Border ? 1 : 2;
+			if(collapse->error > max_error) max_error = collapse->error;
+		}
+
+		u32 next_count = 0;
+		for(u32 i = 0; i < current_count; i += 3) {
+			u32 a = collapse_remap[current[i]];
+			u32 b = collapse_remap[current[i + 1]];
+			u32 c = collapse_remap[current[i + 2]];
+			if(remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) continue;
+			current[next_count++] = a;
+			current[next_count++] = b;
+			current[next_count++] = c;
+		}
+		pass_count++;
+		if(next_count == current_count) break;
+		current_count = next_count;
+	}
+
+	memcpy(dst, current, sizeof(u32) * current_count);
+
+	triangles_at.destroy(platform);
+	platform->free(collapses);
+	platform->free(collapse_locked);
+	platform->free(collapse_remap);
+	platform->free(quadrics);
+	platform->free(kinds);
+	platform->free(open_out);
+	platform->free(open_in);
+	adjacency.destroy(platform);
+	platform->free(current);
+	platform->free(wedge);
+	platform->free(remap);
+	platform->free(positions);
+
+	*result_error = Math::squareRoot(max_error);
+	f32 seconds = (f32)(platform->getPerformanceCounter() - start) / (f32)platform->getPerformanceFrequency();
+	printf("Simplified %u to %u triangles in %u passes, error %.4f, %.3fms\n", index_count / 3, current_count / 3, pass_count, *result_error, seconds * 1000.0f);
+	return current_count;
+}
@@ -0,0 +1,167 @@
+#include <core/platform.h>
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet {
+	u32 vertex_offset; // NOTE: into MeshletMesh::vertices
+	u32 triangle_offset; // NOTE: into MeshletMesh::triangles
+	u32 vertex_count;
+	u32 triangle_count;
+};
+
+// NOTE: a bounding sphere and a normal cone in mesh space. The cluster faces away from any camera for which
+// dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius, cone_cutoff of 1 never culls.
+struct MeshletBounds {
+	Vec3 center;
+	f32 radius;
+	Vec3 cone_axis;
+	f32 cone_cutoff;
+};
+
+// NOTE: Clusters of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles. vertices maps each
+// meshlet's local vertices to the mesh's vertex buffer and triangles holds one triangle per u32, three 8 bit local
+// indices, so a meshlet can be expanded back into a plain index list on the gpu.
+struct MeshletMesh {
+	Meshlet *meshlets;
+	MeshletBounds *bounds;
+	u32 meshlet_count;
+	u32 *vertices;
+	u32 vertex_count;
+	u32 *triangles;
+	u32 triangle_count;
+
+	// NOTE: triangles are taken in index buffer order, so run the vertex cache optimizer first and neighbouring
+	// triangles end up in the same meshlet
+	void build(Platform *platform, const u32 *indices, u32 index_count, const void *mesh_vertices, u32 mesh_vertex_count, u32 vertex_size, u32 position_offset) {
+		u32 mesh_triangle_count = index_count / 3;
+		// NOTE: worst case every meshlet is cut short by its vertex limit after MESHLET_MAX_VERTICES / 3 triangles
+		u32 max_meshlets = mesh_triangle_count / (MESHLET_MAX_VERTICES / 3) + 1;
+		meshlets = (Meshlet *)platform->alloc(sizeof(Meshlet) * max_meshlets);
+		vertices = (u32 *)platform->alloc(sizeof(u32) * max_meshlets * MESHLET_MAX_VERTICES);
+		triangles = (u32 *)platform->alloc(sizeof(u32) * (mesh_triangle_count > 0 ? mesh_triangle_count : 1));
+		meshlet_count = 0;
+		vertex_count = 0;
+		triangle_count = 0;
+
+		u8 *local_index = (u8 *)platform->alloc(mesh_vertex_count);
+		memset(local_index, 0xff, mesh_vertex_count);
+
+		Meshlet current = {};
+		for(u32 t = 0; t < mesh_triangle_count; t++) {
+			u32 a = indices[t * 3 + 0];
+			u32 b = indices[t * 3 + 1];
+			u32 c = indices[t * 3 + 2];
+			u32 new_vertices = (local_index[a] == 0xff) + (local_index[b] == 0xff && b != a) + (local_index[c] == 0xff && c != a && c != b);
+
+			if(current.vertex_count + new_vertices > MESHLET_MAX_VERTICES || current.triangle_count == MESHLET_MAX_TRIANGLES) {
+				finishMeshlet(&current, local_index);
+			}
+
+			u32 triangle[3] = {a, b, c};
+			u32 packed = 0;
+			for(u32 k = 0; k < 3; k++) {
+				u32 v = triangle[k];
+				if(local_index[v] == 0xff) {
+					local_index[v] = (u8)current.vertex_count;
+					vertices[current.vertex_offset + current.vertex_count++] = v;
+				}
+				packed |= (u32)local_index[v] << (k * 8);
+			}
+			triangles[current.triangle_offset + current.triangle_count++] = packed;
+		}
+		if(current.triangle_count > 0) finishMeshlet(&current, local_index);
+		platform->free(local_index);
+
+		bounds = (MeshletBounds *)platform->alloc(sizeof(MeshletBounds) * (meshlet_count > 0 ? meshlet_count : 1));
+		for(u32 m = 0; m < meshlet_count; m++) {
+			bounds[m] = computeBounds(&meshlets[m], mesh_vertices, vertex_size, position_offset);
+		}
+
+		f32 culled_cones = 0.0f;
+		for(u32 m = 0; m < meshlet_count; m++) {
+			if(bounds[m].cone_cutoff < 1.0f) culled_cones += 1.0f;
+		}
+		printf("Meshlets: %u, %.1f vertices and %.1f triangles on average, %.0f%% have a usable normal cone\n", meshlet_count, meshlet_count ? (f32)vertex_count / (f32)meshlet_count : 0.0f, meshlet_count ? (f32)triangle_count / (f32)meshlet_count : 0.0f, meshlet_count ? culled_cones * 100.0f / (f32)meshlet_count : 0.0f);
+	}
+
+	void finishMeshlet(Meshlet *current, u8 *local_index) {
+		for(u32 i = 0; i < current->vertex_count; i++) local_index[vertices[current->vertex_offset + i]] = 0xff;
+		meshlets[meshlet_count++] = *current;
+		vertex_count += current->vertex_count;
+		triangle_count += current->triangle_count;
+
+		Meshlet next = {};
+		next.vertex_offset = vertex_count;
+		next.triangle_offset = triangle_count;
+		*current = next;
+	}
+
+	MeshletBounds computeBounds(Meshlet *meshlet, const void *mesh_vertices, u32 vertex_size, u32 position_offset) {
+		#define POSITION(v) ((const f32 *)((const u8 *)mesh_vertices + (u64)(v) * vertex_size + position_offset))
+
+		MeshletBounds result = {};
+		const f32 *first = POSITION(vertices[meshlet->vertex_offset]);
+		Vec3 min_bound = Vec3(first[0], first[1], first[2]);
+		Vec3 max_bound = min_bound;
+		for(u32 i = 1; i < meshlet->vertex_count; i++) {
+			const f32 *p = POSITION(vertices[meshlet->vertex_offset + i]);
+			min_bound = Vec3::rmin(min_bound, Vec3(p[0], p[1], p[2]));
+			max_bound = Vec3::rmax(max_bound, Vec3(p[0], p[1], p[2]));
+		}
+
+		result.center = (min_bound + max_bound) * 0.5f;
+		f32 radius_squared = 0.0f;
+		for(u32 i = 0; i < meshlet->vertex_count; i++) {
+			const f32 *p = POSITION(vertices[meshlet->vertex_offset + i]);
+			f32 distance_squared = Vec3::lengthSquared(Vec3(p[0], p[1], p[2]) - result.center);
+			if(distance_squared > radius_squared) radius_squared = distance_squared;
+		}
+		result.radius = Math::squareRoot(radius_squared);
+
+		// NOTE: the cone axis is the average of the unit face normals and its spread is the widest of them from it
+		Vec3 normals[MESHLET_MAX_TRIANGLES];
+		u32 normal_count = 0;
+		Vec3 axis = Vec3(0.0f);
+		for(u32 t = 0; t < meshlet->triangle_count; t++) {
+			u32 packed = triangles[meshlet->triangle_offset + t];
+			const f32 *p0 = POSITION(vertices[meshlet->vertex_offset + ((packed >> 0) & 0xff)]);
+			const f32 *p1 = POSITION(vertices[meshlet->vertex_offset + ((packed >> 8) & 0xff)]);
+			const f32 *p2 = POSITION(vertices[meshlet->vertex_offset + ((packed >> 16) & 0xff)]);
+			Vec3 a = Vec3(p0[0], p0[1], p0[2]);
+			Vec3 face = Vec3::cross(Vec3(p1[0], p1[1], p1[2]) - a, Vec3(p2[0], p2[1], p2[2]) - a);
+			f32 length = Vec3::length(face);
+			if(length <= 0.0f) continue;
+			normals[normal_count] = face * (1.0f / length);
+			axis = axis + normals[normal_count];
+			normal_count++;
+		}
+
+		#undef POSITION
+
+		result.cone_axis = Vec3(0.0f, 0.0f, 1.0f);
+		result.cone_cutoff = 1.0f;
+		f32 axis_length = Vec3::length(axis);
+		if(normal_count == 0 || axis_length <= 0.0f) return result;
+		axis = axis * (1.0f / axis_length);
+
+		f32 min_dot = 1.0f;
+		for(u32 i = 0; i < normal_count; i++) {
+			f32 d = Vec3::dot(axis, normals[i]);
+			if(d < min_dot) min_dot = d;
+		}
+
+		// NOTE: a cone wider than a hemisphere can't face away from any point, leave those unculled
+		if(min_dot <= 0.0f) return result;
+		result.cone_axis = axis;
+		result.cone_cutoff = Math::squareRoot(1.0f - min_dot * min_dot);
+		return result;
+	}
+
+	void destroy(Platform *platform) {
+		platform->free(bounds);
+		platform->free(triangles);
+		platform->free(vertices);
+		platform->free(meshlets);
+	}
+};
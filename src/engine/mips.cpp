@@ -0,0 +1,79 @@
+#include <core/platform.h>
+#include <emmintrin.h>
+
+inline u32 mipLevelCount(u32 width, u32 height) {
+	u32 largest = width > height ? width : height;
+	return log2Floor(largest) + 1;
+}
+
+inline u32 mipDimension(u32 size, u32 level) {
+	u32 result = size >> level;
+	return result > 0 ? result : 1;
+}
+
+// NOTE: size in bytes of levels [0, level_count) of a tightly packed rgba8 chain
+inline u64 mipChainSize(u32 width, u32 height, u32 level_count) {
+	u64 result = 0;
+	for(u32 level = 0; level < level_count; level++) {
+		result += (u64)mipDimension(width, level) * mipDimension(height, level) * 4;
+	}
+	return result;
+}
+
+// NOTE: 2x2 box filter of one rgba8 level into the next, odd edges clamp so the last row/column is reused
+internal_func void downsampleBoxRGBA8(const u8 *src, u32 src_width, u32 src_height, u8 *dst, u32 dst_width, u32 dst_height) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i round = _mm_set1_epi16(2);
+
+	for(u32 y = 0; y < dst_height; y++) {
+		u32 y0 = y * 2;
+		u32 y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+		const u8 *row0 = src + (u64)y0 * src_width * 4;
+		const u8 *row1 = src + (u64)y1 * src_width * 4;
+		u8 *out = dst + (u64)y * dst_width * 4;
+
+		u32 x = 0;
+		// NOTE: two output pixels per iteration, needs four whole source pixels on each row
+		if(src_width >= 2 && src_width == dst_width * 2) {
+			for(; x + 2 <= dst_width; x += 2) {
+				__m128i a = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+
+				__m128i sum_lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i sum_hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+				// NOTE: each half holds two horizontally adjacent pixels, fold them together
+				__m128i pixel0 = _mm_add_epi16(sum_lo, _mm_srli_si128(sum_lo, 8));
+				__m128i pixel1 = _mm_add_epi16(sum_hi, _mm_srli_si128(sum_hi, 8));
+				__m128i pixels = _mm_unpacklo_epi64(pixel0, pixel1);
+				pixels = _mm_srli_epi16(_mm_add_epi16(pixels, round), 2);
+
+				_mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(pixels, zero));
+			}
+		}
+
+		for(; x < dst_width; x++) {
+			u32 x0 = x * 2;
+			u32 x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+			for(u32 c = 0; c < 4; c++) {
+				u32 sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+				out[x * 4 + c] = (u8)((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+// NOTE: builds the full chain below level 0 in place, chain must be mipChainSize() bytes with level 0 already filled in
+internal_func void generateMipChainRGBA8(u8 *chain, u32 width, u32 height, u32 level_count) {
+	u8 *src = chain;
+	for(u32 level = 1; level < level_count; level++) {
+		u32 src_width = mipDimension(width, level - 1);
+		u32 src_height = mipDimension(height, level - 1);
+		u32 dst_width = mipDimension(width, level);
+		u32 dst_height = mipDimension(height, level);
+
+		u8 *dst = src + (u64)src_width * src_height * 4;
+		downsampleBoxRGBA8(src, src_width, src_height, dst, dst_width, dst_height);
+		src = dst;
+	}
+}
@@ -9,7 +9,7 @@
 #define Assert(Expression) if(!(Expression)) {*(int *)0 = 0;} else {}
 #define ArrayCount(Array) (sizeof(Array) / sizeof(Array[0]))
 
-inline char *formatString(char *Format, ...) {
+inline char *formatString(const char *Format, ...) {
 	static char char_buffer[1024];
 	va_list Va;
 	va_start(Va, Format);
@@ -45,12 +45,48 @@ typedef double f64;
 
 #define RGBA(r, g, b, a) ((a << 24) | (b << 16) | (g << 8) | r)
 
+#define AlignUp(value, alignment) (((value) + ((alignment) - 1)) & ~((alignment) - 1))
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// NOTE: value must be non zero
+inline u32 findFirstSetBit64(u64 value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctzll(value);
+#endif
+}
+
+inline u64 nextPowerOfTwo(u64 value) {
+	u64 result = 1;
+	while(result < value) result <<= 1;
+	return result;
+}
+
+inline u32 log2Floor(u64 value) {
+	u32 result = 0;
+	while(value > 1) {
+		value >>= 1;
+		result++;
+	}
+	return result;
+}
+
 
 #define GetByte(n, x) ((x >> (8*n)) & 0xff)
 // #define SetBit(n, v, x) x |= v << n;
 #define ContainsBits(n, b) ((n & b) == b)
 
+#ifdef _WIN32
 #define DLL_EXPORT __declspec(dllexport)
+#else
+#define DLL_EXPORT __attribute__((visibility("default")))
+#endif
 
 #define STATE_DEC(name)
 
@@ -4,23 +4,54 @@
 #include <engine/timer.cpp>
 #include <stdlib.h>
 #include <engine/math.cpp>
+#include <engine/frame_pacer.cpp>
 #include <string>
 #include <game/game.h>
 #include <core/platform.h>
 #include <engine/input.cpp>
 #include <core/render_context.h>
 #define STB_IMAGE_IMPLEMENTATION
-#include <core/stb_image.h>
+#include <stb_image.h>
 #include <engine/audio.h>
 #include <game/assets.cpp>
 #include <game/memory.h>
 #include <engine/audio.cpp>
+#include <engine/jobs.cpp>
+#include <engine/mips.cpp>
+#include <engine/mesh_optimizer.cpp>
+#include <engine/mesh_simplifier.cpp>
+#include <engine/mesh_lods.cpp>
+#include <engine/meshlets.cpp>
+#include <engine/cooked_texture.h>
 #include <SDL2/SDL.h>
 #include <vulkan/vulkan.h>
 #include <SDL2/SDL_vulkan.h>
+#include <core/vulkan_memory.cpp>
+#include <core/vulkan_deletion_queue.cpp>
+#include <core/vulkan_ring_buffer.cpp>
+#include <core/vulkan_pipeline_cache.cpp>
+#include <core/vulkan_shader_reflection.cpp>
+#include <core/shader_hot_reload.cpp>
+#include <core/vulkan_profiler.cpp>
+#include <core/vulkan_upload.cpp>
+#include <core/vulkan_bindless.cpp>
+#include <core/vulkan_culling.cpp>
+#include <core/vulkan_meshlet_culling.cpp>
+#include <core/vulkan_render_graph.cpp>
+#include <core/vulkan_vertex_layout.cpp>
+#include <core/vulkan_pipeline_permutations.cpp>
 #include <core/vulkan_renderer.cpp>
+#include <core/vulkan_render_context.cpp>
 #define TINYOBJLOADER_IMPLEMENTATION
-#include <core/tiny_obj_loader.h>
+#include <tiny_obj_loader.h>
+
+#ifdef _WIN32
+#define GAME_LIBRARY_NAME "game.dll"
+#define GAME_TEMP_LIBRARY_NAME "game_temp.dll"
+#else
+#define GAME_LIBRARY_NAME "libgame.so"
+#define GAME_TEMP_LIBRARY_NAME "libgame_temp.so"
+#endif
 
 struct GameCode {
 	void *game_code_dll;
@@ -66,28 +97,95 @@ internal_func void unloadGameCode(Platform *platform, GameCode *game_code) {
 	game_code->render = gameRenderStub;	
 }
 
+// NOTE: fixed timestep so every run renders the same frames, the time reported is wall clock per frame including waiting on the gpu
+internal_func void runHeadless(Platform *platform, VulkanRenderer *renderer, u32 frame_count, const char *capture_path) {
+	f32 delta = 1.0f / 60.0f;
+	u32 warmup_frames = frame_count / 10;
+	u64 start_counter = platform->getPerformanceCounter();
+	
+	for(u32 frame = 0; frame < frame_count; frame++) {
+		if(frame == warmup_frames) start_counter = platform->getPerformanceCounter();
+		
+		renderer->startFrame(platform);
+		if(capture_path != 0 && frame == frame_count - 1) {
+			renderer->requestReadback(platform, capture_path);
+		}
+		renderer->renderFrame(platform, 0, delta);
+		renderer->endFrame();
+	}
+	
+	vkDeviceWaitIdle(renderer->device);
+	u64 end_counter = platform->getPerformanceCounter();
+	
+	u32 timed_frames = frame_count - warmup_frames;
+	f32 seconds = (f32)(end_counter - start_counter) / (f32)platform->getPerformanceFrequency();
+	printf("Headless: %u frames at %ux%u, %.3fms/frame\n", timed_frames, renderer->extent.width, renderer->extent.height, timed_frames > 0 ? seconds * 1000.0f / (f32)timed_frames : 0.0f);
+	renderer->profiler.printTimings();
+}
+
+// NOTE: too big for main's stack, the context's inline caches alone are about half a megabyte
+global_variable VulkanRenderer g_renderer;
+global_variable VulkanRenderContext g_render_context;
+
 int main(int arg_count, char *args[]) {
 	
+	VulkanRenderer &renderer = g_renderer;
+	bool headless = false;
+	u32 headless_frame_count = 300;
+	const char *capture_path = 0;
+	f32 target_rate = 60.0f;
+	bool rebuild_lods = false;
+	
+	for(int i = 1; i < arg_count; i++) {
+		if(strcmp(args[i], "-bench-pipeline-cache") == 0) renderer.benchmark_pipeline_cache = true;
+		if(strcmp(args[i], "-bench-mips") == 0) renderer.benchmark_mips = true;
+		if(strcmp(args[i], "-bench-instancing") == 0) renderer.benchmark_instancing = true;
+		if(strcmp(args[i], "-no-gpu-culling") == 0) renderer.disable_gpu_culling = true;
+		if(strcmp(args[i], "-no-meshlet-culling") == 0) renderer.disable_meshlet_culling = true;
+		if(strcmp(args[i], "-no-lods") == 0) renderer.disable_lods = true;
+		if(strcmp(args[i], "-rebuild-lods") == 0) rebuild_lods = true;
+		if(strcmp(args[i], "-lod-error") == 0 && i + 1 < arg_count) renderer.lod_pixel_error = (f32)atof(args[++i]); // NOTE: in pixels
+		if(strcmp(args[i], "-cpu-mips") == 0) renderer.force_cpu_mips = true;
+		if(strcmp(args[i], "-no-mips") == 0) renderer.disable_mips = true;
+		if(strcmp(args[i], "-no-bindless") == 0) renderer.disable_bindless = true;
+		if(strcmp(args[i], "-no-shader-reload") == 0) renderer.disable_shader_reload = true;
+		if(strcmp(args[i], "-full-vertices") == 0) renderer.full_vertices = true;
+		if(strcmp(args[i], "-vertex-colors") == 0) renderer.vertex_colors = true;
+		if(strcmp(args[i], "-headless") == 0) headless = true;
+		if(strcmp(args[i], "-frames") == 0 && i + 1 < arg_count) headless_frame_count = (u32)atoi(args[++i]);
+		if(strcmp(args[i], "-capture") == 0 && i + 1 < arg_count) capture_path = args[++i];
+		if(strcmp(args[i], "-size") == 0 && i + 1 < arg_count) sscanf(args[++i], "%ux%u", &renderer.headless_width, &renderer.headless_height);
+		if(strcmp(args[i], "-fps") == 0 && i + 1 < arg_count) target_rate = (f32)atof(args[++i]); // NOTE: 0 leaves pacing to the present mode
+		if(strcmp(args[i], "-present") == 0 && i + 1 < arg_count) {
+			const char *mode = args[++i];
+			if(strcmp(mode, "fifo") == 0) renderer.preferred_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+			else if(strcmp(mode, "fifo-relaxed") == 0) renderer.preferred_present_mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			else if(strcmp(mode, "mailbox") == 0) renderer.preferred_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+			else if(strcmp(mode, "immediate") == 0) renderer.preferred_present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			else printf("Unknown present mode %s, expected fifo, fifo-relaxed, mailbox or immediate\n", mode);
+		}
+	}
+	renderer.headless = headless;
+	
 	Platform platform = {};
-	if(!platform.init()) {
+	if(!platform.init(headless)) {
 		platform.error("Couldn't init platform");
 	}
 	
 	char *base_path = platform.getExePath();
-	std::string game_dll_name = std::string(base_path) + "game.dll";
-	std::string temp_game_dll_name = std::string(base_path) + "game_temp.dll";
+	std::string game_dll_name = std::string(base_path) + GAME_LIBRARY_NAME;
+	std::string temp_game_dll_name = std::string(base_path) + GAME_TEMP_LIBRARY_NAME;
 	
 	u32 window_width = 1600;
 	u32 window_height = 900;
 	
-	PlatformWindow window = platform.createWindow("Pawprint Engine", window_width, window_height, true, true);
-	
-	
-	if(window.handle == 0) {
-		platform.error("Couldn't create window");
+	PlatformWindow window = {};
+	if(!headless) {
+		window = platform.createWindow("Pawprint Engine", window_width, window_height, true, true);
+		if(window.handle == 0) {
+			platform.error("Couldn't create window");
+		}
 	}
-	s32 refresh_rate = 60;
-	
 	
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -118,24 +216,55 @@ int main(int arg_count, char *args[]) {
 			
 			vertex.color = Vec3(1.0f);
 			
+			if(index.normal_index >= 0) {
+				vertex.normal = {
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2],
+				};
+			}
+			
 			vertices.push_back(vertex);
 			indices.push_back((u32)indices.size());
 		}
 	}
 	
-	VulkanRenderer renderer;
+	// NOTE: the loop above emits a vertex per index, nothing is shared until the optimizer dedups them
+	u32 optimized_vertex_count = optimizeMesh(&platform, vertices.data(), (u32)vertices.size(), sizeof(Vertex), offsetof(Vertex, pos), indices.data(), (u32)indices.size());
+	vertices.resize(optimized_vertex_count);
+	
+	u32 lod_index_count;
+	u32 *lod_indices = buildMeshLods(&platform, "data/models/chalet.plod", rebuild_lods, vertices.data(), (u32)vertices.size(), sizeof(Vertex), offsetof(Vertex, pos), indices.data(), (u32)indices.size(), renderer.lods, &renderer.lod_count, &lod_index_count);
+	indices.insert(indices.end(), lod_indices, lod_indices + lod_index_count);
+	platform.free(lod_indices);
+	
 	renderer.vertices = vertices.data();
 	renderer.vertex_count = (u32)vertices.size();
 	
 	renderer.indices = indices.data();
 	renderer.index_count = (u32)indices.size();
 	
+	if(headless) {
+		// NOTE: no window, audio or game code, just the renderer so CI can time and capture frames
+		renderer.init(&platform, 0);
+		runHeadless(&platform, &renderer, headless_frame_count, capture_path);
+		renderer.cleanup(&platform);
+		platform.uninit();
+		return 0;
+	}
+	
 	renderer.init(&platform, &window);	
 	
+	VulkanRenderContext &render_context = g_render_context;
+	render_context.attach(&platform, &renderer);
+	render_context.init(window_width, window_height, 0, &window);
+	
 	AudioEngine audio_engine;
 	audio_engine.init();
 	
-	Timer frame_timer = Timer(&platform);
+	FramePacer pacer;
+	pacer.init(&platform, target_rate);
+	renderer.pacer = &pacer;
 	bool running = true;
 	
 	MemoryStore mem_store = {};
@@ -157,8 +286,7 @@ int main(int arg_count, char *args[]) {
 	}
 	
 	
-	f32 target_seconds_per_frame = 1.0f / (f32)refresh_rate;
-	f32 delta = target_seconds_per_frame;
+	f32 delta = target_rate > 0.0f ? 1.0f / target_rate : 1.0f / 60.0f;
 
 	Assets *game_assets = (Assets *)mem_store.asset_memory.memory;
 	Assets::db = game_assets;
@@ -166,20 +294,22 @@ int main(int arg_count, char *args[]) {
 	platform.getDirectoryContents();
 	
 	GameCode game_code = loadGameCode(&platform, game_dll_name.c_str(), temp_game_dll_name.c_str());
-	game_code.init(&platform, &mem_store, 0, game_assets, &audio_engine);
-	
-	u32 current_frame = 0;
+	game_code.init(&platform, &mem_store, &render_context, game_assets, &audio_engine);
 	
 	InputManager input(&window);
 	while(running) {
-		renderer.startFrame();
+		// NOTE: wait before sampling input rather than after rendering, so the sleep doesn't add to input latency
+		f32 frame_delta = pacer.beginFrame();
+		if(frame_delta > 0.0f) delta = frame_delta;
 		
-		frame_timer.start(&platform);
+		renderer.startFrame(&platform);
+		render_context.beginFrame();
 		
 		bool requested_to_quit = false;
 		platform.processEvents(&window, requested_to_quit);
 		running = !requested_to_quit;
 		input.processKeys(&platform);
+		pacer.mark(LatencyMarker::InputSample);
 		
 		FileTime new_dll_write_time = platform.getLastWriteTime((char *)game_dll_name.c_str());
 		if(platform.compareFileTime(&new_dll_write_time, &game_code.last_write_time) != 0) {
@@ -197,41 +327,29 @@ int main(int arg_count, char *args[]) {
 			platform.setWindowFullscreen(&window, platform.isWindowFullscreen(&window));
 		}
 		
-		game_code.update(&platform, &mem_store, &input, delta, &window, game_assets);
+		// NOTE: cycles the debug views, each is a specialization of the same shaders
+		if(input.isKeyDownOnce(Key::F2)) {
+			renderer.debug_view = (DebugView)(((u32)renderer.debug_view + 1) % (u32)DebugView::Count);
+		}
 		
-		renderer.renderFrame(&platform, &window, delta);
+		game_code.update(&platform, &mem_store, &input, delta, &window, game_assets);
 		
-		game_code.render(&platform, &mem_store, &window, 0, &input, game_assets, delta);
+		// NOTE: the game's draws are only recorded, renderFrame is what puts them in the frame
+		game_code.render(&platform, &mem_store, &window, &render_context, &input, game_assets, delta);
 		
-		u64 work_counter = frame_timer.getWallClock(&platform);
-		f32 work_seconds_elapsed = frame_timer.getSecondsElapsed(&platform);
+		renderer.renderFrame(&platform, &window, delta);
 		
-		f32 seconds_elapsed_for_frame = work_seconds_elapsed;
-		if(seconds_elapsed_for_frame < target_seconds_per_frame)
-		{
-			u32 sleep_ms = (u32)((1000.0f * (target_seconds_per_frame - seconds_elapsed_for_frame)) - 1);
-			if(sleep_ms > 0)
-				platform.sleepMS(sleep_ms);
-			while(seconds_elapsed_for_frame < target_seconds_per_frame)
-			{
-				seconds_elapsed_for_frame = frame_timer.getSecondsElapsed(&platform);
-			}
-		}
-		else
-		{
-			// missed frame
-			printf("Missed frame\n");
-		}
-		u64 end_counter = frame_timer.getWallClock(&platform);
-		delta = frame_timer.getSecondsElapsed(&platform);
+		pacer.endFrame();
 		input.endFrame();
 		
-		platform.setWindowTitle(&window, formatString("%.3fms/frame", delta * 1000.0f));
+		platform.setWindowTitle(&window, formatString("%.3fms/frame +-%.3fms, gpu %.3fms, input->present %.3fms", pacer.frame_times.mean(), Math::squareRoot(pacer.frame_times.variance()), renderer.profiler.getAverageMilliseconds("frame"), pacer.input_to_present.mean()));
 		
 		renderer.endFrame();
 	}
 	
-	renderer.cleanup();
+	pacer.printStats();
+	render_context.uninit();
+	renderer.cleanup(&platform);
 	audio_engine.uninit();
 	unloadGameCode(&platform, &game_code);
 	platform.destroyWindow(&window);
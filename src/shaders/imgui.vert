@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+layout(set = 0, binding = 0) uniform ImGuiConstants {
+	mat4 projection;
+} constants;
+
+void main() {
+	gl_Position = constants.projection * vec4(inPosition, 0.0, 1.0);
+	// NOTE: the projection is built for a y up clip space, Vulkan's points down
+	gl_Position.y = -gl_Position.y;
+	fragColor = inColor;
+	fragUV = inUV;
+}
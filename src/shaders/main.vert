@@ -3,23 +3,41 @@
 
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec3 in_color;
-layout(location = 2) in vec3 in_uv;
+layout(location = 2) in vec2 in_uv;
+layout(location = 3) in vec2 in_normal; // NOTE: octahedral encoded
+
+// NOTE: specialization constants, set per pipeline permutation
+layout(constant_id = 0) const bool QUANTIZED_POSITIONS = true;
+layout(constant_id = 1) const bool VERTEX_COLORS = true;
 
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
 layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec3 fragUV;
+layout(location = 1) out vec2 fragUV;
+layout(location = 3) out vec3 fragNormal;
 
 layout(binding = 0) uniform UniformBufferObject {
 	mat4 model;
 	mat4 view;
 	mat4 projection;	
+	vec4 position_scale; // NOTE: undoes quantized positions, identity for float ones
+	vec4 position_offset;
 } ubo;
 
+vec3 octahedralDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main() {
-    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(in_position, 1.0);
-    fragColor = in_color;
+	vec3 position = QUANTIZED_POSITIONS ? in_position * ubo.position_scale.xyz + ubo.position_offset.xyz : in_position;
+    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(position, 1.0);
+    fragColor = VERTEX_COLORS ? in_color : vec3(1.0);
     fragUV = in_uv;
+    fragNormal = normalize(mat3(ubo.model) * octahedralDecode(in_normal));
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
+layout(location = 2) flat in uint fragTextureIndex;
+layout(location = 3) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+// NOTE: specialization constant, set per pipeline permutation. 0 shaded, 1 normals, 2 uvs
+layout(constant_id = 2) const uint DEBUG_VIEW = 0;
+
+layout(set = 1, binding = 0) uniform sampler2D u_textures[];
+
+void main() {
+	if(DEBUG_VIEW == 1) {
+		outColor = vec4(normalize(fragNormal) * 0.5 + 0.5, 1.0);
+		return;
+	}
+	if(DEBUG_VIEW == 2) {
+		outColor = vec4(fract(fragUV), 0.0, 1.0);
+		return;
+	}
+    outColor = texture(u_textures[nonuniformEXT(fragTextureIndex)], fragUV) * vec4(fragColor, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+// NOTE: Headless checks for the buddy suballocator in core/vulkan_memory.cpp. Runs on the first device the loader
+// reports, point VK_ICD_FILENAMES at lavapipe to run it without a gpu. Exits non zero if any check fails.
+// usage: gpu_memory_test
+#include <stdio.h>
+#include <string.h>
+#include <engine/std.h>
+#include <core/platform.h>
+#include <vulkan/vulkan.h>
+#include <core/vulkan_memory.cpp>
+
+global_variable u32 g_check_count = 0;
+global_variable u32 g_failure_count = 0;
+
+#define Check(condition) checkResult((condition), #condition, __LINE__)
+
+internal_func void checkResult(bool passed, const char *condition, int line) {
+	g_check_count++;
+	if(passed) return;
+	printf("FAILED line %d: %s\n", line, condition);
+	g_failure_count++;
+}
+
+internal_func VkMemoryRequirements memoryRequirements(VkDeviceSize size, VkDeviceSize alignment, u32 memory_type) {
+	VkMemoryRequirements result = {};
+	result.size = size;
+	result.alignment = alignment;
+	result.memoryTypeBits = 1u << memory_type;
+	return result;
+}
+
+internal_func void testAllocFree(GpuMemoryAllocator *allocator, u32 memory_type) {
+	GpuAllocation allocation = allocator->allocate(memoryRequirements(1000, 16, memory_type), 0);
+	Check(allocation.memory != VK_NULL_HANDLE);
+	Check(allocation.block_index >= 0);
+	Check(allocation.size >= 1000);
+	Check((allocation.size & (allocation.size - 1)) == 0);
+
+	GpuMemoryStats stats = allocator->getStats(memory_type);
+	Check(stats.block_count == 1);
+	Check(stats.allocation_count == 1);
+	Check(stats.allocated_bytes == allocation.size);
+
+	allocator->free(&allocation);
+	Check(allocation.memory == VK_NULL_HANDLE);
+	stats = allocator->getStats(memory_type);
+	Check(stats.allocation_count == 0);
+	Check(stats.allocated_bytes == 0);
+	Check(stats.block_count == 1); // NOTE: the last empty block is kept
+}
+
+internal_func void testCoalescing(GpuMemoryAllocator *allocator, u32 memory_type) {
+	VkDeviceSize block_size = allocator->types[memory_type].block_size;
+	VkDeviceSize quarter = block_size / 4;
+
+	GpuAllocation allocations[4];
+	for(u32 i = 0; i < 4; i++) {
+		allocations[i] = allocator->allocate(memoryRequirements(quarter, 16, memory_type), 0);
+		Check(allocations[i].block_index == allocations[0].block_index);
+		Check(allocations[i].offset == quarter * i);
+	}
+
+	// NOTE: 1 and 2 aren't buddies, so they stay two quarter sized ranges
+	allocator->free(&allocations[1]);
+	allocator->free(&allocations[2]);
+	GpuMemoryStats stats = allocator->getStats(memory_type);
+	Check(stats.free_range_count == 2);
+	Check(stats.largest_free_range == quarter);
+
+	allocator->free(&allocations[0]);
+	stats = allocator->getStats(memory_type);
+	Check(stats.free_range_count == 2);
+	Check(stats.largest_free_range == quarter * 2);
+
+	allocator->free(&allocations[3]);
+	stats = allocator->getStats(memory_type);
+	Check(stats.free_range_count == 1);
+	Check(stats.largest_free_range == block_size);
+	Check(stats.fragmentation == 0.0f);
+}
+
+internal_func void testAlignment(GpuMemoryAllocator *allocator, u32 memory_type) {
+	VkDeviceSize block_size = allocator->types[memory_type].block_size;
+
+	GpuAllocation allocations[32];
+	u32 allocation_count = ArrayCount(allocations);
+	for(u32 i = 0; i < allocation_count; i++) {
+		VkDeviceSize size = 100 + i * 777;
+		VkDeviceSize alignment = 1ull << (4 + i % 13);
+		allocations[i] = allocator->allocate(memoryRequirements(size, alignment, memory_type), 0);
+		Check(allocations[i].offset % alignment == 0);
+		Check(allocations[i].offset % allocator->buffer_image_granularity == 0);
+		Check(allocations[i].size >= size);
+		Check(allocations[i].offset + allocations[i].size <= block_size);
+	}
+
+	for(u32 i = 0; i < allocation_count; i++) {
+		for(u32 j = i + 1; j < allocation_count; j++) {
+			if(allocations[i].memory != allocations[j].memory) continue;
+			bool disjoint = allocations[i].offset + allocations[i].size <= allocations[j].offset || allocations[j].offset + allocations[j].size <= allocations[i].offset;
+			Check(disjoint);
+		}
+	}
+
+	for(u32 i = 0; i < allocation_count; i++) allocator->free(&allocations[i]);
+	GpuMemoryStats stats = allocator->getStats(memory_type);
+	Check(stats.allocation_count == 0);
+	Check(stats.free_range_count == 1);
+}
+
+internal_func void testExhaustion(GpuMemoryAllocator *allocator, u32 memory_type) {
+	VkDeviceSize block_size = allocator->types[memory_type].block_size;
+
+	GpuAllocation first = allocator->allocate(memoryRequirements(block_size / 2, 16, memory_type), 0);
+	GpuAllocation second = allocator->allocate(memoryRequirements(block_size / 2, 16, memory_type), 0);
+	Check(first.block_index == second.block_index);
+	GpuMemoryBlock *block = &allocator->types[memory_type].blocks[first.block_index];
+	Check(block->allocNode(block->level_count - 1) == -1);
+
+	// NOTE: a full block moves on to a new one, anything bigger than a block gets its own device allocation
+	GpuAllocation third = allocator->allocate(memoryRequirements(256, 16, memory_type), 0);
+	Check(third.block_index >= 0 && third.block_index != first.block_index);
+	GpuAllocation dedicated = allocator->allocate(memoryRequirements(block_size + 1, 16, memory_type), 0);
+	Check(dedicated.block_index == -1);
+
+	GpuMemoryStats stats = allocator->getStats(memory_type);
+	Check(stats.block_count == 2);
+	Check(stats.dedicated_count == 1);
+	Check(stats.allocation_count == 4);
+
+	allocator->free(&first);
+	allocator->free(&second);
+	allocator->free(&third);
+	allocator->free(&dedicated);
+	stats = allocator->getStats(memory_type);
+	Check(stats.block_count == 1);
+	Check(stats.dedicated_count == 0);
+	Check(stats.allocation_count == 0);
+}
+
+int main(int arg_count, char *args[]) {
+	Platform platform = {};
+	if(!platform.init(true)) {
+		printf("Couldn't initialize the platform\n");
+		return 1;
+	}
+
+	VkApplicationInfo app_info = {};
+	app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	app_info.pApplicationName = "gpu_memory_test";
+	app_info.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instance_info = {};
+	instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instance_info.pApplicationInfo = &app_info;
+
+	VkInstance instance;
+	if(vkCreateInstance(&instance_info, 0, &instance) != VK_SUCCESS) {
+		printf("Couldn't create a Vulkan instance\n");
+		return 1;
+	}
+
+	u32 physical_device_count = 1;
+	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+	vkEnumeratePhysicalDevices(instance, &physical_device_count, &physical_device);
+	if(physical_device == VK_NULL_HANDLE) {
+		printf("No Vulkan device\n");
+		return 1;
+	}
+
+	VkPhysicalDeviceProperties device_props;
+	vkGetPhysicalDeviceProperties(physical_device, &device_props);
+	printf("Testing the gpu allocator on %s\n", device_props.deviceName);
+
+	f32 queue_priority = 1.0f;
+	VkDeviceQueueCreateInfo queue_info = {};
+	queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queue_info.queueFamilyIndex = 0;
+	queue_info.queueCount = 1;
+	queue_info.pQueuePriorities = &queue_priority;
+
+	VkDeviceCreateInfo device_info = {};
+	device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	device_info.queueCreateInfoCount = 1;
+	device_info.pQueueCreateInfos = &queue_info;
+
+	VkDevice device;
+	if(vkCreateDevice(physical_device, &device_info, 0, &device) != VK_SUCCESS) {
+		printf("Couldn't create a Vulkan device\n");
+		return 1;
+	}
+
+	GpuMemoryAllocator allocator;
+	allocator.init(&platform, physical_device, device);
+	u32 memory_type = allocator.findMemoryType(~0u, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	testAllocFree(&allocator, memory_type);
+	testCoalescing(&allocator, memory_type);
+	testAlignment(&allocator, memory_type);
+	testExhaustion(&allocator, memory_type);
+
+	allocator.destroy();
+	vkDestroyDevice(device, 0);
+	vkDestroyInstance(instance, 0);
+	platform.uninit();
+
+	printf("%u / %u checks passed\n", g_check_count - g_failure_count, g_check_count);
+	return g_failure_count == 0 ? 0 : 1;
+}
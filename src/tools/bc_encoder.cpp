@@ -0,0 +1,296 @@
+// NOTE: Block encoders for BC1/3/4/5/7. Every function takes one 4x4 block of rgba8 texels in row order. These are
+// single pass encoders (principal axis endpoints, nearest palette index), good enough for cooking at build time
+// but not competitive with an exhaustive search.
+
+struct BlockBitWriter {
+	u8 bytes[16];
+	u32 bit;
+
+	void write(u32 value, u32 count) {
+		for(u32 i = 0; i < count; i++) {
+			if(value & (1 << i)) bytes[bit >> 3] |= (u8)(1 << (bit & 7));
+			bit++;
+		}
+	}
+};
+
+internal_func s32 squaredDistance(const u8 *a, const u8 *b, u32 channels) {
+	s32 result = 0;
+	for(u32 c = 0; c < channels; c++) {
+		s32 d = (s32)a[c] - (s32)b[c];
+		result += d * d;
+	}
+	return result;
+}
+
+// NOTE: finds the two block texels furthest apart along the dominant axis of the block's colour distribution
+internal_func void principalEndpoints(const u8 *texels, u32 channels, f32 *min_out, f32 *max_out) {
+	f32 mean[4] = {};
+	for(u32 i = 0; i < 16; i++) {
+		for(u32 c = 0; c < channels; c++) mean[c] += texels[i * 4 + c];
+	}
+	for(u32 c = 0; c < channels; c++) mean[c] /= 16.0f;
+
+	f32 covariance[4][4] = {};
+	for(u32 i = 0; i < 16; i++) {
+		f32 d[4] = {};
+		for(u32 c = 0; c < channels; c++) d[c] = texels[i * 4 + c] - mean[c];
+		for(u32 a = 0; a < channels; a++) {
+			for(u32 b = 0; b < channels; b++) covariance[a][b] += d[a] * d[b];
+		}
+	}
+
+	// NOTE: a few rounds of power iteration is plenty for a 4x4 block
+	f32 axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+	for(u32 iteration = 0; iteration < 8; iteration++) {
+		f32 next[4] = {};
+		for(u32 a = 0; a < channels; a++) {
+			for(u32 b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+		}
+
+		f32 length = 0.0f;
+		for(u32 c = 0; c < channels; c++) length += next[c] * next[c];
+		if(length < 1e-8f) break;
+
+		length = sqrtf(length);
+		for(u32 c = 0; c < channels; c++) axis[c] = next[c] / length;
+	}
+
+	f32 min_t = 1e30f;
+	f32 max_t = -1e30f;
+	for(u32 i = 0; i < 16; i++) {
+		f32 t = 0.0f;
+		for(u32 c = 0; c < channels; c++) t += (texels[i * 4 + c] - mean[c]) * axis[c];
+		if(t < min_t) min_t = t;
+		if(t > max_t) max_t = t;
+	}
+
+	for(u32 c = 0; c < channels; c++) {
+		f32 lo = mean[c] + axis[c] * min_t;
+		f32 hi = mean[c] + axis[c] * max_t;
+		min_out[c] = lo < 0.0f ? 0.0f : (lo > 255.0f ? 255.0f : lo);
+		max_out[c] = hi < 0.0f ? 0.0f : (hi > 255.0f ? 255.0f : hi);
+	}
+}
+
+internal_func u16 packRGB565(const f32 *color) {
+	u32 r = (u32)(color[0] * 31.0f / 255.0f + 0.5f);
+	u32 g = (u32)(color[1] * 63.0f / 255.0f + 0.5f);
+	u32 b = (u32)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (u16)((r << 11) | (g << 5) | b);
+}
+
+internal_func void unpackRGB565(u16 packed, u8 *out) {
+	u32 r = (packed >> 11) & 31;
+	u32 g = (packed >> 5) & 63;
+	u32 b = packed & 31;
+	out[0] = (u8)((r << 3) | (r >> 2));
+	out[1] = (u8)((g << 2) | (g >> 4));
+	out[2] = (u8)((b << 3) | (b >> 2));
+}
+
+internal_func void encodeBC1Block(const u8 *texels, u8 *out) {
+	f32 lo[4], hi[4];
+	principalEndpoints(texels, 3, lo, hi);
+
+	u16 c0 = packRGB565(hi);
+	u16 c1 = packRGB565(lo);
+	if(c0 < c1) Swap(c0, c1);
+
+	u32 indices = 0;
+	if(c0 != c1) {
+		// NOTE: c0 > c1 selects the four colour mode
+		u8 palette[4][3];
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		for(u32 c = 0; c < 3; c++) {
+			palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+
+		for(u32 i = 0; i < 16; i++) {
+			u32 best = 0;
+			s32 best_error = squaredDistance(&texels[i * 4], palette[0], 3);
+			for(u32 p = 1; p < 4; p++) {
+				s32 error = squaredDistance(&texels[i * 4], palette[p], 3);
+				if(error < best_error) {
+					best_error = error;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	out[0] = (u8)(c0 & 0xff);
+	out[1] = (u8)(c0 >> 8);
+	out[2] = (u8)(c1 & 0xff);
+	out[3] = (u8)(c1 >> 8);
+	out[4] = (u8)(indices & 0xff);
+	out[5] = (u8)((indices >> 8) & 0xff);
+	out[6] = (u8)((indices >> 16) & 0xff);
+	out[7] = (u8)(indices >> 24);
+}
+
+// NOTE: single channel block, channel selects which byte of each texel is encoded
+internal_func void encodeBC4Block(const u8 *texels, u32 channel, u8 *out) {
+	u8 lo = 255;
+	u8 hi = 0;
+	for(u32 i = 0; i < 16; i++) {
+		u8 v = texels[i * 4 + channel];
+		if(v < lo) lo = v;
+		if(v > hi) hi = v;
+	}
+
+	out[0] = hi;
+	out[1] = lo;
+
+	u64 indices = 0;
+	if(hi != lo) {
+		// NOTE: a0 > a1 selects the eight value mode, index 0 is a0, 1 is a1 and 2-7 step from a0 to a1
+		u8 palette[8];
+		palette[0] = hi;
+		palette[1] = lo;
+		for(u32 p = 1; p < 7; p++) {
+			palette[p + 1] = (u8)(((7 - p) * hi + p * lo + 3) / 7);
+		}
+
+		for(u32 i = 0; i < 16; i++) {
+			s32 v = texels[i * 4 + channel];
+			u32 best = 0;
+			s32 best_error = 256;
+			for(u32 p = 0; p < 8; p++) {
+				s32 error = v > palette[p] ? v - palette[p] : palette[p] - v;
+				if(error < best_error) {
+					best_error = error;
+					best = p;
+				}
+			}
+			indices |= (u64)best << (i * 3);
+		}
+	}
+
+	for(u32 b = 0; b < 6; b++) {
+		out[2 + b] = (u8)((indices >> (b * 8)) & 0xff);
+	}
+}
+
+internal_func void encodeBC3Block(const u8 *texels, u8 *out) {
+	encodeBC4Block(texels, 3, out);
+	encodeBC1Block(texels, out + 8);
+}
+
+internal_func void encodeBC5Block(const u8 *texels, u8 *out) {
+	encodeBC4Block(texels, 0, out);
+	encodeBC4Block(texels, 1, out + 8);
+}
+
+// NOTE: BC7 mode 6, one subset, rgba 7.7.7.7 endpoints with a unique p-bit each and 4 bit indices
+internal_func void encodeBC7Block(const u8 *texels, u8 *out) {
+	local_persist const u32 weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	f32 lo[4], hi[4];
+	principalEndpoints(texels, 4, lo, hi);
+
+	u8 endpoints[2][4];
+	u32 quantized[2][4];
+	u32 pbits[2];
+	f32 *targets[2] = {lo, hi};
+	for(u32 e = 0; e < 2; e++) {
+		u32 best_pbit = 0;
+		f32 best_error = 1e30f;
+		for(u32 p = 0; p < 2; p++) {
+			f32 error = 0.0f;
+			for(u32 c = 0; c < 4; c++) {
+				s32 q = (s32)((targets[e][c] - p) / 2.0f + 0.5f);
+				q = q < 0 ? 0 : (q > 127 ? 127 : q);
+				f32 d = (f32)((q << 1) | p) - targets[e][c];
+				error += d * d;
+			}
+			if(error < best_error) {
+				best_error = error;
+				best_pbit = p;
+			}
+		}
+
+		pbits[e] = best_pbit;
+		for(u32 c = 0; c < 4; c++) {
+			s32 q = (s32)((targets[e][c] - best_pbit) / 2.0f + 0.5f);
+			q = q < 0 ? 0 : (q > 127 ? 127 : q);
+			quantized[e][c] = (u32)q;
+			endpoints[e][c] = (u8)((q << 1) | best_pbit);
+		}
+	}
+
+	u8 palette[16][4];
+	for(u32 p = 0; p < 16; p++) {
+		for(u32 c = 0; c < 4; c++) {
+			palette[p][c] = (u8)(((64 - weights[p]) * endpoints[0][c] + weights[p] * endpoints[1][c] + 32) >> 6);
+		}
+	}
+
+	u32 indices[16];
+	for(u32 i = 0; i < 16; i++) {
+		u32 best = 0;
+		s32 best_error = squaredDistance(&texels[i * 4], palette[0], 4);
+		for(u32 p = 1; p < 16; p++) {
+			s32 error = squaredDistance(&texels[i * 4], palette[p], 4);
+			if(error < best_error) {
+				best_error = error;
+				best = p;
+			}
+		}
+		indices[i] = best;
+	}
+
+	// NOTE: the anchor index is stored with its top bit implied zero, swap the endpoints if it isn't
+	if(indices[0] & 8) {
+		for(u32 c = 0; c < 4; c++) Swap(quantized[0][c], quantized[1][c]);
+		Swap(pbits[0], pbits[1]);
+		for(u32 i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+	}
+
+	BlockBitWriter writer = {};
+	writer.write(1 << 6, 7);
+	for(u32 c = 0; c < 4; c++) {
+		writer.write(quantized[0][c], 7);
+		writer.write(quantized[1][c], 7);
+	}
+	writer.write(pbits[0], 1);
+	writer.write(pbits[1], 1);
+	writer.write(indices[0], 3);
+	for(u32 i = 1; i < 16; i++) {
+		writer.write(indices[i], 4);
+	}
+
+	memcpy(out, writer.bytes, 16);
+}
+
+// NOTE: encodes a whole rgba8 level, edge blocks repeat the last row/column
+internal_func void encodeLevel(CookedTextureFormat format, const u8 *pixels, u32 width, u32 height, u8 *out) {
+	u32 block_size = cookedTextureBlockSize(format);
+	u32 blocks_x = (width + 3) / 4;
+	u32 blocks_y = (height + 3) / 4;
+
+	for(u32 by = 0; by < blocks_y; by++) {
+		for(u32 bx = 0; bx < blocks_x; bx++) {
+			u8 texels[16 * 4];
+			for(u32 y = 0; y < 4; y++) {
+				u32 py = by * 4 + y < height ? by * 4 + y : height - 1;
+				for(u32 x = 0; x < 4; x++) {
+					u32 px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+					memcpy(&texels[(y * 4 + x) * 4], &pixels[((u64)py * width + px) * 4], 4);
+				}
+			}
+
+			u8 *block = out + ((u64)by * blocks_x + bx) * block_size;
+			switch(format) {
+				case CookedTextureFormat::BC1: encodeBC1Block(texels, block); break;
+				case CookedTextureFormat::BC3: encodeBC3Block(texels, block); break;
+				case CookedTextureFormat::BC5: encodeBC5Block(texels, block); break;
+				case CookedTextureFormat::BC7: encodeBC7Block(texels, block); break;
+				default: break;
+			}
+		}
+	}
+}
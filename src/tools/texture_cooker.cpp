@@ -0,0 +1,106 @@
+// NOTE: Offline texture cooker, decodes an image, builds the mip chain and writes it out block compressed.
+// usage: texture_cooker <input image> <output .ptex> [bc1|bc3|bc5|bc7]
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <engine/std.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <engine/mips.cpp>
+#include <engine/cooked_texture.h>
+#include <tools/bc_encoder.cpp>
+
+internal_func bool parseFormat(const char *name, CookedTextureFormat *format) {
+	for(u32 i = 0; i < (u32)CookedTextureFormat::Count; i++) {
+		if(strcmp(name, cookedTextureFormatName((CookedTextureFormat)i)) == 0) {
+			*format = (CookedTextureFormat)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int arg_count, char *args[]) {
+	if(arg_count < 3) {
+		printf("usage: texture_cooker <input image> <output .ptex> [bc1|bc3|bc5|bc7]\n");
+		return 1;
+	}
+
+	CookedTextureFormat format = CookedTextureFormat::BC7;
+	if(arg_count > 3 && !parseFormat(args[3], &format)) {
+		printf("Unknown format %s\n", args[3]);
+		return 1;
+	}
+
+	int width, height, channels;
+	u8 *pixels = stbi_load(args[1], &width, &height, &channels, STBI_rgb_alpha);
+	if(pixels == 0) {
+		printf("Couldn't load %s\n", args[1]);
+		return 1;
+	}
+	if((u32)width > COOKED_TEXTURE_MAX_DIMENSION || (u32)height > COOKED_TEXTURE_MAX_DIMENSION) {
+		printf("%s is %dx%d, cooked textures are at most %u on a side\n", args[1], width, height, COOKED_TEXTURE_MAX_DIMENSION);
+		stbi_image_free(pixels);
+		return 1;
+	}
+
+	u32 level_count = mipLevelCount((u32)width, (u32)height);
+	if(level_count > COOKED_TEXTURE_MAX_LEVELS) level_count = COOKED_TEXTURE_MAX_LEVELS;
+
+	u64 chain_size = mipChainSize((u32)width, (u32)height, level_count);
+	u8 *chain = (u8 *)malloc(chain_size);
+	if(chain == 0) {
+		printf("Couldn't allocate %.2fMB for the mip chain\n", chain_size / (1024.0f * 1024.0f));
+		stbi_image_free(pixels);
+		return 1;
+	}
+	memcpy(chain, pixels, (size_t)width * height * 4);
+	stbi_image_free(pixels);
+	generateMipChainRGBA8(chain, (u32)width, (u32)height, level_count);
+
+	CookedTextureHeader header = {};
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+	header.format = format;
+	header.width = (u32)width;
+	header.height = (u32)height;
+	header.level_count = level_count;
+	for(u32 level = 0; level < level_count; level++) {
+		header.level_offsets[level] = header.data_size;
+		header.level_sizes[level] = cookedTextureLevelSize(format, mipDimension(header.width, level), mipDimension(header.height, level));
+		header.data_size += header.level_sizes[level];
+	}
+
+	u8 *blocks = (u8 *)malloc(header.data_size);
+	if(blocks == 0) {
+		printf("Couldn't allocate %.2fMB for the blocks\n", header.data_size / (1024.0f * 1024.0f));
+		free(chain);
+		return 1;
+	}
+	u8 *level_pixels = chain;
+	for(u32 level = 0; level < level_count; level++) {
+		u32 level_width = mipDimension(header.width, level);
+		u32 level_height = mipDimension(header.height, level);
+		encodeLevel(format, level_pixels, level_width, level_height, blocks + header.level_offsets[level]);
+		level_pixels += (u64)level_width * level_height * 4;
+	}
+
+	FILE *file = fopen(args[2], "wb");
+	if(file == 0) {
+		printf("Couldn't open %s for writing\n", args[2]);
+		free(blocks);
+		free(chain);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(blocks, 1, (size_t)header.data_size, file);
+	fclose(file);
+
+	printf("Cooked %s -> %s (%s, %dx%d, %u mips, %.2fMB, was %.2fMB)\n", args[1], args[2], cookedTextureFormatName(format), width, height, level_count, header.data_size / (1024.0f * 1024.0f), chain_size / (1024.0f * 1024.0f));
+
+	free(blocks);
+	free(chain);
+	return 0;
+}
@@ -0,0 +1,3 @@
+#!/bin/bash
+# NOTE: run after build.sh, headless so it works on CI. Without a gpu point VK_ICD_FILENAMES at lavapipe's icd json.
+build/gpu_memory_test